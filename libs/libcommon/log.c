@@ -47,6 +47,13 @@
 #include <sys/thread.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#else
+#include <pthread.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#endif
 #endif
 
 #include "log.h"
@@ -56,8 +63,9 @@ static sys_mutex_t _log_lock;
 #define _LOCK_LOG() sysMutexLock(_log_lock, 0)
 #define _UNLOCK_LOG() sysMutexUnlock(_log_lock)
 #else
-#define _LOCK_LOG()
-#define _UNLOCK_LOG()
+static pthread_mutex_t _log_lock = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK_LOG() pthread_mutex_lock(&_log_lock)
+#define _UNLOCK_LOG() pthread_mutex_unlock(&_log_lock)
 #endif
 
 #define _PUT_LOG(fd, buf, nb)    { fwrite(buf, 1, nb, fd); fflush(fd); }
@@ -73,6 +81,103 @@ static int             output_time_stamp = 0;
 #define LINE_BUF_SIZE       512
 #define DEFAULT_BUF_SIZE    16384
 
+#ifndef __lv2ppu__
+
+/*
+ * Buffered logging: every thread formats its lines into a ring of its own,
+ * the log thread takes them out and writes them. Only the thread that logs
+ * moves the head of its ring and only the log thread moves the tail, so
+ * log_print() takes no lock. When a ring is full the thread that logs
+ * takes the log lock and writes the queued lines itself, no line is lost.
+ */
+#define LOG_RING_LINES      256
+#define LOG_DRAIN_MS        50
+
+#if defined(_MSC_VER)
+#define LOG_LOAD(p)         (*(p))          // volatile accesses are acquire/release with /volatile:ms
+#define LOG_STORE(p, v)     (*(p) = (v))
+#else
+#define LOG_LOAD(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define LOG_STORE(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+typedef struct
+{
+    time_t   time;
+    uint32_t size;
+    char     text[LINE_BUF_SIZE];
+}
+log_line_t;
+
+typedef struct log_ring_s
+{
+    struct log_ring_s *next;
+    long               tid;
+    volatile int       in_use;          // 0 once its thread has ended, it is reused when drained
+    volatile uint32_t  head;            // moved by the thread that logs
+    volatile uint32_t  tail;            // moved by whoever drains, under the log lock
+    log_line_t         lines[LOG_RING_LINES];
+}
+log_ring_t;
+
+static log_ring_t      *volatile log_rings = NULL;
+static pthread_mutex_t  log_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t    log_ring_key;
+static pthread_cond_t   log_drain_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t        log_drain_thread;
+static volatile int     log_draining = 0;
+static volatile int     log_drain_stop = 0;
+static int              log_flush_at_exit = 0;
+static time_t           log_stamp_time = (time_t) -1;
+static char             log_stamp[64];
+
+#endif
+
+static long current_thread_id(void)
+{
+#if defined(__lv2ppu__)
+    sys_ppu_thread_t me = 0;
+
+    sysThreadGetId(&me);
+    return (long) me;
+#elif defined(_WIN32)
+    return (long) GetCurrentThreadId();
+#elif defined(__linux__)
+    return (long) syscall(SYS_gettid);
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+
+    pthread_threadid_np(NULL, &tid);
+    return (long) tid;
+#else
+    return (long) (intptr_t) pthread_self();
+#endif
+}
+
+static void format_stamp(char *stamp, size_t size, time_t now)
+{
+    struct tm ts = *localtime(&now);
+
+    snprintf(stamp, size, "%04d-%02d-%02d %02d:%02d:%02d - ",
+             ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday,
+             ts.tm_hour, ts.tm_min, ts.tm_sec);
+}
+
+// formats a line and makes sure it ends with a newline, returns its length
+static uint32_t format_line(char *line, size_t size, const char *fmt, va_list ap)
+{
+    int nb = vsnprintf(line, size - 1, fmt, ap);
+
+    if (nb < 0)
+        nb = 0;
+    else if ((size_t) nb > size - 2)
+        nb = (int) size - 2;        // truncated
+    if (nb == 0 || line[nb - 1] != '\n')
+        line[nb++] = '\n';
+    line[nb] = '\0';
+    return (uint32_t) nb;
+}
+
 void log_init(void)
 {
     char             *ev = 0;
@@ -169,7 +274,7 @@ void log_destroy(void)
 {
     log_module_info_t *lm = logModules;
 
-    log_flush();
+    set_log_buffering(0);
 
     if (log_file && log_file != stdout && log_file != stderr)
     {
@@ -177,8 +282,14 @@ void log_destroy(void)
     }
     log_file = NULL;
 
-    if (log_buf)
-        free(log_buf);
+#ifndef __lv2ppu__
+    while (log_rings != NULL)
+    {
+        log_ring_t *next = log_rings->next;
+        free(log_rings);
+        log_rings = next;
+    }
+#endif
 
     while (lm != NULL)
     {
@@ -193,7 +304,6 @@ void log_destroy(void)
     sysMutexDestroy(_log_lock);
 #endif
 }
-
 static void set_log_module_level(log_module_info_t *lm)
 {
     char *ev;
@@ -276,153 +386,275 @@ int set_log_file(const char *file)
     return 0;
 }
 
-void set_log_buffering(int buffer_size)
+#ifndef __lv2ppu__
+
+static void release_ring(void *ring)
 {
-    log_flush();
+    ((log_ring_t *) ring)->in_use = 0;
+}
 
-    if (log_buf)
-        free(log_buf);
+// the ring of the calling thread, takes a drained one of an ended thread if there is one
+static log_ring_t *get_ring(void)
+{
+    log_ring_t *ring = (log_ring_t *) pthread_getspecific(log_ring_key);
 
-    if (buffer_size >= LINE_BUF_SIZE)
+    if (ring)
+        return ring;
+
+    pthread_mutex_lock(&log_rings_lock);
+    for (ring = log_rings; ring; ring = ring->next)
     {
-        logp    = log_buf = (char *) malloc(buffer_size);
-        log_endp = logp + buffer_size;
+        if (!ring->in_use && LOG_LOAD(&ring->tail) == ring->head)
+            break;
+    }
+    if (ring == NULL)
+    {
+        ring = (log_ring_t *) calloc(1, sizeof(log_ring_t));
+        if (ring)
+        {
+            // drain_rings() walks the list without log_rings_lock
+            ring->next = log_rings;
+            LOG_STORE(&log_rings, ring);
+        }
+    }
+    if (ring)
+    {
+        ring->tid = current_thread_id();
+        ring->in_use = 1;
     }
+    pthread_mutex_unlock(&log_rings_lock);
+
+    if (ring)
+        pthread_setspecific(log_ring_key, ring);
+    return ring;
 }
 
-void log_print(const char *fmt, ...)
+static void put_line(const char *line, size_t nb)
 {
-    va_list          ap;
-    char             line[LINE_BUF_SIZE];
-    char             *line_long = NULL;
-    uint32_t         nb_tid     = 0, nb;
-#ifdef __lv2ppu__
-    sys_ppu_thread_t me        = 0;
-#else
-    int              me     = 0;
-#endif
-    time_t           now;
-    struct tm        ts;
+    if (logp + nb > log_endp)
+    {
+        _PUT_LOG(log_file, log_buf, logp - log_buf);
+        logp = log_buf;
+    }
+    memcpy(logp, line, nb);
+    logp += nb;
+}
+
+// writes out the lines of all rings, _log_lock is held
+static void drain_rings(void)
+{
+    log_ring_t *ring;
+    char        prefix[64];
+    int         nb;
 
     if (!log_file)
-    {
         return;
-    }
 
-    if (output_time_stamp)
+    for (ring = LOG_LOAD(&log_rings); ring; ring = ring->next)
     {
-        time(&now);
-        ts = *localtime(&now);
+        uint32_t head = LOG_LOAD(&ring->head);
+        uint32_t tail = ring->tail;
+
+        for (; tail != head; tail++)
+        {
+            log_line_t *line = &ring->lines[tail % LOG_RING_LINES];
+
+            if (output_time_stamp)
+            {
+                // localtime() once a second
+                if (line->time != log_stamp_time)
+                {
+                    format_stamp(log_stamp, sizeof(log_stamp), line->time);
+                    log_stamp_time = line->time;
+                }
+                nb = snprintf(prefix, sizeof(prefix), "%s[%ld]: ", log_stamp, ring->tid);
+            }
+            else
+                nb = snprintf(prefix, sizeof(prefix), "[%ld]: ", ring->tid);
+            put_line(prefix, nb);
+            put_line(line->text, line->size);
+        }
+        LOG_STORE(&ring->tail, tail);
+    }
 
-        nb_tid = snprintf(line, sizeof(line) - 1,
-                          "%04d-%02d-%02d %02d:%02d:%02d - ",
-                          ts.tm_year, ts.tm_mon + 1, ts.tm_mday,
-                          ts.tm_hour, ts.tm_min, ts.tm_sec);
+    if (logp > log_buf)
+    {
+        _PUT_LOG(log_file, log_buf, logp - log_buf);
+        logp = log_buf;
     }
+}
 
-#ifdef __lv2ppu__
-    sysThreadGetId(&me);
-    nb_tid += snprintf(line + nb_tid, sizeof(line) - nb_tid - 1, "%ld[%p]: ", me, (void *) me);
+static void *drain_thread(void *arg)
+{
+    (void) arg;
+
+    _LOCK_LOG();
+    while (!log_drain_stop)
+    {
+        struct timespec until;
+
+        drain_rings();
+
+#if defined(_MSC_VER)
+        timespec_get(&until, TIME_UTC);
 #else
-    nb_tid += snprintf(line + nb_tid, sizeof(line) - nb_tid - 1, "[%d]: ", me);
+        clock_gettime(CLOCK_REALTIME, &until);
 #endif
+        until.tv_nsec += LOG_DRAIN_MS * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&log_drain_cond, &_log_lock, &until);
+    }
+    drain_rings();
+    _UNLOCK_LOG();
+    return NULL;
+}
 
-    va_start(ap, fmt);
-    nb = nb_tid + vsnprintf(line + nb_tid, sizeof(line) - nb_tid - 1, fmt, ap);
-    va_end(ap);
+// puts the line in the ring of the calling thread, the log thread writes it,
+//   return 0 if there is no ring and the caller has to write the line
+static int queue_line(const char *fmt, va_list ap)
+{
+    log_ring_t *ring = get_ring();
+    log_line_t *line;
+    uint32_t    head;
 
-    /*
-     * Check if we might have run out of buffer space (in case we have a
-     * long line), and malloc a buffer just this once.
-     */
-    if (nb == sizeof(line) - 2)
+    if (ring == NULL)
+        return 0;
+
+    head = ring->head;
+    if (head - LOG_LOAD(&ring->tail) >= LOG_RING_LINES)
     {
-        line_long = (char *) malloc(LINE_BUF_SIZE * 8);
-        va_start(ap, fmt);
-        vsnprintf(line_long, LINE_BUF_SIZE, fmt, ap);
-        va_end(ap);
-        /* If this failed, we'll fall back to writing the truncated line. */
+        // the log thread is behind, write out the queued lines here
+        _LOCK_LOG();
+        drain_rings();
+        _UNLOCK_LOG();
+        if (head - LOG_LOAD(&ring->tail) >= LOG_RING_LINES)
+            return 0;
     }
 
-    if (line_long)
+    line = &ring->lines[head % LOG_RING_LINES];
+    line->time = output_time_stamp ? time(NULL) : 0;
+    line->size = format_line(line->text, sizeof(line->text), fmt, ap);
+    LOG_STORE(&ring->head, head + 1);
+
+    // wake the log thread early when the ring fills up, no lock so a wakeup may be missed
+    if (head + 1 - LOG_LOAD(&ring->tail) == LOG_RING_LINES / 2)
+        pthread_cond_signal(&log_drain_cond);
+    return 1;
+}
+
+#endif
+
+void set_log_buffering(int buffer_size)
+{
+#ifndef __lv2ppu__
+    if (log_draining)
     {
-        nb = strlen(line_long);
         _LOCK_LOG();
-        if (log_buf != 0)
-        {
-            _PUT_LOG(log_file, log_buf, logp - log_buf);
-            logp = log_buf;
-        }
-        /*
-         * Write out the thread id (with an optional timestamp) and the
-         * malloc'ed buffer.
-         */
-        _PUT_LOG(log_file, line, nb_tid);
-        _PUT_LOG(log_file, line_long, nb);
-        /* Ensure there is a trailing newline. */
-        if (!nb || (line_long[nb - 1] != '\n'))
-        {
-            char eol[2];
-            eol[0] = '\n';
-            eol[1] = '\0';
-            _PUT_LOG(log_file, eol, 1);
-        }
+        log_drain_stop = 1;
+        pthread_cond_signal(&log_drain_cond);
         _UNLOCK_LOG();
-        free(line_long);
+        pthread_join(log_drain_thread, NULL);
+        log_draining = 0;
+        pthread_key_delete(log_ring_key);
     }
-    else
+#endif
+
+    if (log_buf)
+        free(log_buf);
+    log_buf = NULL;
+
+#ifndef __lv2ppu__
+    if (buffer_size >= LINE_BUF_SIZE)
     {
-        /* Ensure there is a trailing newline. */
-        if (nb && (line[nb - 1] != '\n'))
-        {
-            line[nb++] = '\n';
-            line[nb]   = '\0';
-        }
-        _LOCK_LOG();
-        if (log_buf == 0)
+        logp    = log_buf = (char *) malloc(buffer_size);
+        log_endp = logp + buffer_size;
+        log_drain_stop = 0;
+        if (log_buf && pthread_key_create(&log_ring_key, release_ring) == 0)
         {
-            _PUT_LOG(log_file, line, nb);
+            if (pthread_create(&log_drain_thread, NULL, drain_thread, NULL) == 0)
+                log_draining = 1;
+            else
+                pthread_key_delete(log_ring_key);
         }
-        else
+        // the queued lines of a program that exits without log_destroy()
+        if (log_draining && !log_flush_at_exit)
         {
-            /* If nb can't fit into logBuf, write out logBuf first. */
-            if (logp + nb > log_endp)
-            {
-                _PUT_LOG(log_file, log_buf, logp - log_buf);
-                logp = log_buf;
-            }
-            /* nb is guaranteed to fit into logBuf. */
-            memcpy(logp, line, nb);
-            logp += nb;
+            atexit(log_flush);
+            log_flush_at_exit = 1;
         }
-        _UNLOCK_LOG();
     }
-    log_flush();
+#else
+    (void) buffer_size;
+#endif
+}
+
+void log_print(const char *fmt, ...)
+{
+    va_list          ap;
+    char             line[LINE_BUF_SIZE];
+    uint32_t         nb = 0;
+
+    if (!log_file)
+    {
+        return;
+    }
+
+#ifndef __lv2ppu__
+    if (log_draining)
+    {
+        int queued;
+
+        va_start(ap, fmt);
+        queued = queue_line(fmt, ap);
+        va_end(ap);
+        if (queued)
+            return;
+    }
+#endif
+
+    // unbuffered, the caller writes the line
+    if (output_time_stamp)
+    {
+        format_stamp(line, 64, time(NULL));
+        nb = strlen(line);
+    }
+    nb += snprintf(line + nb, 64, "[%ld]: ", current_thread_id());
+    va_start(ap, fmt);
+    nb += format_line(line + nb, sizeof(line) - nb, fmt, ap);
+    va_end(ap);
+
+    _LOCK_LOG();
+    _PUT_LOG(log_file, line, nb);
+    _UNLOCK_LOG();
 }
 
 void log_flush(void)
 {
-    if (log_buf && log_file)
+#ifndef __lv2ppu__
+    if (log_draining)
     {
         _LOCK_LOG();
-        if (logp > log_buf)
-        {
-            _PUT_LOG(log_file, log_buf, logp - log_buf);
-            logp = log_buf;
-        }
+        drain_rings();
         _UNLOCK_LOG();
     }
+#endif
 }
 
 void log_abort(void)
 {
     log_print("Aborting");
+    log_flush();
     abort();
 }
 
 void log_assert(const char *s, const char *file, int ln)
 {
     log_print("Assertion failure: %s, at %s:%d\n", s, file, ln);
+    log_flush();
     fprintf(stderr, "Assertion failure: %s, at %s:%d\n", s, file, ln);
     fflush(stderr);
     abort();
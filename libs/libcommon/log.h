@@ -85,7 +85,13 @@ extern "C" {
 ** set LOG_MODULES=all:5
 **
 ** The special LogModule name "sync" tells the log service to do
-** unbuffered logging.
+** unbuffered logging: each LOG() writes its line before it returns.
+**
+** Otherwise each thread puts its lines in a ring of its own without
+** locking and a log thread writes them out every 50 ms (sooner when a
+** ring fills up). A thread that logs faster than that loses lines, the
+** log tells how many. The timestamp is read once a line and formatted
+** once a second, the thread id is the one of the OS.
 **
 ** The special LogModule name "bufsize:<size>" tells the log service 
 ** to set the log buffer to <size>.
@@ -199,11 +205,19 @@ void log_assert(const char *s, const char *file, int ln);
 
 #define DEBUG 1
 
+/*
+** The highest level compiled in, the LOG() calls above it compile to
+** nothing, e.g. -DLOG_COMPILE_LEVEL=LOG_ERROR keeps the errors only.
+*/
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_MAX
+#endif
+
 #if defined(DEBUG) || defined(FORCE_LOG)
 #define LOGGING    1
 
 #define LOG_TEST(_module, _level) \
-    ((_module)->level >= (_level))
+    ((_level) <= LOG_COMPILE_LEVEL && (_module)->level >= (_level))
 
 /*
 ** Log something.
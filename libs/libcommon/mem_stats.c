@@ -0,0 +1,205 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef __lv2ppu__
+#include <pthread.h>
+#endif
+
+#include "logging.h"
+#include "mem_stats.h"
+
+#define MAX_SITES       32
+// in front of a yarn block, keeps the alignment of malloc()
+#define YARN_HEADER     16
+
+typedef struct
+{
+    const char *site;
+    int         subsystem;
+    uint64_t    allocs;
+    uint64_t    bytes;
+}
+site_stats_t;
+
+static const char *subsystem_names[MEM_SUBSYSTEMS] =
+{
+    "yarn", "buffer pools", "dst decoders", "output"
+};
+
+static mem_subsystem_totals_t subsystems[MEM_SUBSYSTEMS];
+static uint64_t     total_current = 0;
+static uint64_t     total_peak = 0;
+static site_stats_t sites[MAX_SITES];
+static int          site_count = 0;
+static uint64_t     other_sites = 0;    // large allocations of sites past MAX_SITES
+
+#ifdef __lv2ppu__
+#define _LOCK_MEM()
+#define _UNLOCK_MEM()
+#else
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK_MEM() pthread_mutex_lock(&mem_lock)
+#define _UNLOCK_MEM() pthread_mutex_unlock(&mem_lock)
+#endif
+
+static void add_site(int subsystem, size_t size, const char *site)
+{
+    int i;
+
+    for (i = 0; i < site_count; i++)
+    {
+        if (sites[i].site == site)
+            break;
+    }
+    if (i == site_count)
+    {
+        if (site_count == MAX_SITES)
+        {
+            other_sites++;
+            return;
+        }
+        sites[i].site = site;
+        sites[i].subsystem = subsystem;
+        site_count++;
+    }
+    sites[i].allocs++;
+    sites[i].bytes += size;
+}
+
+void mem_stats_alloc(int subsystem, size_t size, const char *site)
+{
+    mem_subsystem_totals_t *s;
+
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEMS)
+        return;
+
+    _LOCK_MEM();
+    s = &subsystems[subsystem];
+    s->current += size;
+    s->allocs++;
+    if (s->current > s->peak)
+        s->peak = s->current;
+    total_current += size;
+    if (total_current > total_peak)
+        total_peak = total_current;
+    if (size >= MEM_STATS_LARGE && site)
+        add_site(subsystem, size, site);
+    _UNLOCK_MEM();
+}
+
+void mem_stats_free(int subsystem, size_t size)
+{
+    mem_subsystem_totals_t *s;
+
+    if (subsystem < 0 || subsystem >= MEM_SUBSYSTEMS)
+        return;
+
+    _LOCK_MEM();
+    s = &subsystems[subsystem];
+    s->current -= size <= s->current ? size : s->current;
+    s->frees++;
+    total_current -= size <= total_current ? size : total_current;
+    _UNLOCK_MEM();
+}
+
+void *mem_stats_yarn_malloc(size_t size)
+{
+    char *block = (char *) malloc(YARN_HEADER + size);
+
+    if (block == NULL)
+        return NULL;
+    *(size_t *) block = size;
+    mem_stats_alloc(MEM_YARN, size, NULL);
+    return block + YARN_HEADER;
+}
+
+void mem_stats_yarn_free(void *block)
+{
+    char *header;
+
+    if (block == NULL)
+        return;
+    header = (char *) block - YARN_HEADER;
+    mem_stats_free(MEM_YARN, *(size_t *) header);
+    free(header);
+}
+
+void mem_stats_reset_peaks(void)
+{
+    int i;
+
+    _LOCK_MEM();
+    for (i = 0; i < MEM_SUBSYSTEMS; i++)
+        subsystems[i].peak = subsystems[i].current;
+    total_peak = total_current;
+    _UNLOCK_MEM();
+}
+
+uint64_t mem_stats_totals(mem_subsystem_totals_t totals[MEM_SUBSYSTEMS])
+{
+    uint64_t peak;
+
+    _LOCK_MEM();
+    memcpy(totals, subsystems, sizeof(subsystems));
+    peak = total_peak;
+    _UNLOCK_MEM();
+
+    return peak;
+}
+
+const char *mem_stats_subsystem_name(int subsystem)
+{
+    return subsystem >= 0 && subsystem < MEM_SUBSYSTEMS ? subsystem_names[subsystem] : "";
+}
+
+void mem_stats_log(void)
+{
+    mem_subsystem_totals_t totals[MEM_SUBSYSTEMS];
+    site_stats_t copy[MAX_SITES];
+    uint64_t peak, other;
+    int i, count;
+
+    peak = mem_stats_totals(totals);
+    _LOCK_MEM();
+    count = site_count;
+    memcpy(copy, sites, sizeof(copy));
+    other = other_sites;
+    _UNLOCK_MEM();
+
+    LOG(lm_main, LOG_NOTICE, ("memory peak: %.1f KB", peak / 1024.0));
+    for (i = 0; i < MEM_SUBSYSTEMS; i++)
+    {
+        LOG(lm_main, LOG_NOTICE, ("memory of %s: peak %.1f KB, now %.1f KB, %llu allocations, %llu frees",
+            subsystem_names[i], totals[i].peak / 1024.0, totals[i].current / 1024.0,
+            (unsigned long long) totals[i].allocs, (unsigned long long) totals[i].frees));
+    }
+    for (i = 0; i < count; i++)
+    {
+        LOG(lm_main, LOG_NOTICE, ("large allocations at %s (%s): %llu for %.1f KB",
+            copy[i].site, subsystem_names[copy[i].subsystem],
+            (unsigned long long) copy[i].allocs, copy[i].bytes / 1024.0));
+    }
+    if (other)
+        LOG(lm_main, LOG_NOTICE, ("large allocations at other sites: %llu", (unsigned long long) other));
+}
@@ -0,0 +1,105 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __MEM_STATS_H__
+#define __MEM_STATS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bytes held by each subsystem of a rip, now and at the peak, to size the
+ * buffers and to catch one that grows without bound. The subsystems report
+ * what they allocate and free, allocations of MEM_STATS_LARGE bytes or more
+ * are also counted per call site.
+ *
+ * buf = malloc(size);
+ * mem_stats_alloc(MEM_OUTPUT, size, MEM_SITE);
+ * ...
+ * free(buf);
+ * mem_stats_free(MEM_OUTPUT, size);
+ */
+enum
+{
+    MEM_YARN,               // locks and threads of yarn (yarn_mem)
+    MEM_BUFFER_POOL,        // spaces of the dst decoder buffer pools
+    MEM_DST_DECODER,        // tables of the DST decoders (DST_InitDecoder)
+    MEM_OUTPUT,             // read buffers, write caches and format handlers
+
+    MEM_SUBSYSTEMS
+};
+
+#define MEM_STATS_LARGE     (64 * 1024)
+
+#define MEM_STR_(x) #x
+#define MEM_STR(x) MEM_STR_(x)
+#define MEM_SITE __FILE__ ":" MEM_STR(__LINE__)
+
+/**
+ * site must be a string literal (only the pointer is kept), NULL for none
+ */
+void mem_stats_alloc(int subsystem, size_t size, const char *site);
+void mem_stats_free(int subsystem, size_t size);
+
+/**
+ * malloc() and free() that count into MEM_YARN, for yarn_mem() before the
+ * first lock or thread of yarn is made (the size is kept in front of the block)
+ */
+void *mem_stats_yarn_malloc(size_t size);
+void mem_stats_yarn_free(void *block);
+
+typedef struct
+{
+    uint64_t current;       // bytes held now
+    uint64_t peak;          // most bytes held since the reset
+    uint64_t allocs;
+    uint64_t frees;
+}
+mem_subsystem_totals_t;
+
+/**
+ * the peaks start again from the bytes held now
+ */
+void mem_stats_reset_peaks(void);
+
+/**
+ * copies the totals of every subsystem, returns the peak of all of them together
+ */
+uint64_t mem_stats_totals(mem_subsystem_totals_t totals[MEM_SUBSYSTEMS]);
+
+/**
+ * the name of a subsystem in the reports ("yarn", "buffer pools", ...)
+ */
+const char *mem_stats_subsystem_name(int subsystem);
+
+/**
+ * logs the totals and the call sites of the large allocations
+ */
+void mem_stats_log(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* __MEM_STATS_H__ */
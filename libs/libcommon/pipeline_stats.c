@@ -0,0 +1,363 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <windows.h>
+#elif !defined(__lv2ppu__)
+#include <time.h>
+#endif
+#ifndef __lv2ppu__
+#include <pthread.h>
+#endif
+
+#include "pipeline_stats.h"
+
+// latency bucket i counts the periods of [2^i, 2^(i+1)) us, the first one includes < 1 us
+#define LATENCY_BUCKETS     24
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t busy_ns;
+    uint64_t idle_ns;
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t depth_sum;
+    uint64_t depth_samples;
+    uint32_t depth_max;
+    uint64_t latency[LATENCY_BUCKETS];
+}
+stage_stats_t;
+
+static const char *stage_names[PIPELINE_STAGES] =
+{
+    "read", "decrypt", "parse", "decode", "reorder", "write"
+};
+
+// the stages of one thread, only that thread adds to them
+typedef struct stats_block_s
+{
+    struct stats_block_s *next;
+    volatile int          in_use;       // 0 once its thread has ended, the next new thread takes it over
+    stage_stats_t         stages[PIPELINE_STAGES];
+}
+stats_block_t;
+
+static int            stats_enabled = 0;
+static uint64_t       stats_started;
+
+// the stats are only kept by the desktop tools
+#ifdef __lv2ppu__
+static stage_stats_t   stats_stages[PIPELINE_STAGES];
+#define _LOCK_STATS()
+#define _UNLOCK_STATS()
+#define get_stages()   (stats_stages)
+#define merge_stages(merged) memcpy(merged, stats_stages, sizeof(stats_stages))
+#else
+// every thread that added to the stats has a block, the reports merge them;
+// the lock only guards the list, the events never take it after the first one
+static stats_block_t  *stats_blocks = NULL;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t   stats_key;
+static pthread_once_t  stats_key_once = PTHREAD_ONCE_INIT;
+#define _LOCK_STATS() pthread_mutex_lock(&stats_lock)
+#define _UNLOCK_STATS() pthread_mutex_unlock(&stats_lock)
+
+static void release_block(void *block)
+{
+    ((stats_block_t *) block)->in_use = 0;
+}
+
+static void create_key(void)
+{
+    pthread_key_create(&stats_key, release_block);
+}
+
+// the block of the calling thread, 0 when there is no memory for it
+static stage_stats_t *get_stages(void)
+{
+    stats_block_t *block;
+
+    pthread_once(&stats_key_once, create_key);
+    block = (stats_block_t *) pthread_getspecific(stats_key);
+    if (block)
+        return block->stages;
+
+    // the counts of an ended thread stay in its block, they are merged as before
+    _LOCK_STATS();
+    for (block = stats_blocks; block; block = block->next)
+    {
+        if (!block->in_use)
+            break;
+    }
+    if (block == NULL)
+    {
+        block = (stats_block_t *) calloc(1, sizeof(stats_block_t));
+        if (block)
+        {
+            block->next = stats_blocks;
+            stats_blocks = block;
+        }
+    }
+    if (block)
+        block->in_use = 1;
+    _UNLOCK_STATS();
+
+    if (!block)
+        return 0;
+    pthread_setspecific(stats_key, block);
+    return block->stages;
+}
+
+/**
+ * sums the blocks of all threads, the lock is held. The threads keep adding
+ * meanwhile, a report taken during a rip may miss the events in flight.
+ */
+static void merge_stages(stage_stats_t merged[PIPELINE_STAGES])
+{
+    stats_block_t *block;
+    int i, j;
+
+    memset(merged, 0, PIPELINE_STAGES * sizeof(stage_stats_t));
+    for (block = stats_blocks; block; block = block->next)
+    {
+        for (i = 0; i < PIPELINE_STAGES; i++)
+        {
+            stage_stats_t *s = &block->stages[i];
+            stage_stats_t *m = &merged[i];
+
+            m->calls += s->calls;
+            m->busy_ns += s->busy_ns;
+            m->idle_ns += s->idle_ns;
+            m->bytes += s->bytes;
+            m->frames += s->frames;
+            m->depth_sum += s->depth_sum;
+            m->depth_samples += s->depth_samples;
+            if (s->depth_max > m->depth_max)
+                m->depth_max = s->depth_max;
+            for (j = 0; j < LATENCY_BUCKETS; j++)
+                m->latency[j] += s->latency[j];
+        }
+    }
+}
+#endif
+
+uint64_t pipeline_stats_now(void)
+{
+#if defined(WIN32) || defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) ((double) counter.QuadPart * 1e9 / (double) frequency.QuadPart);
+#elif defined(__lv2ppu__)
+    return 0;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+void pipeline_stats_enable(int enable)
+{
+#ifdef __lv2ppu__
+    (void) enable;
+#else
+    stats_enabled = enable;
+    pipeline_stats_reset();
+#endif
+}
+
+int pipeline_stats_enabled(void)
+{
+    return stats_enabled;
+}
+
+void pipeline_stats_reset(void)
+{
+#ifdef __lv2ppu__
+    memset(stats_stages, 0, sizeof(stats_stages));
+#else
+    stats_block_t *block;
+
+    // between rips, no thread is adding to its block
+    _LOCK_STATS();
+    for (block = stats_blocks; block; block = block->next)
+        memset(block->stages, 0, sizeof(block->stages));
+    stats_started = pipeline_stats_now();
+    _UNLOCK_STATS();
+#endif
+}
+
+uint64_t pipeline_stats_clock(void)
+{
+    // never 0 when enabled, a start of 0 means not measured
+    return stats_enabled ? pipeline_stats_now() | 1 : 0;
+}
+
+void pipeline_stats_busy(int stage, uint64_t start, uint64_t bytes, uint32_t frames)
+{
+    stage_stats_t *stages;
+    uint64_t elapsed, us;
+    int bucket = 0;
+
+    if (start == 0 || stage < 0 || stage >= PIPELINE_STAGES)
+        return;
+
+    elapsed = pipeline_stats_now() - start;
+    for (us = elapsed / 1000; us > 1 && bucket < LATENCY_BUCKETS - 1; us >>= 1)
+        bucket++;
+
+    stages = get_stages();
+    if (!stages)
+        return;
+    stages[stage].calls++;
+    stages[stage].busy_ns += elapsed;
+    stages[stage].bytes += bytes;
+    stages[stage].frames += frames;
+    stages[stage].latency[bucket]++;
+}
+
+void pipeline_stats_idle(int stage, uint64_t start)
+{
+    stage_stats_t *stages;
+
+    if (start == 0 || stage < 0 || stage >= PIPELINE_STAGES)
+        return;
+
+    stages = get_stages();
+    if (stages)
+        stages[stage].idle_ns += pipeline_stats_now() - start;
+}
+
+void pipeline_stats_depth(int stage, uint32_t depth)
+{
+    stage_stats_t *stages;
+
+    if (!stats_enabled || stage < 0 || stage >= PIPELINE_STAGES)
+        return;
+
+    stages = get_stages();
+    if (!stages)
+        return;
+    stages[stage].depth_sum += depth;
+    stages[stage].depth_samples++;
+    if (depth > stages[stage].depth_max)
+        stages[stage].depth_max = depth;
+}
+
+double pipeline_stats_totals(pipeline_stage_totals_t totals[PIPELINE_STAGES])
+{
+    stage_stats_t stages[PIPELINE_STAGES];
+    double wall;
+    int i;
+
+    _LOCK_STATS();
+    merge_stages(stages);
+    for (i = 0; i < PIPELINE_STAGES; i++)
+    {
+        totals[i].busy_seconds = (double) stages[i].busy_ns / 1e9;
+        totals[i].idle_seconds = (double) stages[i].idle_ns / 1e9;
+        totals[i].bytes = stages[i].bytes;
+        totals[i].frames = stages[i].frames;
+    }
+    wall = (double) (pipeline_stats_now() - stats_started) / 1e9;
+    _UNLOCK_STATS();
+
+    return wall;
+}
+
+const char *pipeline_stats_stage_name(int stage)
+{
+    return stage >= 0 && stage < PIPELINE_STAGES ? stage_names[stage] : "";
+}
+
+static void write_json_string(FILE *fd, const char *s)
+{
+    fputc('"', fd);
+    for (; s && *s; s++)
+    {
+        unsigned char c = (unsigned char) *s;
+
+        if (c == '"' || c == '\\')
+            fprintf(fd, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fd, "\\u%04x", c);
+        else
+            fputc(c, fd);
+    }
+    fputc('"', fd);
+}
+
+int pipeline_stats_write_json(FILE *fd, const char *input, int jobs)
+{
+    stage_stats_t copy[PIPELINE_STAGES];
+    double wall;
+    int i, j, last;
+
+    _LOCK_STATS();
+    merge_stages(copy);
+    wall = (double) (pipeline_stats_now() - stats_started) / 1e9;
+    _UNLOCK_STATS();
+
+    if (wall <= 0.0)
+        wall = 1e-9;
+
+    fprintf(fd, "{\n  \"input\": ");
+    write_json_string(fd, input);
+    fprintf(fd, ",\n  \"jobs\": %d,\n  \"wall_seconds\": %.6f,\n  \"stages\": {\n", jobs, wall);
+
+    for (i = 0; i < PIPELINE_STAGES; i++)
+    {
+        stage_stats_t *s = &copy[i];
+
+        fprintf(fd, "    \"%s\": {\n", stage_names[i]);
+        fprintf(fd, "      \"calls\": %llu,\n", (unsigned long long) s->calls);
+        fprintf(fd, "      \"busy_seconds\": %.6f,\n", (double) s->busy_ns / 1e9);
+        fprintf(fd, "      \"idle_seconds\": %.6f,\n", (double) s->idle_ns / 1e9);
+        fprintf(fd, "      \"bytes\": %llu,\n", (unsigned long long) s->bytes);
+        fprintf(fd, "      \"frames\": %llu,\n", (unsigned long long) s->frames);
+        fprintf(fd, "      \"bytes_per_second\": %.1f,\n", (double) s->bytes / wall);
+        fprintf(fd, "      \"frames_per_second\": %.1f,\n", (double) s->frames / wall);
+        fprintf(fd, "      \"queue_depth_max\": %u,\n", s->depth_max);
+        fprintf(fd, "      \"queue_depth_avg\": %.2f,\n", s->depth_samples ? (double) s->depth_sum / (double) s->depth_samples : 0.0);
+
+        // up to the last bucket used
+        for (last = LATENCY_BUCKETS - 1; last > 0 && s->latency[last] == 0; last--)
+            ;
+        fprintf(fd, "      \"latency_us_log2\": [");
+        for (j = 0; j <= last; j++)
+            fprintf(fd, "%s%llu", j ? ", " : "", (unsigned long long) s->latency[j]);
+        fprintf(fd, "]\n    }%s\n", i < PIPELINE_STAGES - 1 ? "," : "");
+    }
+    fprintf(fd, "  }\n}");
+
+    return ferror(fd) ? -1 : 0;
+}
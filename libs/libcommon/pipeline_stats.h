@@ -0,0 +1,115 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PIPELINE_STATS_H__
+#define __PIPELINE_STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Time, bytes and frames spent in each stage of a rip, to tell whether the
+ * input, the DST decoders or the output is the bottleneck. Disabled by
+ * default, then pipeline_stats_clock() returns 0 and the other calls return
+ * right away.
+ *
+ * uint64_t start = pipeline_stats_clock();
+ * blocks = sacd_read_block_raw(sacd, lsn, count, buffer);
+ * pipeline_stats_busy(PIPELINE_READ, start, blocks * SACD_LSN_SIZE, 0);
+ */
+enum
+{
+    PIPELINE_READ,          // sectors (or frames of a server) read from the input
+    PIPELINE_DECRYPT,       // sectors decrypted (PS3 drives)
+    PIPELINE_PARSE,         // audio frames parsed from the sectors, includes handing them over
+    PIPELINE_DECODE,        // DST frames decoded, idle = decode threads waiting for frames
+    PIPELINE_REORDER,       // decoded frames waiting for their turn, idle = write thread waiting
+    PIPELINE_WRITE,         // format handler conversion and file writes
+
+    PIPELINE_STAGES
+};
+
+void pipeline_stats_enable(int enable);
+int pipeline_stats_enabled(void);
+
+/**
+ * clears all stages, the wall time of the report starts here
+ */
+void pipeline_stats_reset(void);
+
+/**
+ * monotonic time in ns, 0 when disabled
+ */
+uint64_t pipeline_stats_clock(void);
+
+/**
+ * monotonic time in ns, also when disabled (0 on the PS3)
+ */
+uint64_t pipeline_stats_now(void);
+
+/**
+ * adds a busy period that started at start (pipeline_stats_clock()),
+ * its length also goes into the latency histogram of the stage
+ */
+void pipeline_stats_busy(int stage, uint64_t start, uint64_t bytes, uint32_t frames);
+
+/**
+ * adds an idle period (waiting for work) that started at start
+ */
+void pipeline_stats_idle(int stage, uint64_t start);
+
+/**
+ * samples the depth of the queue in front of a stage
+ */
+void pipeline_stats_depth(int stage, uint32_t depth);
+
+typedef struct
+{
+    double   busy_seconds;
+    double   idle_seconds;
+    uint64_t bytes;
+    uint64_t frames;
+}
+pipeline_stage_totals_t;
+
+/**
+ * copies the totals of every stage, returns the wall time since the reset in seconds
+ */
+double pipeline_stats_totals(pipeline_stage_totals_t totals[PIPELINE_STAGES]);
+
+/**
+ * the name of a stage in the reports ("read", "decode", ...)
+ */
+const char *pipeline_stats_stage_name(int stage);
+
+/**
+ * writes the stages as a JSON object, returns 0 on success
+ */
+int pipeline_stats_write_json(FILE *fd, const char *input, int jobs);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* __PIPELINE_STATS_H__ */
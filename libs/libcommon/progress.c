@@ -0,0 +1,183 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef __lv2ppu__
+#include <pthread.h>
+#endif
+#if defined(WIN32) || defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "pipeline_stats.h"
+#include "progress.h"
+
+static volatile int64_t counters[PROGRESS_COUNTERS];
+
+#if defined(_MSC_VER)
+#define PROGRESS_ADD(p, n)  InterlockedExchangeAdd64((volatile LONG64 *) (p), (n))
+#else
+#define PROGRESS_ADD(p, n)  __sync_fetch_and_add(p, n)
+#endif
+
+void progress_add(int counter, int64_t n)
+{
+    if (counter >= 0 && counter < PROGRESS_COUNTERS)
+        PROGRESS_ADD(&counters[counter], n);
+}
+
+int64_t progress_read(int counter)
+{
+    if (counter < 0 || counter >= PROGRESS_COUNTERS)
+        return 0;
+    return PROGRESS_ADD(&counters[counter], 0);
+}
+
+#ifndef __lv2ppu__
+
+static pthread_mutex_t     reporter_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t      reporter_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t           reporter_thread;
+static int                 reporter_running = 0;
+static int                 reporter_stop = 0;
+static int                 reporter_interval_ms;
+static progress_callback_t reporter_callback;
+static void               *reporter_userdata;
+static progress_sample_t   last_sample;
+static uint64_t            started;
+
+static void take_sample(int final)
+{
+    progress_sample_t sample;
+    double seconds = (double) (pipeline_stats_now() - started) / 1e9;
+    int i;
+
+    for (i = 0; i < PROGRESS_COUNTERS; i++)
+    {
+        sample.counters[i] = progress_read(i);
+        sample.deltas[i] = sample.counters[i] - last_sample.counters[i];
+    }
+    sample.seconds = seconds;
+    sample.interval = seconds - last_sample.seconds;
+    sample.final = final;
+    last_sample = sample;
+
+    reporter_callback(&sample, reporter_userdata);
+}
+
+static void *reporter(void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&reporter_lock);
+    while (!reporter_stop)
+    {
+        struct timespec until;
+
+#if defined(_MSC_VER)
+        timespec_get(&until, TIME_UTC);
+#else
+        clock_gettime(CLOCK_REALTIME, &until);
+#endif
+        until.tv_sec += reporter_interval_ms / 1000;
+        until.tv_nsec += (reporter_interval_ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        while (!reporter_stop && pthread_cond_timedwait(&reporter_cond, &reporter_lock, &until) == 0)
+            ;
+        if (reporter_stop)
+            break;
+
+        // the callback may print, the lock is only for the stop flag
+        pthread_mutex_unlock(&reporter_lock);
+        take_sample(0);
+        pthread_mutex_lock(&reporter_lock);
+    }
+    pthread_mutex_unlock(&reporter_lock);
+
+    take_sample(1);
+    return NULL;
+}
+
+int progress_start(int interval_ms, progress_callback_t callback, void *userdata)
+{
+    int i;
+
+    progress_stop();
+
+    for (i = 0; i < PROGRESS_COUNTERS; i++)
+        PROGRESS_ADD(&counters[i], -progress_read(i));
+    memset(&last_sample, 0, sizeof(last_sample));
+    started = pipeline_stats_now();
+
+    if (callback == NULL || interval_ms <= 0)
+        return -1;
+
+    reporter_callback = callback;
+    reporter_userdata = userdata;
+    reporter_interval_ms = interval_ms;
+    reporter_stop = 0;
+    if (pthread_create(&reporter_thread, NULL, reporter, NULL) != 0)
+        return -1;
+    reporter_running = 1;
+    return 0;
+}
+
+void progress_stop(void)
+{
+    if (!reporter_running)
+        return;
+
+    pthread_mutex_lock(&reporter_lock);
+    reporter_stop = 1;
+    pthread_cond_signal(&reporter_cond);
+    pthread_mutex_unlock(&reporter_lock);
+    pthread_join(reporter_thread, NULL);
+    reporter_running = 0;
+}
+
+#else
+
+// not on the PS3, scarletbook_output_create() takes a progress callback there
+
+int progress_start(int interval_ms, progress_callback_t callback, void *userdata)
+{
+    int i;
+
+    (void) interval_ms;
+    (void) callback;
+    (void) userdata;
+    for (i = 0; i < PROGRESS_COUNTERS; i++)
+        PROGRESS_ADD(&counters[i], -progress_read(i));
+    return -1;
+}
+
+void progress_stop(void)
+{
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PROGRESS_H__
+#define __PROGRESS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Progress of an extraction. The pipeline adds to atomic counters and a
+ * reporter thread samples them at a fixed rate and hands the sample to a
+ * callback, so the reading, decoding and writing threads never wait for the
+ * console.
+ *
+ * progress_start(250, show_progress, NULL);
+ * ...
+ * progress_add(PROGRESS_SECTORS, blocks);      // from any thread
+ * ...
+ * progress_stop();                             // one last (final) sample
+ *
+ * The counters can be added to without a reporter (and on the PS3, that
+ * has no reporter thread).
+ */
+enum
+{
+    PROGRESS_TOTAL_SECTORS, // sectors of the queued tracks
+    PROGRESS_SECTORS,       // sectors read (or frames of a server turned into sectors)
+    PROGRESS_FRAMES,        // audio frames parsed
+    PROGRESS_TOTAL_TRACKS,
+    PROGRESS_TRACKS,        // tracks done
+    PROGRESS_DECODE_QUEUE,  // DST frames waiting for a decode thread, of all decoders
+
+    PROGRESS_COUNTERS
+};
+
+typedef struct
+{
+    int64_t  counters[PROGRESS_COUNTERS];   // at the sample
+    int64_t  deltas[PROGRESS_COUNTERS];     // since the previous sample
+    double   seconds;                       // since progress_start()
+    double   interval;                      // since the previous sample
+    int      final;                         // 1 for the sample of progress_stop()
+}
+progress_sample_t;
+
+typedef void (*progress_callback_t)(const progress_sample_t *sample, void *userdata);
+
+void progress_add(int counter, int64_t n);
+
+int64_t progress_read(int counter);
+
+/**
+ * clears the counters and calls callback every interval_ms from a thread of
+ * its own, returns 0 on success
+ */
+int progress_start(int interval_ms, progress_callback_t callback, void *userdata);
+
+/**
+ * stops the reporter, its callback gets a last sample with final set
+ */
+void progress_stop(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* __PROGRESS_H__ */
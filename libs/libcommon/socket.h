@@ -102,6 +102,15 @@ const char *socket_strerror(int err);
 int socket_send(p_socket ps, const char *data, size_t count, 
         size_t *sent, int flags, p_timeout tm);
 int socket_recv(p_socket ps, char *data, size_t count, size_t *got, int flags, p_timeout tm);
+
+/* gather send, keeps going until every buffer went out or an error occurs */
+#define SOCKET_MAX_IOBUF 16
+typedef struct t_iobuf_ {
+    const char *data;
+    size_t count;
+} t_iobuf;
+typedef t_iobuf *p_iobuf;
+int socket_sendv(p_socket ps, const t_iobuf *bufs, int nbufs, size_t *sent, p_timeout tm);
 const char *socket_ioerror(p_socket ps, int err);
 
 int socket_gethostbyaddr(const char *addr, socklen_t len, struct hostent **hp);
@@ -0,0 +1,296 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef __lv2ppu__
+#include <pthread.h>
+#endif
+
+#include "pipeline_stats.h"
+#include "trace_events.h"
+
+volatile int trace_events_on = 0;
+
+#ifndef __lv2ppu__
+
+#if defined(_MSC_VER)
+#define TRACE_TLS __declspec(thread)
+#else
+#define TRACE_TLS __thread
+#endif
+
+#define TRACE_CHUNK_EVENTS  4096
+#define TRACE_MAX_CHUNKS    2048        // 256 MB, the events after that are dropped
+#define TRACE_NAME_SIZE     32
+
+typedef struct
+{
+    const char *name;
+    uint64_t    ts;
+    int64_t     arg;
+    char        phase;
+}
+trace_event_t;
+
+typedef struct trace_chunk_s
+{
+    struct trace_chunk_s *next;
+    int                   count;
+    trace_event_t         events[TRACE_CHUNK_EVENTS];
+}
+trace_chunk_t;
+
+// the events of one thread, only that thread adds to its chunks
+typedef struct trace_thread_s
+{
+    struct trace_thread_s *next;
+    int                    tid;
+    char                   name[TRACE_NAME_SIZE];
+    trace_chunk_t         *head;
+    trace_chunk_t         *tail;
+    int                    saturated;   // no more chunks for it, its events are only counted
+    uint64_t               dropped;     // events it couldn't keep
+}
+trace_thread_t;
+
+static pthread_mutex_t   trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_thread_t   *trace_threads = NULL;
+static int               trace_thread_count = 0;
+static int               trace_chunk_count = 0;
+static int               trace_generation = 0;
+static char             *trace_filename = NULL;
+static uint64_t          trace_started;
+
+static TRACE_TLS trace_thread_t *current_thread = NULL;
+static TRACE_TLS int             current_generation = 0;
+
+// a chunk for the calling thread, registers the thread the first time
+static trace_thread_t *new_chunk(void)
+{
+    trace_thread_t *thread = current_generation == trace_generation ? current_thread : NULL;
+    trace_chunk_t *chunk = NULL;
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_chunk_count < TRACE_MAX_CHUNKS)
+    {
+        chunk = (trace_chunk_t *) malloc(sizeof(trace_chunk_t));
+        if (chunk)
+        {
+            chunk->next = NULL;
+            chunk->count = 0;
+            trace_chunk_count++;
+        }
+    }
+    if (thread == NULL)
+    {
+        thread = (trace_thread_t *) calloc(1, sizeof(trace_thread_t));
+        if (thread)
+        {
+            thread->tid = ++trace_thread_count;
+            snprintf(thread->name, sizeof(thread->name), "thread %d", thread->tid);
+            thread->next = trace_threads;
+            trace_threads = thread;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    if (thread == NULL)
+    {
+        free(chunk);
+        return NULL;
+    }
+    if (chunk)
+    {
+        if (thread->tail)
+            thread->tail->next = chunk;
+        else
+            thread->head = chunk;
+        thread->tail = chunk;
+    }
+    else
+        thread->saturated = 1;
+
+    current_thread = thread;
+    current_generation = trace_generation;
+    return thread;
+}
+
+void trace_events_add(char phase, const char *name, int64_t arg)
+{
+    trace_thread_t *thread = current_generation == trace_generation ? current_thread : NULL;
+    trace_event_t *event;
+
+    // once the chunks ran out the thread doesn't ask for more, no lock per event
+    if (thread && thread->saturated)
+    {
+        thread->dropped++;
+        return;
+    }
+
+    if (thread == NULL || thread->tail == NULL || thread->tail->count == TRACE_CHUNK_EVENTS)
+    {
+        thread = new_chunk();
+        if (thread == NULL)
+            return;
+        if (thread->saturated)
+        {
+            thread->dropped++;
+            return;
+        }
+    }
+
+    event = &thread->tail->events[thread->tail->count++];
+    event->name = name;
+    event->phase = phase;
+    event->arg = arg;
+    event->ts = pipeline_stats_now();
+}
+
+void trace_events_thread_name(const char *name)
+{
+    trace_thread_t *thread;
+
+    if (!trace_events_on)
+        return;
+
+    thread = current_generation == trace_generation ? current_thread : NULL;
+    if (thread == NULL)
+        thread = new_chunk();
+    if (thread)
+    {
+        strncpy(thread->name, name, sizeof(thread->name) - 1);
+        thread->name[sizeof(thread->name) - 1] = '\0';
+    }
+}
+
+int trace_events_start(const char *filename)
+{
+    pthread_mutex_lock(&trace_lock);
+    free(trace_filename);
+    trace_filename = strdup(filename);
+    trace_started = pipeline_stats_now();
+    pthread_mutex_unlock(&trace_lock);
+
+    if (trace_filename == NULL)
+        return -1;
+
+    trace_events_on = 1;
+    return 0;
+}
+
+int trace_events_stop(void)
+{
+    trace_thread_t *thread, *next_thread;
+    trace_chunk_t *chunk, *next_chunk;
+    FILE *fd;
+    uint64_t dropped = 0;
+    int i, first = 1, result = 0;
+
+    if (!trace_events_on)
+        return 0;
+
+    trace_events_on = 0;
+
+    pthread_mutex_lock(&trace_lock);
+
+    fd = fopen(trace_filename, "w");
+    if (fd == NULL)
+        result = -1;
+    else
+    {
+        fprintf(fd, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        for (thread = trace_threads; thread; thread = thread->next)
+        {
+            fprintf(fd, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                    first ? "" : ",\n", thread->tid, thread->name);
+            first = 0;
+            dropped += thread->dropped;
+
+            for (chunk = thread->head; chunk; chunk = chunk->next)
+            {
+                for (i = 0; i < chunk->count; i++)
+                {
+                    trace_event_t *event = &chunk->events[i];
+
+                    fprintf(fd, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"n\": %lld}}",
+                            event->name, event->phase, (double) (event->ts - trace_started) / 1000.0,
+                            thread->tid, (long long) event->arg);
+                }
+            }
+        }
+        fprintf(fd, "\n], \"otherData\": {\"dropped_events\": %llu}}\n", (unsigned long long) dropped);
+        if (fclose(fd) != 0)
+            result = -1;
+    }
+
+    for (thread = trace_threads; thread; thread = next_thread)
+    {
+        next_thread = thread->next;
+        for (chunk = thread->head; chunk; chunk = next_chunk)
+        {
+            next_chunk = chunk->next;
+            free(chunk);
+        }
+        free(thread);
+    }
+    trace_threads = NULL;
+    trace_thread_count = 0;
+    trace_chunk_count = 0;
+    // the thread locals of the threads still running point to freed memory now
+    trace_generation++;
+    free(trace_filename);
+    trace_filename = NULL;
+
+    pthread_mutex_unlock(&trace_lock);
+
+    return result;
+}
+
+#else
+
+// not on the PS3
+
+int trace_events_start(const char *filename)
+{
+    (void) filename;
+    return -1;
+}
+
+int trace_events_stop(void)
+{
+    return 0;
+}
+
+void trace_events_thread_name(const char *name)
+{
+    (void) name;
+}
+
+void trace_events_add(char phase, const char *name, int64_t arg)
+{
+    (void) phase;
+    (void) name;
+    (void) arg;
+}
+
+#endif
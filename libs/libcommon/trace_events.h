@@ -0,0 +1,76 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __TRACE_EVENTS_H__
+#define __TRACE_EVENTS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Timeline of the pipeline threads, written as Chrome trace-event JSON
+ * (chrome://tracing, https://ui.perfetto.dev). Each thread records its
+ * begin/end events into its own buffers without locking, the file is
+ * written by trace_events_stop() once the threads are joined.
+ *
+ * TRACE_BEGIN("read", lsn);
+ * blocks = sacd_read_block_raw(sacd, lsn, count, buffer);
+ * TRACE_END("read", blocks);
+ *
+ * Names must be string literals (only the pointer is kept). When tracing
+ * is off a TRACE_ macro is one test of trace_events_on.
+ */
+
+#ifdef __lv2ppu__
+#define TRACE_BEGIN(name, arg)
+#define TRACE_END(name, arg)
+#else
+#define TRACE_BEGIN(name, arg) do { if (trace_events_on) trace_events_add('B', name, (int64_t) (arg)); } while (0)
+#define TRACE_END(name, arg) do { if (trace_events_on) trace_events_add('E', name, (int64_t) (arg)); } while (0)
+#endif
+
+extern volatile int trace_events_on;
+
+/**
+ * starts tracing, the events go to filename when stopped, returns 0 on success
+ */
+int trace_events_start(const char *filename);
+
+/**
+ * writes the trace file and frees all buffers, the threads that recorded
+ * events must have ended (or not record any more), returns 0 on success
+ */
+int trace_events_stop(void);
+
+/**
+ * names the calling thread in the timeline (the name is copied)
+ */
+void trace_events_thread_name(const char *name);
+
+void trace_events_add(char phase, const char *name, int64_t arg);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* __TRACE_EVENTS_H__ */
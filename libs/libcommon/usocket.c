@@ -246,6 +246,69 @@ int socket_send(p_socket ps, const char *data, size_t count,
     return IO_UNKNOWN;
 }
 
+/*-------------------------------------------------------------------------*\
+* Gather send with timeout
+\*-------------------------------------------------------------------------*/
+int socket_sendv(p_socket ps, const t_iobuf *bufs, int nbufs, size_t *sent, 
+        p_timeout tm)
+{
+    int err, i;
+    size_t done;
+    *sent = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+#ifdef __lv2ppu__
+    /* no sendmsg, send the pieces one after another */
+    for (i = 0; i < nbufs; i++) {
+        size_t left = bufs[i].count;
+        while (left > 0) {
+            err = socket_send(ps, bufs[i].data + bufs[i].count - left, left, &done, 0, tm);
+            if (err != IO_DONE) return err;
+            left -= done;
+            *sent += done;
+        }
+    }
+    return IO_DONE;
+#else
+    {
+        struct iovec iov[SOCKET_MAX_IOBUF];
+        struct msghdr msg;
+        int first = 0;
+        if (nbufs > SOCKET_MAX_IOBUF) return IO_UNKNOWN;
+        for (i = 0; i < nbufs; i++) {
+            iov[i].iov_base = (void *) bufs[i].data;
+            iov[i].iov_len = bufs[i].count;
+        }
+        while (first < nbufs) {
+            long put;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov + first;
+            msg.msg_iovlen = nbufs - first;
+            put = (long) sendmsg(*ps, &msg, 0);
+            if (put > 0) {
+                /* skip what went out, a short send leaves a partial buffer */
+                done = (size_t) put;
+                *sent += done;
+                while (first < nbufs && done >= iov[first].iov_len) {
+                    done -= iov[first].iov_len;
+                    first++;
+                }
+                if (first < nbufs) {
+                    iov[first].iov_base = (char *) iov[first].iov_base + done;
+                    iov[first].iov_len -= done;
+                }
+                continue;
+            }
+            err = errno;
+            if (put == 0 || err == EPIPE) return IO_CLOSED;
+            if (err == EINTR) continue;
+            if (err != EAGAIN) return err;
+            if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+        }
+        return IO_DONE;
+    }
+#endif
+}
+
 /*-------------------------------------------------------------------------*\
 * Sendto with timeout
 \*-------------------------------------------------------------------------*/
@@ -38,6 +38,10 @@
 #include <sys/types.h>
 /* socket function */
 #include <sys/socket.h>
+#ifndef __lv2ppu__
+/* struct iovec for gather sends */
+#include <sys/uio.h>
+#endif
 /* struct timeval */
 #include <sys/time.h>
 /* gethostbyname and gethostbyaddr functions */
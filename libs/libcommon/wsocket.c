@@ -239,6 +239,43 @@ int socket_send(p_socket ps, const char *data, size_t count,
     return IO_UNKNOWN;
 }
 
+/*-------------------------------------------------------------------------*\
+* Gather send with timeout
+\*-------------------------------------------------------------------------*/
+int socket_sendv(p_socket ps, const t_iobuf *bufs, int nbufs, size_t *sent, 
+        p_timeout tm)
+{
+    WSABUF wsabuf[SOCKET_MAX_IOBUF];
+    int err, i, first = 0;
+    *sent = 0;
+    if (*ps == SOCKET_INVALID) return IO_CLOSED;
+    if (nbufs > SOCKET_MAX_IOBUF) return IO_UNKNOWN;
+    for (i = 0; i < nbufs; i++) {
+        wsabuf[i].buf = (char *) bufs[i].data;
+        wsabuf[i].len = (ULONG) bufs[i].count;
+    }
+    while (first < nbufs) {
+        DWORD put = 0;
+        if (WSASend(*ps, wsabuf + first, (DWORD) (nbufs - first), &put, 0, NULL, NULL) == 0) {
+            /* skip what went out, a short send leaves a partial buffer */
+            *sent += put;
+            while (first < nbufs && put >= wsabuf[first].len) {
+                put -= wsabuf[first].len;
+                first++;
+            }
+            if (first < nbufs) {
+                wsabuf[first].buf += put;
+                wsabuf[first].len -= put;
+            }
+            continue;
+        }
+        err = WSAGetLastError();
+        if (err != WSAEWOULDBLOCK) return err;
+        if ((err = socket_waitfd(ps, WAITFD_W, tm)) != IO_DONE) return err;
+    }
+    return IO_DONE;
+}
+
 /*-------------------------------------------------------------------------*\
 * Sendto with timeout
 \*-------------------------------------------------------------------------*/
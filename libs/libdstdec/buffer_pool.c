@@ -25,6 +25,8 @@
 #include <malloc.h>
 #endif
 
+#include <mem_stats.h>
+
 #include "buffer_pool.h"
 
 /* initialize a pool (pool structure itself provided, not allocated) -- the
@@ -80,6 +82,7 @@ buffer_pool_space_t *buffer_pool_get_space(buffer_pool_t *pool)
 #endif
     if (space->buf == NULL)
         return 0;
+    mem_stats_alloc(MEM_BUFFER_POOL, sizeof(buffer_pool_space_t) + pool->size, MEM_SITE);
     space->pool = pool;                 /* remember the pool this belongs to */
     return space;
 }
@@ -131,6 +134,7 @@ int buffer_pool_free(buffer_pool_t *pool)
 #endif
         free_lock(space->use);
         free(space);
+        mem_stats_free(MEM_BUFFER_POOL, sizeof(buffer_pool_space_t) + pool->size);
         count++;
     }
     release(pool->have);
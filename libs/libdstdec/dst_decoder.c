@@ -58,12 +58,17 @@
 #endif
 
 #include <logging.h>
+#include <pipeline_stats.h>
+#include <trace_events.h>
+#include <mem_stats.h>
+#include <progress.h>
 
 #include "dst_decoder.h"
 #include "yarn.h"
 #include "buffer_pool.h"
 #include "dst_fram.h"
 #include "dst_init.h"
+#include "dst_stats.h"
 
 #ifdef __APPLE__
 #include <sys/sysctl.h>
@@ -81,6 +86,8 @@ typedef struct job_t
     int more;                                 /* true if this is not the last chunk */
     buffer_pool_space_t *in;                  /* input DST data to decode */
     buffer_pool_space_t *out;                 /* resulting DSD decoded data */
+    uint64_t decoded;                         /* when it went to the write list (stats) */
+    FrameStats frame_stats;                   /* what the frame cost, when collected */
     struct job_t *next;                       /* next job in the list (either list) */
 } 
 job_t;
@@ -103,9 +110,11 @@ struct dst_decoder_s
     /* list of write jobs */
     lock *write_first;    /* lowest sequence number in list */
     job_t *write_head;
+    int write_pending;    /* number of jobs in the write list */
 
-    /* number of decoding threads running */
+    /* number of decoding threads running, and the threads (procs of them) */
     int cthreads;
+    thread **decodeth;
 
     /* write thread if running */
     thread *writeth;
@@ -113,8 +122,36 @@ struct dst_decoder_s
     frame_decoded_callback_t frame_decoded_callback;
     frame_error_callback_t frame_error_callback;
     void *userdata;
+
+    dst_stats_t *stats;   /* frames added by the write thread, or NULL */
 };
 
+/* decoders that run at the same time, they share the processors */
+static int concurrent_decoders = 1;
+
+/* decoding threads set by dst_decoder_set_threads, 0 = share of the processors */
+static int decoder_threads = 0;
+
+void dst_decoder_set_concurrency(int decoders)
+{
+    concurrent_decoders = decoders > 1 ? decoders : 1;
+}
+
+void dst_decoder_set_threads(int threads)
+{
+    decoder_threads = threads > 0 ? threads : 0;
+}
+
+void dst_decoder_count_memory(void)
+{
+    yarn_mem(mem_stats_yarn_malloc, mem_stats_yarn_free);
+}
+
+void dst_decoder_set_lock_stats(int enable)
+{
+    yarn_lock_stats = enable != 0;
+}
+
 static unsigned processor_count(void)
 {
 #if defined(_WIN32)
@@ -147,12 +184,26 @@ static void setup_decoding_jobs(dst_decoder_t *dst_decoder)
     buffer_pool_create(&dst_decoder->out_pool, 64 * 1024, -1);
 }
 
+/* logs the waits on a lock of the decoder, see yarn_lock_stats -- a useful
+   wake-up ends a wait, the others found the value not yet there */
+static void log_lock_stats(dst_decoder_t *dst_decoder, const char *name, lock *bolt)
+{
+    lock_stats_t s;
+
+    lock_stats(bolt, &s);
+    LOG(lm_main, LOG_NOTICE, ("-- lock %s (%d threads): %lu possessed, %lu contended (%.1f%%) for %.3f ms (max %.3f ms), "
+        "%lu waits for %.3f ms (max %.3f ms), %lu wake-ups (%lu useful), %lu twists",
+        name, dst_decoder->cthreads, s.possessed, s.contended,
+        s.possessed ? 100.0 * s.contended / s.possessed : 0.0, s.contended_ns / 1e6, s.contended_max_ns / 1e6,
+        s.waits, s.wait_ns / 1e6, s.wait_max_ns / 1e6, s.wakeups, s.waits, s.twists));
+}
+
 /* command the decode threads to all return, then join them all (call from
    main thread), free all the thread-related resources */
 static void finish_decoding_jobs(dst_decoder_t *dst_decoder)
 {
     job_t job;
-    int caught;
+    int caught, i;
 
     /* only do this once */
     if (dst_decoder->decode_have == NULL)
@@ -167,10 +218,18 @@ static void finish_decoding_jobs(dst_decoder_t *dst_decoder)
     dst_decoder->decode_tail = &(job.next);
     twist(dst_decoder->decode_have, BY, +1);       /* will wake them all up */
 
-    /* join all of the decode threads, verify they all came back */
-    caught = join_all();
-    LOG(lm_main, LOG_NOTICE, ("-- joined %d decode threads", caught));
-    assert(caught == dst_decoder->cthreads);
+    /* join the decode threads of this decoder only, other decoders (and
+       yarn users) may have threads running */
+    for (i = 0; i < dst_decoder->cthreads; i++)
+        join(dst_decoder->decodeth[i]);
+    LOG(lm_main, LOG_NOTICE, ("-- joined %d decode threads", dst_decoder->cthreads));
+    if (yarn_lock_stats)
+    {
+        log_lock_stats(dst_decoder, "decode_have", dst_decoder->decode_have);
+        log_lock_stats(dst_decoder, "write_first", dst_decoder->write_first);
+        log_lock_stats(dst_decoder, "in_pool have", dst_decoder->in_pool.have);
+        log_lock_stats(dst_decoder, "out_pool have", dst_decoder->out_pool.have);
+    }
     dst_decoder->cthreads = 0;
 
     /* free the resources */
@@ -193,6 +252,7 @@ static void decode_thread(void *userdata)
     job_t *job;                /* job pulled and working on */ 
     job_t *here, **prior;      /* pointers for inserting in write list */ 
     ebunch      D;
+    uint64_t stage_start;
     dst_decoder_t *dst_decoder = (dst_decoder_t *) userdata;
 
     if (DST_InitDecoder(&D, dst_decoder->channel_count, 64) != 0)
@@ -200,12 +260,16 @@ static void decode_thread(void *userdata)
         pthread_exit(0);
     }
 
+    trace_events_thread_name("dst decode");
+
     /* keep looking for work */
     for(;;)
     {
         /* get a job */
+        stage_start = pipeline_stats_clock();
         possess(dst_decoder->decode_have);
         wait_for(dst_decoder->decode_have, NOT_TO_BE, 0);
+        pipeline_stats_idle(PIPELINE_DECODE, stage_start);
         job = dst_decoder->decode_head;
         assert(job != NULL);
         if (job->seq == -1)
@@ -214,6 +278,7 @@ static void decode_thread(void *userdata)
         if (job->next == NULL)
             dst_decoder->decode_tail = &dst_decoder->decode_head;
         twist(dst_decoder->decode_have, BY, -1);
+        progress_add(PROGRESS_DECODE_QUEUE, -1);
 
         /* got a job */
         //LOG(lm_main, LOG_NOTICE, ("-- decoding #%ld", job->seq));
@@ -223,11 +288,16 @@ static void decode_thread(void *userdata)
             job->out = buffer_pool_get_space(&dst_decoder->out_pool);
 
             /* Save the error for later, so that the write_thread can output them in DST frame order */
+            stage_start = pipeline_stats_clock();
+            D.Stats = dst_decoder->stats ? &job->frame_stats : NULL;
+            TRACE_BEGIN("decode", job->seq);
             job->error = DST_FramDSTDecode(job->in->buf, job->out->buf, job->in->len, job->seq, &D); 
+            TRACE_END("decode", job->seq);
             if (job->error != DSTErr_NoError)
                 LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(job->error), D.FrameHdr.FrameNr));
 
             job->out->len = (size_t)(MAX_DSDBITS_INFRAME / 8 * dst_decoder->channel_count);
+            pipeline_stats_busy(PIPELINE_DECODE, stage_start, job->out->len, 1);
             buffer_pool_drop_space(job->in);
 
             //LOG(lm_main, LOG_NOTICE, ("-- decoded #%ld%s", job->seq, job->more ? "" : " (last)"));
@@ -244,6 +314,9 @@ static void decode_thread(void *userdata)
         }
         job->next = here;
         *prior = job;
+        job->decoded = pipeline_stats_clock();
+        dst_decoder->write_pending++;
+        pipeline_stats_depth(PIPELINE_REORDER, dst_decoder->write_pending);
         twist(dst_decoder->write_first, TO, dst_decoder->write_head->seq);
 
         /* done with that one -- go find another job */
@@ -266,20 +339,28 @@ static void write_thread(void *userdata)
     long seq;                       /* next sequence number looking for */
     job_t *job;                     /* job pulled and working on */
     int more;                       /* true if more chunks to write */
+    uint64_t stage_start;
     dst_decoder_t *dst_decoder = (dst_decoder_t *) userdata;
 
     /* build and write header */
     LOG(lm_main, LOG_NOTICE, ("-- write thread running"));
+    trace_events_thread_name("dst write");
 
     /* process output of decode threads until end of input */
     seq = 0;
     do 
     {
         /* get next write job in order */
+        stage_start = pipeline_stats_clock();
+        TRACE_BEGIN("reorder wait", seq);
         possess(dst_decoder->write_first);
         wait_for(dst_decoder->write_first, TO_BE, seq);
+        TRACE_END("reorder wait", seq);
+        pipeline_stats_idle(PIPELINE_REORDER, stage_start);
         job = dst_decoder->write_head;
         dst_decoder->write_head = job->next;
+        dst_decoder->write_pending--;
+        pipeline_stats_busy(PIPELINE_REORDER, job->decoded, job->more ? job->out->len : 0, job->more ? 1 : 0);
         twist(dst_decoder->write_first, TO, dst_decoder->write_head == NULL ? -1 : dst_decoder->write_head->seq);
 
         /* report any error */
@@ -288,6 +369,9 @@ static void write_thread(void *userdata)
 
         more = job->more;
 
+        if (more && dst_decoder->stats)
+            dst_stats_add(dst_decoder->stats, &job->frame_stats);
+
         if (more)
         {
             /* write the decoded data and drop the output buffer */
@@ -330,7 +414,7 @@ static void finish_write_job(dst_decoder_t *dst_decoder)
     /* start another decode thread if needed */
     if (dst_decoder->cthreads < dst_decoder->procs) 
     {
-        (void)launch(decode_thread, dst_decoder);
+        dst_decoder->decodeth[dst_decoder->cthreads] = launch(decode_thread, dst_decoder);
         dst_decoder->cthreads++;
     }
 
@@ -339,6 +423,7 @@ static void finish_write_job(dst_decoder_t *dst_decoder)
     job->next = NULL;
     *dst_decoder->decode_tail = job;
     dst_decoder->decode_tail = &(job->next);
+    progress_add(PROGRESS_DECODE_QUEUE, 1);
     twist(dst_decoder->decode_have, BY, +1);
 
     join(dst_decoder->writeth);
@@ -358,7 +443,12 @@ dst_decoder_t* dst_decoder_create(int channel_count, frame_decoded_callback_t fr
     dst_decoder->userdata = userdata;
     dst_decoder->frame_decoded_callback = frame_decoded_callback;
     dst_decoder->frame_error_callback = frame_error_callback;
-    dst_decoder->procs = processor_count();
+    dst_decoder->procs = decoder_threads > 0 ? decoder_threads : (int) processor_count() / concurrent_decoders;
+    if (dst_decoder->procs < 1)
+        dst_decoder->procs = 1;
+    dst_decoder->decodeth = (thread **) calloc(dst_decoder->procs, sizeof(thread *));
+    if (!dst_decoder->decodeth)
+        exit(1);
 
     /* if first time or after an option change, setup the job lists */
     setup_decoding_jobs(dst_decoder);
@@ -374,9 +464,15 @@ void dst_decoder_destroy(dst_decoder_t *dst_decoder)
     finish_write_job(dst_decoder);
     finish_decoding_jobs(dst_decoder);
 
+    free(dst_decoder->decodeth);
     free(dst_decoder);
 }
 
+void dst_decoder_collect_stats(dst_decoder_t *dst_decoder, dst_stats_t *stats)
+{
+    dst_decoder->stats = stats;
+}
+
 void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t frame_size)
 {
     job_t *job;                /* job for decode, then write */
@@ -398,7 +494,7 @@ void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t
     /* start another decode thread if needed */
     if (dst_decoder->cthreads < dst_decoder->procs) 
     {
-        (void)launch(decode_thread, dst_decoder);
+        dst_decoder->decodeth[dst_decoder->cthreads] = launch(decode_thread, dst_decoder);
         dst_decoder->cthreads++;
     }
 
@@ -407,5 +503,7 @@ void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t
     job->next = NULL;
     *dst_decoder->decode_tail = job;
     dst_decoder->decode_tail = &(job->next);
+    pipeline_stats_depth(PIPELINE_DECODE, (uint32_t) peek_lock(dst_decoder->decode_have) + 1);
+    progress_add(PROGRESS_DECODE_QUEUE, 1);
     twist(dst_decoder->decode_have, BY, +1);
 }
@@ -25,6 +25,7 @@
 #include <stdint.h>
 
 typedef struct dst_decoder_s dst_decoder_t;
+struct dst_stats_s;
 typedef void (*frame_decoded_callback_t)(uint8_t* frame_data, size_t frame_size, void *userdata);
 typedef void (*frame_error_callback_t)(int frame_count, int frame_error_code, const char *frame_error_message, void *userdata);
 
@@ -32,5 +33,22 @@ dst_decoder_t* dst_decoder_create(int channel_count, frame_decoded_callback_t fr
 void dst_decoder_destroy(dst_decoder_t *dst_decoder);
 void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t frame_size);
 
+/* the decoding threads of a decoder are limited to their share of the processors,
+   taken when it is created (decoders already running keep theirs) */
+void dst_decoder_set_concurrency(int decoders);
+
+/* decoding threads of every decoder created after this, 0 = its share of the processors */
+void dst_decoder_set_threads(int threads);
+
+/* counts the memory of yarn in the mem_stats, call before the first decoder is created */
+void dst_decoder_count_memory(void);
+
+/* counts the lock waits of the decoders (yarn_lock_stats), each decoder logs them when destroyed */
+void dst_decoder_set_lock_stats(int enable);
+
+/* adds every frame decoded from now on to stats (dst_stats.h, initialized by the caller),
+   the stats are complete once dst_decoder_destroy() returns */
+void dst_decoder_collect_stats(dst_decoder_t *dst_decoder, struct dst_stats_s *stats);
+
 
 #endif /* DST_DECODER_H */
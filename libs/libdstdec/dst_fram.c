@@ -71,6 +71,7 @@ Changes:
 #include "types.h"
 #include "dst_fram.h"
 #include "unpack_dst.h"
+#include <pipeline_stats.h>
 
 /*============================================================================*/
 /*       CONSTANTS                                                            */
@@ -85,6 +86,49 @@ Changes:
 #define ONE     (1 << ABITS)
 #define HALF    (1 << (ABITS - 1))
 
+/* adds the time since Start to the kernel, Start moves on to now */
+#define KERNEL_TIME(D, Kernel, Start) \
+    if ((D)->KernelTime) \
+    { \
+        uint64_t Now = pipeline_stats_now(); \
+        (D)->KernelTime[Kernel] += Now - (Start); \
+        (Start) = Now; \
+    }
+
+/* the figures of the frame just unpacked, see FrameStats */
+static void FillFrameStats(ebunch *D, int FrameSizeInBytes, int Error)
+{
+    FrameStats *S = D->Stats;
+    int        Nr;
+
+    memset(S, 0, sizeof(FrameStats));
+    S->FrameNr      = D->FrameHdr.FrameNr;
+    S->FrameSize    = FrameSizeInBytes;
+    S->DSTCoded     = D->FrameHdr.DSTCoded;
+    S->Error        = Error;
+    S->NrOfChannels = D->FrameHdr.NrOfChannels;
+
+    /* the header of a plain DSD frame still holds the tables of an earlier frame */
+    if (Error != DSTErr_NoError || D->FrameHdr.DSTCoded != 1)
+        return;
+
+    S->NrOfFilters = D->FrameHdr.NrOfFilters;
+    S->NrOfPtables = D->FrameHdr.NrOfPtables;
+    for (Nr = 0; Nr < D->FrameHdr.NrOfFilters; Nr++)
+    {
+        S->MaxPredOrder  = MAX(S->MaxPredOrder, D->FrameHdr.PredOrder[Nr]);
+        S->SumPredOrder += D->FrameHdr.PredOrder[Nr];
+    }
+    for (Nr = 0; Nr < D->FrameHdr.NrOfPtables; Nr++)
+        S->MaxPtableLen = MAX(S->MaxPtableLen, D->FrameHdr.PtableLen[Nr]);
+    for (Nr = 0; Nr < D->FrameHdr.NrOfChannels; Nr++)
+    {
+        S->NrOfFSegments  += D->FrameHdr.FSeg.NrOfSegments[Nr];
+        S->NrOfPSegments  += D->FrameHdr.PSeg.NrOfSegments[Nr];
+        S->NrOfHalfProbCh += D->FrameHdr.HalfProb[Nr] != 0;
+    }
+}
+
 static __inline void LT_ACDecodeBit_Init(ACData *AC, uint8_t *cb, int fs)
 {
     AC->Init = 0;
@@ -338,6 +382,8 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
     const int NrOfBitsPerCh = D->FrameHdr.NrOfBitsPerCh;
     const int NrOfChannels = D->FrameHdr.NrOfChannels;
     uint8_t   *MuxedDSD = MuxedDSDdata;
+    uint64_t  KernelStart = D->KernelTime || D->Stats ? pipeline_stats_now() : 0;
+    const uint64_t FrameStart = KernelStart;
 
     D->FrameHdr.FrameNr       = FrameCnt;
     D->FrameHdr.CalcNrOfBytes = FrameSizeInBytes;
@@ -345,6 +391,9 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
 
     /* unpack DST frame: segmentation, mapping, arithmatic data */
     error = UnpackDSTframe(D, DSTdata, MuxedDSDdata);
+    if (D->Stats)
+        FillFrameStats(D, FrameSizeInBytes, error);
+    KERNEL_TIME(D, DST_KERNEL_UNPACK, KernelStart);
 
     if (error == DSTErr_NoError && D->FrameHdr.DSTCoded == 1)
     {
@@ -363,6 +412,7 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
         LT_InitCoefTablesI(D, LT_ICoefI);
         //LT_InitCoefTablesU(D, LT_ICoefU);
         LT_InitStatus(D, LT_Status);
+        KERNEL_TIME(D, DST_KERNEL_TABLES, KernelStart);
 
         LT_ACDecodeBit_Init(&AC, D->AData, D->ADataLen);
         LT_ACDecodeBit_Decode(&AC, &ACError, Reverse7LSBs(D->FrameHdr.ICoefA[0][0]), D->AData, D->ADataLen);
@@ -420,6 +470,7 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
 
         if (ACError != 1)
             error = DSTErr_ArithmeticDecoder;
+        KERNEL_TIME(D, DST_KERNEL_AC, KernelStart);
     }
 
     if (error != DSTErr_NoError)
@@ -428,6 +479,12 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
         memset(MuxedDSDdata, 0x55, (NrOfBitsPerCh * NrOfChannels) / 8);
     }
 
+    if (D->Stats)
+    {
+        D->Stats->Error = error;
+        D->Stats->DecodeTime = pipeline_stats_now() - FrameStart;
+    }
+
     return error;
 }
 
@@ -68,6 +68,21 @@ Changes:
 
 #include "types.h"
 
+/*============================================================================*/
+/*       CONSTANTS                                                            */
+/*============================================================================*/
+
+/* stages of DST_FramDSTDecode, timed into D->KernelTime[] when it is set  */
+/* (D->Stats, when set, gets the figures of each frame, see dst_stats.h)    */
+enum
+{
+    DST_KERNEL_UNPACK,              /* UnpackDSTframe: header, filters, Ptables */
+    DST_KERNEL_TABLES,              /* segment tables, filter lookup tables     */
+    DST_KERNEL_AC,                  /* prediction and arithmetic decoding loop  */
+
+    DST_KERNELS
+};
+
 /*============================================================================*/
 /*       FUNCTION PROTOTYPES                                                  */
 /*============================================================================*/
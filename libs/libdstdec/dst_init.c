@@ -67,6 +67,8 @@ Changes:
 #if !defined(NO_SSE2) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
 #include <emmintrin.h>
 #endif
+#include <mem_stats.h>
+
 #include "dst_init.h"
 #include "ccp_calc.h"
 #include "conststr.h"
@@ -76,30 +78,44 @@ Changes:
 /*       STATIC FUNCTION IMPLEMENTATIONS                                      */
 /*============================================================================*/
 
+/* Size of an array, kept in front of it for the memory stats (keeps the alignment) */
+#define MEMORY_HEADER 16
+
 /* General function for allocating memory for array of any type */
 static void *MemoryAllocate(int NrOfElements, int SizeOfElement) 
 {
-  void *Array;
+  char   *Array;
+  size_t Size = (size_t)NrOfElements * SizeOfElement;
 #if defined(__arm__) || defined(__aarch64__)
-  if ((Array = malloc(NrOfElements * SizeOfElement)) == NULL)
+  if ((Array = malloc(MEMORY_HEADER + Size)) == NULL)
   {
     fprintf(stderr,"ERROR: not enough memory available!\n\n");
+    return NULL;
   }
 #else
-  if ((Array = _mm_malloc(NrOfElements * SizeOfElement, 16)) == NULL) 
+  if ((Array = _mm_malloc(MEMORY_HEADER + Size, 16)) == NULL) 
   {
     fprintf(stderr,"ERROR: not enough memory available!\n\n");
+    return NULL;
   }
 #endif
-  return Array;
+  *(size_t *)Array = Size;
+  mem_stats_alloc(MEM_DST_DECODER, Size, MEM_SITE);
+  return Array + MEMORY_HEADER;
 }
 
 static void MemoryFree(void *Array) 
 {
+  char *Header;
+
+  if (Array == NULL)
+    return;
+  Header = (char *)Array - MEMORY_HEADER;
+  mem_stats_free(MEM_DST_DECODER, *(size_t *)Header);
 #if defined(__arm__) || defined(__aarch64__)
-  free(Array);
+  free(Header);
 #else
-  _mm_free(Array);
+  _mm_free(Header);
 #endif
 }
 
@@ -0,0 +1,226 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <logging.h>
+
+#include "dst_stats.h"
+
+static const char *histogram_names[DST_STATS_HISTOGRAMS] =
+{
+    "size_sixteenths", "filters", "ptables", "max_pred_order_8", "filter_segments", "ptable_segments", "decode_us_log2"
+};
+
+volatile int dst_stats_on = 0;
+
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *report_fd = NULL;
+static int report_count = 0;
+static int report_error = 0;
+
+void dst_stats_init(dst_stats_t *stats, int channel_count)
+{
+    memset(stats, 0, sizeof(dst_stats_t));
+    stats->channel_count = channel_count;
+}
+
+static void add_to_bin(dst_stats_t *stats, int histogram, int bin, uint64_t ns)
+{
+    if (bin < 0)
+        bin = 0;
+    if (bin >= DST_STATS_BINS)
+        bin = DST_STATS_BINS - 1;
+    stats->histograms[histogram].frames[bin]++;
+    stats->histograms[histogram].ns[bin] += ns;
+}
+
+void dst_stats_add(dst_stats_t *stats, const FrameStats *frame)
+{
+    const int dsd_size = MAX_DSDBITS_INFRAME / 8 * (stats->channel_count > 0 ? stats->channel_count : 1);
+    uint64_t ns = frame->DecodeTime;
+    int i, time_bin;
+
+    if (stats->frames == 0 || frame->FrameSize < stats->min_frame_size)
+        stats->min_frame_size = frame->FrameSize;
+    if (frame->FrameSize > stats->max_frame_size)
+        stats->max_frame_size = frame->FrameSize;
+    stats->frames++;
+    stats->bytes += frame->FrameSize;
+    stats->ns += ns;
+    if (frame->DSTCoded != 1)
+    {
+        stats->plain_frames++;
+        stats->plain_ns += ns;
+    }
+    if (frame->Error != 0)
+        stats->error_frames++;
+
+    for (time_bin = 0; (ns / 1000) >> (time_bin + 1) != 0; time_bin++)
+        ;
+    add_to_bin(stats, DST_STATS_SIZE, (int) ((int64_t) frame->FrameSize * 16 / dsd_size), ns);
+    add_to_bin(stats, DST_STATS_FILTERS, frame->NrOfFilters, ns);
+    add_to_bin(stats, DST_STATS_PTABLES, frame->NrOfPtables, ns);
+    add_to_bin(stats, DST_STATS_PRED_ORDER, (frame->MaxPredOrder + 7) / 8, ns);
+    add_to_bin(stats, DST_STATS_FSEGMENTS, frame->NrOfFSegments, ns);
+    add_to_bin(stats, DST_STATS_PSEGMENTS, frame->NrOfPSegments, ns);
+    add_to_bin(stats, DST_STATS_TIME, time_bin, ns);
+
+    /* keep the slowest frames, slowest first */
+    for (i = stats->costliest_count; i > 0 && stats->costliest[i - 1].DecodeTime < ns; i--)
+    {
+        if (i < DST_STATS_COSTLIEST)
+            stats->costliest[i] = stats->costliest[i - 1];
+    }
+    if (i < DST_STATS_COSTLIEST)
+    {
+        stats->costliest[i] = *frame;
+        if (stats->costliest_count < DST_STATS_COSTLIEST)
+            stats->costliest_count++;
+    }
+}
+
+static void write_json_string(FILE *fd, const char *s)
+{
+    fputc('"', fd);
+    for (; s && *s; s++)
+    {
+        unsigned char c = (unsigned char) *s;
+
+        if (c == '"' || c == '\\')
+            fprintf(fd, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fd, "\\u%04x", c);
+        else
+            fputc(c, fd);
+    }
+    fputc('"', fd);
+}
+
+int dst_stats_write_json(FILE *fd, const dst_stats_t *stats, const char *name)
+{
+    const uint32_t dst_frames = stats->frames - stats->plain_frames;
+    const double seconds = (double) stats->ns / 1e9;
+    int i, j, last;
+
+    fprintf(fd, "{\n  \"name\": ");
+    write_json_string(fd, name);
+    fprintf(fd, ",\n  \"channels\": %d,\n", stats->channel_count);
+    fprintf(fd, "  \"frames\": %u,\n", stats->frames);
+    fprintf(fd, "  \"plain_frames\": %u,\n", stats->plain_frames);
+    fprintf(fd, "  \"error_frames\": %u,\n", stats->error_frames);
+    fprintf(fd, "  \"bytes\": %llu,\n", (unsigned long long) stats->bytes);
+    fprintf(fd, "  \"frame_size_min\": %d,\n", stats->min_frame_size);
+    fprintf(fd, "  \"frame_size_max\": %d,\n", stats->max_frame_size);
+    fprintf(fd, "  \"decode_seconds\": %.6f,\n", seconds);
+    fprintf(fd, "  \"dst_frame_us\": %.1f,\n", dst_frames ? (double) (stats->ns - stats->plain_ns) / dst_frames / 1000.0 : 0.0);
+    fprintf(fd, "  \"plain_frame_us\": %.1f,\n", stats->plain_frames ? (double) stats->plain_ns / stats->plain_frames / 1000.0 : 0.0);
+    /* one decoding thread, 75 frames are a second of audio */
+    fprintf(fd, "  \"frames_per_second\": %.1f,\n", seconds > 0.0 ? (double) stats->frames / seconds : 0.0);
+    fprintf(fd, "  \"realtime_factor\": %.2f,\n", seconds > 0.0 ? (double) stats->frames / 75.0 / seconds : 0.0);
+
+    fprintf(fd, "  \"histograms\": {\n");
+    for (i = 0; i < DST_STATS_HISTOGRAMS; i++)
+    {
+        const dst_stats_histogram_t *h = &stats->histograms[i];
+
+        /* up to the last bin used */
+        for (last = DST_STATS_BINS - 1; last > 0 && h->frames[last] == 0; last--)
+            ;
+        fprintf(fd, "    \"%s\": {\"frames\": [", histogram_names[i]);
+        for (j = 0; j <= last; j++)
+            fprintf(fd, "%s%u", j ? ", " : "", h->frames[j]);
+        fprintf(fd, "], \"us\": [");
+        for (j = 0; j <= last; j++)
+            fprintf(fd, "%s%llu", j ? ", " : "", (unsigned long long) (h->ns[j] / 1000));
+        fprintf(fd, "]}%s\n", i < DST_STATS_HISTOGRAMS - 1 ? "," : "");
+    }
+    fprintf(fd, "  },\n  \"costliest\": [");
+    for (i = 0; i < stats->costliest_count; i++)
+    {
+        const FrameStats *f = &stats->costliest[i];
+
+        fprintf(fd, "%s\n    {\"frame\": %d, \"us\": %.1f, \"size\": %d, \"dst_coded\": %d, \"error\": %d, "
+                "\"filters\": %d, \"ptables\": %d, \"max_pred_order\": %d, \"sum_pred_order\": %d, \"max_ptable_len\": %d, "
+                "\"filter_segments\": %d, \"ptable_segments\": %d, \"half_prob_channels\": %d}",
+                i ? "," : "", f->FrameNr, (double) f->DecodeTime / 1000.0, f->FrameSize, f->DSTCoded, f->Error,
+                f->NrOfFilters, f->NrOfPtables, f->MaxPredOrder, f->SumPredOrder, f->MaxPtableLen,
+                f->NrOfFSegments, f->NrOfPSegments, f->NrOfHalfProbCh);
+    }
+    fprintf(fd, "%s]\n}", stats->costliest_count ? "\n  " : "");
+
+    return ferror(fd) ? -1 : 0;
+}
+
+int dst_stats_start(const char *filename)
+{
+    pthread_mutex_lock(&report_lock);
+    if (report_fd == NULL)
+    {
+        report_fd = fopen(filename, "w");
+        report_count = 0;
+        report_error = report_fd == NULL || fprintf(report_fd, "[\n") < 0;
+    }
+    dst_stats_on = report_fd != NULL;
+    pthread_mutex_unlock(&report_lock);
+
+    return report_fd != NULL ? 0 : -1;
+}
+
+int dst_stats_stop(void)
+{
+    int result = 0;
+
+    pthread_mutex_lock(&report_lock);
+    dst_stats_on = 0;
+    if (report_fd != NULL)
+    {
+        fprintf(report_fd, "%s]\n", report_count ? "\n" : "");
+        if (fclose(report_fd) != 0 || report_error)
+            result = -1;
+        report_fd = NULL;
+    }
+    pthread_mutex_unlock(&report_lock);
+
+    return result;
+}
+
+void dst_stats_report(const dst_stats_t *stats, const char *name)
+{
+    const uint32_t dst_frames = stats->frames - stats->plain_frames;
+
+    LOG(lm_main, LOG_NOTICE, ("dst stats of %s: %u frames (%u plain, %u errors), %.1f us per DST frame, slowest %.1f us",
+        name, stats->frames, stats->plain_frames, stats->error_frames,
+        dst_frames ? (double) (stats->ns - stats->plain_ns) / dst_frames / 1000.0 : 0.0,
+        stats->costliest_count ? (double) stats->costliest[0].DecodeTime / 1000.0 : 0.0));
+
+    pthread_mutex_lock(&report_lock);
+    if (report_fd != NULL)
+    {
+        if (report_count++ > 0)
+            fprintf(report_fd, ",\n");
+        if (dst_stats_write_json(report_fd, stats, name) != 0)
+            report_error = 1;
+    }
+    pthread_mutex_unlock(&report_lock);
+}
@@ -0,0 +1,101 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DST_STATS_H_INCLUDED
+#define DST_STATS_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/* -- what the DST frames of a track cost to decode -- */
+
+/* The frames of a track are added one by one (FrameStats of dst_fram.c, in
+   frame order) and reported as a JSON object: counts, the distributions of
+   the frame properties that drive the decoding time, with the time spent
+   in each bin, and the costliest frames.
+
+   dst_stats_start("dst.json");
+   dst_stats_init(&stats, channel_count);
+   ... dst_stats_add(&stats, &frame) for each frame ...
+   dst_stats_report(&stats, "track 1");
+   dst_stats_stop();
+ */
+
+#define DST_STATS_BINS      (MAX_CHANNELS * MAXNROF_PSEGS + 1)
+#define DST_STATS_COSTLIEST 8
+
+/* frames and decoding time per bin of one frame property */
+typedef struct
+{
+    uint32_t frames[DST_STATS_BINS];
+    uint64_t ns[DST_STATS_BINS];
+} dst_stats_histogram_t;
+
+enum
+{
+    DST_STATS_SIZE,         /* frame size in 1/16 of the plain DSD frame */
+    DST_STATS_FILTERS,      /* filters of the frame */
+    DST_STATS_PTABLES,      /* Ptables of the frame */
+    DST_STATS_PRED_ORDER,   /* highest prediction order, 8 per bin (0 = plain DSD) */
+    DST_STATS_FSEGMENTS,    /* filter segments of all channels */
+    DST_STATS_PSEGMENTS,    /* Ptable segments of all channels */
+    DST_STATS_TIME,         /* decoding time in us, log2 bins */
+
+    DST_STATS_HISTOGRAMS
+};
+
+typedef struct dst_stats_s
+{
+    int                   channel_count;
+    uint32_t              frames;
+    uint32_t              plain_frames;           /* DSTCoded == 0 */
+    uint32_t              error_frames;
+    uint64_t              bytes;                  /* of the DST frames */
+    uint64_t              ns;                     /* decoding time of all frames */
+    uint64_t              plain_ns;
+    int                   min_frame_size;
+    int                   max_frame_size;
+    dst_stats_histogram_t histograms[DST_STATS_HISTOGRAMS];
+    FrameStats            costliest[DST_STATS_COSTLIEST];   /* slowest first */
+    int                   costliest_count;
+} dst_stats_t;
+
+void dst_stats_init(dst_stats_t *stats, int channel_count);
+void dst_stats_add(dst_stats_t *stats, const FrameStats *frame);
+
+/* writes stats as a JSON object, returns 0 on success */
+int dst_stats_write_json(FILE *fd, const dst_stats_t *stats, const char *name);
+
+/* the report file, a JSON array with one object per track, returns 0 on success */
+int dst_stats_start(const char *filename);
+
+/* closes the report file, returns 0 when it was written */
+int dst_stats_stop(void);
+
+/* adds the stats of a track to the report file (any thread), logs a summary */
+void dst_stats_report(const dst_stats_t *stats, const char *name);
+
+/* true between dst_stats_start() and dst_stats_stop() */
+extern volatile int dst_stats_on;
+
+#endif  /* DST_STATS_H_INCLUDED */
@@ -138,6 +138,25 @@ typedef struct
 } CodedTable;
 
 
+/* what a frame costs to decode, filled by DST_FramDSTDecode when D->Stats is set */
+typedef struct
+{
+    int      FrameNr;
+    int      FrameSize;                                         /* Bytes of the DST frame                     */
+    int      DSTCoded;                                          /* 0 = plain DSD, the fields below are 0      */
+    int      Error;                                             /* DSTErr_ of the frame                       */
+    int      NrOfChannels;
+    int      NrOfFilters;
+    int      NrOfPtables;
+    int      MaxPredOrder;                                      /* Highest prediction order of the filters    */
+    int      SumPredOrder;                                      /* Prediction orders of all filters           */
+    int      MaxPtableLen;                                      /* Most entries of a Ptable                   */
+    int      NrOfFSegments;                                     /* Filter segments of all channels            */
+    int      NrOfPSegments;                                     /* Ptable segments of all channels            */
+    int      NrOfHalfProbCh;                                    /* Channels that start with p=0.5 bits        */
+    uint64_t DecodeTime;                                        /* ns spent in DST_FramDSTDecode              */
+} FrameStats;
+
 typedef struct
 {
     uint8_t*   pDSTdata;
@@ -169,6 +188,9 @@ typedef struct
     StrData      S;                                              /* DST data stream */
 
     int          SSE2;
+
+    uint64_t     *KernelTime;                                    /* if set, ns spent per DST_KERNEL_ stage      */
+    FrameStats   *Stats;                                         /* if set, gets the figures of the last frame  */
 } ebunch;
 
 #endif  /* __TYPES_H_INCLUDED */
@@ -30,7 +30,9 @@
        pthread_mutex_lock(), pthread_mutex_unlock(), pthread_mutex_destroy(),
        pthread_cond_t, PTHREAD_COND_INITIALIZER, pthread_cond_init(),
        pthread_cond_broadcast(), pthread_cond_wait(), pthread_cond_destroy() */
-#include <errno.h>      /* ENOMEM, EAGAIN, EINVAL */
+#include <errno.h>      /* ENOMEM, EAGAIN, EINVAL, EBUSY */
+#include <string.h>     /* memset() */
+#include <pipeline_stats.h> /* pipeline_stats_now() */
 
 /* interface definition */
 #include "yarn.h"
@@ -42,6 +44,9 @@
 char *yarn_prefix = "yarn";
 void (*yarn_abort)(int) = NULL;
 
+/* lock statistics, set by the application */
+int yarn_lock_stats = 0;
+
 
 /* immediately exit -- use for errors that shouldn't ever happen */
 local void fail(int err)
@@ -83,6 +88,7 @@ struct lock_s {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     long value;
+    lock_stats_t stats;         /* counted while yarn_lock_stats is set */
 };
 
 lock *new_lock(long initial)
@@ -95,13 +101,39 @@ lock *new_lock(long initial)
         (ret = pthread_cond_init(&(bolt->cond), NULL)))
         fail(ret);
     bolt->value = initial;
+    memset(&(bolt->stats), 0, sizeof(lock_stats_t));
     return bolt;
 }
 
+/* possess() that counts, and times the wait when the lock is taken */
+local void possess_counted(lock *bolt)
+{
+    int ret;
+    uint64_t start, waited;
+
+    if ((ret = pthread_mutex_trylock(&(bolt->mutex))) == EBUSY) {
+        start = pipeline_stats_now();
+        if ((ret = pthread_mutex_lock(&(bolt->mutex))) != 0)
+            fail(ret);
+        waited = pipeline_stats_now() - start;
+        bolt->stats.contended++;
+        bolt->stats.contended_ns += waited;
+        if (waited > bolt->stats.contended_max_ns)
+            bolt->stats.contended_max_ns = waited;
+    }
+    else if (ret != 0)
+        fail(ret);
+    bolt->stats.possessed++;
+}
+
 void possess(lock *bolt)
 {
     int ret;
 
+    if (yarn_lock_stats) {
+        possess_counted(bolt);
+        return;
+    }
     if ((ret = pthread_mutex_lock(&(bolt->mutex))) != 0)
         fail(ret);
 }
@@ -122,6 +154,8 @@ void twist(lock *bolt, enum twist_op op, long val)
         bolt->value = val;
     else if (op == BY)
         bolt->value += val;
+    if (yarn_lock_stats)
+        bolt->stats.twists++;
     if ((ret = pthread_cond_broadcast(&(bolt->cond))) ||
         (ret = pthread_mutex_unlock(&(bolt->mutex))))
         fail(ret);
@@ -129,10 +163,51 @@ void twist(lock *bolt, enum twist_op op, long val)
 
 #define until(a) while(!(a))
 
+/* true if the lock value is as waited for */
+local int reached(lock *bolt, enum wait_op op, long val)
+{
+    switch (op) {
+    case TO_BE:
+        return bolt->value == val;
+    case NOT_TO_BE:
+        return bolt->value != val;
+    case TO_BE_MORE_THAN:
+        return bolt->value > val;
+    case TO_BE_LESS_THAN:
+        return bolt->value < val;
+    }
+    return 1;
+}
+
+/* wait_for() that counts the wake-ups and times the sleep */
+local void wait_for_counted(lock *bolt, enum wait_op op, long val)
+{
+    int ret;
+    uint64_t start, slept;
+
+    if (reached(bolt, op, val))
+        return;
+    start = pipeline_stats_now();
+    do {
+        if ((ret = pthread_cond_wait(&(bolt->cond), &(bolt->mutex))) != 0)
+            fail(ret);
+        bolt->stats.wakeups++;
+    } until (reached(bolt, op, val));
+    slept = pipeline_stats_now() - start;
+    bolt->stats.waits++;
+    bolt->stats.wait_ns += slept;
+    if (slept > bolt->stats.wait_max_ns)
+        bolt->stats.wait_max_ns = slept;
+}
+
 void wait_for(lock *bolt, enum wait_op op, long val)
 {
     int ret;
 
+    if (yarn_lock_stats) {
+        wait_for_counted(bolt, op, val);
+        return;
+    }
     switch (op) {
     case TO_BE:
         until (bolt->value == val)
@@ -161,6 +236,11 @@ long peek_lock(lock *bolt)
     return bolt->value;
 }
 
+void lock_stats(lock *bolt, lock_stats_t *stats)
+{
+    *stats = bolt->stats;
+}
+
 void free_lock(lock *bolt)
 {
     int ret;
@@ -183,7 +263,8 @@ struct thread_s {
 local lock threads_lock = {
     PTHREAD_MUTEX_INITIALIZER,
     PTHREAD_COND_INITIALIZER,
-    0                           /* number of threads exited but not joined */
+    0,                          /* number of threads exited but not joined */
+    {0, 0, 0, 0, 0, 0, 0, 0, 0}
 };
 local thread *threads = NULL;       /* list of extant threads */
 
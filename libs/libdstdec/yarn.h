@@ -98,6 +98,16 @@
         provided in order to supply thread-safe memory allocation routines or
         for any other reason -- by default malloc() and free() will be used
 
+   -- Lock statistics --
+
+   yarn_lock_stats - set to 1 to count, for every lock, the possessions, the
+        possessions that had to wait for another thread, the time spent
+        waiting for them, the wait_for() calls that had to sleep, the time they
+        slept and their wake-ups (a wake-up that does not end the wait was for
+        nothing), and the twists -- 0 by default, then nothing is counted
+   lock_stats(lock, &stats) - copy the counts of a lock (possess the lock, or
+        make sure no other thread uses it)
+
    -- Error control --
 
    yarn_name - a char pointer to a string that will be the prefix for any error
@@ -113,6 +123,7 @@
 #define YARN_H_INCLUDED 
 
 #include <stdio.h>
+#include <stdint.h>
 
 extern char *yarn_prefix;
 extern void (*yarn_abort)(int);
@@ -138,4 +149,19 @@ void wait_for(lock *, enum wait_op, long);
 long peek_lock(lock *);
 void free_lock(lock *);
 
+typedef struct {
+    unsigned long possessed;    /* possess() calls */
+    unsigned long contended;    /* possess() calls that found the lock taken */
+    uint64_t contended_ns;      /* time waited for the lock, total and longest */
+    uint64_t contended_max_ns;
+    unsigned long waits;        /* wait_for() calls that slept */
+    unsigned long wakeups;      /* wake-ups of these, waits of them were needed */
+    uint64_t wait_ns;           /* time slept in wait_for(), total and longest */
+    uint64_t wait_max_ns;
+    unsigned long twists;       /* twist() calls */
+} lock_stats_t;
+
+extern int yarn_lock_stats;
+void lock_stats(lock *, lock_stats_t *);
+
 #endif /* YARN_H_INCLUDED */ 
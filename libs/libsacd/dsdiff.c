@@ -37,6 +37,7 @@
 #endif
 
 #include <charset.h>
+#include <mem_stats.h>
 
 #include "sacd_reader.h"
 #include "scarletbook_id3.h"
@@ -635,7 +636,10 @@ static int dsdiff_close(scarletbook_output_format_t *ft)
 	}	
 
     if (handle->frame_indexes)
+    {
         free(handle->frame_indexes);
+        mem_stats_free(MEM_OUTPUT, handle->frame_indexes_allocated * DST_FRAME_INDEX_SIZE);
+    }
     if (handle->header)
         free(handle->header);
     if (handle->footer)
@@ -674,6 +678,7 @@ static int dsdiff_write_frame(scarletbook_output_format_t *ft, const uint8_t *bu
             {
                 handle->frame_indexes_allocated += 10000;
                 handle->frame_indexes = (dst_frame_index_t *) realloc(handle->frame_indexes, handle->frame_indexes_allocated * DST_FRAME_INDEX_SIZE);
+                mem_stats_alloc(MEM_OUTPUT, 10000 * DST_FRAME_INDEX_SIZE, MEM_SITE);
             }
 
             handle->frame_indexes[handle->frame_count - 1].length = len;
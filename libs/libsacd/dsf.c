@@ -80,10 +80,36 @@ static const uint8_t bit_reverse_table[] =
         0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef, 0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
     };
 
-static uint8_t buffer_prev[MAX_CHANNEL_COUNT][SACD_BLOCK_SIZE_PER_CHANNEL]; // used for nopad option; keep the previus data copied form buffer[]
-static uint8_t *buffer_ptr_prev[MAX_CHANNEL_COUNT];
 #define NO_PREV_TRACK  -2
-static int prev_track_no = NO_PREV_TRACK;
+
+// used for nopad option; the samples left in buffer[] by a track, they start the next track of the area (ft->carry)
+typedef struct
+{
+    int      prev_track_no;
+    uint8_t  buffer_prev[MAX_CHANNEL_COUNT][SACD_BLOCK_SIZE_PER_CHANNEL];
+    size_t   size_prev[MAX_CHANNEL_COUNT];
+}
+dsf_carry_t;
+
+static dsf_carry_t *dsf_get_carry(scarletbook_output_format_t *ft, int create)
+{
+    dsf_carry_t *carry;
+
+    if (!ft->carry)
+        return NULL;
+
+    carry = (dsf_carry_t *) *ft->carry;
+    if (!carry && create)
+    {
+        carry = (dsf_carry_t *) calloc(1, sizeof(dsf_carry_t));
+        if (carry)
+        {
+            carry->prev_track_no = NO_PREV_TRACK;
+            *ft->carry = carry;
+        }
+    }
+    return carry;
+}
 
 static int dsf_create_header(scarletbook_output_format_t *ft)
 {
@@ -182,6 +208,7 @@ static int dsf_create_header(scarletbook_output_format_t *ft)
 static int dsf_create(scarletbook_output_format_t *ft)
 {
     dsf_handle_t *handle = (dsf_handle_t *)ft->priv;
+    dsf_carry_t *carry = dsf_get_carry(ft, 0);
 
     int rez = dsf_create_header(ft);
 
@@ -193,26 +220,26 @@ static int dsf_create(scarletbook_output_format_t *ft)
 
     // If this is not the first track, carry over the leftover samples from the tail of the previous track for no zero padding.
     // and leftovers must be from previous track (==track-1); To work with selected tracks.
-    if (ft->sb_handle->dsf_nopad && (ft->track > 0) && (ft->track == prev_track_no + 1))
+    if (ft->sb_handle->dsf_nopad && (ft->track > 0) && carry && (ft->track == carry->prev_track_no + 1))
     {
         for (int i = 0; i < handle->channel_count; i++)
         {
-            if (buffer_ptr_prev[i] > buffer_prev[i]) // if has something in buffer_prev[] to carry over
+            if (carry->size_prev[i] > 0) // if has something in buffer_prev[] to carry over
             {
-                memcpy(handle->buffer[i], buffer_prev[i], SACD_BLOCK_SIZE_PER_CHANNEL);
-                handle->buffer_ptr[i] = handle->buffer[i] + (buffer_ptr_prev[i] - buffer_prev[i]);
+                memcpy(handle->buffer[i], carry->buffer_prev[i], SACD_BLOCK_SIZE_PER_CHANNEL);
+                handle->buffer_ptr[i] = handle->buffer[i] + carry->size_prev[i];
 
                 // DEBUG
-                //LOG(lm_main, LOG_NOTICE, ("Dsf_create, nopad & track>0: prev_track_no=%d, track=%d, size_prev=%d ", prev_track_no, ft->track, (int)(buffer_ptr_prev[i] - buffer_prev[i])));
+                //LOG(lm_main, LOG_NOTICE, ("Dsf_create, nopad & track>0: prev_track_no=%d, track=%d, size_prev=%d ", carry->prev_track_no, ft->track, (int)carry->size_prev[i]));
                 // empty prev buffer
-                buffer_ptr_prev[i] = &buffer_prev[i][0];               
+                carry->size_prev[i] = 0;
             }
         }
-        prev_track_no = NO_PREV_TRACK;
+        carry->prev_track_no = NO_PREV_TRACK;
     }
 
     //DEBUG
-    //LOG(lm_main, LOG_NOTICE, ("Dsf_create: prev_track_no=%d, track=%d, size_buffer=%d ", prev_track_no, ft->track, (int)(handle->buffer_ptr[0] - handle->buffer[0])));    
+    //LOG(lm_main, LOG_NOTICE, ("Dsf_create: track=%d, size_buffer=%d ", ft->track, (int)(handle->buffer_ptr[0] - handle->buffer[0])));    
 
     return rez;
 }
@@ -221,13 +248,14 @@ static int dsf_close(scarletbook_output_format_t *ft)
 {
     dsf_handle_t *handle = (dsf_handle_t *)ft->priv;
     scarletbook_handle_t *sb_handle = ft->sb_handle;
+    dsf_carry_t *carry = dsf_get_carry(ft, sb_handle->dsf_nopad);
     int i;
 	size_t bytes_w;
 	int result=0;
 
     // Save the remaining samples in the buffer to be attached to the beginning of the next track.  // This is mindset idea with nopad option !! Thank you!
     // This is needed for padding-less DSF generation.  This is for players that cannot handle zero-padding properly.
-    if (sb_handle->dsf_nopad && ft->track < sb_handle->area[ft->area].area_toc->track_count - 1)
+    if (sb_handle->dsf_nopad && ft->track < sb_handle->area[ft->area].area_toc->track_count - 1 && carry)
     {
         if(sb_handle->concatenate ==0)
         {
@@ -236,13 +264,13 @@ static int dsf_close(scarletbook_output_format_t *ft)
                 // if it exists some data in buffers then copy it in a special buffers for use in next track
                 if (handle->buffer_ptr[i] > handle->buffer[i])
                 {
-                    memcpy(buffer_prev[i], handle->buffer[i], SACD_BLOCK_SIZE_PER_CHANNEL);
-                    buffer_ptr_prev[i] = buffer_prev[i] + (handle->buffer_ptr[i] - handle->buffer[i]);
-                    prev_track_no = ft->track;
+                    memcpy(carry->buffer_prev[i], handle->buffer[i], SACD_BLOCK_SIZE_PER_CHANNEL);
+                    carry->size_prev[i] = handle->buffer_ptr[i] - handle->buffer[i];
+                    carry->prev_track_no = ft->track;
                     
                     //DEBUG
-                    //int size_rezult=(int)(buffer_ptr_prev[i] - buffer_prev[i]);
-                    //LOG(lm_main, LOG_NOTICE, ("Dsf_close, nopad, memcopy: prev_track_no=track=%d, size_prev=%d, full=%d[%%]", prev_track_no,size_rezult, (int)size_rezult*100/SACD_BLOCK_SIZE_PER_CHANNEL ));
+                    //int size_rezult=(int)carry->size_prev[i];
+                    //LOG(lm_main, LOG_NOTICE, ("Dsf_close, nopad, memcopy: prev_track_no=track=%d, size_prev=%d, full=%d[%%]", carry->prev_track_no,size_rezult, (int)size_rezult*100/SACD_BLOCK_SIZE_PER_CHANNEL ));
 
                     // empty the main frame buffers
                     memset(handle->buffer[i], 0x00, SACD_BLOCK_SIZE_PER_CHANNEL); // Mandatory is 0x00. But tried with 0x99 (10011001) for reducing pop noise or 0x69 (0110 1001)
@@ -250,15 +278,15 @@ static int dsf_close(scarletbook_output_format_t *ft)
                 }
                 else // very rare but happens
                 {
-                    buffer_ptr_prev[i] = &buffer_prev[i][0]; // emtpy, nothing to carry over to the next track
-                    prev_track_no = NO_PREV_TRACK;
+                    carry->size_prev[i] = 0; // emtpy, nothing to carry over to the next track
+                    carry->prev_track_no = NO_PREV_TRACK;
                     //DEBUG
-                    //LOG(lm_main, LOG_NOTICE, ("Dsf_close, nopad, memcopy, Buffer Empty: prev_track_no=%d, track=%d", prev_track_no, ft->track));
+                    //LOG(lm_main, LOG_NOTICE, ("Dsf_close, nopad, memcopy, Buffer Empty: prev_track_no=%d, track=%d", carry->prev_track_no, ft->track));
                 }
             }
         }
         else // in concatenation mode do not keep these remaining samples
-            prev_track_no = NO_PREV_TRACK;
+            carry->prev_track_no = NO_PREV_TRACK;
     }
     else // if dsf_nopad = 0 or is last track in dsf_nopad==1 case
     {
@@ -283,7 +311,7 @@ static int dsf_close(scarletbook_output_format_t *ft)
 
                 //DEBUG
                 //int size_rezult=(int)(handle->buffer_ptr[i] - handle->buffer[i]);
-                //LOG(lm_main, LOG_NOTICE, ("Dsf_close: nopad=0 or last track; prev_track_no=%d, track=%d, size_buffer=%d, full=%d[%%]", prev_track_no, ft->track, size_rezult,(int)size_rezult*100/SACD_BLOCK_SIZE_PER_CHANNEL));
+                //LOG(lm_main, LOG_NOTICE, ("Dsf_close: nopad=0 or last track; track=%d, size_buffer=%d, full=%d[%%]", ft->track, size_rezult,(int)size_rezult*100/SACD_BLOCK_SIZE_PER_CHANNEL));
 
                 // empty the main frame buffers
                 memset(handle->buffer[i], 0x00, SACD_BLOCK_SIZE_PER_CHANNEL); // Mandatory is 0x00. But tried with 0x99 (10011001) for reducing pop noise or 0x69 (0110 1001)
@@ -291,7 +319,8 @@ static int dsf_close(scarletbook_output_format_t *ft)
             }
         }
 
-        prev_track_no = NO_PREV_TRACK;
+        if (carry)
+            carry->prev_track_no = NO_PREV_TRACK;
     }
 
     // write the footer
@@ -0,0 +1,67 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <logging.h>
+#include "scarletbook_output.h"
+
+// counts what would have been written, see OUTPUT_FLAG_NULL
+typedef struct
+{
+    uint64_t frames;
+    uint64_t bytes;
+}
+null_handle_t;
+
+static int null_write_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
+{
+    null_handle_t *handle = (null_handle_t *) ft->priv;
+
+    handle->frames++;
+    handle->bytes += len;
+    return (int) len;
+}
+
+static int null_close(scarletbook_output_format_t *ft)
+{
+    null_handle_t *handle = (null_handle_t *) ft->priv;
+
+    LOG(lm_main, LOG_NOTICE, ("null output %s: %llu frames, %llu bytes", ft->filename,
+        (unsigned long long) handle->frames, (unsigned long long) handle->bytes));
+    return 0;
+}
+
+scarletbook_format_handler_t const * null_format_fn(void) 
+{
+    static scarletbook_format_handler_t handler = 
+    {
+        "Null output (nothing is written)", 
+        "null", 
+        0, 
+        null_write_frame,
+        null_close, 
+        OUTPUT_FLAG_DSD | OUTPUT_FLAG_NULL,
+        sizeof(null_handle_t)
+    };
+    return &handler;
+}
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/stat.h>
 
 #if defined(__lv2ppu__)
@@ -59,6 +60,15 @@ char *       (*sacd_input_error)        (sacd_input_t);
 int          (*sacd_input_authenticate) (sacd_input_t);
 int          (*sacd_input_decrypt)      (sacd_input_t, uint8_t *, uint32_t);
 uint32_t     (*sacd_input_total_sectors)(sacd_input_t);
+int          (*sacd_input_read_frames)  (sacd_input_t, uint32_t, uint32_t, uint32_t, int, sacd_input_frame_callback_t, void *);
+
+/* upper bound for the number of DISC_READ requests kept in flight */
+#define MAX_NET_READ_WINDOW 16
+
+/* sectors kept from the start of a stream, enough for the master TOC and area TOC-1 */
+#define STREAM_HEAD_SECTORS 4096
+/* sectors kept from the end of the last stream read, covers the overlap between tracks */
+#define STREAM_TAIL_SECTORS 16
 
 struct sacd_input_s
 {
@@ -67,8 +77,39 @@ struct sacd_input_s
 #if defined(__lv2ppu__)
     device_info_t       device_info;
 #endif
+    /* sequential (pipe) input */
+    uint32_t            stream_pos;         /* LSN of the next sector delivered by the pipe */
+    uint8_t            *stream_head;        /* sectors [0, min(stream_pos, STREAM_HEAD_SECTORS)) */
+    uint8_t            *stream_tail;        /* copy of the last sectors handed out */
+    uint32_t            stream_tail_lsn;
+    uint32_t            stream_tail_count;
+
+    /* pipelined network reads, responses arrive in request order */
+    pb_socket_stream_t  net_stream;
+    uint32_t            net_protocol;       /* negotiated protocol version */
+    uint32_t            net_total_sectors;
+    uint32_t            net_next_lsn;       /* first sector not requested yet */
+    uint32_t            net_last_end;       /* end of the previous read, detects sequential access */
+    uint32_t            net_pending_lsn[MAX_NET_READ_WINDOW];
+    uint32_t            net_pending_count[MAX_NET_READ_WINDOW];
+    uint8_t             net_pending_frames[MAX_NET_READ_WINDOW];   /* 1 for DISC_READ_FRAMES */
+    int                 net_pending_first;
+    int                 net_pending;
+    uint32_t            net_frames_next;    /* first sector of the frame range not requested yet, */
+                                            /* where the frame parser of the server stands */
+    uint32_t            net_frames_end;     /* end of the frame range */
+    uint32_t            net_frames_block;   /* sectors per DISC_READ_FRAMES request */
+    uint32_t            prefetch_lsn;       /* response data kept in input_buffer */
+    uint32_t            prefetch_count;
 };
 
+static uint32_t net_read_window = 4;
+
+void sacd_input_set_read_window(uint32_t window)
+{
+    net_read_window = max(1, min(window, MAX_NET_READ_WINDOW));
+}
+
 static int sacd_dev_input_authenticate(sacd_input_t dev)
 {
 #if defined(__lv2ppu__)
@@ -237,20 +278,28 @@ static uint32_t sacd_dev_input_read(sacd_input_t dev,  uint32_t pos,  uint32_t b
     return (ret != 0) ? 0 : sectors_read;
 
 #else
-    off_t ret_lseek;
     size_t len;
     ssize_t ret;
 
-    ret_lseek = lseek(dev->fd, (off_t)pos * (off_t)SACD_LSN_SIZE, SEEK_SET);
-    if (ret_lseek < 0)  // -1 on error
+    len = (size_t) blocks * SACD_LSN_SIZE;
+
+#if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
     {
-		LOG(lm_main, LOG_ERROR, ("Error in sacd_dev_input_read: lseek(..pos..); pos=%ld\n",pos));
-        return 0;
-    }
+        off_t ret_lseek;
 
-    len = (size_t) blocks * SACD_LSN_SIZE;
+        ret_lseek = lseek(dev->fd, (off_t)pos * (off_t)SACD_LSN_SIZE, SEEK_SET);
+        if (ret_lseek < 0)  // -1 on error
+        {
+            LOG(lm_main, LOG_ERROR, ("Error in sacd_dev_input_read: lseek(..pos..); pos=%ld\n",pos));
+            return 0;
+        }
+    }
 
     ret = read(dev->fd, buffer, len);
+#else
+    // positioned read, the server shares one reader between its client threads
+    ret = pread(dev->fd, buffer, len, (off_t)pos * (off_t)SACD_LSN_SIZE);
+#endif
 
     if (ret <= 0) // -1 on error ; 0 =indicates EOF
     {
@@ -330,19 +379,425 @@ static uint32_t sacd_dev_input_total_sectors(sacd_input_t dev)
 #endif
 }
 
+/**
+ * initialize and open a forward-only stream (stdin or a named pipe).
+ */
+static sacd_input_t sacd_stream_input_open(const char *target)
+{
+    sacd_input_t dev;
+
+    dev = (sacd_input_t) calloc(sizeof(*dev), 1);
+    if (dev == NULL)
+    {
+        fprintf(stderr, "libsacdread: Could not allocate memory.\n");
+        return NULL;
+    }
+
+    dev->input_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    dev->stream_head = (uint8_t *) malloc(STREAM_HEAD_SECTORS * SACD_LSN_SIZE);
+    dev->stream_tail = (uint8_t *) malloc(STREAM_TAIL_SECTORS * SACD_LSN_SIZE);
+    if (!dev->input_buffer || !dev->stream_head || !dev->stream_tail)
+    {
+        fprintf(stderr, "libsacdread: Could not allocate memory.\n");
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_stream_input_open():libsacdread: Could not allocate memory"));
+        goto error;
+    }
+
+    if (strcmp(target, "-") == 0)
+    {
+#if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        dev->fd = fileno(stdin);
+    }
+    else
+    {
+        dev->fd = open(target, O_RDONLY);
+    }
+
+    if (dev->fd < 0)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_stream_input_open(): can't open %s", target));
+        goto error;
+    }
+
+    return dev;
+
+error:
+
+    free(dev->input_buffer);
+    free(dev->stream_head);
+    free(dev->stream_tail);
+    free(dev);
+
+    return 0;
+}
+
+/**
+ * read the next blocks from the stream, keeping a copy of the head sectors.
+ */
+static uint32_t sacd_stream_pull(sacd_input_t dev, uint8_t *buffer, uint32_t blocks)
+{
+    size_t  len = (size_t) blocks * SACD_LSN_SIZE;
+    size_t  got = 0;
+    ssize_t ret;
+    uint32_t sectors;
+
+    while (got < len)
+    {
+        ret = read(dev->fd, buffer + got, len - got);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+        got += (size_t) ret;
+    }
+
+    sectors = (uint32_t) (got / SACD_LSN_SIZE);
+
+    if (dev->stream_pos < STREAM_HEAD_SECTORS && sectors > 0)
+    {
+        uint32_t n = min(sectors, STREAM_HEAD_SECTORS - dev->stream_pos);
+        memcpy(dev->stream_head + (size_t) dev->stream_pos * SACD_LSN_SIZE, buffer, (size_t) n * SACD_LSN_SIZE);
+    }
+
+    dev->stream_pos += sectors;
+
+    return sectors;
+}
+
+/**
+ * read and drop sectors until the stream is positioned at lsn.
+ */
+static int sacd_stream_skip(sacd_input_t dev, uint32_t lsn)
+{
+    while (dev->stream_pos < lsn)
+    {
+        uint32_t n = min(lsn - dev->stream_pos, MAX_PROCESSING_BLOCK_SIZE);
+
+        if (sacd_stream_pull(dev, dev->input_buffer, n) != n)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_stream_skip(): end of stream at sector %u, wanted %u", dev->stream_pos, lsn));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * read data from the stream. Sectors behind the stream position are only
+ * available when they are part of the kept head or tail.
+ */
+static uint32_t sacd_stream_input_read(sacd_input_t dev, uint32_t pos, uint32_t blocks, void *buffer)
+{
+    uint8_t *out = (uint8_t *) buffer;
+    uint32_t head_count = min(dev->stream_pos, STREAM_HEAD_SECTORS);
+    uint32_t done = 0;
+
+    while (done < blocks)
+    {
+        uint32_t lsn = pos + done;
+        uint32_t n;
+
+        if (lsn < head_count)
+        {
+            n = min(blocks - done, head_count - lsn);
+            memcpy(out + (size_t) done * SACD_LSN_SIZE, dev->stream_head + (size_t) lsn * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+        }
+        else if (lsn >= dev->stream_tail_lsn && lsn < dev->stream_tail_lsn + dev->stream_tail_count)
+        {
+            n = min(blocks - done, dev->stream_tail_lsn + dev->stream_tail_count - lsn);
+            memcpy(out + (size_t) done * SACD_LSN_SIZE, dev->stream_tail + (size_t) (lsn - dev->stream_tail_lsn) * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+        }
+        else if (lsn < dev->stream_pos)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_stream_input_read(): can't seek back to sector %u on a stream (at sector %u)", lsn, dev->stream_pos));
+            break;
+        }
+        else
+        {
+            if (sacd_stream_skip(dev, lsn) != 0)
+                break;
+
+            n = sacd_stream_pull(dev, out + (size_t) done * SACD_LSN_SIZE, blocks - done);
+            if (n == 0)
+                break;
+        }
+        done += n;
+    }
+
+    if (done > 0)
+    {
+        uint32_t n = min(done, STREAM_TAIL_SECTORS);
+
+        memcpy(dev->stream_tail, out + (size_t) (done - n) * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+        dev->stream_tail_lsn = pos + done - n;
+        dev->stream_tail_count = n;
+    }
+
+    return done;
+}
+
+/**
+ * close the stream and clean up.
+ */
+static int sacd_stream_input_close(sacd_input_t dev)
+{
+    int ret = 0;
+
+    if (!dev)
+        return 0;
+
+    if (dev->fd != fileno(stdin))
+        ret = close(dev->fd);
+
+    free(dev->input_buffer);
+    free(dev->stream_head);
+    free(dev->stream_tail);
+    free(dev);
+
+    return ret;
+}
+
+/**
+ * the size of a stream is not known up front.
+ */
+static uint32_t sacd_stream_input_total_sectors(sacd_input_t dev)
+{
+    (void) dev;
+    return 0;
+}
+
+/**
+ * queue a request in the send buffer, pb_socket_stream_flush() sends it.
+ */
+static int sacd_net_send_request(sacd_input_t dev, ServerRequest_Type type, uint32_t sector_offset, uint32_t sector_count, int frame_flags)
+{
+    ServerRequest request;
+    pb_ostream_t output = pb_ostream_from_socket_stream(&dev->net_stream);
+    uint8_t zero = 0;
+
+    request.type = type;
+    request.sector_offset = sector_offset;
+    request.sector_count = sector_count;
+    request.has_protocol_version = (type == ServerRequest_Type_DISC_OPEN);
+    request.protocol_version = SACD_PROTOCOL_VERSION;
+    request.has_frame_flags = (type == ServerRequest_Type_DISC_READ_FRAMES);
+    request.frame_flags = (uint32_t) frame_flags;
+
+    if (!pb_encode(&output, ServerRequest_fields, &request))
+    {
+        return -1;
+    }
+
+    /* We signal the end of request with a 0 tag. */
+    if (!pb_write(&output, &zero, 1))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * keep up to window DISC_READ requests of count sectors in flight.
+ */
+static int sacd_net_issue_reads(sacd_input_t dev, uint32_t window, uint32_t count)
+{
+    int issued = 0;
+
+    while ((uint32_t) dev->net_pending < window && dev->net_next_lsn < dev->net_total_sectors)
+    {
+        int      slot = (dev->net_pending_first + dev->net_pending) % MAX_NET_READ_WINDOW;
+        uint32_t n = min(count, dev->net_total_sectors - dev->net_next_lsn);
+
+        if (sacd_net_send_request(dev, ServerRequest_Type_DISC_READ, dev->net_next_lsn, n, 0) != 0)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_issue_reads(): can't send read request for sector %u", dev->net_next_lsn));
+            return -1;
+        }
+
+        dev->net_pending_lsn[slot] = dev->net_next_lsn;
+        dev->net_pending_count[slot] = n;
+        dev->net_pending_frames[slot] = 0;
+        dev->net_pending++;
+        dev->net_next_lsn += n;
+        issued++;
+    }
+
+    /* all new requests go out in a single send */
+    if (issued > 0 && !pb_socket_stream_flush(&dev->net_stream))
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_issue_reads(): can't send read requests"));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * keep up to window DISC_READ_FRAMES requests of the frame range in flight,
+ * the first one restarts the frame parser of the server if asked.
+ */
+static int sacd_net_issue_frames(sacd_input_t dev, uint32_t window, int restart)
+{
+    int issued = 0;
+
+    while ((uint32_t) dev->net_pending < window && dev->net_frames_next < dev->net_frames_end)
+    {
+        int      slot = (dev->net_pending_first + dev->net_pending) % MAX_NET_READ_WINDOW;
+        uint32_t n = min(dev->net_frames_block, dev->net_frames_end - dev->net_frames_next);
+        int      frame_flags = (issued == 0 && restart ? SACD_FRAMES_RESTART : 0) |
+                               (dev->net_frames_next + n >= dev->net_frames_end ? SACD_FRAMES_LAST : 0);
+
+        if (sacd_net_send_request(dev, ServerRequest_Type_DISC_READ_FRAMES, dev->net_frames_next, n, frame_flags) != 0)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_issue_frames(): can't send request for sector %u", dev->net_frames_next));
+            return -1;
+        }
+
+        dev->net_pending_lsn[slot] = dev->net_frames_next;
+        dev->net_pending_count[slot] = n;
+        dev->net_pending_frames[slot] = 1;
+        dev->net_pending++;
+        dev->net_frames_next += n;
+        issued++;
+    }
+
+    if (issued > 0 && !pb_socket_stream_flush(&dev->net_stream))
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_issue_frames(): can't send requests"));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * receive the response of the oldest DISC_READ request into buffer.
+ */
+static uint32_t sacd_net_receive_read(sacd_input_t dev, uint8_t *buffer)
+{
+    ServerResponse response;
+    pb_istream_t input = pb_istream_from_socket_stream(&dev->net_stream);
+
+    dev->net_pending_first = (dev->net_pending_first + 1) % MAX_NET_READ_WINDOW;
+    dev->net_pending--;
+
+    response.data.bytes = buffer;
+    if (!pb_decode(&input, ServerResponse_fields, &response))
+    {
+        return 0;
+    }
+
+    if (response.type != ServerResponse_Type_DISC_READ || response.result <= 0)
+    {
+        return 0;
+    }
+
+    if (dev->net_protocol >= 2)
+    {
+        /* raw sector runs follow the response */
+        if (!pb_socket_stream_read_sectors(&dev->net_stream, buffer, (uint32_t) response.result))
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_receive_read(): broken sector payload"));
+            return 0;
+        }
+        return (uint32_t) response.result;
+    }
+
+    if (!response.has_data)
+    {
+        return 0;
+    }
+
+    return (uint32_t) response.result;
+}
+
+/**
+ * receive the response of the oldest request, a DISC_READ_FRAMES, and call
+ * back for its frames (none when frame_callback is 0), returns the number of
+ * sectors consumed.
+ */
+static uint32_t sacd_net_receive_frames(sacd_input_t dev, sacd_input_frame_callback_t frame_callback, void *userdata)
+{
+    ServerResponse     response;
+    pb_istream_t       input = pb_istream_from_socket_stream(&dev->net_stream);
+    sacd_input_frame_t frame;
+    uint32_t           lsn = dev->net_pending_lsn[dev->net_pending_first];
+
+    dev->net_pending_first = (dev->net_pending_first + 1) % MAX_NET_READ_WINDOW;
+    dev->net_pending--;
+
+    response.data.bytes = dev->input_buffer;
+    if (!pb_decode(&input, ServerResponse_fields, &response) ||
+        response.type != ServerResponse_Type_DISC_READ_FRAMES || response.result <= 0)
+    {
+        return 0;
+    }
+
+    for (;;)
+    {
+        frame.data = dev->input_buffer;
+        if (!pb_socket_stream_read_frame(&dev->net_stream, &frame, MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE))
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_receive_frames(): broken frame list for sector %u", lsn));
+            return 0;
+        }
+        if (frame.size == SACD_FRAME_END)
+            break;
+
+        if (frame_callback)
+            frame_callback(&frame, userdata);
+    }
+
+    return (uint32_t) response.result;
+}
+
+/**
+ * wait for all outstanding responses and throw them away.
+ */
+static void sacd_net_drain(sacd_input_t dev)
+{
+    while (dev->net_pending > 0)
+    {
+        if (dev->net_pending_frames[dev->net_pending_first])
+            sacd_net_receive_frames(dev, 0, 0);
+        else
+            sacd_net_receive_read(dev, dev->input_buffer);
+    }
+    dev->prefetch_count = 0;
+}
+
+/**
+ * send a request and wait for its response, nothing may be in flight.
+ */
+static int sacd_net_transact(sacd_input_t dev, ServerRequest_Type type, ServerResponse *response)
+{
+    pb_istream_t input = pb_istream_from_socket_stream(&dev->net_stream);
+
+    sacd_net_drain(dev);
+
+    if (sacd_net_send_request(dev, type, 0, 0, 0) != 0 || !pb_socket_stream_flush(&dev->net_stream))
+    {
+        return -1;
+    }
+
+    if (!pb_decode(&input, ServerResponse_fields, response))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
 /**
  * initialize and open a SACD device or file.
  */
 static sacd_input_t sacd_net_input_open(const char *target)
 {
-    ServerRequest request;
     ServerResponse response;
     sacd_input_t dev = 0;
     const char *err = 0;
     t_timeout tm;
-    pb_istream_t input;
-    pb_ostream_t output;
-    uint8_t zero = 0;
 
     /* Allocate the library structure */
     dev = (sacd_input_t) calloc(sizeof(*dev), 1);
@@ -366,6 +821,13 @@ static sacd_input_t sacd_net_input_open(const char *target)
     socket_create((p_socket)&dev->fd, AF_INET, SOCK_STREAM, 0);
     socket_setblocking((p_socket)&dev->fd);
 
+    if (pb_socket_stream_init(&dev->net_stream, (p_socket)&dev->fd) != 0)
+    {
+        fprintf(stderr, "libsacdread: Could not allocate memory.\n");
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_net_input_open():libsacdread: Could not allocate memory"));
+        goto error;
+    }
+
     timeout_markstart(&tm);
     err = inet_tryconnect((p_socket)&dev->fd,
                           substr(target, 0, strchr(target, ':') - target),
@@ -381,22 +843,8 @@ static sacd_input_t sacd_net_input_open(const char *target)
     }
     socket_setblocking((p_socket)&dev->fd);
 
-    input = pb_istream_from_socket((p_socket)&dev->fd);
-
-    output = pb_ostream_from_socket((p_socket)&dev->fd);
-
-    request.type = ServerRequest_Type_DISC_OPEN;request.sector_count=0;request.sector_offset=0;
-
-    if (!pb_encode(&output, ServerRequest_fields, &request))
-    {
-        fprintf(stderr, "Failed to encode request\n");
-        goto error;
-    }
-
-    /* We signal the end of request with a 0 tag. */
-    pb_write(&output, &zero, 1);
-
-    if (!pb_decode(&input, ServerResponse_fields, &response))
+    response.data.bytes = dev->input_buffer;
+    if (sacd_net_transact(dev, ServerRequest_Type_DISC_OPEN, &response) != 0)
     {
         fprintf(stderr, "Failed to decode response\n");
         goto error;
@@ -408,6 +856,22 @@ static sacd_input_t sacd_net_input_open(const char *target)
         goto error;
     }
 
+    /* older servers don't answer with a version and speak protocol 1 */
+    dev->net_protocol = response.has_protocol_version ? min(response.protocol_version, SACD_PROTOCOL_VERSION) : 1;
+    LOG(lm_main, LOG_NOTICE, ("sacd_net_input_open(): using protocol version %u", dev->net_protocol));
+
+    /* the disc size bounds the read-ahead, an unknown size leaves it open */
+    response.data.bytes = dev->input_buffer;
+    if (sacd_net_transact(dev, ServerRequest_Type_DISC_SIZE, &response) == 0 &&
+        response.type == ServerResponse_Type_DISC_SIZE && response.result > 0)
+    {
+        dev->net_total_sectors = (uint32_t) response.result;
+    }
+    else
+    {
+        dev->net_total_sectors = UINT32_MAX;
+    }
+
     return dev;
 
 error:
@@ -428,21 +892,16 @@ static int sacd_net_input_close(sacd_input_t dev)
     }
     else
     {
-        ServerRequest request;
         ServerResponse response;
-        pb_istream_t input = pb_istream_from_socket((p_socket)&dev->fd);
-        pb_ostream_t output = pb_ostream_from_socket((p_socket)&dev->fd);
-        uint8_t zero = 0;
 
-        request.type = ServerRequest_Type_DISC_CLOSE;request.sector_count=0;request.sector_offset=0;
-        if (!pb_encode(&output, ServerRequest_fields, &request))
+        /* never got as far as connecting */
+        if (!dev->net_stream.send_buffer)
         {
             goto error;
         }
 
-        pb_write(&output, &zero, 1);
-
-        if (!pb_decode(&input, ServerResponse_fields, &response))
+        response.data.bytes = dev->input_buffer;
+        if (sacd_net_transact(dev, ServerRequest_Type_DISC_CLOSE, &response) != 0)
         {
             goto error;
         }
@@ -459,6 +918,7 @@ error:
     {
         socket_destroy((p_socket)&dev->fd);
         socket_close();
+        pb_socket_stream_destroy(&dev->net_stream);
         if (dev->input_buffer)
         {
             free(dev->input_buffer);
@@ -472,129 +932,183 @@ error:
 
 static uint32_t sacd_net_input_total_sectors(sacd_input_t dev)
 {
-    if (!dev)
+    if (!dev || dev->net_total_sectors == UINT32_MAX)
     {
         return 0;
     }
-    else
-    {
-        ServerRequest request;
-        ServerResponse response;
-        pb_istream_t input = pb_istream_from_socket((p_socket)&dev->fd);
-        pb_ostream_t output = pb_ostream_from_socket((p_socket)&dev->fd);
-        uint8_t zero = 0;
-
-        request.type = ServerRequest_Type_DISC_SIZE;request.sector_count=0;request.sector_offset=0;
-
-        if (!pb_encode(&output, ServerRequest_fields, &request))
-        {
-            return 0;
-        }
 
-        /* We signal the end of request with a 0 tag. */
-        pb_write(&output, &zero, 1);
-
-        if (!pb_decode(&input, ServerResponse_fields, &response))
-        {
-            return 0;
-        }
-
-        if (response.type != ServerResponse_Type_DISC_SIZE)
-        {
-            return 0;
-        }
-
-        return (uint32_t) response.result;
-    }
+    return dev->net_total_sectors;
 }
 
+/**
+ * read data from the server. Sequential reads keep a window of requests in
+ * flight so the link stays busy, any other access restarts the pipeline.
+ */
 static uint32_t sacd_net_input_read(sacd_input_t dev, uint32_t pos, uint32_t blocks, void *buffer)
 {
+    uint8_t *out = (uint8_t *) buffer;
+    uint32_t done = 0;
+    int      sequential;
+
     if (!dev)
     {
         return 0;
     }
-    else
-    {
-        uint8_t output_buf[16];
-        ServerRequest request;
-        ServerResponse response;
-        pb_ostream_t output = pb_ostream_from_buffer(output_buf, sizeof(output_buf));
-        pb_istream_t input = pb_istream_from_socket((p_socket)&dev->fd);
-        uint8_t zero = 0;
 
-        request.type = ServerRequest_Type_DISC_READ;
-        request.sector_offset = pos;
-        request.sector_count = blocks;
+    sequential = (pos == dev->net_last_end) ||
+                 (pos >= dev->prefetch_lsn && pos < dev->prefetch_lsn + dev->prefetch_count);
+
+    while (done < blocks)
+    {
+        uint32_t lsn = pos + done;
+        uint32_t got;
 
-        if (!pb_encode(&output, ServerRequest_fields, &request))
+        if (lsn >= dev->prefetch_lsn && lsn < dev->prefetch_lsn + dev->prefetch_count)
         {
-            return 0;
-        }
+            uint32_t n = min(blocks - done, dev->prefetch_lsn + dev->prefetch_count - lsn);
 
-        /* We signal the end of request with a 0 tag. */
-        pb_write(&output, &zero, 1);
+            memcpy(out + (size_t) done * SACD_LSN_SIZE, dev->input_buffer + (size_t) (lsn - dev->prefetch_lsn) * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+            done += n;
+            continue;
+        }
 
-        // write the output buffer to the opened socket
+        if (dev->net_pending == 0 || dev->net_pending_frames[dev->net_pending_first] ||
+            dev->net_pending_lsn[dev->net_pending_first] != lsn)
         {
-            bool ret;
-            size_t written;
-            ret = (socket_send((p_socket)&dev->fd, (char *)output_buf, output.bytes_written, &written, 0, 0) == IO_DONE && written == output.bytes_written);
+            sacd_net_drain(dev);
+            dev->net_next_lsn = lsn;
+
+            if (sequential)
+                sacd_net_issue_reads(dev, net_read_window, MAX_PROCESSING_BLOCK_SIZE);
+            else
+                sacd_net_issue_reads(dev, 1, min(blocks - done, MAX_PROCESSING_BLOCK_SIZE));
 
-            if (!ret)
-                return 0;
+            if (dev->net_pending == 0)
+                break;
         }
 
-#if 0
-        response.data.bytes = buffer;
+        if (blocks - done >= dev->net_pending_count[dev->net_pending_first])
         {
-            size_t got; 
-            uint8_t *buf_ptr = dev->input_buffer;
-            size_t buf_left = blocks * SACD_LSN_SIZE + 16;
+            got = sacd_net_receive_read(dev, out + (size_t) done * SACD_LSN_SIZE);
+            done += got;
+        }
+        else
+        {
+            got = sacd_net_receive_read(dev, dev->input_buffer);
+            dev->prefetch_lsn = lsn;
+            dev->prefetch_count = got;
+        }
 
-            input = pb_istream_from_buffer(dev->input_buffer, MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE + 1024);
+        if (got == 0)
+        {
+            sacd_net_drain(dev);
+            break;
+        }
 
-            if (socket_recv(&dev->fd, (char *) buf_ptr, buf_left, &got, MSG_PARTIAL, 0) != IO_DONE)
-                return 0;
+        if (sequential)
+            sacd_net_issue_reads(dev, net_read_window, MAX_PROCESSING_BLOCK_SIZE);
+    }
 
-            while(got > 0 && !pb_decode(&input, ServerResponse_fields, &response))
-            {
-                buf_ptr += got;
-                buf_left -= got;
+    dev->net_last_end = pos + done;
+
+    return done;
+}
 
-                if (socket_recv(&dev->fd, (char *) buf_ptr, buf_left, &got, MSG_PARTIAL, 0) != IO_DONE)
-                    return 0;
+/**
+ * let the server parse the audio sectors and receive only the frames. The
+ * range up to end_lsn is read on in blocks of the size of the first call,
+ * with a window of these requests in flight, any other access starts over.
+ */
+static int sacd_net_input_read_frames(sacd_input_t dev, uint32_t pos, uint32_t blocks, uint32_t end_lsn, int frame_flags,
+                                      sacd_input_frame_callback_t frame_callback, void *userdata)
+{
+    uint32_t done = 0;
+    int      restart;
 
-                input = pb_istream_from_buffer(dev->input_buffer, MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE + 1024);
-            }
-        }
-#else
-        response.data.bytes = buffer;
-        if (!pb_decode(&input, ServerResponse_fields, &response))
+    if (!dev || dev->net_protocol < 3)
+    {
+        return -1;
+    }
+
+    end_lsn = max(end_lsn, pos + blocks);
+    restart = (frame_flags & SACD_FRAMES_RESTART) || end_lsn != dev->net_frames_end;
+    if (restart || dev->net_pending == 0 || !dev->net_pending_frames[dev->net_pending_first] ||
+        dev->net_pending_lsn[dev->net_pending_first] != pos)
+    {
+        // the frame parser of the server stands at net_frames_next, it continues only from there
+        if (pos != dev->net_frames_next)
+            restart = 1;
+
+        sacd_net_drain(dev);
+        dev->net_frames_next = pos;
+        dev->net_frames_end = end_lsn;
+        dev->net_frames_block = max(1, min(blocks, MAX_PROCESSING_BLOCK_SIZE));
+        if (sacd_net_issue_frames(dev, net_read_window, restart) != 0)
         {
+            dev->net_frames_end = 0;
             return 0;
         }
-#endif
-        if (response.type != ServerResponse_Type_DISC_READ)
+    }
+
+    while (done < blocks && dev->net_pending > 0 && dev->net_pending_frames[dev->net_pending_first] &&
+           dev->net_pending_lsn[dev->net_pending_first] == pos + done)
+    {
+        uint32_t got = sacd_net_receive_frames(dev, frame_callback, userdata);
+
+        if (got == 0)
         {
-            return 0;
+            // the stream is out of step, the next call starts over
+            sacd_net_drain(dev);
+            dev->net_frames_end = 0;
+            break;
         }
+        done += got;
 
-        if (response.has_data)
+        if (sacd_net_issue_frames(dev, net_read_window, 0) != 0)
         {
-            return (uint32_t) response.result;
+            dev->net_frames_end = 0;
+            break;
         }
     }
 
+    dev->net_last_end = pos + done;
+
+    return (int) done;
+}
+
+static int sacd_input_is_fifo(const char *path)
+{
+#if defined(__lv2ppu__) || defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
+    (void) path;
     return 0;
+#else
+    struct stat file_stat;
+
+    return stat(path, &file_stat) == 0 && S_ISFIFO(file_stat.st_mode);
+#endif
 }
 
 /**
- * Setup read functions with either network or file access
+ * Setup read functions with either network, stream or file access
  */
 int sacd_input_setup(const char* path)
 {
     int net_conn = 0;
+
+    if (strcmp(path, "-") == 0 || sacd_input_is_fifo(path))
+    {
+        sacd_input_open = sacd_stream_input_open;
+        sacd_input_close = sacd_stream_input_close;
+        sacd_input_read = sacd_stream_input_read;
+        sacd_input_error = sacd_dev_input_error;
+        sacd_input_authenticate  = sacd_dev_input_authenticate;
+        sacd_input_decrypt = sacd_dev_input_decrypt;
+        sacd_input_total_sectors = sacd_stream_input_total_sectors;
+        sacd_input_read_frames = 0;
+
+        return 2;
+    }
+
     {
         // TODO: replace this F*(&^*($#^(&*#^$GLY hack to detect IP
         int i = 0;
@@ -618,6 +1132,7 @@ int sacd_input_setup(const char* path)
         sacd_input_authenticate  = sacd_dev_input_authenticate;
         sacd_input_decrypt = sacd_dev_input_decrypt;
         sacd_input_total_sectors = sacd_net_input_total_sectors;
+        sacd_input_read_frames = sacd_net_input_read_frames;
 
         return 1;
     } 
@@ -629,6 +1144,7 @@ int sacd_input_setup(const char* path)
     sacd_input_authenticate  = sacd_dev_input_authenticate;
     sacd_input_decrypt = sacd_dev_input_decrypt;
     sacd_input_total_sectors = sacd_dev_input_total_sectors;
+    sacd_input_read_frames = 0;
 
     return 0;
 } 
@@ -61,6 +61,25 @@
 
 typedef struct sacd_input_s * sacd_input_t;
 
+/* an audio frame assembled by a server from the sectors of a DISC_READ_FRAMES request */
+typedef struct
+{
+    uint8_t    *data;
+    uint32_t    size;
+    uint8_t     minutes;                    /* timecode of the frame */
+    uint8_t     seconds;
+    uint8_t     frames;
+    uint8_t     dst_encoded;
+    uint8_t     channel_count;
+}
+sacd_input_frame_t;
+
+typedef void (*sacd_input_frame_callback_t)(const sacd_input_frame_t *, void *);
+
+/* frame_flags of sacd_input_read_frames() */
+#define SACD_FRAMES_RESTART     1           /* first block of a track, drop any partial frame */
+#define SACD_FRAMES_LAST        2           /* last block of a track, hand out the final frame */
+
 extern sacd_input_t (*sacd_input_open)         (const char *);
 extern int          (*sacd_input_close)        (sacd_input_t);
 extern uint32_t     (*sacd_input_read)         (sacd_input_t, uint32_t, uint32_t, void *);
@@ -69,6 +88,20 @@ extern int          (*sacd_input_authenticate) (sacd_input_t);
 extern int          (*sacd_input_decrypt)      (sacd_input_t, uint8_t *, uint32_t);
 extern uint32_t     (*sacd_input_total_sectors)(sacd_input_t);
 
+/**
+ * Reads a range of audio sectors and calls back for every complete audio frame,
+ * the frames are assembled on the other side of the connection. The sectors up
+ * to the end of the track range (third argument) are requested ahead, so read
+ * them on in order. Returns the number of sectors consumed (can be more than
+ * asked for), 0 on error and -1 when the server is older than protocol 3. File
+ * and stream inputs leave the pointer 0.
+ */
+extern int          (*sacd_input_read_frames)  (sacd_input_t, uint32_t, uint32_t, uint32_t, int, sacd_input_frame_callback_t, void *);
+
+/* returns 0 for a file or device, 1 for a network server, 2 for a forward-only stream ("-" or a fifo) */
 int sacd_input_setup(const char *); 
 
+/* number of DISC_READ requests the network backend keeps in flight on sequential reads (1..16, default 4) */
+void sacd_input_set_read_window(uint32_t);
+
 #endif /* SACD_INPUT_H_INCLUDED */
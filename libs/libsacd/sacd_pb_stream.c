@@ -20,10 +20,13 @@
  */
 
 #include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
 #include <pb_encode.h>
 #include <pb_decode.h>
 
 #include "socket.h"
+#include "scarletbook.h"
 #include "sacd_pb_stream.h"
 
 static bool write_callback(pb_ostream_t *stream, const uint8_t *buf, size_t count)
@@ -71,3 +74,294 @@ pb_istream_t pb_istream_from_socket(p_socket socket)
     pb_istream_t stream = {&read_callback, (void*)socket, SIZE_MAX};
     return stream;
 }
+
+int pb_socket_stream_init(pb_socket_stream_t *stream, p_socket socket)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->socket = socket;
+    stream->recv_buffer = (uint8_t *) malloc(PB_SOCKET_BUFFER_SIZE);
+    stream->send_buffer = (uint8_t *) malloc(PB_SOCKET_BUFFER_SIZE);
+    if (!stream->recv_buffer || !stream->send_buffer)
+    {
+        pb_socket_stream_destroy(stream);
+        return -1;
+    }
+    return 0;
+}
+
+void pb_socket_stream_destroy(pb_socket_stream_t *stream)
+{
+    free(stream->recv_buffer);
+    free(stream->send_buffer);
+    stream->recv_buffer = 0;
+    stream->send_buffer = 0;
+}
+
+/* moves the buffered bytes written since the last mark into the gather list */
+static void socket_stream_mark(pb_socket_stream_t *stream)
+{
+    if (stream->send_len > stream->send_mark)
+    {
+        stream->send_iov[stream->send_iov_count].data = (const char *) stream->send_buffer + stream->send_mark;
+        stream->send_iov[stream->send_iov_count].count = stream->send_len - stream->send_mark;
+        stream->send_iov_count++;
+        stream->send_mark = stream->send_len;
+    }
+}
+
+bool pb_socket_stream_flush(pb_socket_stream_t *stream)
+{
+    size_t sent, total = 0;
+    int i, ret;
+
+    socket_stream_mark(stream);
+    if (stream->send_iov_count == 0)
+        return true;
+
+    for (i = 0; i < stream->send_iov_count; i++)
+        total += stream->send_iov[i].count;
+
+    if (stream->deliver)
+    {
+        ret = stream->deliver(stream->deliver_context, stream->send_iov, stream->send_iov_count) ? IO_DONE : IO_UNKNOWN;
+        sent = total;
+    }
+    else
+    {
+        ret = socket_sendv(stream->socket, stream->send_iov, stream->send_iov_count, &sent, 0);
+    }
+
+    stream->send_len = 0;
+    stream->send_mark = 0;
+    stream->send_iov_count = 0;
+
+    return ret == IO_DONE && sent == total;
+}
+
+static bool buffered_write_callback(pb_ostream_t *ostream, const uint8_t *buf, size_t count)
+{
+    pb_socket_stream_t *stream = (pb_socket_stream_t *) ostream->state;
+
+    if (count >= PB_SOCKET_BYPASS_SIZE)
+    {
+        /* keep room for the buffered bytes before and after this payload */
+        if (stream->send_iov_count + 3 > SOCKET_MAX_IOBUF)
+        {
+            if (!pb_socket_stream_flush(stream))
+                return false;
+        }
+        socket_stream_mark(stream);
+        stream->send_iov[stream->send_iov_count].data = (const char *) buf;
+        stream->send_iov[stream->send_iov_count].count = count;
+        stream->send_iov_count++;
+        return true;
+    }
+
+    if (stream->send_len + count > PB_SOCKET_BUFFER_SIZE)
+    {
+        if (!pb_socket_stream_flush(stream))
+            return false;
+    }
+    memcpy(stream->send_buffer + stream->send_len, buf, count);
+    stream->send_len += count;
+    return true;
+}
+
+static bool buffered_read_callback(pb_istream_t *istream, uint8_t *buf, size_t count)
+{
+    pb_socket_stream_t *stream = (pb_socket_stream_t *) istream->state;
+    size_t got;
+    int result;
+
+    while (count > 0)
+    {
+        size_t avail = stream->recv_len - stream->recv_pos;
+
+        if (avail > 0)
+        {
+            size_t n = avail < count ? avail : count;
+            if (buf != NULL)
+            {
+                memcpy(buf, stream->recv_buffer + stream->recv_pos, n);
+                buf += n;
+            }
+            stream->recv_pos += n;
+            count -= n;
+            continue;
+        }
+
+        if (buf != NULL && count >= PB_SOCKET_BYPASS_SIZE)
+        {
+            /* bulk payload, straight into the caller's memory */
+            result = socket_recv(stream->socket, (char *) buf, count, &got, MSG_WAITALL, 0);
+            if (result != IO_DONE)
+                break;
+            buf += got;
+            count -= got;
+            continue;
+        }
+
+        result = socket_recv(stream->socket, (char *) stream->recv_buffer, PB_SOCKET_BUFFER_SIZE, &got, 0, 0);
+        if (result != IO_DONE)
+            break;
+        stream->recv_pos = 0;
+        stream->recv_len = got;
+    }
+
+    if (count > 0)
+        istream->bytes_left = 0; /* EOF */
+
+    return count == 0;
+}
+
+pb_ostream_t pb_ostream_from_socket_stream(pb_socket_stream_t *stream)
+{
+    pb_ostream_t ostream = {&buffered_write_callback, (void*)stream, SIZE_MAX, 0};
+    return ostream;
+}
+
+pb_istream_t pb_istream_from_socket_stream(pb_socket_stream_t *stream)
+{
+    pb_istream_t istream = {&buffered_read_callback, (void*)stream, SIZE_MAX};
+    return istream;
+}
+
+static int sector_is_zero(const uint8_t *sector)
+{
+    const uint64_t *p = (const uint64_t *) sector;
+    const uint64_t *e = p + SACD_LSN_SIZE / sizeof(uint64_t);
+
+    while (p < e)
+    {
+        if (*p++ != 0)
+            return 0;
+    }
+    return 1;
+}
+
+bool pb_socket_stream_write_sectors(pb_socket_stream_t *stream, const uint8_t *data, uint32_t sector_count)
+{
+    pb_ostream_t output = pb_ostream_from_socket_stream(stream);
+    uint32_t i = 0;
+
+    while (i < sector_count)
+    {
+        int      zero = sector_is_zero(data + (size_t) i * SACD_LSN_SIZE);
+        uint32_t n = 1;
+        uint8_t  header[4];
+        uint32_t word;
+
+        while (i + n < sector_count && sector_is_zero(data + (size_t) (i + n) * SACD_LSN_SIZE) == zero)
+            n++;
+
+        word = n | (zero ? SACD_SECTOR_RUN_ZERO : 0);
+        header[0] = (uint8_t) word;
+        header[1] = (uint8_t) (word >> 8);
+        header[2] = (uint8_t) (word >> 16);
+        header[3] = (uint8_t) (word >> 24);
+
+        if (!pb_write(&output, header, sizeof(header)))
+            return false;
+
+        if (!zero && !pb_write(&output, data + (size_t) i * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE))
+            return false;
+
+        i += n;
+    }
+    return true;
+}
+
+bool pb_socket_stream_read_sectors(pb_socket_stream_t *stream, uint8_t *data, uint32_t sector_count)
+{
+    pb_istream_t input = pb_istream_from_socket_stream(stream);
+    uint32_t i = 0;
+
+    while (i < sector_count)
+    {
+        uint8_t  header[4];
+        uint32_t word, n;
+
+        if (!pb_read(&input, header, sizeof(header)))
+            return false;
+
+        word = (uint32_t) header[0] | ((uint32_t) header[1] << 8) | ((uint32_t) header[2] << 16) | ((uint32_t) header[3] << 24);
+        n = word & ~SACD_SECTOR_RUN_ZERO;
+        if (n == 0 || n > sector_count - i)
+            return false;
+
+        if (word & SACD_SECTOR_RUN_ZERO)
+            memset(data + (size_t) i * SACD_LSN_SIZE, 0, (size_t) n * SACD_LSN_SIZE);
+        else if (!pb_read(&input, data + (size_t) i * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE))
+            return false;
+
+        i += n;
+    }
+    return true;
+}
+
+/* always copies, unlike buffered_write_callback() which references bulk payloads */
+static bool socket_stream_copy(pb_socket_stream_t *stream, const uint8_t *buf, size_t count)
+{
+    while (count > 0)
+    {
+        size_t n;
+
+        if (stream->send_len == PB_SOCKET_BUFFER_SIZE)
+        {
+            if (!pb_socket_stream_flush(stream))
+                return false;
+        }
+        n = PB_SOCKET_BUFFER_SIZE - stream->send_len;
+        if (n > count)
+            n = count;
+        memcpy(stream->send_buffer + stream->send_len, buf, n);
+        stream->send_len += n;
+        buf += n;
+        count -= n;
+    }
+    return true;
+}
+
+bool pb_socket_stream_write_frame(pb_socket_stream_t *stream, const sacd_input_frame_t *frame)
+{
+    uint8_t  header[8];
+    uint32_t size = frame ? frame->size : SACD_FRAME_END;
+
+    header[0] = (uint8_t) size;
+    header[1] = (uint8_t) (size >> 8);
+    header[2] = (uint8_t) (size >> 16);
+    header[3] = (uint8_t) (size >> 24);
+    header[4] = frame ? frame->minutes : 0;
+    header[5] = frame ? frame->seconds : 0;
+    header[6] = frame ? frame->frames : 0;
+    header[7] = frame ? (uint8_t) (frame->channel_count | (frame->dst_encoded ? SACD_FRAME_DST : 0)) : 0;
+
+    if (!socket_stream_copy(stream, header, sizeof(header)))
+        return false;
+
+    return !frame || socket_stream_copy(stream, frame->data, frame->size);
+}
+
+bool pb_socket_stream_read_frame(pb_socket_stream_t *stream, sacd_input_frame_t *frame, uint32_t max_size)
+{
+    pb_istream_t input = pb_istream_from_socket_stream(stream);
+    uint8_t      header[8];
+
+    if (!pb_read(&input, header, sizeof(header)))
+        return false;
+
+    frame->size = (uint32_t) header[0] | ((uint32_t) header[1] << 8) | ((uint32_t) header[2] << 16) | ((uint32_t) header[3] << 24);
+    frame->minutes = header[4];
+    frame->seconds = header[5];
+    frame->frames = header[6];
+    frame->dst_encoded = (header[7] & SACD_FRAME_DST) != 0;
+    frame->channel_count = header[7] & ~SACD_FRAME_DST;
+
+    if (frame->size == SACD_FRAME_END)
+        return true;
+
+    if (frame->size > max_size)
+        return false;
+
+    return pb_read(&input, frame->data, frame->size);
+}
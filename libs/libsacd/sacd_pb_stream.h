@@ -25,8 +25,77 @@
 #include <pb.h>
 
 #include "socket.h"
+#include "sacd_input.h"
 
 pb_ostream_t pb_ostream_from_socket(p_socket socket);
 pb_istream_t pb_istream_from_socket(p_socket socket);
 
+/* size of the receive and send buffers of a socket stream */
+#define PB_SOCKET_BUFFER_SIZE (64 * 1024)
+/* reads and writes of at least this size bypass the buffers */
+#define PB_SOCKET_BYPASS_SIZE 4096
+
+/* takes the gathered writes of a flush instead of the socket, see pb_socket_stream_t */
+typedef bool (*pb_socket_deliver_t)(void *context, const t_iobuf *bufs, int nbufs);
+
+/**
+ * Buffered stream over a socket, one per connection. Small reads are served
+ * from a large receive buffer, bulk payloads are received straight into the
+ * caller's memory. Writes are gathered and go out with one send on
+ * pb_socket_stream_flush(); bulk payloads are referenced, not copied, so they
+ * must stay valid until the flush. With deliver set the flush hands them to
+ * deliver, which has to copy what it keeps.
+ */
+typedef struct
+{
+    p_socket    socket;
+    uint8_t    *recv_buffer;
+    size_t      recv_pos;
+    size_t      recv_len;
+    uint8_t    *send_buffer;
+    size_t      send_len;
+    size_t      send_mark;          /* start of the buffered bytes not yet in send_iov */
+    t_iobuf     send_iov[SOCKET_MAX_IOBUF];
+    int         send_iov_count;
+    pb_socket_deliver_t deliver;
+    void       *deliver_context;
+} pb_socket_stream_t;
+
+int pb_socket_stream_init(pb_socket_stream_t *stream, p_socket socket);
+void pb_socket_stream_destroy(pb_socket_stream_t *stream);
+bool pb_socket_stream_flush(pb_socket_stream_t *stream);
+
+pb_ostream_t pb_ostream_from_socket_stream(pb_socket_stream_t *stream);
+pb_istream_t pb_istream_from_socket_stream(pb_socket_stream_t *stream);
+
+/* highest network protocol version, negotiated with DISC_OPEN */
+#define SACD_PROTOCOL_VERSION 3
+
+/**
+ * Protocol v2 sends the sectors of a DISC_READ response as raw runs right
+ * after the (data-less) ServerResponse. Every run starts with a 32 bit
+ * little endian word: the sector count, with SACD_SECTOR_RUN_ZERO set for a
+ * run of all-zero sectors that has no payload. Data runs are followed by
+ * their sectors. The runs add up to the sector count in response.result.
+ */
+#define SACD_SECTOR_RUN_ZERO 0x80000000U
+
+bool pb_socket_stream_write_sectors(pb_socket_stream_t *stream, const uint8_t *data, uint32_t sector_count);
+bool pb_socket_stream_read_sectors(pb_socket_stream_t *stream, uint8_t *data, uint32_t sector_count);
+
+/**
+ * Protocol v3 adds DISC_READ_FRAMES. Its response is followed by the audio
+ * frames the server assembled: an 8 byte header per frame (32 bit little
+ * endian size, the minutes, seconds and frames of the timecode, and the
+ * channel count with SACD_FRAME_DST set for DST frames) and the frame data.
+ * A size of SACD_FRAME_END closes the list.
+ */
+#define SACD_FRAME_END 0xFFFFFFFFU
+#define SACD_FRAME_DST 0x80
+
+/* frame == 0 writes the end marker. The frame data is copied, it may be reused right away. */
+bool pb_socket_stream_write_frame(pb_socket_stream_t *stream, const sacd_input_frame_t *frame);
+/* frame->data must hold max_size bytes, frame->size is SACD_FRAME_END at the end of the list */
+bool pb_socket_stream_read_frame(pb_socket_stream_t *stream, sacd_input_frame_t *frame, uint32_t max_size);
+
 #endif /* _SACD_PB_STREAM_H_ */
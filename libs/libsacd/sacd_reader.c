@@ -53,6 +53,16 @@ struct sacd_reader_s
 
     /* Information required for an image file. */
     sacd_input_t dev;
+
+    /* Forward-only input, only one area can be reached. */
+    int          sequential;
+
+    /* Sectors can be read from several threads at once. */
+    int          parallel;
+    int          stream_area;
+
+    /* optional cache in front of dev */
+    sector_cache_t *cache;
 };
 
 /**
@@ -62,8 +72,9 @@ static sacd_reader_t *sacd_open_image_file(const char *location)
 {
     sacd_reader_t *sacd;
     sacd_input_t  dev;
+    int           input_type;
 
-    sacd_input_setup(location);
+    input_type = sacd_input_setup(location);
 
     dev = sacd_input_open(location);
     if (!dev)
@@ -80,6 +91,14 @@ static sacd_reader_t *sacd_open_image_file(const char *location)
     }
     sacd->is_image_file = 1;
     sacd->dev           = dev;
+    sacd->sequential    = (input_type == 2);
+#if defined(__lv2ppu__) || defined(WIN32) || defined(_WIN32)
+    sacd->parallel      = 0;              // a shared file position (lseek + read)
+#else
+    sacd->parallel      = (input_type == 0);
+#endif
+    sacd->stream_area   = 0;
+    sacd->cache         = 0;
 
     return sacd;
 }
@@ -170,6 +189,14 @@ sacd_reader_t *sacd_open(const char *ppath)
     }
 #endif
 
+    /* "-" reads the image from stdin */
+    if (strcmp(path, "-") == 0)
+    {
+        ret_val = sacd_open_image_file(path);
+        free(path);
+        return ret_val;
+    }
+
 #if defined(WIN32) || defined(_WIN32)
     wchar_t *w_pathname;
     
@@ -207,7 +234,8 @@ sacd_reader_t *sacd_open(const char *ppath)
 #else   
     if (S_ISBLK(fileinfo.st_mode) ||
         S_ISCHR(fileinfo.st_mode) ||
-        S_ISREG(fileinfo.st_mode))
+        S_ISREG(fileinfo.st_mode) ||
+        S_ISFIFO(fileinfo.st_mode))
 #endif        
     {
         /**
@@ -395,6 +423,7 @@ void sacd_close(sacd_reader_t *sacd)
 {
     if (sacd)
     {
+        sector_cache_destroy(sacd->cache);
         if (sacd->dev)
             sacd_input_close(sacd->dev);
         free(sacd);
@@ -411,11 +440,51 @@ uint32_t sacd_read_block_raw(sacd_reader_t *sacd, uint32_t lb_number,
         return 0;
     }
 
-    ret = sacd_input_read(sacd->dev, lb_number,  block_count, (void *) data);
+    if (sacd->cache)
+        ret = sector_cache_read(sacd->cache, lb_number, block_count, data);
+    else
+        ret = sacd_input_read(sacd->dev, lb_number,  block_count, (void *) data);
 
     return ret;
 }
 
+static uint32_t read_input(void *context, uint32_t lsn, uint32_t count, uint8_t *buffer)
+{
+    return sacd_input_read((sacd_input_t) context, lsn, count, (void *) buffer);
+}
+
+int sacd_set_cache(sacd_reader_t *sacd, uint32_t max_sectors)
+{
+    sector_cache_destroy(sacd->cache);
+    sacd->cache = 0;
+
+    // a stream can't go back to the start of a run
+    if (max_sectors == 0 || sacd->sequential || !sacd->dev)
+        return 0;
+
+    sacd->cache = sector_cache_create(max_sectors, read_input, sacd->dev);
+
+    return sacd->cache ? 0 : -1;
+}
+
+int sacd_get_cache_stats(sacd_reader_t *sacd, sector_cache_stats_t *stats)
+{
+    if (!sacd->cache)
+        return -1;
+
+    sector_cache_get_stats(sacd->cache, stats);
+    return 0;
+}
+
+int sacd_read_frames(sacd_reader_t *sacd, uint32_t lb_number, uint32_t block_count, uint32_t end_lsn, int frame_flags,
+                     sacd_input_frame_callback_t frame_callback, void *userdata)
+{
+    if (!sacd->dev || !sacd_input_read_frames)
+        return -1;
+
+    return sacd_input_read_frames(sacd->dev, lb_number, block_count, end_lsn, frame_flags, frame_callback, userdata);
+}
+
 int sacd_authenticate(sacd_reader_t *sacd)
 {
     if (!sacd->dev)
@@ -440,3 +509,22 @@ uint32_t sacd_get_total_sectors(sacd_reader_t *sacd)
     return sacd_input_total_sectors(sacd->dev);
 }
 
+int sacd_is_sequential(sacd_reader_t *sacd)
+{
+    return sacd->sequential;
+}
+
+int sacd_can_read_in_parallel(sacd_reader_t *sacd)
+{
+    return sacd->parallel;
+}
+
+void sacd_set_stream_area(sacd_reader_t *sacd, int multi_channel)
+{
+    sacd->stream_area = multi_channel;
+}
+
+int sacd_get_stream_area(sacd_reader_t *sacd)
+{
+    return sacd->stream_area;
+}
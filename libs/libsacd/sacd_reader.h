@@ -32,6 +32,7 @@
 #include <inttypes.h>
 
 #include "sacd_input.h"
+#include "sector_cache.h"
 
 /**
  * The SACD access interface.
@@ -81,6 +82,17 @@ void sacd_close(sacd_reader_t *);
  */
 uint32_t sacd_read_block_raw(sacd_reader_t *, uint32_t, uint32_t, uint8_t *);
 
+/**
+ * Reads audio sectors that a sacd server parses into frames, only the frames
+ * cross the network. Returns the number of sectors consumed, 0 on error and
+ * -1 when the input can't assemble frames (then read the sectors raw and
+ * use scarletbook_process_frames()). end_lsn is the end of the track range,
+ * the sectors up to it are requested ahead.
+ *
+ * sacd_read_frames(sacd, lb_number, block_count, end_lsn, frame_flags, frame_callback, userdata);
+ */
+int sacd_read_frames(sacd_reader_t *, uint32_t, uint32_t, uint32_t, int, sacd_input_frame_callback_t, void *);
+
 /**
  * Decrypts audio sectors, only available on PS3
  */
@@ -96,6 +108,41 @@ int sacd_authenticate(sacd_reader_t *);
  */
 uint32_t sacd_get_total_sectors(sacd_reader_t *);
 
+/**
+ * Puts an LRU cache of max_sectors in front of the input, so sectors that
+ * are read again (TOC copies, track boundaries, a second output format)
+ * don't go back to the disc or the server. 0 removes the cache, forward-only
+ * streams are never cached. Returns 0 on success.
+ */
+int sacd_set_cache(sacd_reader_t *, uint32_t max_sectors);
+
+/**
+ * copies the cache counters, returns -1 when there is no cache
+ */
+int sacd_get_cache_stats(sacd_reader_t *, sector_cache_stats_t *);
+
+/**
+ * returns 1 when the input is a forward-only stream (stdin or a fifo).
+ * Sectors must then be read in ascending order, apart from the TOC
+ * sectors at the start of the stream.
+ */
+int sacd_is_sequential(sacd_reader_t *);
+
+/**
+ * returns 1 when sectors can be read from several threads at once
+ * (an image file or a device read with pread), 0 for network and
+ * stream inputs that keep a single position.
+ */
+int sacd_can_read_in_parallel(sacd_reader_t *);
+
+/**
+ * Selects which area scarletbook_open() reads from a forward-only stream,
+ * 0 = two channel (default), 1 = multi channel. Reaching the multi channel
+ * TOC skips over the whole two channel area.
+ */
+void sacd_set_stream_area(sacd_reader_t *, int);
+int sacd_get_stream_area(sacd_reader_t *);
+
 #ifdef __cplusplus
 };
 #endif
@@ -5,7 +5,7 @@ const uint32_t ServerRequest_sector_offset_default = 0;
 const uint32_t ServerRequest_sector_count_default = 0;
 
 
-const pb_field_t ServerRequest_fields[4] = {
+const pb_field_t ServerRequest_fields[6] = {
     {1, PB_HTYPE_REQUIRED | PB_LTYPE_VARINT,
     offsetof(ServerRequest, type), 0,
     pb_membersize(ServerRequest, type), 0, 0},
@@ -20,10 +20,20 @@ const pb_field_t ServerRequest_fields[4] = {
     pb_membersize(ServerRequest, sector_count), 0,
     &ServerRequest_sector_count_default},
 
+    {4, PB_HTYPE_OPTIONAL | PB_LTYPE_VARINT,
+    pb_delta_end(ServerRequest, protocol_version, sector_count),
+    pb_delta(ServerRequest, has_protocol_version, protocol_version),
+    pb_membersize(ServerRequest, protocol_version), 0, 0},
+
+    {5, PB_HTYPE_OPTIONAL | PB_LTYPE_VARINT,
+    pb_delta_end(ServerRequest, frame_flags, protocol_version),
+    pb_delta(ServerRequest, has_frame_flags, frame_flags),
+    pb_membersize(ServerRequest, frame_flags), 0, 0},
+
     PB_LAST_FIELD
 };
 
-const pb_field_t ServerResponse_fields[4] = {
+const pb_field_t ServerResponse_fields[5] = {
     {1, PB_HTYPE_REQUIRED | PB_LTYPE_VARINT,
     offsetof(ServerResponse, type), 0,
     pb_membersize(ServerResponse, type), 0, 0},
@@ -32,8 +42,14 @@ const pb_field_t ServerResponse_fields[4] = {
     pb_delta_end(ServerResponse, result, type), 0,
     pb_membersize(ServerResponse, result), 0, 0},
 
+    /* data_size of the bytes field is its maximum, so it has to stay last */
+    {4, PB_HTYPE_OPTIONAL | PB_LTYPE_VARINT,
+    pb_delta_end(ServerResponse, protocol_version, result),
+    pb_delta(ServerResponse, has_protocol_version, protocol_version),
+    pb_membersize(ServerResponse, protocol_version), 0, 0},
+
     {3, PB_HTYPE_OPTIONAL | PB_LTYPE_BYTES,
-    pb_delta_end(ServerResponse, data, result),
+    pb_delta_end(ServerResponse, data, protocol_version),
     pb_delta(ServerResponse, has_data, data),
     512 * 2048, 0, 0},
 
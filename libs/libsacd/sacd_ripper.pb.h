@@ -7,14 +7,16 @@ typedef enum {
     ServerRequest_Type_DISC_OPEN = 1,
     ServerRequest_Type_DISC_CLOSE = 2,
     ServerRequest_Type_DISC_READ = 3,
-    ServerRequest_Type_DISC_SIZE = 4
+    ServerRequest_Type_DISC_SIZE = 4,
+    ServerRequest_Type_DISC_READ_FRAMES = 5
 } ServerRequest_Type;
 
 typedef enum {
     ServerResponse_Type_DISC_OPENED = 1,
     ServerResponse_Type_DISC_CLOSED = 2,
     ServerResponse_Type_DISC_READ = 3,
-    ServerResponse_Type_DISC_SIZE = 4
+    ServerResponse_Type_DISC_SIZE = 4,
+    ServerResponse_Type_DISC_READ_FRAMES = 5
 } ServerResponse_Type;
 
 /* Struct definitions */
@@ -22,6 +24,10 @@ typedef struct {
     ServerRequest_Type type;
     uint32_t sector_offset;
     uint32_t sector_count;
+    bool has_protocol_version;
+    uint32_t protocol_version;
+    bool has_frame_flags;
+    uint32_t frame_flags;
 } ServerRequest;
 
 typedef struct {
@@ -32,6 +38,8 @@ typedef struct {
 typedef struct {
     ServerResponse_Type type;
     int64_t result;
+    bool has_protocol_version;
+    uint32_t protocol_version;
     bool has_data;
     ServerResponse_data_t data;
 } ServerResponse;
@@ -41,7 +49,7 @@ extern const uint32_t ServerRequest_sector_offset_default;
 extern const uint32_t ServerRequest_sector_count_default;
 
 /* Struct field encoding specification for nanopb */
-extern const pb_field_t ServerRequest_fields[4];
-extern const pb_field_t ServerResponse_fields[4];
+extern const pb_field_t ServerRequest_fields[6];
+extern const pb_field_t ServerResponse_fields[5];
 
 #endif
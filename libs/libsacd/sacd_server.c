@@ -0,0 +1,519 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pb.h>
+#include <pb_encode.h>
+#include <pb_decode.h>
+#include <utils.h>
+#include <logging.h>
+#include <timeout.h>
+#ifndef __lv2ppu__
+#include <yarn.h>
+#endif
+
+#include "scarletbook.h"
+#include "scarletbook_read.h"
+#include "sacd_reader.h"
+#include "sacd_pb_stream.h"
+#include "sacd_ripper.pb.h"
+#include "sacd_server.h"
+
+#ifndef __lv2ppu__
+/* a response held back by the shaper, the bytes follow the header */
+typedef struct delayed_response_s
+{
+    struct delayed_response_s *next;
+    double                due;
+    size_t                size;
+}
+delayed_response_t;
+
+/* delivers the responses of a session late, see sacd_server_config_t */
+typedef struct
+{
+    p_socket              socket;
+    double                latency;              /* s */
+    double                bandwidth;            /* bytes/s, 0 is unlimited */
+    double                request_time;         /* arrival of the request being served */
+    double                link_free;            /* the link is busy sending until then */
+    lock                 *queue_lock;           /* number of queued responses */
+    delayed_response_t   *head;
+    delayed_response_t   *tail;
+    int                   closing;
+    int                   error;
+    thread               *writer;
+}
+response_shaper_t;
+#endif
+
+typedef struct
+{
+    const sacd_server_config_t *config;
+    pb_socket_stream_t    stream;
+#ifndef __lv2ppu__
+    response_shaper_t    *shaper;
+#endif
+    sacd_reader_t        *sacd_reader;
+    scarletbook_handle_t *handle;
+    scarletbook_frame_parser_t *frame_parser;
+    uint8_t              *buffer;
+    uint32_t              protocol_version;
+    uint32_t              encrypted_start_1;
+    uint32_t              encrypted_end_1;
+    uint32_t              encrypted_start_2;
+    uint32_t              encrypted_end_2;
+    int                   non_encrypted_disc;
+    int                   checked_for_non_encrypted_disc;
+    int                   frame_error;
+}
+server_session_t;
+
+static void session_close_disc(server_session_t *session)
+{
+    if (session->frame_parser)
+    {
+        scarletbook_frame_parser_destroy(session->frame_parser);
+        session->frame_parser = 0;
+    }
+    if (session->handle)
+    {
+        scarletbook_close(session->handle);
+        session->handle = 0;
+    }
+    if (session->sacd_reader)
+    {
+        // a shared disc stays open for the other sessions
+        if (!session->config->sacd_reader)
+            sacd_close(session->sacd_reader);
+        session->sacd_reader = 0;
+    }
+}
+
+static int session_open_disc(server_session_t *session)
+{
+    const char *path = session->config->path ? session->config->path : "shared disc";
+
+    session_close_disc(session);
+
+    session->sacd_reader = session->config->sacd_reader ? session->config->sacd_reader : sacd_open(path);
+    if (!session->sacd_reader)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_server_session(): can't open %s", path));
+        return -1;
+    }
+
+    session->handle = scarletbook_open(session->sacd_reader);
+    session->checked_for_non_encrypted_disc = 0;
+    session->non_encrypted_disc = 0;
+    session->encrypted_start_1 = session->encrypted_end_1 = 0;
+    session->encrypted_start_2 = session->encrypted_end_2 = 0;
+
+    if (!session->handle)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_server_session(): %s is not a ScarletBook disc", path));
+        return -1;
+    }
+
+    session->frame_parser = scarletbook_frame_parser_create(session->handle);
+    if (!session->frame_parser)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_server_session(): Could not allocate memory"));
+        return -1;
+    }
+
+    // set the encryption range
+    if (session->handle->area[0].area_toc != 0)
+    {
+        session->encrypted_start_1 = session->handle->area[0].area_toc->track_start;
+        session->encrypted_end_1 = session->handle->area[0].area_toc->track_end;
+    }
+    if (session->handle->area[1].area_toc != 0)
+    {
+        session->encrypted_start_2 = session->handle->area[1].area_toc->track_start;
+        session->encrypted_end_2 = session->handle->area[1].area_toc->track_end;
+    }
+
+    return sacd_authenticate(session->sacd_reader);
+}
+
+/**
+ * reads up to sector_count sectors into session->buffer and decrypts them,
+ * a read never crosses the border of an encrypted range.
+ */
+static int session_read(server_session_t *session, uint32_t sector_offset, uint32_t sector_count)
+{
+    uint32_t block_size;
+    uint32_t blocks_read;
+    int      encrypted = 0;
+
+    // check what block ranges are encrypted..
+    if (sector_offset < session->encrypted_start_1)
+    {
+        block_size = session->encrypted_start_1 - sector_offset;
+    }
+    else if (sector_offset <= session->encrypted_end_1)
+    {
+        block_size = session->encrypted_end_1 + 1 - sector_offset;
+        encrypted = 1;
+    }
+    else if (sector_offset < session->encrypted_start_2)
+    {
+        block_size = session->encrypted_start_2 - sector_offset;
+    }
+    else if (sector_offset <= session->encrypted_end_2)
+    {
+        block_size = session->encrypted_end_2 + 1 - sector_offset;
+        encrypted = 1;
+    }
+    else
+    {
+        block_size = MAX_PROCESSING_BLOCK_SIZE;
+    }
+    block_size = min(min(sector_count, block_size), MAX_PROCESSING_BLOCK_SIZE);
+
+    blocks_read = sacd_read_block_raw(session->sacd_reader, sector_offset, block_size, session->buffer);
+    if (blocks_read == 0)
+    {
+        return 0;
+    }
+
+    // the ATAPI call which returns the flag if the disc is encrypted or not is unknown at this point.
+    // user reports tell me that the only non-encrypted discs out there are DSD 3 14/16 discs.
+    // this is a quick hack/fix for these discs.
+    if (encrypted && session->checked_for_non_encrypted_disc == 0 && session->handle->area[0].area_toc != 0)
+    {
+        switch (session->handle->area[0].area_toc->frame_format)
+        {
+        case FRAME_FORMAT_DSD_3_IN_14:
+        case FRAME_FORMAT_DSD_3_IN_16:
+            session->non_encrypted_disc = *(uint64_t *)(session->buffer + 16) == 0;
+            break;
+        }
+
+        session->checked_for_non_encrypted_disc = 1;
+    }
+
+    // encrypted blocks need to be decrypted first
+    if (encrypted && session->non_encrypted_disc == 0)
+    {
+        sacd_decrypt(session->sacd_reader, session->buffer, blocks_read);
+    }
+
+    return (int) blocks_read;
+}
+
+static void send_frame(scarletbook_frame_parser_t *parser, uint8_t *frame_data, size_t frame_size, void *userdata)
+{
+    server_session_t  *session = (server_session_t *) userdata;
+    sacd_input_frame_t frame;
+
+    frame.data = frame_data;
+    frame.size = (uint32_t) frame_size;
+    frame.minutes = parser->frame.timecode.minutes;
+    frame.seconds = parser->frame.timecode.seconds;
+    frame.frames = parser->frame.timecode.frames;
+    frame.dst_encoded = (uint8_t) parser->frame.dst_encoded;
+    frame.channel_count = (uint8_t) parser->frame.channel_count;
+
+    if (!session->frame_error && !pb_socket_stream_write_frame(&session->stream, &frame))
+    {
+        session->frame_error = 1;
+    }
+}
+
+#ifndef __lv2ppu__
+static void shaper_wait_until(double when)
+{
+    t_timeout tm;
+    double    now = timeout_gettime();
+
+    if (when > now)
+    {
+        timeout_init(&tm, when - now, -1);
+        timeout_markstart(&tm);
+        socket_select(0, NULL, NULL, NULL, &tm);
+    }
+}
+
+static void shaper_thread(void *userdata)
+{
+    response_shaper_t  *shaper = (response_shaper_t *) userdata;
+    delayed_response_t *response;
+    t_iobuf             buf;
+    size_t              sent;
+    double              send_time;
+
+    for (;;)
+    {
+        possess(shaper->queue_lock);
+        wait_for(shaper->queue_lock, NOT_TO_BE, 0);
+        response = shaper->head;
+        if (!response)
+        {
+            // closing and all sent
+            release(shaper->queue_lock);
+            break;
+        }
+        shaper->head = response->next;
+        if (!shaper->head)
+            shaper->tail = 0;
+        twist(shaper->queue_lock, BY, -1);
+
+        // the link sends one response after the other
+        send_time = max(response->due, shaper->link_free);
+        if (shaper->bandwidth > 0)
+            send_time += (double) response->size / shaper->bandwidth;
+        shaper->link_free = send_time;
+        shaper_wait_until(send_time);
+
+        buf.data = (const char *) (response + 1);
+        buf.count = response->size;
+        if (!shaper->error && (socket_sendv(shaper->socket, &buf, 1, &sent, 0) != IO_DONE || sent != response->size))
+        {
+            shaper->error = 1;
+        }
+        free(response);
+    }
+}
+
+/* pb_socket_deliver_t of a shaped session, queues a copy of the flushed bytes */
+static bool shaper_deliver(void *context, const t_iobuf *bufs, int nbufs)
+{
+    response_shaper_t  *shaper = (response_shaper_t *) context;
+    delayed_response_t *response;
+    uint8_t            *data;
+    size_t              size = 0;
+    int                 i;
+
+    if (shaper->error)
+        return false;
+
+    for (i = 0; i < nbufs; i++)
+        size += bufs[i].count;
+
+    response = (delayed_response_t *) malloc(sizeof(delayed_response_t) + size);
+    if (!response)
+        return false;
+    response->next = 0;
+    response->due = shaper->request_time + shaper->latency;
+    response->size = size;
+    data = (uint8_t *) (response + 1);
+    for (i = 0; i < nbufs; i++)
+    {
+        memcpy(data, bufs[i].data, bufs[i].count);
+        data += bufs[i].count;
+    }
+
+    possess(shaper->queue_lock);
+    if (shaper->tail)
+        shaper->tail->next = response;
+    else
+        shaper->head = response;
+    shaper->tail = response;
+    twist(shaper->queue_lock, BY, 1);
+
+    return true;
+}
+
+static response_shaper_t *shaper_create(p_socket client, const sacd_server_config_t *config)
+{
+    response_shaper_t *shaper = (response_shaper_t *) calloc(1, sizeof(response_shaper_t));
+
+    if (!shaper)
+        return 0;
+
+    shaper->socket = client;
+    shaper->latency = config->latency / 1000.0;
+    shaper->bandwidth = config->bandwidth * 1024.0;
+    shaper->queue_lock = new_lock(0);
+    shaper->writer = launch(shaper_thread, shaper);
+
+    return shaper;
+}
+
+/* sends what is still queued, then stops the writer */
+static void shaper_destroy(response_shaper_t *shaper)
+{
+    possess(shaper->queue_lock);
+    shaper->closing = 1;
+    twist(shaper->queue_lock, BY, 1);
+    join(shaper->writer);
+    free_lock(shaper->queue_lock);
+    free(shaper);
+}
+#endif
+
+int sacd_server_session(p_socket client, const sacd_server_config_t *config)
+{
+    server_session_t session;
+    ServerRequest    request;
+    ServerResponse   response;
+    uint8_t          zero = 0;
+    pb_istream_t     input;
+    pb_ostream_t     output;
+    int              ret = -1;
+
+    memset(&session, 0, sizeof(session));
+    session.config = config;
+    session.protocol_version = 1;
+    session.buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    if (!session.buffer || pb_socket_stream_init(&session.stream, client) != 0)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sacd_server_session(): Could not allocate memory"));
+        free(session.buffer);
+        return -1;
+    }
+
+#ifndef __lv2ppu__
+    if (config->latency > 0 || config->bandwidth > 0)
+    {
+        session.shaper = shaper_create(client, config);
+        if (!session.shaper)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sacd_server_session(): Could not allocate memory"));
+            free(session.buffer);
+            pb_socket_stream_destroy(&session.stream);
+            return -1;
+        }
+        session.stream.deliver = shaper_deliver;
+        session.stream.deliver_context = session.shaper;
+    }
+#endif
+
+    for (;;)
+    {
+        input = pb_istream_from_socket_stream(&session.stream);
+        if (!pb_decode(&input, ServerRequest_fields, &request))
+        {
+            break;
+        }
+
+#ifndef __lv2ppu__
+        if (session.shaper)
+            session.shaper->request_time = timeout_gettime();
+#endif
+
+        response.has_data = false;
+        response.data.bytes = session.buffer;
+        response.data.size = 0;
+        response.result = -1;
+        response.has_protocol_version = false;
+
+        switch (request.type)
+        {
+        case ServerRequest_Type_DISC_READ:
+            response.type = ServerResponse_Type_DISC_READ;
+            if (session.handle)
+            {
+                response.result = session_read(&session, request.sector_offset, request.sector_count);
+                // protocol 2 sends the sectors as raw runs after the response
+                response.has_data = response.result > 0 && session.protocol_version < 2;
+                response.data.size = (size_t) response.result * SACD_LSN_SIZE;
+            }
+            break;
+        case ServerRequest_Type_DISC_READ_FRAMES:
+            response.type = ServerResponse_Type_DISC_READ_FRAMES;
+            if (session.handle && session.protocol_version >= 3)
+            {
+                // a new track, the frame parser must not continue with the previous one
+                if (request.has_frame_flags && (request.frame_flags & SACD_FRAMES_RESTART))
+                {
+                    scarletbook_frame_init(session.frame_parser);
+                }
+                response.result = session_read(&session, request.sector_offset, request.sector_count);
+            }
+            break;
+        case ServerRequest_Type_DISC_OPEN:
+            response.type = ServerResponse_Type_DISC_OPENED;
+            session.protocol_version = request.has_protocol_version ? min(request.protocol_version, SACD_PROTOCOL_VERSION) : 1;
+            response.has_protocol_version = request.has_protocol_version;
+            response.protocol_version = session.protocol_version;
+            response.result = session_open_disc(&session);
+            break;
+        case ServerRequest_Type_DISC_CLOSE:
+            response.type = ServerResponse_Type_DISC_CLOSED;
+            session_close_disc(&session);
+            response.result = 0;
+            break;
+        case ServerRequest_Type_DISC_SIZE:
+            response.type = ServerResponse_Type_DISC_SIZE;
+            if (session.sacd_reader)
+            {
+                response.result = sacd_get_total_sectors(session.sacd_reader);
+            }
+            break;
+        }
+
+        // the sector data is sent from response.data.bytes, no copy
+        output = pb_ostream_from_socket_stream(&session.stream);
+
+        if (!pb_encode(&output, ServerResponse_fields, &response))
+        {
+            break;
+        }
+
+        /* We signal the end of a request with a 0 tag. */
+        pb_write(&output, &zero, 1);
+
+        if (request.type == ServerRequest_Type_DISC_READ && session.protocol_version >= 2 && response.result > 0)
+        {
+            if (!pb_socket_stream_write_sectors(&session.stream, session.buffer, (uint32_t) response.result))
+                break;
+        }
+
+        if (request.type == ServerRequest_Type_DISC_READ_FRAMES && response.result > 0)
+        {
+            // the last frame of a track is only complete when the whole block was read
+            int last_block = request.has_frame_flags && (request.frame_flags & SACD_FRAMES_LAST) &&
+                             response.result == request.sector_count;
+
+            session.frame_error = 0;
+            scarletbook_process_frames(session.frame_parser, session.buffer, (int) response.result, last_block, send_frame, &session);
+            if (session.frame_error || !pb_socket_stream_write_frame(&session.stream, 0))
+                break;
+        }
+
+        if (!pb_socket_stream_flush(&session.stream))
+            break;
+
+        if (request.type == ServerRequest_Type_DISC_CLOSE)
+        {
+            ret = 0;
+            break;
+        }
+    }
+
+    session_close_disc(&session);
+
+#ifndef __lv2ppu__
+    if (session.shaper)
+        shaper_destroy(session.shaper);
+#endif
+
+    free(session.buffer);
+    pb_socket_stream_destroy(&session.stream);
+
+    return ret;
+}
@@ -0,0 +1,69 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SACD_SERVER_H_INCLUDED
+#define SACD_SERVER_H_INCLUDED
+
+#include "socket.h"
+#include "sacd_reader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Where a session gets its disc from. Only path is required, the rest is
+ * for servers that handle several connections on one disc.
+ */
+typedef struct
+{
+    /* opened on DISC_OPEN (the PS3 drive or an image file) unless sacd_reader is set */
+    const char     *path;
+
+    /* an opened disc shared by all sessions (see sacd_set_cache()), the session doesn't close it */
+    sacd_reader_t  *sacd_reader;
+
+    /*
+     * emulates a slow link: every response is delivered latency ms after its
+     * request arrived and takes its size / bandwidth KB/s on the link. The
+     * session keeps serving the next requests meanwhile, a writer thread
+     * sends the held back responses when they are due. Not available on
+     * the PS3, its responses always go out directly.
+     */
+    uint32_t        latency;
+    uint32_t        bandwidth;
+}
+sacd_server_config_t;
+
+/**
+ * Serves the ServerRequest / ServerResponse protocol on a connected socket,
+ * the server side of the network input in sacd_input.c. Returns when the
+ * client closes the disc or the connection drops, the socket stays open.
+ *
+ * sacd_server_config_t config = { "/dev_bdvd" };
+ * sacd_server_session(&client, &config);
+ */
+int sacd_server_session(p_socket client, const sacd_server_config_t *config);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SACD_SERVER_H_INCLUDED */
@@ -629,6 +629,27 @@ typedef struct
 } 
 ATTRIBUTE_PACKED audio_sector_t;
 
+#define FRAME_INDEX_SIZE    64
+
+// a sector of the track area that holds the start of an audio frame,
+// frame is the timecode (as frame count) of the last frame that starts there
+typedef struct
+{
+    uint32_t lsn;
+    uint32_t frame;
+}
+scarletbook_frame_index_t;
+
+#define FRAME_SEEK_SIZE     256
+
+// an answer of scarletbook_frame_to_lsn(), kept in the seek-point cache file (see scarletbook_frame_index.h)
+typedef struct
+{
+    uint32_t frame;
+    uint32_t lsn;
+}
+scarletbook_frame_seek_t;
+
 typedef struct  
 {
     uint8_t                  * area_data;
@@ -643,6 +664,15 @@ typedef struct
     char                     * copyright;
     char                     * description_phonetic;
     char                     * copyright_phonetic;
+
+    // sectors found by scarletbook_frame_to_lsn(), sorted by lsn
+    scarletbook_frame_index_t  frame_index[FRAME_INDEX_SIZE];
+    int                        frame_index_count;
+
+    // frames looked up before, in the order they were asked for
+    scarletbook_frame_seek_t   frame_seek[FRAME_SEEK_SIZE];
+    int                        frame_seek_count;
+    int                        frame_seek_saved;        // the first ones came from or went to the seek-point cache file
 }
 scarletbook_area_t;
 
@@ -667,6 +697,8 @@ typedef struct
 } 
 scarletbook_audio_frame_t;
 
+// the disc, read by scarletbook_open(). Once the tracks to extract are chosen it is only read,
+// the state of extracting a track is in its scarletbook_frame_parser_t and output format
 typedef struct
 {
     void                     * sacd;                                      // sacd_reader_t
@@ -681,21 +713,33 @@ typedef struct
     int                        area_count;
     scarletbook_area_t         area[4];   // added for backup 2 more areas:  2= TWOCHTOC  TOC-2;    3 =MULCHTOC  TOC-2
 
-    scarletbook_audio_frame_t  frame;
-    audio_sector_t             audio_sector;
-    
-    int                        frame_info_idx;  // added for retrieving timecode of current frame;   e.g. handle->audio_sector.frame[handle->frame_info_idx].timecode
     int                        audio_frame_trimming;    // if No pauses included if 1.  Trimm out audioframes in trimecode interval [area_tracklist_time->start...+duration]
-    uint32_t                   count_frames;                              // keep the number of audio frames in a track (for verification)
     int                        dsf_nopad;
     int                        concatenate;
     int                        id3_tag_mode;  // 0=no id3tag inserted; 1=id3v2.3/utf16; 2=miminal id3v2.3/iso8859-1;3=id3v2.3/iso8859-1; 4=id3v2.4/utf8;5=minimal id3v2.4/utf8
     int                        artist_flag;
     int                        performer_flag;
     uint32_t                   total_sectors_iso;
+    int                        frame_parse_threads;     // for the frame parsers created, see scarletbook_frame_parser_t
 } 
 scarletbook_handle_t;
 
+// the state of assembling the audio frames of one run of sectors (a track), see scarletbook_frame_parser_create().
+// Every extraction has its own, so several tracks of a disc can be parsed at the same time.
+typedef struct
+{
+    scarletbook_handle_t     * handle;
+
+    scarletbook_audio_frame_t  frame;
+    audio_sector_t             audio_sector;
+    
+    int                        frame_info_idx;  // added for retrieving timecode of current frame;   e.g. parser->audio_sector.frame[parser->frame_info_idx].timecode
+    int                        frame_parse_threads;     // > 1 splits the sectors given to scarletbook_process_frames() between threads
+    void                     * frame_workers;           // their buffers
+    void                     * frame_layout;            // sector layout of a 3 in 14/16 area, learned by scarletbook_process_frames()
+}
+scarletbook_frame_parser_t;
+
 #if PRAGMA_PACK
 #pragma pack()
 #endif
@@ -0,0 +1,188 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <logging.h>
+
+#include "scarletbook.h"
+#include "scarletbook_read.h"
+#include "scarletbook_frame_index.h"
+#include "sacd_reader.h"
+#include "utils.h"
+
+#define FRAME_INDEX_ID            "SACDFIDX"
+#define FRAME_INDEX_VERSION       2
+#define FRAME_INDEX_BYTE_ORDER    0x01020304
+
+// the file is written in the byte order of the machine, another one just looks the frames up again
+typedef struct
+{
+    uint32_t track_start;
+    uint32_t track_end;
+    uint32_t count;
+    uint32_t reserved;
+}
+frame_index_area_t;
+
+typedef struct
+{
+    char               id[8];
+    uint32_t           version;
+    uint32_t           byte_order;
+    uint64_t           hash;
+    uint32_t           total_sectors;
+    uint32_t           reserved;
+    frame_index_area_t area[2];                    // the areas of TOC-1, followed by their lookups
+}
+frame_index_header_t;
+
+uint64_t scarletbook_frame_index_hash(scarletbook_handle_t *handle)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t   i;
+
+    for (i = 0; i < MASTER_TOC_LEN * SACD_LSN_SIZE; i++)
+    {
+        hash ^= handle->master_data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void frame_index_header_init(scarletbook_handle_t *handle, frame_index_header_t *header)
+{
+    int i;
+
+    memset(header, 0, sizeof(frame_index_header_t));
+    memcpy(header->id, FRAME_INDEX_ID, sizeof(header->id));
+    header->version = FRAME_INDEX_VERSION;
+    header->byte_order = FRAME_INDEX_BYTE_ORDER;
+    header->hash = scarletbook_frame_index_hash(handle);
+    header->total_sectors = sacd_get_total_sectors((sacd_reader_t *) handle->sacd);
+
+    for (i = 0; i < 2; i++)
+    {
+        if (handle->area[i].area_toc)
+        {
+            header->area[i].track_start = handle->area[i].area_toc->track_start;
+            header->area[i].track_end = handle->area[i].area_toc->track_end;
+            header->area[i].count = (uint32_t) handle->area[i].frame_seek_count;
+        }
+    }
+}
+
+int scarletbook_frame_index_load(scarletbook_handle_t *handle, const char *path)
+{
+    frame_index_header_t      expected, header;
+    scarletbook_frame_seek_t  seek[2][FRAME_SEEK_SIZE];
+    FILE *fd;
+    int   i;
+
+    fd = fopen(path, "rb");
+    if (!fd)
+        return -1;
+
+    frame_index_header_init(handle, &expected);
+    if (fread(&header, sizeof(header), 1, fd) != 1 ||
+        memcmp(header.id, expected.id, sizeof(header.id)) != 0 ||
+        header.version != expected.version || header.byte_order != expected.byte_order ||
+        header.hash != expected.hash || header.total_sectors != expected.total_sectors)
+    {
+        LOG(lm_main, LOG_NOTICE, ("scarletbook_frame_index_load(): %s is stale, ignored", path));
+        fclose(fd);
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (header.area[i].count == 0)
+            continue;
+
+        if (!handle->area[i].area_toc || header.area[i].count > FRAME_SEEK_SIZE ||
+            header.area[i].track_start != expected.area[i].track_start || header.area[i].track_end != expected.area[i].track_end ||
+            fread(seek[i], sizeof(scarletbook_frame_seek_t), header.area[i].count, fd) != header.area[i].count)
+        {
+            LOG(lm_main, LOG_NOTICE, ("scarletbook_frame_index_load(): %s is damaged, ignored", path));
+            fclose(fd);
+            return -1;
+        }
+    }
+    fclose(fd);
+
+    for (i = 0; i < 2; i++)
+    {
+        memcpy(handle->area[i].frame_seek, seek[i], header.area[i].count * sizeof(scarletbook_frame_seek_t));
+        handle->area[i].frame_seek_count = (int) header.area[i].count;
+        handle->area[i].frame_seek_saved = (int) header.area[i].count;
+
+        if (header.area[i].count > 0)
+            LOG(lm_main, LOG_NOTICE, ("scarletbook_frame_index_load(): area: %d, lookups: %u", i, header.area[i].count));
+    }
+
+    return 0;
+}
+
+int scarletbook_frame_index_save(scarletbook_handle_t *handle, const char *path)
+{
+    frame_index_header_t header;
+    FILE *fd;
+    int   i, ret = 0;
+
+    if (handle->area[0].frame_seek_count == handle->area[0].frame_seek_saved &&
+        handle->area[1].frame_seek_count == handle->area[1].frame_seek_saved)
+        return 0;
+
+    fd = fopen(path, "wb");
+    if (!fd)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in scarletbook_frame_index_save(): can't create %s", path));
+        return -1;
+    }
+
+    frame_index_header_init(handle, &header);
+    if (fwrite(&header, sizeof(header), 1, fd) != 1)
+        ret = -1;
+
+    for (i = 0; i < 2 && ret == 0; i++)
+    {
+        if (header.area[i].count > 0 &&
+            fwrite(handle->area[i].frame_seek, sizeof(scarletbook_frame_seek_t), header.area[i].count, fd) != header.area[i].count)
+            ret = -1;
+    }
+
+    if (fclose(fd) != 0)
+        ret = -1;
+
+    if (ret != 0)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in scarletbook_frame_index_save(): can't write %s", path));
+        remove(path);
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++)
+        handle->area[i].frame_seek_saved = handle->area[i].frame_seek_count;
+
+    return 0;
+}
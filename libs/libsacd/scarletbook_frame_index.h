@@ -0,0 +1,64 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SCARLETBOOK_FRAME_INDEX_H_INCLUDED
+#define SCARLETBOOK_FRAME_INDEX_H_INCLUDED
+
+#include "scarletbook.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A seek-point cache: the file keeps the answers of scarletbook_frame_to_lsn()
+ * (the first sectors of the tracks without pauses and of the -r ranges), so
+ * the next run on the same disc seeks to them without probing. It is not an
+ * index of the frames, the audio is still read and parsed sector by sector.
+ * The file carries a hash of the master TOC sectors, a file made for another
+ * disc (or by an older version) is not loaded.
+ *
+ * scarletbook_frame_index_load(handle, path);
+ * ... extract, scarletbook_frame_to_lsn() adds the new lookups ...
+ * scarletbook_frame_index_save(handle, path);
+ */
+
+/**
+ * FNV-1a hash of the master TOC sectors, names and validates the file
+ */
+uint64_t scarletbook_frame_index_hash(scarletbook_handle_t *);
+
+/**
+ * reads the lookups of all areas it holds,
+ *   return 0 on success, -1 if the file is missing, damaged or for another disc
+ */
+int scarletbook_frame_index_load(scarletbook_handle_t *, const char *);
+
+/**
+ * writes the lookups of all areas when there are new ones since the load,
+ *   return 0 on success (also when there is nothing new), -1 on errors
+ */
+int scarletbook_frame_index_save(scarletbook_handle_t *, const char *);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SCARLETBOOK_FRAME_INDEX_H_INCLUDED */
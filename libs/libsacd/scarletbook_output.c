@@ -45,6 +45,13 @@
 #include <utils.h>
 #include <logging.h>
 #include <fileutils.h>
+#include <pipeline_stats.h>
+#include <trace_events.h>
+#include <mem_stats.h>
+#include <progress.h>
+#ifndef __lv2ppu__
+#include <dst_stats.h>
+#endif
 
 #include "scarletbook_output.h"
 #include "scarletbook_read.h"
@@ -52,11 +59,21 @@
 
 
 #define WRITE_CACHE_SIZE 1 * 1024 * 1024
+#define MAX_OUTPUT_JOBS  32
+
+#ifdef __lv2ppu__
+#define _LOCK_OUTPUT(output)
+#define _UNLOCK_OUTPUT(output)
+#else
+#define _LOCK_OUTPUT(output) pthread_mutex_lock(&(output)->lock)
+#define _UNLOCK_OUTPUT(output) pthread_mutex_unlock(&(output)->lock)
+#endif
 
 extern scarletbook_format_handler_t const * dsdiff_format_fn(void);
 extern scarletbook_format_handler_t const * dsdiff_edit_master_format_fn(void);
 extern scarletbook_format_handler_t const * dsf_format_fn(void);
 extern scarletbook_format_handler_t const * iso_format_fn(void);
+extern scarletbook_format_handler_t const * null_format_fn(void);
 
 typedef const scarletbook_format_handler_t *(*sacd_output_format_fn_t)(void); 
 static sacd_output_format_fn_t s_sacd_output_format_fns[] = 
@@ -65,22 +82,64 @@ static sacd_output_format_fn_t s_sacd_output_format_fns[] =
     dsdiff_edit_master_format_fn,
     dsf_format_fn,
     iso_format_fn,
+    null_format_fn,
     NULL
 }; 
 
+#ifndef __lv2ppu__
+// track workers of all the outputs running, the dst decoders of each get their share of the processors
+static pthread_mutex_t jobs_running_lock = PTHREAD_MUTEX_INITIALIZER;
+static int jobs_running = 0;
+
+static void add_jobs_running(int jobs)
+{
+    pthread_mutex_lock(&jobs_running_lock);
+    jobs_running += jobs;
+    dst_decoder_set_concurrency(jobs_running);
+    pthread_mutex_unlock(&jobs_running_lock);
+}
+#endif
+
+// what a worker needs to process a track next to the others, see scarletbook_output_set_jobs()
+typedef struct
+{
+    scarletbook_output_t       *output;
+    uint8_t                    *read_buffer;
+    scarletbook_frame_parser_t *frame_parser;
+    int                         non_encrypted_disc;
+    int                         checked_for_non_encrypted_disc;
+#ifndef __lv2ppu__
+    pthread_t                   thread_id;
+#endif
+}
+output_worker_t;
+
 struct scarletbook_output_s
 {
     struct list_head    ripping_queue;
 
-    uint8_t            *read_buffer;
+    // the tracks are processed by jobs workers, the processing thread is the first one
+    output_worker_t    *workers;
+    int                 jobs;
+    int                 ordered;                    // an area's tracks are processed one after the other
+    int                 area_busy[4];
+#ifndef __lv2ppu__
+    pthread_mutex_t     lock;                       // guards the queue and the stats
+#endif
+
+    // what a format handler hands from a track to the next one of the area, see scarletbook_output_format_t
+    void               *carry[4];
 
 #ifdef __lv2ppu__
     sys_ppu_thread_t    processing_thread_id;
 #else
     pthread_t           processing_thread_id;
 #endif
+    int                 processing_thread_joined;
     atomic_t            stop_processing;            // indicates if the thread needs to stop or has stopped
     atomic_t            processing;
+    atomic_t            aborted;                    // a track was stopped, no more tracks are taken
+    int                 tracks_with_errors;
 
     // stats
     int                 stats_total_tracks;
@@ -138,6 +197,7 @@ int scarletbook_output_enqueue_track(scarletbook_output_t *output, int area, int
         output_format_ptr->sb_handle = sb_handle;
         output_format_ptr->cb_fwprintf = output->fwprintf_callback;
         output_format_ptr->area = area;
+        output_format_ptr->carry = &output->carry[area];
         output_format_ptr->track = track;
         output_format_ptr->handler = *handler;
         output_format_ptr->filename = strdup(file_path);
@@ -212,6 +272,29 @@ int scarletbook_output_enqueue_track(scarletbook_output_t *output, int area, int
                     output_format_ptr->cb_fwprintf(stderr, L"\n Queuing error: equation not valid(beetween track_start_lsn and track_length_lsn)! area: %d, track %d, start_lsn: %d, length_lsn: %d\n", area, track, output_format_ptr->start_lsn, output_format_ptr->length_lsn);
                 }
             }
+
+            // without pauses only the sectors from the start of the first audio frame
+            // up to the start of the next track's first frame are needed
+            if (sb_handle->audio_frame_trimming)
+            {
+                uint32_t end_lsn = output_format_ptr->start_lsn + output_format_ptr->length_lsn;
+                uint32_t lsn;
+
+                output_format_ptr->frame_start = TIME_FRAMECOUNT(&sb_handle->area[area].area_tracklist_time->start[track]);
+                output_format_ptr->frame_end = output_format_ptr->frame_start + TIME_FRAMECOUNT(&sb_handle->area[area].area_tracklist_time->duration[track]);
+
+                lsn = scarletbook_frame_to_lsn(sb_handle, area, output_format_ptr->frame_start);
+                if (lsn > output_format_ptr->start_lsn && lsn < end_lsn)
+                {
+                    output_format_ptr->start_lsn = lsn;
+                }
+                lsn = scarletbook_frame_to_lsn(sb_handle, area, output_format_ptr->frame_end);
+                if (lsn >= output_format_ptr->start_lsn && lsn + 1 < end_lsn)
+                {
+                    end_lsn = lsn + 1;
+                }
+                output_format_ptr->length_lsn = end_lsn - output_format_ptr->start_lsn;
+            }
         }
 
         LOG(lm_main, LOG_NOTICE, ("Queuing: %s, area: %d, track %d, start_lsn: %d, length_lsn: %d, dst_encoded_import: %d, dsd_encoded_export: %d", file_path, area, track, output_format_ptr->start_lsn, output_format_ptr->length_lsn, output_format_ptr->dst_encoded_import, output_format_ptr->dsd_encoded_export));
@@ -261,6 +344,7 @@ int scarletbook_output_enqueue_concatenate_tracks(scarletbook_output_t *output,
         output_format_ptr->sb_handle = sb_handle;
         output_format_ptr->cb_fwprintf = output->fwprintf_callback;
         output_format_ptr->area = area;
+        output_format_ptr->carry = &output->carry[area];
         output_format_ptr->track = track;
         output_format_ptr->handler = *handler;
         output_format_ptr->filename = strdup(file_path);
@@ -330,10 +414,78 @@ int scarletbook_output_enqueue_concatenate_tracks(scarletbook_output_t *output,
     return -1;
 }
 
+int scarletbook_output_enqueue_range(scarletbook_output_t *output, int area, uint32_t frame_start, uint32_t frame_end, char *file_path, char *fmt, int dsd_encoded_export)
+{
+    scarletbook_format_handler_t const *handler;
+    scarletbook_output_format_t *output_format_ptr;
+    scarletbook_handle_t *sb_handle = output->sb_handle;
+    int track = 0;
+    uint32_t end_lsn, lsn;
+
+    if (frame_end <= frame_start)
+        return -1;
+
+    if ((handler = find_output_format(fmt)))
+    {
+        // the clip gets the tags of the track it starts in
+        while (track < sb_handle->area[area].area_toc->track_count - 1 &&
+               TIME_FRAMECOUNT(&sb_handle->area[area].area_tracklist_time->start[track + 1]) <= frame_start)
+        {
+            track++;
+        }
+
+        output_format_ptr = calloc(sizeof(scarletbook_output_format_t), 1);
+        output_format_ptr->sb_handle = sb_handle;
+        output_format_ptr->cb_fwprintf = output->fwprintf_callback;
+        output_format_ptr->area = area;
+        output_format_ptr->carry = &output->carry[area];
+        output_format_ptr->track = track;
+        output_format_ptr->handler = *handler;
+        output_format_ptr->filename = strdup(file_path);
+        output_format_ptr->channel_count = sb_handle->area[area].area_toc->channel_count;
+        output_format_ptr->dst_encoded_import = sb_handle->area[area].area_toc->frame_format == FRAME_FORMAT_DST;
+        output_format_ptr->dsd_encoded_export = dsd_encoded_export;
+        output_format_ptr->frame_start = frame_start;
+        output_format_ptr->frame_end = frame_end;
+
+        // read from the start of the first frame up to the start of the frame after the clip,
+        // the whole track area when the frames can't be found
+        output_format_ptr->start_lsn = sb_handle->area[area].area_toc->track_start;
+        end_lsn = sb_handle->area[area].area_toc->track_end + 1;
+
+        lsn = scarletbook_frame_to_lsn(sb_handle, area, frame_start);
+        if (lsn > output_format_ptr->start_lsn && lsn < end_lsn)
+        {
+            output_format_ptr->start_lsn = lsn;
+        }
+        lsn = scarletbook_frame_to_lsn(sb_handle, area, frame_end);
+        if (lsn >= output_format_ptr->start_lsn && lsn + 1 < end_lsn)
+        {
+            end_lsn = lsn + 1;
+        }
+        output_format_ptr->length_lsn = end_lsn - output_format_ptr->start_lsn;
+
+        LOG(lm_main, LOG_NOTICE, ("Queuing: range %s, area: %d, frames %u-%u, start_lsn: %d, length_lsn: %d, dst_encoded_import: %d, dsd_encoded_export: %d", file_path, area, frame_start, frame_end, output_format_ptr->start_lsn, output_format_ptr->length_lsn, output_format_ptr->dst_encoded_import, output_format_ptr->dsd_encoded_export));
+
+        list_add_tail(&output_format_ptr->siblings, &output->ripping_queue);
+
+        return 0;
+    }
+    return -1;
+}
+
 static int create_output_file(scarletbook_output_format_t *ft)
 {
     int result;
 
+    if (ft->handler.flags & OUTPUT_FLAG_NULL)
+    {
+        ft->priv = calloc(1, ft->handler.priv_size);
+        if (ft->priv)
+            mem_stats_alloc(MEM_OUTPUT, ft->handler.priv_size, MEM_SITE);
+        return ft->handler.startwrite ? (*ft->handler.startwrite)(ft) : 0;
+    }
+
 #if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
     char filename_long[MAX_BUFF_FULL_PATH_LEN];
 	memset(filename_long, '\0', MAX_BUFF_FULL_PATH_LEN);
@@ -360,9 +512,13 @@ static int create_output_file(scarletbook_output_format_t *ft)
 #endif
 
     ft->write_cache = malloc(WRITE_CACHE_SIZE);
+    if (ft->write_cache)
+        mem_stats_alloc(MEM_OUTPUT, WRITE_CACHE_SIZE, MEM_SITE);
     setvbuf(ft->fd, ft->write_cache, _IOFBF , WRITE_CACHE_SIZE);
 
     ft->priv = calloc(1, ft->handler.priv_size);
+    if (ft->priv)
+        mem_stats_alloc(MEM_OUTPUT, ft->handler.priv_size, MEM_SITE);
 
     result = ft->handler.startwrite ? (*ft->handler.startwrite)(ft) : 0;
    
@@ -378,7 +534,7 @@ static inline int close_output_file(scarletbook_output_format_t * ft)
 {
     int result=0;
 	
-	if(ft->fd != NULL){
+	if(ft->fd != NULL || (ft->handler.flags & OUTPUT_FLAG_NULL)){
 		result = ft->handler.stopwrite ? (*ft->handler.stopwrite)(ft) : 0;
 		if(result ==-1)
 			LOG(lm_main, LOG_ERROR, ("error closing %s", ft->filename));
@@ -389,9 +545,17 @@ static inline int close_output_file(scarletbook_output_format_t * ft)
         fclose(ft->fd);
     }	
 	
-    if(ft->write_cache)free(ft->write_cache);	
+    if (ft->write_cache)
+    {
+        free(ft->write_cache);
+        mem_stats_free(MEM_OUTPUT, WRITE_CACHE_SIZE);
+    }
     if(ft->filename)free(ft->filename);	
-    if(ft->priv)free(ft->priv);
+    if (ft->priv)
+    {
+        free(ft->priv);
+        mem_stats_free(MEM_OUTPUT, ft->handler.priv_size);
+    }
     free(ft);
 
     return result;
@@ -415,12 +579,20 @@ static void scarletbook_output_init_stats(scarletbook_output_t *output)
         output->stats_total_sectors += output_format_ptr->length_lsn;
         output->stats_total_tracks++;
     }
+    progress_add(PROGRESS_TOTAL_SECTORS, output->stats_total_sectors);
+    progress_add(PROGRESS_TOTAL_TRACKS, output->stats_total_tracks);
 }
 
 static inline int write_block(scarletbook_output_format_t * ft, const uint8_t *buf, size_t len)
 {
-    int actual = ft->handler.write? (*ft->handler.write)(ft, buf, len) : 0;
+    uint64_t start = pipeline_stats_clock();
+    int actual;
+
+    TRACE_BEGIN("write", len);
+    actual = ft->handler.write? (*ft->handler.write)(ft, buf, len) : 0;
+    TRACE_END("write", actual);
     if (actual < 0 ) return -1;
+    pipeline_stats_busy(PIPELINE_WRITE, start, (uint64_t) actual, (ft->handler.flags & OUTPUT_FLAG_RAW) ? 0 : 1);
     ft->write_length += actual;
     return actual;
 }
@@ -448,7 +620,7 @@ static void frame_error_callback(int frame_count, int frame_error_code, const ch
     LOG(lm_main, LOG_ERROR, ("ERROR in dst_decoder: %s in frame: %d", frame_error_message, frame_count));
 }
 
-static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_data, size_t frame_size, void *userdata)
+static void frame_read_callback(scarletbook_frame_parser_t *parser, uint8_t* frame_data, size_t frame_size, void *userdata)
 {
     scarletbook_output_format_t *ft = (scarletbook_output_format_t *) userdata;
 
@@ -458,7 +630,7 @@ static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_dat
         if (ft->dsd_encoded_export && ft->dst_encoded_import) 
         {
             dst_decoder_decode(ft->dst_decoder, frame_data, frame_size);
-			ft->sb_handle->count_frames++;
+			ft->count_frames++;
         }
         else
         {
@@ -470,26 +642,23 @@ static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_dat
                 LOG(lm_main, LOG_ERROR, ("ERROR in frame_read_callback:write_block()...writting in file: %s  ", ft->filename));
                 raise(SIGINT);
             }
-			ft->sb_handle->count_frames++;
+			ft->count_frames++;
         }
     }
     else   // DSF, DSDIFF
     {
-        if (ft->sb_handle->audio_frame_trimming > 0)  // (pausese will not be included)
+        if (ft->frame_end > 0)  // (pausese will not be included)
         {
-            uint32_t frame_count_time_start = TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->start[ft->track]);
-            uint32_t frame_count_time_end = frame_count_time_start +
-                                            TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->duration[ft->track]);
-            //uint32_t frame_timecode = TIME_FRAMECOUNT(&handle->audio_sector.frame[handle->frame_info_idx].timecode);
-            uint32_t frame_timecode = TIME_FRAMECOUNT(&handle->frame.timecode);
-
-            if (frame_timecode >= frame_count_time_start &&
-                frame_timecode < frame_count_time_end)
+            //uint32_t frame_timecode = TIME_FRAMECOUNT(&parser->audio_sector.frame[parser->frame_info_idx].timecode);
+            uint32_t frame_timecode = TIME_FRAMECOUNT(&parser->frame.timecode);
+
+            if (frame_timecode >= ft->frame_start &&
+                frame_timecode < ft->frame_end)
             {
                 if (ft->dsd_encoded_export && ft->dst_encoded_import)
                 {
                     dst_decoder_decode(ft->dst_decoder, frame_data, frame_size);
-                    ft->sb_handle->count_frames++;
+                    ft->count_frames++;
                 }
                 else
                 {
@@ -501,7 +670,7 @@ static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_dat
                         LOG(lm_main, LOG_ERROR, ("ERROR in frame_read_callback:write_block()...writting in file: %s  ", ft->filename));
                         raise(SIGINT);
                     }
-                    ft->sb_handle->count_frames++;
+                    ft->count_frames++;
                 }
             }
         }
@@ -510,7 +679,7 @@ static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_dat
             if (ft->dsd_encoded_export && ft->dst_encoded_import)
             {
                 dst_decoder_decode(ft->dst_decoder, frame_data, frame_size);
-                ft->sb_handle->count_frames++;
+                ft->count_frames++;
             }
             else
             {
@@ -522,314 +691,455 @@ static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_dat
                     LOG(lm_main, LOG_ERROR, ("ERROR in frame_read_callback:write_block()...writting in file: %s  ", ft->filename));
                     raise(SIGINT);
                 }
-                ft->sb_handle->count_frames++;
+                ft->count_frames++;
             }
         }
 
     }
 }
 
-#ifdef __lv2ppu__
-static void processing_thread(void *arg)
-#else
-static void *processing_thread(void *arg)
-#endif
+// the next track a worker can take, ordered outputs (dsf nopad) take the tracks
+// of an area one after the other, so that a track can hand its tail to the next one
+static scarletbook_output_format_t *take_next_track(scarletbook_output_t *output)
 {
-    scarletbook_output_t *output = (scarletbook_output_t *) arg;
-    scarletbook_handle_t *handle = output->sb_handle;
     struct list_head * node_ptr;
-    scarletbook_output_format_t *ft = NULL;
-    int non_encrypted_disc = 0;
-    int checked_for_non_encrypted_disc = 0;
-	int no_tracks_with_errors = 0;
+    scarletbook_output_format_t *ft;
 
-    sysAtomicSet(&output->processing, 1);
-    while (!list_empty(&output->ripping_queue))
+    list_for_each(node_ptr, &output->ripping_queue)
     {
-        node_ptr = output->ripping_queue.next;
-
         ft = list_entry(node_ptr, scarletbook_output_format_t, siblings);
-        list_del(node_ptr);
-
-        if (ft->dsd_encoded_export && ft->dst_encoded_import)
+        if (output->ordered && output->area_busy[ft->area])
         {
-            ft->dst_decoder = dst_decoder_create(ft->channel_count, frame_decoded_callback, frame_error_callback, ft);
+            continue;
         }
+        list_del(node_ptr);
+        output->area_busy[ft->area] = 1;
+        return ft;
+    }
+
+    // an ordered worker leaves when all areas left are taken,
+    // the workers of these areas take the rest of their tracks
+    return NULL;
+}
 
-        output->stats_current_file_total_sectors = ft->length_lsn;
-        output->stats_current_file_sectors_processed = 0;
-        output->stats_current_track++;
+// processes one track with the read buffer and frame parser of the worker,
+// returns the number of sectors processed
+static uint32_t process_track(output_worker_t *worker, scarletbook_output_format_t *ft, int track_no)
+{
+    scarletbook_output_t *output = worker->output;
+    scarletbook_handle_t *handle = output->sb_handle;
+    uint32_t sectors_processed = 0;
 
-        if (output->stats_track_callback)
+    if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    {
+        ft->dst_decoder = dst_decoder_create(ft->channel_count, frame_decoded_callback, frame_error_callback, ft);
+#ifndef __lv2ppu__
+        if (dst_stats_on)
         {
-            output->stats_track_callback(ft->filename, output->stats_current_track, output->stats_total_tracks);
+            ft->dst_stats = (dst_stats_t *) malloc(sizeof(dst_stats_t));
+            if (ft->dst_stats)
+            {
+                dst_stats_init(ft->dst_stats, ft->channel_count);
+                dst_decoder_collect_stats(ft->dst_decoder, ft->dst_stats);
+            }
         }
+#endif
+    }
 
-        scarletbook_frame_init(handle);
-        handle->count_frames = 0;
+    scarletbook_frame_init(worker->frame_parser);
+    ft->count_frames = 0;
 
-        if (create_output_file(ft) == 0)
+    if (create_output_file(ft) == 0)
+    {
+        uint32_t block_size=0, end_lsn=0, blocks_readed = 0;
+        uint32_t block_frames;
+        uint64_t stage_start;
+        uint32_t encrypted_start_1 = 0;
+        uint32_t encrypted_start_2 = 0;
+        uint32_t encrypted_end_1 = 0;
+        uint32_t encrypted_end_2 = 0;
+        int encrypted;
+        // a sacd server that assembles the frames itself only sends those
+        int server_frames = (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST) != 0;
+
+        // set the encryption range
+        if (handle->area[0].area_toc != 0)
         {
-            uint32_t block_size=0, end_lsn=0, blocks_readed = 0;
-            uint32_t encrypted_start_1 = 0;
-            uint32_t encrypted_start_2 = 0;
-            uint32_t encrypted_end_1 = 0;
-            uint32_t encrypted_end_2 = 0;
-            int encrypted;
-
-            // set the encryption range
-            if (handle->area[0].area_toc != 0)
-            {
-                encrypted_start_1 = handle->area[0].area_toc->track_start;
-                encrypted_end_1 = handle->area[0].area_toc->track_end;
-            }
-            if (handle->area[1].area_toc != 0)
-            {
-                encrypted_start_2 = handle->area[1].area_toc->track_start;
-                encrypted_end_2 = handle->area[1].area_toc->track_end;
-            }
+            encrypted_start_1 = handle->area[0].area_toc->track_start;
+            encrypted_end_1 = handle->area[0].area_toc->track_end;
+        }
+        if (handle->area[1].area_toc != 0)
+        {
+            encrypted_start_2 = handle->area[1].area_toc->track_start;
+            encrypted_end_2 = handle->area[1].area_toc->track_end;
+        }
 
-            // what blocks do we need to process?
-            ft->current_lsn = ft->start_lsn;
-            end_lsn = ft->start_lsn + ft->length_lsn;
+        // what blocks do we need to process?
+        ft->current_lsn = ft->start_lsn;
+        end_lsn = ft->start_lsn + ft->length_lsn;
 
-            //handle->count_frames = 0;
+        //ft->count_frames = 0;
 
-            sysAtomicSet(&output->stop_processing, 0);
+        sysAtomicSet(&output->stop_processing, 0);
 
-            while (sysAtomicRead(&output->stop_processing) == 0)
+        while (sysAtomicRead(&output->stop_processing) == 0 && sysAtomicRead(&output->aborted) == 0)
+        {
+            if (ft->current_lsn < end_lsn)
             {
-                if (ft->current_lsn < end_lsn)
+                // check what block ranges are encrypted..
+                if (ft->current_lsn < encrypted_start_1)
                 {
-                    // check what block ranges are encrypted..
-                    if (ft->current_lsn < encrypted_start_1)
-                    {
-                        block_size = min(encrypted_start_1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 0;
-                    }
-                    else if (ft->current_lsn >= encrypted_start_1 && ft->current_lsn <= encrypted_end_1)
-                    {
-                        block_size = min(encrypted_end_1 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 1;
-                    }
-                    else if (ft->current_lsn > encrypted_end_1 && ft->current_lsn < encrypted_start_2)
-                    {
-                        block_size = min(encrypted_start_2 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 0;
-                    }
-                    else if (ft->current_lsn >= encrypted_start_2 && ft->current_lsn <= encrypted_end_2)
-                    {
-                        block_size = min(encrypted_end_2 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 1;
-                    }
+                    block_size = min(encrypted_start_1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 0;
+                }
+                else if (ft->current_lsn >= encrypted_start_1 && ft->current_lsn <= encrypted_end_1)
+                {
+                    block_size = min(encrypted_end_1 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 1;
+                }
+                else if (ft->current_lsn > encrypted_end_1 && ft->current_lsn < encrypted_start_2)
+                {
+                    block_size = min(encrypted_start_2 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 0;
+                }
+                else if (ft->current_lsn >= encrypted_start_2 && ft->current_lsn <= encrypted_end_2)
+                {
+                    block_size = min(encrypted_end_2 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 1;
+                }
+                else
+                {
+                    block_size = MAX_PROCESSING_BLOCK_SIZE;
+                    encrypted = 0;
+                }
+                block_size = min(end_lsn - ft->current_lsn, block_size);
+
+                blocks_readed = 0;
+                block_frames = ft->count_frames;
+                stage_start = pipeline_stats_clock();
+                TRACE_BEGIN("read", ft->current_lsn);
+                if (server_frames)
+                {
+                    int frame_flags = (ft->current_lsn == ft->start_lsn ? SACD_FRAMES_RESTART : 0) |
+                                      (ft->current_lsn + block_size >= end_lsn ? SACD_FRAMES_LAST : 0);
+                    int rezult_read_frames = scarletbook_read_frames(worker->frame_parser, ft->current_lsn, block_size, end_lsn, frame_flags, frame_read_callback, ft);
+
+                    if (rezult_read_frames < 0)
+                        server_frames = 0;  // not supported by the input, fall back to raw sectors
                     else
-                    {
-                        block_size = MAX_PROCESSING_BLOCK_SIZE;
-                        encrypted = 0;
-                    }
-                    block_size = min(end_lsn - ft->current_lsn, block_size);
+                        blocks_readed = (uint32_t) rezult_read_frames;
+                }
 
-                    // read some blocks
-                    blocks_readed = sacd_read_block_raw(ft->sb_handle->sacd, ft->current_lsn, block_size, output->read_buffer);
+                // read some blocks
+                if (!server_frames)
+                    blocks_readed = sacd_read_block_raw(ft->sb_handle->sacd, ft->current_lsn, block_size, worker->read_buffer);
 
-                    if (blocks_readed == 0)
-                    {
-                        output->fwprintf_callback(stdout, L"\n \n Error:blocks_readed =0, current_lsn:%d, end_lsn:%d, block_size:%d \n", ft->current_lsn, end_lsn, block_size);
-                        LOG(lm_main, LOG_ERROR, ("Error:blocks_readed = 0, current_lsn:%d, end_lsn:%d, block_size:%d", ft->current_lsn, end_lsn, block_size));                        
-                        sysAtomicSet(&output->stop_processing, 1);
-                    }
+                TRACE_END("read", blocks_readed);
+                pipeline_stats_busy(PIPELINE_READ, stage_start, (uint64_t) blocks_readed * SACD_LSN_SIZE, 0);
 
-                    block_size=blocks_readed;
-                    
-                    ft->current_lsn += block_size;
-                    output->stats_total_sectors_processed += block_size;
-                    output->stats_current_file_sectors_processed += block_size;
+                if (blocks_readed == 0)
+                {
+                    output->fwprintf_callback(stdout, L"\n \n Error:blocks_readed =0, current_lsn:%d, end_lsn:%d, block_size:%d \n", ft->current_lsn, end_lsn, block_size);
+                    LOG(lm_main, LOG_ERROR, ("Error:blocks_readed = 0, current_lsn:%d, end_lsn:%d, block_size:%d", ft->current_lsn, end_lsn, block_size));                        
+                    sysAtomicSet(&output->stop_processing, 1);
+                    sysAtomicSet(&output->aborted, 1);
+                }
 
-                    // the ATAPI call which returns the flag if the disc is encrypted or not is unknown at this point. 
-                    // user reports tell me that the only non-encrypted discs out there are DSD 3 14/16 discs. 
-                    // this is a quick hack/fix for these discs.
-                    if (encrypted && checked_for_non_encrypted_disc == 0)
-                    {
-                        switch (handle->area[ft->area].area_toc->frame_format)
-                        {
-                        case FRAME_FORMAT_DSD_3_IN_14:
-                        case FRAME_FORMAT_DSD_3_IN_16:
-                            non_encrypted_disc = *(uint64_t *)(output->read_buffer + 16) == 0;
-                            break;
-                        }
-
-                        checked_for_non_encrypted_disc = 1;
-                    }
+                block_size=blocks_readed;
+                
+                ft->current_lsn += block_size;
+                sectors_processed += block_size;
 
-                    // encrypted blocks need to be decrypted first
-                    if (encrypted && non_encrypted_disc == 0)
+                // the ATAPI call which returns the flag if the disc is encrypted or not is unknown at this point. 
+                // user reports tell me that the only non-encrypted discs out there are DSD 3 14/16 discs. 
+                // this is a quick hack/fix for these discs.
+                if (encrypted && worker->checked_for_non_encrypted_disc == 0 && !server_frames)
+                {
+                    switch (handle->area[ft->area].area_toc->frame_format)
                     {
-                        sacd_decrypt(ft->sb_handle->sacd, output->read_buffer, block_size);
+                    case FRAME_FORMAT_DSD_3_IN_14:
+                    case FRAME_FORMAT_DSD_3_IN_16:
+                        worker->non_encrypted_disc = *(uint64_t *)(worker->read_buffer + 16) == 0;
+                        break;
                     }
 
-                    //debug
-                    //output->fwprintf_callback(stdout, L"\n \n Debug - scarletbook_process_frames(): block_size %d, last bloc=%d \n", block_size, ft->current_lsn == end_lsn);
+                    worker->checked_for_non_encrypted_disc = 1;
+                }
 
-                    // process DSD & DST frames
-                    if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST)
-                    {
-                       int rezult_proc_frames =  scarletbook_process_frames(ft->sb_handle, output->read_buffer, block_size, ft->current_lsn >= end_lsn, frame_read_callback, ft);
-                       if (rezult_proc_frames < 0){
-                           LOG(lm_main, LOG_ERROR, ("Error in return of scarlet_process_frames!, current_lsn:%d, end_lsn:%d, block_size:%d", ft->current_lsn, end_lsn, block_size));
-                           output->fwprintf_callback(stdout, L"\n \n Error in processing frames! \n");
-                       }
-                       if (ft->current_lsn >= end_lsn){
-                           LOG(lm_main, LOG_NOTICE, ("End track no. %d. After last call to scarletbook_process_frames. current_lsn >= end_lsn, current_lsn:%d, end_lsn:%d, block_size:%d", ft->track, ft->current_lsn, end_lsn, block_size));
-                           uint32_t frame_count_time_start = TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->start[ft->track]);
-                           uint32_t frame_count_time_end = frame_count_time_start +  TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->duration[ft->track]);
-                           LOG(lm_main, LOG_NOTICE, ("End track. After last call to scarletbook_process_frames. frame_count_time_start:%u, frame_count_time_end:%u", frame_count_time_start, frame_count_time_end));
-                       }
-                    }
-                    // ISO output is written without frame processing                        
-                    else if (ft->handler.flags & OUTPUT_FLAG_RAW)
-                    {
-                       size_t rezult=  write_block(ft, output->read_buffer, block_size);
-					   if (rezult ==(size_t) -1) 
-					   {
-						   output->fwprintf_callback(stdout, L"\n \n Error in writting ISO in file. \n");
-						   sysAtomicSet(&output->stop_processing, 1);
-					   }
-					    
-                    }
+                // encrypted blocks need to be decrypted first
+                if (encrypted && worker->non_encrypted_disc == 0 && !server_frames)
+                {
+                    stage_start = pipeline_stats_clock();
+                    TRACE_BEGIN("decrypt", block_size);
+                    sacd_decrypt(ft->sb_handle->sacd, worker->read_buffer, block_size);
+                    TRACE_END("decrypt", block_size);
+                    pipeline_stats_busy(PIPELINE_DECRYPT, stage_start, (uint64_t) block_size * SACD_LSN_SIZE, 0);
+                }
 
-                    // debug
-                    //output->fwprintf_callback(stdout, L"\n \n After scarlet_processe_frames. Processed: %d audioframes\n", ft->count_frames);
+                //debug
+                //output->fwprintf_callback(stdout, L"\n \n Debug - scarletbook_process_frames(): block_size %d, last bloc=%d \n", block_size, ft->current_lsn == end_lsn);
 
-                    // update statistics
-                    if (output->stats_progress_callback)
-                    {
-                        output->stats_progress_callback(output->stats_total_sectors, output->stats_total_sectors_processed, 
-                            output->stats_current_file_total_sectors, output->stats_current_file_sectors_processed);
-                    }
+                // process DSD & DST frames
+                if (server_frames)
+                {
+                   // the frames went to frame_read_callback already
                 }
-                else
+                else if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST)
                 {
-                    break;
-                } // end if (ft->current_lsn < end_lsn)
+                   uint32_t frames_before = ft->count_frames;
+                   int rezult_proc_frames;
+
+                   stage_start = pipeline_stats_clock();
+                   TRACE_BEGIN("parse", block_size);
+                   rezult_proc_frames = scarletbook_process_frames(worker->frame_parser, worker->read_buffer, block_size, ft->current_lsn >= end_lsn, frame_read_callback, ft);
+                   TRACE_END("parse", ft->count_frames - frames_before);
+                   pipeline_stats_busy(PIPELINE_PARSE, stage_start, (uint64_t) block_size * SACD_LSN_SIZE, ft->count_frames - frames_before);
+                   if (rezult_proc_frames < 0){
+                       LOG(lm_main, LOG_ERROR, ("Error in return of scarlet_process_frames!, current_lsn:%d, end_lsn:%d, block_size:%d", ft->current_lsn, end_lsn, block_size));
+                       output->fwprintf_callback(stdout, L"\n \n Error in processing frames! \n");
+                   }
+                   if (ft->current_lsn >= end_lsn){
+                       LOG(lm_main, LOG_NOTICE, ("End track no. %d. After last call to scarletbook_process_frames. current_lsn >= end_lsn, current_lsn:%d, end_lsn:%d, block_size:%d", ft->track, ft->current_lsn, end_lsn, block_size));
+                       uint32_t frame_count_time_start = TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->start[ft->track]);
+                       uint32_t frame_count_time_end = frame_count_time_start +  TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->duration[ft->track]);
+                       LOG(lm_main, LOG_NOTICE, ("End track. After last call to scarletbook_process_frames. frame_count_time_start:%u, frame_count_time_end:%u", frame_count_time_start, frame_count_time_end));
+                   }
+                }
+                // ISO output is written without frame processing                        
+                else if (ft->handler.flags & OUTPUT_FLAG_RAW)
+                {
+                   size_t rezult=  write_block(ft, worker->read_buffer, block_size);
+				   if (rezult ==(size_t) -1) 
+				   {
+					   output->fwprintf_callback(stdout, L"\n \n Error in writting ISO in file. \n");
+					   sysAtomicSet(&output->stop_processing, 1);
+					   sysAtomicSet(&output->aborted, 1);
+				   }
+				    
+                }
 
-            } // end while (sysAtomicRead(&output->stop_processing
+                // debug
+                //output->fwprintf_callback(stdout, L"\n \n After scarlet_processe_frames. Processed: %d audioframes\n", ft->count_frames);
 
-        }  // end  if (create_output_file(ft)
-        else  // error in creating file
+                // update statistics
+                progress_add(PROGRESS_SECTORS, block_size);
+                progress_add(PROGRESS_FRAMES, ft->count_frames - block_frames);
+                _LOCK_OUTPUT(output);
+                output->stats_total_sectors_processed += block_size;
+                output->stats_current_file_sectors_processed += block_size;
+                if (output->stats_progress_callback)
+                {
+                    output->stats_progress_callback(output->stats_total_sectors, output->stats_total_sectors_processed, 
+                        output->stats_current_file_total_sectors, output->stats_current_file_sectors_processed);
+                }
+                _UNLOCK_OUTPUT(output);
+            }
+            else
+            {
+                break;
+            } // end if (ft->current_lsn < end_lsn)
+
+        } // end while (sysAtomicRead(&output->stop_processing
+
+    }  // end  if (create_output_file(ft)
+    else  // error in creating file
+    {
+        _LOCK_OUTPUT(output);
+        output->tracks_with_errors++;
+        _UNLOCK_OUTPUT(output);
+        output->fwprintf_callback(stdout, L"\n \n ERROR: Cannot create output file for current track number %d of total %d !!", track_no, output->stats_total_tracks);
+        LOG(lm_main, LOG_ERROR, ("ERROR: Cannot create output file for current track number %d of total %d !!", track_no, output->stats_total_tracks));
+    }
+
+
+    // Show statistics only for DFF-edit-master : print Error if nr of processed frames < of duration (nr of frames)
+    if (ft->handler.flags & OUTPUT_FLAG_EDIT_MASTER)
+    {
+        int count_sec = (int)(ft->count_frames / SACD_FRAME_RATE);
+        uint32_t duration = (uint32_t)TIME_FRAMECOUNT(&handle->area[ft->area].area_toc->total_playtime);
+        output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes (%02d:%02d:%02d [mins:secs:frames]). Total playing time specified:%d (%02d:%02d:%02d [mins:secs:frames])\n",
+                                  ft->count_frames,
+                                  (int)count_sec / 60,
+                                  (int)count_sec % 60,
+                                  (int)ft->count_frames % SACD_FRAME_RATE,
+                                  duration,
+                                  handle->area[ft->area].area_toc->total_playtime.minutes,
+                                  handle->area[ft->area].area_toc->total_playtime.seconds,
+                                  handle->area[ft->area].area_toc->total_playtime.frames);
+        if (ft->count_frames < duration) 
         {
-			no_tracks_with_errors++;
-            output->fwprintf_callback(stdout, L"\n \n ERROR: Cannot create output file for current track number %d of total %d !!", output->stats_current_track, output->stats_total_tracks);
-            LOG(lm_main, LOG_ERROR, ("ERROR: Cannot create output file for current track number %d of total %d !!", output->stats_current_track, output->stats_total_tracks));
+            LOG(lm_main, LOG_NOTICE, ("Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d)", ft->count_frames, duration));
+            output->fwprintf_callback(stdout, L"\n \n Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d) \n", ft->count_frames, duration);
         }
-
-        // Show statistics only for DFF-edit-master : print Error if nr of processed frames < of duration (nr of frames)
-        if (ft->handler.flags & OUTPUT_FLAG_EDIT_MASTER)
+    }
+    else
+    // Show statistics only for DSF/DFF : print Error if nr of processed frames < of duration (nr of frames)
+    if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST )
+    {
+        if(handle->concatenate == 0 || ft->frame_end > 0)
         {
-            int count_sec = (int)(handle->count_frames / SACD_FRAME_RATE);
-            uint32_t duration = (uint32_t)TIME_FRAMECOUNT(&handle->area[ft->area].area_toc->total_playtime);
-            output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes (%02d:%02d:%02d [mins:secs:frames]). Total playing time specified:%d (%02d:%02d:%02d [mins:secs:frames])\n",
-                                      handle->count_frames,
-                                      (int)count_sec / 60,
-                                      (int)count_sec % 60,
-                                      (int)handle->count_frames % SACD_FRAME_RATE,
-                                      duration,
-                                      handle->area[ft->area].area_toc->total_playtime.minutes,
-                                      handle->area[ft->area].area_toc->total_playtime.seconds,
-                                      handle->area[ft->area].area_toc->total_playtime.frames);
-            if (handle->count_frames < duration) 
+            // a range covers its own frames, not those of the track
+            uint32_t duration = ft->frame_end > 0 ? ft->frame_end - ft->frame_start :
+                                (uint32_t)TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->duration[ft->track]);
+
+            output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes. Duration specified: %d (%02d:%02d:%02d [mins:secs:frames])\n",
+                                      ft->count_frames, duration,
+                                      (int)(duration / (60 * SACD_FRAME_RATE)),
+                                      (int)(duration / SACD_FRAME_RATE % 60),
+                                      (int)(duration % SACD_FRAME_RATE));
+            if (ft->count_frames < duration) //output->stats_current_count_frames
             {
-                LOG(lm_main, LOG_NOTICE, ("Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d)", handle->count_frames, duration));
-                output->fwprintf_callback(stdout, L"\n \n Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d) \n", handle->count_frames, duration);
+                LOG(lm_main, LOG_NOTICE, ("Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d)", ft->count_frames, duration));
+                output->fwprintf_callback(stdout, L"\n \n Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d) \n", ft->count_frames, duration);
             }
         }
         else
-        // Show statistics only for DSF/DFF : print Error if nr of processed frames < of duration (nr of frames)
-        if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST )
         {
-            if(handle->concatenate == 0)
-            {
-                uint32_t duration = (uint32_t)TIME_FRAMECOUNT(&handle->area[ft->area].area_tracklist_time->duration[ft->track]);
-
-                output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes. Duration specified: %d (%02d:%02d:%02d [mins:secs:frames])\n",
-                                          handle->count_frames, duration,
-                                          handle->area[ft->area].area_tracklist_time->duration[ft->track].minutes,
-                                          handle->area[ft->area].area_tracklist_time->duration[ft->track].seconds,
-                                          handle->area[ft->area].area_tracklist_time->duration[ft->track].frames);
-                if (handle->count_frames < duration) //output->stats_current_count_frames
-                {
-                    LOG(lm_main, LOG_NOTICE, ("Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d)", handle->count_frames, duration));
-                    output->fwprintf_callback(stdout, L"\n \n Warning: Number of processed audioframes (%d) is smaller than number of frames in duration (%d) \n", handle->count_frames, duration);
-                }
-            }
-            else
-            {
-                int count_sec = (int)(handle->count_frames / SACD_FRAME_RATE);
-                output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes. Total duration: %02d:%02d:%02d [mins:secs:frames] \n",
-                                          handle->count_frames,
-                                          (int)count_sec / 60,
-                                          (int)count_sec % 60,
-                                          (int)handle->count_frames % SACD_FRAME_RATE);
-            }
-                      
+            int count_sec = (int)(ft->count_frames / SACD_FRAME_RATE);
+            output->fwprintf_callback(stdout, L"\n \n Processed %d audioframes. Total duration: %02d:%02d:%02d [mins:secs:frames] \n",
+                                      ft->count_frames,
+                                      (int)count_sec / 60,
+                                      (int)count_sec % 60,
+                                      (int)ft->count_frames % SACD_FRAME_RATE);
         }
+                  
+    }
 
-        if (sysAtomicRead(&output->stop_processing) == 1)
-        {
-            output->fwprintf_callback(stdout, L"\n ...stop processing\n");
-            LOG(lm_main, LOG_NOTICE, ("...stop processing"));
-            // make a copy of the filename
-            //char *file_to_remove = strdup(ft->filename);
+    return sectors_processed;
+}
+
+// takes tracks from the queue until it is empty or the processing is stopped
+static void process_tracks(output_worker_t *worker)
+{
+    scarletbook_output_t *output = worker->output;
+    scarletbook_output_format_t *ft;
+    uint32_t sectors_processed;
+    int track_no = 0;
+    char thread_name[32];
 
-            sysAtomicSet(&output->processing, 0);
+    snprintf(thread_name, sizeof(thread_name), "output %d", (int) (worker - output->workers));
+    trace_events_thread_name(thread_name);
 
-            if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    for (;;)
+    {
+        _LOCK_OUTPUT(output);
+        ft = sysAtomicRead(&output->aborted) == 0 ? take_next_track(output) : NULL;
+        if (ft)
+        {
+            // the current file stats cover all tracks being processed
+            output->stats_current_file_total_sectors += ft->length_lsn;
+            track_no = ++output->stats_current_track;
+
+            if (output->stats_track_callback)
             {
-                dst_decoder_destroy(ft->dst_decoder);
+                output->stats_track_callback(ft->filename, output->stats_current_track, output->stats_total_tracks);
             }
+        }
+        _UNLOCK_OUTPUT(output);
 
-            close_output_file(ft);
-			
-			if (no_tracks_with_errors > 0)
-			{
-				output->fwprintf_callback(stdout, L"\n \n Error: (%d) track(s) has errors !!", no_tracks_with_errors);
-                LOG(lm_main, LOG_ERROR, ("Error: (%d) track(s) has errors !!", no_tracks_with_errors));
-            }
+        if (!ft)
+            break;
 
-            // remove the file being worked on
-#ifdef __lv2ppu__
-           // if (sysFsUnlink(file_to_remove) != 0)
-#else
-           // if (remove(file_to_remove) != 0)
-#endif
-            //{
-            //    LOG(lm_main, LOG_ERROR, ("user cancelled, error removing: %s, [%s]", file_to_remove, strerror(errno)));
-            //}
+        TRACE_BEGIN("track", track_no);
+        sectors_processed = process_track(worker, ft, track_no);
 
-            //free(file_to_remove);
+        _LOCK_OUTPUT(output);
+        output->stats_current_file_total_sectors -= ft->length_lsn;
+        output->stats_current_file_sectors_processed -= sectors_processed;
+        output->area_busy[ft->area] = 0;
+        _UNLOCK_OUTPUT(output);
 
-            destroy_ripping_queue(output);
-#ifdef __lv2ppu__
-            sysThreadExit(-1);
-#else
-            pthread_exit(0);
-#endif
+        if (sysAtomicRead(&output->stop_processing) == 1)
+        {
+            sysAtomicSet(&output->aborted, 1);
         }
-		
+
 		//DEBUG LOG(lm_main, LOG_ERROR, ("before dsd_encoded_export"));
 
         if (ft->dsd_encoded_export && ft->dst_encoded_import)
         {
+            TRACE_BEGIN("dst flush", track_no);
             dst_decoder_destroy(ft->dst_decoder);
+            TRACE_END("dst flush", track_no);
+#ifndef __lv2ppu__
+            if (ft->dst_stats)
+            {
+                dst_stats_report(ft->dst_stats, ft->filename);
+                free(ft->dst_stats);
+                ft->dst_stats = NULL;
+            }
+#endif
         }
 		
 		//DEBUG LOG(lm_main, LOG_ERROR, ("before close_output_file"));
 
+        TRACE_BEGIN("close", track_no);
         close_output_file(ft);
-    } // end while (!list_empty(&output->ripping_queue))
+        TRACE_END("close", track_no);
+        TRACE_END("track", sectors_processed);
+        progress_add(PROGRESS_TRACKS, 1);
+    }
+}
 
-    if (no_tracks_with_errors > 0)
+#ifndef __lv2ppu__
+static void *worker_thread(void *arg)
+{
+    process_tracks((output_worker_t *) arg);
+
+    return 0;
+}
+#endif
+
+#ifdef __lv2ppu__
+static void processing_thread(void *arg)
+#else
+static void *processing_thread(void *arg)
+#endif
+{
+    scarletbook_output_t *output = (scarletbook_output_t *) arg;
+#ifndef __lv2ppu__
+    int started;
+#endif
+
+    sysAtomicSet(&output->processing, 1);
+
+    // the processing thread is the first worker, the others get their own thread
+#ifndef __lv2ppu__
+    for (started = 1; started < output->jobs; started++)
     {
-        output->fwprintf_callback(stdout, L"\n \n Error: %d track(s) has errors of total %d tracks !!", no_tracks_with_errors, output->stats_total_tracks);
+        int ret = pthread_create(&output->workers[started].thread_id, NULL, worker_thread, &output->workers[started]);
+        if (ret)
+        {
+            LOG(lm_main, LOG_ERROR, ("return code from worker thread creation is %d\n", ret));
+            break;
+        }
+    }
+#endif
+
+    process_tracks(&output->workers[0]);
+
+#ifndef __lv2ppu__
+    while (--started > 0)
+    {
+        pthread_join(output->workers[started].thread_id, NULL);
+    }
+    add_jobs_running(-output->jobs);
+#endif
+
+    if (sysAtomicRead(&output->aborted) == 1)
+    {
+        output->fwprintf_callback(stdout, L"\n ...stop processing\n");
+        LOG(lm_main, LOG_NOTICE, ("...stop processing"));
+
+        if (output->tracks_with_errors > 0)
+        {
+            output->fwprintf_callback(stdout, L"\n \n Error: (%d) track(s) has errors !!", output->tracks_with_errors);
+            LOG(lm_main, LOG_ERROR, ("Error: (%d) track(s) has errors !!", output->tracks_with_errors));
+        }
+    }
+    else if (output->tracks_with_errors > 0)
+    {
+        output->fwprintf_callback(stdout, L"\n \n Error: %d track(s) has errors of total %d tracks !!", output->tracks_with_errors, output->stats_total_tracks);
     }
 
 	// DEBUG LOG(lm_main, LOG_ERROR, ("before destroy_ripping_queue"));
@@ -851,7 +1161,10 @@ scarletbook_output_t *scarletbook_output_create(scarletbook_handle_t *handle, st
     scarletbook_output_t *output = (scarletbook_output_t *) calloc(1, sizeof(scarletbook_output_t));
 
     INIT_LIST_HEAD(&output->ripping_queue);
-    output->read_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    output->jobs = 1;
+#ifndef __lv2ppu__
+    pthread_mutex_init(&output->lock, NULL);
+#endif
     output->sb_handle = handle;
     output->stats_track_callback = cb_track;
     output->stats_progress_callback = cb_progress;
@@ -860,17 +1173,84 @@ scarletbook_output_t *scarletbook_output_create(scarletbook_handle_t *handle, st
     return output;
 }
 
+void scarletbook_output_set_jobs(scarletbook_output_t *output, int jobs)
+{
+#ifdef __lv2ppu__
+    output->jobs = 1;
+#else
+    output->jobs = max(1, min(jobs, MAX_OUTPUT_JOBS));
+#endif
+}
+
 int scarletbook_output_is_busy(scarletbook_output_t *output)
 {
     return sysAtomicRead(&output->processing);
 }
 
+// longest track first, so the last tracks taken are the short ones
+static void sort_ripping_queue(scarletbook_output_t *output)
+{
+    struct list_head unsorted;
+    struct list_head * node_ptr;
+    scarletbook_output_format_t *ft, *pos;
+
+    INIT_LIST_HEAD(&unsorted);
+    list_splice_init(&output->ripping_queue, &unsorted);
+
+    while (!list_empty(&unsorted))
+    {
+        ft = list_entry(unsorted.next, scarletbook_output_format_t, siblings);
+        list_del(&ft->siblings);
+
+        // insert before the first shorter one, equal lengths keep their order
+        list_for_each(node_ptr, &output->ripping_queue)
+        {
+            pos = list_entry(node_ptr, scarletbook_output_format_t, siblings);
+            if (pos->length_lsn < ft->length_lsn)
+            {
+                break;
+            }
+        }
+        list_add_tail(&ft->siblings, node_ptr);
+    }
+}
+
 int scarletbook_output_start(scarletbook_output_t *output)
 {
     int ret = 0;
+    int i;
 
     scarletbook_output_init_stats(output);
 
+    // readers with a single position can't serve several workers,
+    // more workers than tracks don't help
+    if (!sacd_can_read_in_parallel((sacd_reader_t *) output->sb_handle->sacd))
+    {
+        output->jobs = 1;
+    }
+    output->jobs = max(1, min(output->jobs, output->stats_total_tracks));
+    output->ordered = output->sb_handle->dsf_nopad;
+    if (output->jobs > 1 && !output->ordered)
+    {
+        sort_ripping_queue(output);
+    }
+#ifndef __lv2ppu__
+    add_jobs_running(output->jobs);
+#endif
+
+    // busy from now on, not only once the thread runs
+    sysAtomicSet(&output->processing, 1);
+
+    output->workers = (output_worker_t *) calloc(output->jobs, sizeof(output_worker_t));
+    for (i = 0; i < output->jobs; i++)
+    {
+        output->workers[i].output = output;
+        output->workers[i].read_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+        if (output->workers[i].read_buffer)
+            mem_stats_alloc(MEM_OUTPUT, MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE, MEM_SITE);
+        output->workers[i].frame_parser = scarletbook_frame_parser_create(output->sb_handle);
+    }
+
 #ifdef __lv2ppu__
     ret = sysThreadCreate(&output->processing_thread_id,
                           processing_thread,
@@ -885,6 +1265,10 @@ int scarletbook_output_start(scarletbook_output_t *output)
     if (ret)
     {
         LOG(lm_main, LOG_ERROR, ("return code from processing thread creation is %d\n", ret));
+        sysAtomicSet(&output->processing, 0);
+#ifndef __lv2ppu__
+        add_jobs_running(-output->jobs);
+#endif
     }
 
     return ret;
@@ -895,33 +1279,65 @@ void scarletbook_output_interrupt(scarletbook_output_t *output)
     sysAtomicSet(&output->stop_processing, 1);
 }
 
-int scarletbook_output_destroy(scarletbook_output_t *output)
+int scarletbook_output_wait(scarletbook_output_t *output)
 {
 #ifdef __lv2ppu__
     uint64_t thr_exit_code;
 #else
     void *thr_exit_code;
 #endif
-    int ret = 0;
+    int ret;
 
-    if (!output)
-        return -1;
+    if (output->processing_thread_joined)
+        return 0;
 
 #ifdef __lv2ppu__
-    scarletbook_output_interrupt(output);
     ret = sysThreadJoin(output->processing_thread_id, &thr_exit_code);
 #else
-    scarletbook_output_interrupt(output);
     ret = pthread_join(output->processing_thread_id, &thr_exit_code);
-#endif    
+#endif
     if (ret != 0)
     {
         LOG(lm_main, LOG_ERROR, ("processing thread didn't close properly... %x", thr_exit_code));
     }
+    output->processing_thread_joined = 1;
+
+    return ret;
+}
+
+int scarletbook_output_destroy(scarletbook_output_t *output)
+{
+    int ret = 0;
+    int i;
+
+    if (!output)
+        return -1;
+
+    scarletbook_output_interrupt(output);
+    ret = scarletbook_output_wait(output);
 
     // If decoding is aborted (eg. ctrl+C), then free() buffers after the decoder has been destroyed,
     // to ensure that buffers aren't still in use when they're free()d.
-    free(output->read_buffer);
+    if (output->workers)
+    {
+        for (i = 0; i < output->jobs; i++)
+        {
+            if (output->workers[i].read_buffer)
+            {
+                free(output->workers[i].read_buffer);
+                mem_stats_free(MEM_OUTPUT, MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+            }
+            scarletbook_frame_parser_destroy(output->workers[i].frame_parser);
+        }
+        free(output->workers);
+    }
+#ifndef __lv2ppu__
+    pthread_mutex_destroy(&output->lock);
+#endif
+    for (i = 0; i < 4; i++)
+    {
+        free(output->carry[i]);
+    }
     free(output);
 
     return ret;
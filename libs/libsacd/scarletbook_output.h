@@ -39,7 +39,8 @@ enum
     OUTPUT_FLAG_RAW         = 1 << 0,
     OUTPUT_FLAG_DSD         = 1 << 1,
     OUTPUT_FLAG_DST         = 1 << 2,
-    OUTPUT_FLAG_EDIT_MASTER = 1 << 3
+    OUTPUT_FLAG_EDIT_MASTER = 1 << 3,
+    OUTPUT_FLAG_NULL        = 1 << 4    // nothing is written, no file is created
 };
 
 // Handler structure defined by each output format.
@@ -66,7 +67,13 @@ struct scarletbook_output_format_t
     uint32_t                        current_lsn;
     char                           *filename;
 
+    // timecodes (as frame count) of the audio frames written, [frame_start, frame_end),
+    // frame_end is 0 when all frames read are written (pauses included)
+    uint32_t                        frame_start;
+    uint32_t                        frame_end;
+
     int                             channel_count;
+    uint32_t                        count_frames;               // audio frames written (for verification)
 
     FILE                           *fd;
     char                           *write_cache;
@@ -78,11 +85,15 @@ struct scarletbook_output_format_t
 
     scarletbook_format_handler_t    handler;
     void                           *priv;
+    void                          **carry;                      // handed to the next track of the area, owned by the handler
 
     int                             error_nr;
     char                            error_str[256];
 
     dst_decoder_t                  *dst_decoder;
+#ifndef __lv2ppu__
+    struct dst_stats_s             *dst_stats;                  // what the frames cost to decode, see dst_stats_start()
+#endif
 
     scarletbook_handle_t           *sb_handle;
     fwprintf_callback_t             cb_fwprintf;
@@ -100,8 +111,23 @@ int scarletbook_output_destroy(scarletbook_output_t *);
 int scarletbook_output_enqueue_track(scarletbook_output_t *, int, int, char *, char *, int);
 int scarletbook_output_enqueue_raw_sectors(scarletbook_output_t *, int, int, char *, char *);
 int scarletbook_output_enqueue_concatenate_tracks(scarletbook_output_t *output, int area, int track, char *file_path, char *fmt, int dsd_encoded_export, int last_track);
+int scarletbook_output_enqueue_range(scarletbook_output_t *output, int area, uint32_t frame_start, uint32_t frame_end, char *file_path, char *fmt, int dsd_encoded_export);
 int scarletbook_output_start(scarletbook_output_t *);
+
+/**
+ * processes up to jobs tracks at the same time (default 1), longest first.
+ * Only image files and devices are read by several workers, the dst decoders
+ * of the tracks of all the outputs running share the processors. Call before
+ * scarletbook_output_start().
+ */
+void scarletbook_output_set_jobs(scarletbook_output_t *, int);
 void scarletbook_output_interrupt(scarletbook_output_t *);
+
+/**
+ * waits until all queued tracks are processed (or the processing is interrupted),
+ * scarletbook_output_destroy() stops the processing first
+ */
+int scarletbook_output_wait(scarletbook_output_t *);
 int scarletbook_output_is_busy(scarletbook_output_t *);
 
 #endif /* SCARLETBOOK_OUTPUT_H_INCLUDED */
@@ -38,6 +38,9 @@
 #include "sacd_reader.h"
 #include "sacd_read_internal.h"
 #include "utils.h"
+#ifndef __lv2ppu__
+#include "yarn.h"
+#endif
 
 #ifndef NDEBUG
 #define CHECK_ZERO0(arg)                                                       \
@@ -63,25 +66,21 @@ static const uint8_t my_friendly_zeros[2048];
 /* Prototypes for internal functions */
 static int scarletbook_read_master_toc(scarletbook_handle_t *);
 static int scarletbook_read_area_toc(scarletbook_handle_t *, int);
+#ifndef __lv2ppu__
+static void free_frame_workers(void *);
+#endif
 
 
 scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
 {
     scarletbook_handle_t *sb;
+    uint32_t area_1_toc_1_start, area_1_toc_2_start;
+    uint32_t area_2_toc_1_start, area_2_toc_2_start;
 
     sb = (scarletbook_handle_t *) calloc(sizeof(scarletbook_handle_t), 1);
     if (!sb)
         return NULL;
 
-#ifdef __lv2ppu__
-    sb->frame.data = (uint8_t *) memalign(128, MAX_DST_SIZE);  // (1024 * 64)
-#else
-    sb->frame.data = (uint8_t *) malloc(MAX_DST_SIZE);			//(1024 * 64)
-#endif
-
-    if (!sb->frame.data)
-        return NULL;
-
     sb->sacd      = sacd;
     sb->twoch_area_idx = -1;
     sb->mulch_area_idx = -1;
@@ -90,12 +89,27 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
     {
         fwprintf(stdout, L"scarletbook_open: Can't read Master TOC !!\n");
         LOG(lm_main, LOG_ERROR, ("Error: scarletbook_open: Can't read Master TOC !!"));
-        free(sb->frame.data);
         free(sb);
         return NULL;
     }
 
-    if (sb->master_toc->area_1_toc_1_start > 0) // Area 1 (TWOCHTOC) TOC-1
+    area_1_toc_1_start = sb->master_toc->area_1_toc_1_start;
+    area_1_toc_2_start = sb->master_toc->area_1_toc_2_start;
+    area_2_toc_1_start = sb->master_toc->area_2_toc_1_start;
+    area_2_toc_2_start = sb->master_toc->area_2_toc_2_start;
+
+    if (sacd_is_sequential(sacd))
+    {
+        // a stream reaches only one area, and never the TOC-2 copies at the end of the disc
+        if (sacd_get_stream_area(sacd) && area_2_toc_1_start > 0)
+            area_1_toc_1_start = 0;
+        else if (area_1_toc_1_start > 0)
+            area_2_toc_1_start = 0;
+        area_1_toc_2_start = 0;
+        area_2_toc_2_start = 0;
+    }
+
+    if (area_1_toc_1_start > 0) // Area 1 (TWOCHTOC) TOC-1
     {
         int flag_use_toc1 = 0;
         int flag_use_toc2 = 0;
@@ -108,7 +122,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
         }
         else
         {
-            if (!sacd_read_block_raw(sacd, sb->master_toc->area_1_toc_1_start,(uint32_t) sb->master_toc->area_1_toc_size, sb->area[sb->area_count].area_data))
+            if (!sacd_read_block_raw(sacd, area_1_toc_1_start,(uint32_t) sb->master_toc->area_1_toc_size, sb->area[sb->area_count].area_data))
             {
                 fwprintf(stdout, L"Can't read Area 1 (TWOCHTOC) TOC-1 !! Trying to read and use TOC-2...\n");
                 LOG(lm_main, LOG_NOTICE, ("Warning: Can't read Area 1 (TWOCHTOC) TOC-1 !! Trying to read and use TOC-2..."));
@@ -118,7 +132,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
               flag_use_toc1 = 1;
 
             // check if Area 1 (TWOCHTOC) TOC-1 is identical with backup AREA 1 (TWOCHTOC) TOC-2
-            if (sb->master_toc->area_1_toc_2_start > 0) // Area 1 (TWOCHTOC) TOC-2
+            if (area_1_toc_2_start > 0) // Area 1 (TWOCHTOC) TOC-2
             {
                 sb->area[2].area_data = malloc(sb->master_toc->area_1_toc_size * SACD_LSN_SIZE);
                 if (sb->area[2].area_data == NULL)
@@ -129,7 +143,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
                 }
                 else
                 {
-                    if (!sacd_read_block_raw(sacd, sb->master_toc->area_1_toc_2_start, (uint32_t)sb->master_toc->area_1_toc_size, sb->area[2].area_data))
+                    if (!sacd_read_block_raw(sacd, area_1_toc_2_start, (uint32_t)sb->master_toc->area_1_toc_size, sb->area[2].area_data))
                     {
                         fwprintf(stdout, L"Warning: can't read Area 1 (TWOCHTOC) TOC-2 !! There are some errros on disc !\n");
                         LOG(lm_main, LOG_NOTICE, ("Warning: can't read Area 1 (TWOCHTOC) TOC-2 !! There are some errros on disc !"));
@@ -166,7 +180,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
 
     }
  
-    if (sb->master_toc->area_2_toc_1_start > 0) //  Area 2 (MULCHTOC) TOC-1
+    if (area_2_toc_1_start > 0) //  Area 2 (MULCHTOC) TOC-1
     {
         int flag_use_toc1 = 0;
         int flag_use_toc2 = 0;
@@ -179,7 +193,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
         }
         else
         {
-            if (!sacd_read_block_raw(sacd, sb->master_toc->area_2_toc_1_start, (uint32_t)sb->master_toc->area_2_toc_size, sb->area[sb->area_count].area_data))
+            if (!sacd_read_block_raw(sacd, area_2_toc_1_start, (uint32_t)sb->master_toc->area_2_toc_size, sb->area[sb->area_count].area_data))
             {
                 fwprintf(stdout, L"Error: can't read Area 2 (MULCHTOC) TOC-1 !! Trying to read and use TOC-2...\n");
                 LOG(lm_main, LOG_ERROR, ("Error: can't read Area 2 (MULCHTOC) TOC-1 !! Trying to read and use TOC-2..."));
@@ -189,7 +203,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
                 flag_use_toc1 = 1;
 
             // check if are identical Area 2 (MULCHTOC) TOC-1 with backup Area 2 (MULCHTOC) TOC-2
-            if (sb->master_toc->area_2_toc_2_start > 0) // Area 2 (MULCHTOC) TOC-2
+            if (area_2_toc_2_start > 0) // Area 2 (MULCHTOC) TOC-2
             {
                 sb->area[3].area_data = malloc(sb->master_toc->area_2_toc_size * SACD_LSN_SIZE);
 
@@ -200,7 +214,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
                 }
                 else 
                 {
-                    if (!sacd_read_block_raw(sacd, sb->master_toc->area_2_toc_2_start, (uint32_t)sb->master_toc->area_2_toc_size, sb->area[3].area_data))
+                    if (!sacd_read_block_raw(sacd, area_2_toc_2_start, (uint32_t)sb->master_toc->area_2_toc_size, sb->area[3].area_data))
                     {
                         fwprintf(stdout, L"Warning: can't read Area 2 (MULCHTOC) TOC-2 !! There are some errros on disc !\n");
                         LOG(lm_main, LOG_NOTICE, ("Warning: can't read Area 2 (MULCHTOC) TOC-2 !! There are some errros on disc !"));
@@ -236,7 +250,6 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd)
 
     if (sb->area_count == 0)
     {
-        free(sb->frame.data);
         free(sb);
         return NULL;
     }
@@ -314,9 +327,6 @@ void scarletbook_close(scarletbook_handle_t *handle)
     if (handle->master_data)
         free((void *) handle->master_data);
 
-    if (handle->frame.data)
-        free((void *) handle->frame.data);
-
     memset(handle, 0, sizeof(scarletbook_handle_t));
 
     free(handle);
@@ -366,13 +376,18 @@ static int scarletbook_read_master_toc(scarletbook_handle_t *handle)
     }
 
     uint32_t total_sectors = sacd_get_total_sectors((sacd_reader_t*)handle->sacd); // get the real full size of disc [number of sectors] or file [number of SACD_LSN_SIZE]
-    handle->total_sectors_iso = total_sectors;
 
     // made some checks on the total size of iso/disc
     uint32_t area1_sectors_max = master_toc->area_1_toc_2_start + master_toc->area_1_toc_size;
     uint32_t area2_sectors_max = master_toc->area_2_toc_2_start + master_toc->area_2_toc_size;
     uint32_t max_sectors = area2_sectors_max > area1_sectors_max ? area2_sectors_max : area1_sectors_max;
 
+    // the size of a stream is unknown, the last TOC-2 copy marks the end of the audio data
+    if (sacd_is_sequential((sacd_reader_t*)handle->sacd))
+        total_sectors = max_sectors;
+
+    handle->total_sectors_iso = total_sectors;
+
     if (max_sectors <= total_sectors)
     {
         fwprintf(stdout, L"The size of sacd is ok (sectors=%d). Size is: %llu bytes, %.3f GB (gigabyte) \n", total_sectors, (uint64_t)total_sectors * SACD_LSN_SIZE, (double)total_sectors * SACD_LSN_SIZE / (1000 * 1000 * 1000));
@@ -794,22 +809,61 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
     return 1;
 }
 
-void scarletbook_frame_init(scarletbook_handle_t *handle)
+scarletbook_frame_parser_t *scarletbook_frame_parser_create(scarletbook_handle_t *handle)
+{
+    scarletbook_frame_parser_t *parser;
+
+    parser = (scarletbook_frame_parser_t *) calloc(sizeof(scarletbook_frame_parser_t), 1);
+    if (!parser)
+        return NULL;
+
+#ifdef __lv2ppu__
+    parser->frame.data = (uint8_t *) memalign(128, MAX_DST_SIZE);  // (1024 * 64)
+#else
+    parser->frame.data = (uint8_t *) malloc(MAX_DST_SIZE);			//(1024 * 64)
+#endif
+
+    if (!parser->frame.data)
+    {
+        free(parser);
+        return NULL;
+    }
+
+    parser->handle = handle;
+    parser->frame_parse_threads = handle->frame_parse_threads;
+
+    return parser;
+}
+
+void scarletbook_frame_parser_destroy(scarletbook_frame_parser_t *parser)
+{
+    if (!parser)
+        return;
+
+    free(parser->frame.data);
+#ifndef __lv2ppu__
+    free_frame_workers(parser->frame_workers);
+#endif
+    free(parser->frame_layout);
+    free(parser);
+}
+
+void scarletbook_frame_init(scarletbook_frame_parser_t *parser)
 {
-    //handle->packet_info_idx = 0;
-    handle->frame_info_idx = 0;
+    //parser->packet_info_idx = 0;
+    parser->frame_info_idx = 0;
 
-    handle->frame.size = 0;
-    handle->frame.started = 0;
-    handle->frame.sector_count = 0;
-    handle->frame.channel_count = 0;
-    handle->frame.dst_encoded = 0;
+    parser->frame.size = 0;
+    parser->frame.started = 0;
+    parser->frame.sector_count = 0;
+    parser->frame.channel_count = 0;
+    parser->frame.dst_encoded = 0;
 
-    handle->frame.timecode.minutes = (uint8_t)0;
-    handle->frame.timecode.seconds = (uint8_t)0;
-    handle->frame.timecode.frames = (uint8_t)0;
+    parser->frame.timecode.minutes = (uint8_t)0;
+    parser->frame.timecode.seconds = (uint8_t)0;
+    parser->frame.timecode.frames = (uint8_t)0;
 
-    memset(&handle->audio_sector, 0, sizeof(audio_sector_t));
+    memset(&parser->audio_sector, 0, sizeof(audio_sector_t));
 }
 
 static inline int get_channel_count(audio_frame_info_t *frame_info)
@@ -828,10 +882,10 @@ static inline int get_channel_count(audio_frame_info_t *frame_info)
     }
 }
 
-static inline void exec_read_callback(scarletbook_handle_t *handle, frame_read_callback_t frame_read_callback, void *userdata)
+static inline void exec_read_callback(scarletbook_frame_parser_t *parser, frame_read_callback_t frame_read_callback, void *userdata)
 {
-        handle->frame.started = 0;
-        frame_read_callback(handle, handle->frame.data, handle->frame.size, userdata);  
+        parser->frame.started = 0;
+        frame_read_callback(parser, parser->frame.data, parser->frame.size, userdata);  
 }
 
 
@@ -840,7 +894,7 @@ static inline void exec_read_callback(scarletbook_handle_t *handle, frame_read_c
 //       return nr of frames proccesed >=0 succes
 //              -1 error (has sector bad reads)
 //
-int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+static int process_frames_sequential(scarletbook_frame_parser_t *parser, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
 {
     int frame_info_idx;
     uint8_t packet_info_idx;
@@ -853,57 +907,57 @@ int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffe
     for (int j = 0; j < blocks_read_in; j++)
     {            
         // read Audio Sector Header
-        memcpy(&handle->audio_sector.header, read_buffer_ptr, AUDIO_SECTOR_HEADER_SIZE);
+        memcpy(&parser->audio_sector.header, read_buffer_ptr, AUDIO_SECTOR_HEADER_SIZE);
         read_buffer_ptr += AUDIO_SECTOR_HEADER_SIZE;
 
         // read Audio Packet Info Header
 #if defined(__BIG_ENDIAN__)
-        memcpy(&handle->audio_sector.packet, read_buffer_ptr, AUDIO_PACKET_INFO_SIZE * handle->audio_sector.header.packet_info_count);
-        read_buffer_ptr += AUDIO_PACKET_INFO_SIZE * handle->audio_sector.header.packet_info_count;
+        memcpy(&parser->audio_sector.packet, read_buffer_ptr, AUDIO_PACKET_INFO_SIZE * parser->audio_sector.header.packet_info_count);
+        read_buffer_ptr += AUDIO_PACKET_INFO_SIZE * parser->audio_sector.header.packet_info_count;
 #else
         // Little Endian systems cannot properly deal with audio_packet_info_t
         {
-            for (uint8_t i = 0; i < handle->audio_sector.header.packet_info_count; i++)
+            for (uint8_t i = 0; i < parser->audio_sector.header.packet_info_count; i++)
             {
-                handle->audio_sector.packet[i].frame_start = (read_buffer_ptr[0] >> 7) & 1;
-                handle->audio_sector.packet[i].data_type = (read_buffer_ptr[0] >> 3) & 7;
-                handle->audio_sector.packet[i].packet_length = (read_buffer_ptr[0] & 7) << 8 | read_buffer_ptr[1];
+                parser->audio_sector.packet[i].frame_start = (read_buffer_ptr[0] >> 7) & 1;
+                parser->audio_sector.packet[i].data_type = (read_buffer_ptr[0] >> 3) & 7;
+                parser->audio_sector.packet[i].packet_length = (read_buffer_ptr[0] & 7) << 8 | read_buffer_ptr[1];
                 read_buffer_ptr += AUDIO_PACKET_INFO_SIZE;
             }
         }
 #endif
         //  read Audio Frame Info Header 
-        if (handle->audio_sector.header.dst_encoded)
+        if (parser->audio_sector.header.dst_encoded)
         {
-            if (handle->audio_sector.header.frame_info_count > 0)
+            if (parser->audio_sector.header.frame_info_count > 0)
             {
-                memcpy(&handle->audio_sector.frame, read_buffer_ptr, AUDIO_FRAME_INFO_SIZE * handle->audio_sector.header.frame_info_count);
-                read_buffer_ptr += AUDIO_FRAME_INFO_SIZE * handle->audio_sector.header.frame_info_count;
+                memcpy(&parser->audio_sector.frame, read_buffer_ptr, AUDIO_FRAME_INFO_SIZE * parser->audio_sector.header.frame_info_count);
+                read_buffer_ptr += AUDIO_FRAME_INFO_SIZE * parser->audio_sector.header.frame_info_count;
             }
         }
         else
         {
-            for (uint8_t i = 0; i < handle->audio_sector.header.frame_info_count; i++)
+            for (uint8_t i = 0; i < parser->audio_sector.header.frame_info_count; i++)
             {
-                memcpy(&handle->audio_sector.frame[i], read_buffer_ptr, AUDIO_FRAME_INFO_SIZE - 1);
+                memcpy(&parser->audio_sector.frame[i], read_buffer_ptr, AUDIO_FRAME_INFO_SIZE - 1);
                 read_buffer_ptr += AUDIO_FRAME_INFO_SIZE - 1;
             }
         }
 
-        if(handle->audio_sector.header.packet_info_count > (uint8_t)7)  // max 7 packets must contain an audio sector
+        if(parser->audio_sector.header.packet_info_count > (uint8_t)7)  // max 7 packets must contain an audio sector
         {
             sector_bad_reads = 1;
-            handle->frame.started = 0;
+            parser->frame.started = 0;
 
             fwprintf(stdout, L"\n ERROR: scarletbook_process_frames(), > Max 7 packets!!\n");
-            LOG(lm_main, LOG_ERROR, ("Error : scarletbook_process_frames(). > Max 7 packets!!, handle->audio_sector.header.packet_info_count:%d", handle->audio_sector.header.packet_info_count));
+            LOG(lm_main, LOG_ERROR, ("Error : scarletbook_process_frames(). > Max 7 packets!!, parser->audio_sector.header.packet_info_count:%d", parser->audio_sector.header.packet_info_count));
         }
         
-        handle->frame_info_idx = 0;
+        parser->frame_info_idx = 0;
         frame_info_idx = 0;
-        for (packet_info_idx = 0; packet_info_idx < handle->audio_sector.header.packet_info_count; packet_info_idx++) //&& (sector_bad_reads == 0)
+        for (packet_info_idx = 0; packet_info_idx < parser->audio_sector.header.packet_info_count; packet_info_idx++) //&& (sector_bad_reads == 0)
         {
-            audio_packet_info_t* packet = &handle->audio_sector.packet[packet_info_idx];
+            audio_packet_info_t* packet = &parser->audio_sector.packet[packet_info_idx];
             if(packet->packet_length > MAX_PACKET_SIZE)
             {
                 sector_bad_reads = 1;
@@ -917,19 +971,19 @@ int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffe
                         // If frame is already started 
                         // try to save the entire previous audio frame
                         // checks if we have a completed frame
-                        if (handle->frame.started){
-                            if (handle->frame.size > 0){
-                                if ((handle->frame.dst_encoded && handle->frame.sector_count == 0) ||
-                                    (!handle->frame.dst_encoded && handle->frame.size == handle->frame.channel_count * FRAME_SIZE_64))
+                        if (parser->frame.started){
+                            if (parser->frame.size > 0){
+                                if ((parser->frame.dst_encoded && parser->frame.sector_count == 0) ||
+                                    (!parser->frame.dst_encoded && parser->frame.size == parser->frame.channel_count * FRAME_SIZE_64))
                                 {
-                                    exec_read_callback(handle, frame_read_callback, userdata);
+                                    exec_read_callback(parser, frame_read_callback, userdata);
                                     nr_frames_proccesed ++;                                  
                                 } 
                             }
                         }
                         //check if timecode is consecutive (didn't miss a frame)
-                        uint32_t frametimecode_prev=TIME_FRAMECOUNT(&handle->frame.timecode);
-                        uint32_t frametimecode_current =TIME_FRAMECOUNT(&handle->audio_sector.frame[frame_info_idx].timecode);
+                        uint32_t frametimecode_prev=TIME_FRAMECOUNT(&parser->frame.timecode);
+                        uint32_t frametimecode_current =TIME_FRAMECOUNT(&parser->audio_sector.frame[frame_info_idx].timecode);
                        
                         if (frametimecode_prev > 0)
                         {
@@ -940,35 +994,35 @@ int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffe
                             }
                         }                       
 
-                        handle->frame.size = 0;
-                        handle->frame.dst_encoded = handle->audio_sector.header.dst_encoded;
-                        handle->frame.sector_count = handle->audio_sector.frame[frame_info_idx].sector_count;
-                        handle->frame.channel_count = get_channel_count(&handle->audio_sector.frame[frame_info_idx]);
-                        handle->frame.started = 1;
-                        handle->frame.timecode.minutes = handle->audio_sector.frame[frame_info_idx].timecode.minutes;
-                        handle->frame.timecode.seconds = handle->audio_sector.frame[frame_info_idx].timecode.seconds;
-                        handle->frame.timecode.frames = handle->audio_sector.frame[frame_info_idx].timecode.frames;
-                        handle->frame_info_idx = frame_info_idx;
+                        parser->frame.size = 0;
+                        parser->frame.dst_encoded = parser->audio_sector.header.dst_encoded;
+                        parser->frame.sector_count = parser->audio_sector.frame[frame_info_idx].sector_count;
+                        parser->frame.channel_count = get_channel_count(&parser->audio_sector.frame[frame_info_idx]);
+                        parser->frame.started = 1;
+                        parser->frame.timecode.minutes = parser->audio_sector.frame[frame_info_idx].timecode.minutes;
+                        parser->frame.timecode.seconds = parser->audio_sector.frame[frame_info_idx].timecode.seconds;
+                        parser->frame.timecode.frames = parser->audio_sector.frame[frame_info_idx].timecode.frames;
+                        parser->frame_info_idx = frame_info_idx;
 
                         // advance frame_info_idx
                         frame_info_idx++;
                     }
-                    if (handle->frame.started)
+                    if (parser->frame.started)
                     {
-                        if (handle->frame.size + packet->packet_length <= MAX_DST_SIZE)
+                        if (parser->frame.size + packet->packet_length <= MAX_DST_SIZE)
                         {
-                            memcpy(handle->frame.data + handle->frame.size, read_buffer_ptr, packet->packet_length);
-                            handle->frame.size += packet->packet_length;
-                            if (handle->frame.dst_encoded)
+                            memcpy(parser->frame.data + parser->frame.size, read_buffer_ptr, packet->packet_length);
+                            parser->frame.size += packet->packet_length;
+                            if (parser->frame.dst_encoded)
                             {
-                                handle->frame.sector_count--;
+                                parser->frame.sector_count--;
                             }
                         }
                         else
                         {
                             sector_bad_reads = 1;
                             // buffer overflow error, try next frame..
-                            handle->frame.started = 0;
+                            parser->frame.started = 0;
 
                             fwprintf(stdout, L"\n ERROR: scarletbook_process_frames(), buffer overflow error in blocks_read:%d\n", j);
                             LOG(lm_main, LOG_ERROR, ("Error : scarletbook_process_frames(), buffer overflow error. in blocks_read:%d", j));                                                      
@@ -1001,13 +1055,13 @@ int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffe
         // try to save the entire last audio frame
         // checks if we have a completed audio frame
         
-        if (handle->frame.started)
+        if (parser->frame.started)
         {
-            if (handle->frame.size > 0){
-                if ((handle->frame.dst_encoded && handle->frame.sector_count == 0) ||
-                    (!handle->frame.dst_encoded && handle->frame.size == handle->frame.channel_count * FRAME_SIZE_64))
+            if (parser->frame.size > 0){
+                if ((parser->frame.dst_encoded && parser->frame.sector_count == 0) ||
+                    (!parser->frame.dst_encoded && parser->frame.size == parser->frame.channel_count * FRAME_SIZE_64))
                 {
-                    exec_read_callback(handle, frame_read_callback, userdata);
+                    exec_read_callback(parser, frame_read_callback, userdata);
                     nr_frames_proccesed++;
                     
                 }
@@ -1022,4 +1076,876 @@ int scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffe
         return nr_frames_proccesed;
 }
 
+static inline int frame_complete(scarletbook_audio_frame_t *frame)
+{
+    return frame->size > 0 &&
+           ((frame->dst_encoded && frame->sector_count == 0) ||
+            (!frame->dst_encoded && frame->size == frame->channel_count * FRAME_SIZE_64));
+}
+
+#ifndef __lv2ppu__
+
+// a block is only split when every worker gets at least this many sectors
+#define FRAME_PARSE_MIN_SECTORS    64
+#define FRAME_PARSE_MAX_THREADS    16
+
+// a frame that starts in the sectors of a worker, its audio packets are gathered in the worker's data
+typedef struct
+{
+    size_t             offset;
+    int                size;
+    int                sector_count;             // DST packets still missing at the end of the worker's sectors
+    int                channel_count;
+    int                dst_encoded;
+    int                frame_info_idx;
+    audio_frame_info_t frame_info;
+}
+parsed_frame_t;
+
+typedef struct
+{
+    uint8_t        *sectors;
+    int             sector_count;
+
+    uint8_t        *data;                        // the head, followed by the frames
+    size_t          data_capacity;
+    size_t          head_size;                   // audio packets before the first frame start, they continue
+    int             head_packets;                // the last frame of the worker before
+    parsed_frame_t *frames;
+    int             frame_capacity;
+    int             frame_count;
+    int             error;                       // anything unusual, the sequential parser does the block then
+
+    thread         *thread;                      // started with the first block it gets, it stays for the next ones
+    lock           *state;                       // WORKER_IDLE, WORKER_BUSY or WORKER_QUIT
+}
+frame_parse_worker_t;
+
+enum
+{
+    WORKER_IDLE,
+    WORKER_BUSY,                                 // its sectors are set, it is parsing them
+    WORKER_QUIT
+};
+
+typedef struct
+{
+    frame_parse_worker_t worker[FRAME_PARSE_MAX_THREADS];
+}
+frame_workers_t;
+
+static void parse_frames_worker(void *arg);
+
+// waits for blocks until the parser goes away, worker 0 runs on the thread of the parser
+static void frame_worker_thread(void *arg)
+{
+    frame_parse_worker_t *worker = (frame_parse_worker_t *) arg;
+
+    for (;;)
+    {
+        possess(worker->state);
+        wait_for(worker->state, NOT_TO_BE, WORKER_IDLE);
+        if (peek_lock(worker->state) == WORKER_QUIT)
+        {
+            release(worker->state);
+            break;
+        }
+        release(worker->state);
+
+        parse_frames_worker(worker);
+
+        possess(worker->state);
+        twist(worker->state, TO, WORKER_IDLE);
+    }
+}
+
+static void free_frame_workers(void *frame_workers)
+{
+    frame_workers_t *workers = (frame_workers_t *) frame_workers;
+    int i;
+
+    if (!workers)
+        return;
+
+    for (i = 0; i < FRAME_PARSE_MAX_THREADS; i++)
+    {
+        frame_parse_worker_t *worker = &workers->worker[i];
+
+        if (worker->thread)
+        {
+            possess(worker->state);
+            twist(worker->state, TO, WORKER_QUIT);
+            join(worker->thread);
+        }
+        if (worker->state)
+            free_lock(worker->state);
+        free(worker->data);
+        free(worker->frames);
+    }
+    free(workers);
+}
+
+// the packet parsing of process_frames_sequential() on a worker's sectors, with no frame started at the beginning
+static void parse_frames_worker(void *arg)
+{
+    frame_parse_worker_t *worker = (frame_parse_worker_t *) arg;
+    audio_sector_t        audio_sector;
+    parsed_frame_t       *frame = 0;
+    size_t                data_size = 0;
+    uint8_t              *read_buffer_ptr;
+    int                   frame_info_idx;
+
+    memset(&audio_sector, 0, sizeof(audio_sector_t));
+    worker->head_size = 0;
+    worker->head_packets = 0;
+    worker->frame_count = 0;
+    worker->error = 0;
+
+    for (int j = 0; j < worker->sector_count && !worker->error; j++)
+    {
+        read_buffer_ptr = worker->sectors + j * SACD_LSN_SIZE;
+
+        memcpy(&audio_sector.header, read_buffer_ptr, AUDIO_SECTOR_HEADER_SIZE);
+        read_buffer_ptr += AUDIO_SECTOR_HEADER_SIZE;
+
+        if (audio_sector.header.packet_info_count > 7)
+        {
+            worker->error = 1;
+            break;
+        }
+
+#if defined(__BIG_ENDIAN__)
+        memcpy(&audio_sector.packet, read_buffer_ptr, AUDIO_PACKET_INFO_SIZE * audio_sector.header.packet_info_count);
+        read_buffer_ptr += AUDIO_PACKET_INFO_SIZE * audio_sector.header.packet_info_count;
+#else
+        for (uint8_t i = 0; i < audio_sector.header.packet_info_count; i++)
+        {
+            audio_sector.packet[i].frame_start = (read_buffer_ptr[0] >> 7) & 1;
+            audio_sector.packet[i].data_type = (read_buffer_ptr[0] >> 3) & 7;
+            audio_sector.packet[i].packet_length = (read_buffer_ptr[0] & 7) << 8 | read_buffer_ptr[1];
+            read_buffer_ptr += AUDIO_PACKET_INFO_SIZE;
+        }
+#endif
+        if (audio_sector.header.dst_encoded)
+        {
+            memcpy(&audio_sector.frame, read_buffer_ptr, AUDIO_FRAME_INFO_SIZE * audio_sector.header.frame_info_count);
+            read_buffer_ptr += AUDIO_FRAME_INFO_SIZE * audio_sector.header.frame_info_count;
+        }
+        else
+        {
+            for (uint8_t i = 0; i < audio_sector.header.frame_info_count; i++)
+            {
+                memcpy(&audio_sector.frame[i], read_buffer_ptr, AUDIO_FRAME_INFO_SIZE - 1);
+                read_buffer_ptr += AUDIO_FRAME_INFO_SIZE - 1;
+            }
+        }
+
+        frame_info_idx = 0;
+        for (uint8_t i = 0; i < audio_sector.header.packet_info_count; i++)
+        {
+            audio_packet_info_t *packet = &audio_sector.packet[i];
+
+            if (packet->packet_length > MAX_PACKET_SIZE)
+            {
+                worker->error = 1;
+                break;
+            }
+            if (packet->data_type == DATA_TYPE_AUDIO)
+            {
+                if (packet->frame_start)
+                {
+                    frame = &worker->frames[worker->frame_count++];
+                    frame->offset = data_size;
+                    frame->size = 0;
+                    frame->dst_encoded = audio_sector.header.dst_encoded;
+                    frame->sector_count = audio_sector.frame[frame_info_idx].sector_count;
+                    frame->channel_count = get_channel_count(&audio_sector.frame[frame_info_idx]);
+                    frame->frame_info = audio_sector.frame[frame_info_idx];
+                    frame->frame_info_idx = frame_info_idx;
+                    frame_info_idx++;
+                }
+                if (frame)
+                {
+                    if (frame->size + packet->packet_length > MAX_DST_SIZE)
+                    {
+                        worker->error = 1;
+                        break;
+                    }
+                    frame->size += packet->packet_length;
+                    if (frame->dst_encoded)
+                    {
+                        frame->sector_count--;
+                    }
+                }
+                else
+                {
+                    worker->head_size += packet->packet_length;
+                    worker->head_packets++;
+                }
+                memcpy(worker->data + data_size, read_buffer_ptr, packet->packet_length);
+                data_size += packet->packet_length;
+            }
+            read_buffer_ptr += packet->packet_length;
+        }
+    }
+}
+
+//       Splits the blocks between frame_parse_threads workers and joins their frames in order,
+//       the workers are threads of the parser that wait for the next block,
+//       the frame that is still open goes on in parser->frame as with process_frames_sequential()
+//       return nr of frames proccesed >=0 succes
+//              -1 the workers found something unusual, nothing is processed
+//
+static int process_frames_parallel(scarletbook_frame_parser_t *parser, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    frame_workers_t *workers = (frame_workers_t *) parser->frame_workers;
+    int              worker_count, started, size;
+    int              nr_frames_proccesed = 0;
+    int              k;
+
+    if (!workers)
+    {
+        workers = (frame_workers_t *) calloc(1, sizeof(frame_workers_t));
+        if (!workers)
+            return -1;
+        parser->frame_workers = workers;
+    }
+
+    worker_count = min(min(parser->frame_parse_threads, blocks_read_in / FRAME_PARSE_MIN_SECTORS), FRAME_PARSE_MAX_THREADS);
+    for (k = 0; k < worker_count; k++)
+    {
+        frame_parse_worker_t *worker = &workers->worker[k];
+        int first = blocks_read_in * k / worker_count;
+
+        worker->sectors = read_buffer + (size_t) first * SACD_LSN_SIZE;
+        worker->sector_count = blocks_read_in * (k + 1) / worker_count - first;
+
+        // every sector holds at most 7 frame starts and less than a sector of packets
+        if (worker->data_capacity < (size_t) worker->sector_count * SACD_LSN_SIZE)
+        {
+            free(worker->data);
+            worker->data_capacity = (size_t) worker->sector_count * SACD_LSN_SIZE;
+            worker->data = (uint8_t *) malloc(worker->data_capacity);
+        }
+        if (worker->frame_capacity < worker->sector_count * 7)
+        {
+            free(worker->frames);
+            worker->frame_capacity = worker->sector_count * 7;
+            worker->frames = (parsed_frame_t *) malloc(worker->frame_capacity * sizeof(parsed_frame_t));
+        }
+        if (!worker->data || !worker->frames)
+        {
+            free(worker->data);
+            free(worker->frames);
+            worker->data = 0;
+            worker->frames = 0;
+            worker->data_capacity = 0;
+            worker->frame_capacity = 0;
+            return -1;
+        }
+    }
+
+    // the threads are started once per parser, every block only wakes them up
+    for (k = 1; k < worker_count; k++)
+    {
+        frame_parse_worker_t *worker = &workers->worker[k];
+
+        if (!worker->thread)
+        {
+            worker->state = new_lock(WORKER_IDLE);
+            worker->thread = launch(frame_worker_thread, worker);
+        }
+        possess(worker->state);
+        twist(worker->state, TO, WORKER_BUSY);
+    }
+    parse_frames_worker(&workers->worker[0]);
+    for (k = 1; k < worker_count; k++)
+    {
+        possess(workers->worker[k].state);
+        wait_for(workers->worker[k].state, TO_BE, WORKER_IDLE);
+        release(workers->worker[k].state);
+    }
 
+    // the heads must fit in the frames they continue, like in process_frames_sequential()
+    started = parser->frame.started;
+    size = parser->frame.size;
+    for (k = 0; k < worker_count; k++)
+    {
+        frame_parse_worker_t *worker = &workers->worker[k];
+
+        if (worker->error || (started && size + worker->head_size > MAX_DST_SIZE))
+            return -1;
+
+        if (started)
+            size += (int) worker->head_size;
+        if (worker->frame_count > 0)
+        {
+            started = 1;
+            size = worker->frames[worker->frame_count - 1].size;
+        }
+    }
+
+    for (k = 0; k < worker_count; k++)
+    {
+        frame_parse_worker_t *worker = &workers->worker[k];
+
+        if (parser->frame.started && worker->head_packets > 0)
+        {
+            memcpy(parser->frame.data + parser->frame.size, worker->data, worker->head_size);
+            parser->frame.size += (int) worker->head_size;
+            if (parser->frame.dst_encoded)
+            {
+                parser->frame.sector_count -= worker->head_packets;
+            }
+        }
+
+        for (int i = 0; i < worker->frame_count; i++)
+        {
+            parsed_frame_t *frame = &worker->frames[i];
+
+            // the frame before is saved when it is complete, it is in parser->frame.data
+            // if it started in an earlier worker
+            if (parser->frame.started && frame_complete(&parser->frame))
+            {
+                if (i == 0)
+                {
+                    exec_read_callback(parser, frame_read_callback, userdata);
+                }
+                else
+                {
+                    parser->frame.started = 0;
+                    frame_read_callback(parser, worker->data + worker->frames[i - 1].offset, parser->frame.size, userdata);
+                }
+                nr_frames_proccesed++;
+            }
+
+            {
+                uint32_t frametimecode_prev = TIME_FRAMECOUNT(&parser->frame.timecode);
+                uint32_t frametimecode_current = TIME_FRAMECOUNT(&frame->frame_info.timecode);
+
+                if (frametimecode_prev > 0 && frametimecode_current != frametimecode_prev + 1)
+                {
+                    LOG(lm_main, LOG_ERROR, ("Error : scarletbook_process_frames(), frametimecode not succesive! frametimecode_current:%u, frametimecode_prev:%u", frametimecode_current, frametimecode_prev));
+                }
+            }
+
+            parser->frame.size = frame->size;
+            parser->frame.dst_encoded = frame->dst_encoded;
+            parser->frame.sector_count = frame->sector_count;
+            parser->frame.channel_count = frame->channel_count;
+            parser->frame.started = 1;
+            parser->frame.timecode.minutes = frame->frame_info.timecode.minutes;
+            parser->frame.timecode.seconds = frame->frame_info.timecode.seconds;
+            parser->frame.timecode.frames = frame->frame_info.timecode.frames;
+            parser->frame_info_idx = frame->frame_info_idx;
+        }
+
+        if (worker->frame_count > 0)
+        {
+            parsed_frame_t *frame = &worker->frames[worker->frame_count - 1];
+
+            memcpy(parser->frame.data, worker->data + frame->offset, frame->size);
+        }
+    }
+
+    if (last_block && parser->frame.started && frame_complete(&parser->frame))
+    {
+        exec_read_callback(parser, frame_read_callback, userdata);
+        nr_frames_proccesed++;
+    }
+
+    return nr_frames_proccesed;
+}
+
+#endif
+
+// the 3 in 14 and 3 in 16 areas repeat the same sectors every 14 or 16 sectors, such a period
+// holds 3 stereo plain DSD frames. Once the layout is learned from the first period, a period
+// is checked by comparing its sector and packet headers and the frames are gathered by offset.
+#define FIXED_LAYOUT_FRAMES         3
+#define FIXED_LAYOUT_MAX_PERIOD     16
+#define FIXED_LAYOUT_PREFIX_SIZE    (AUDIO_SECTOR_HEADER_SIZE + 7 * AUDIO_PACKET_INFO_SIZE)
+#define FIXED_LAYOUT_MAX_PIECES     (FIXED_LAYOUT_MAX_PERIOD * 7)
+#define FIXED_LAYOUT_ATTEMPTS       8
+
+typedef struct
+{
+    uint16_t offset;                             // from the start of the period
+    uint16_t length;
+}
+fixed_layout_piece_t;
+
+typedef struct
+{
+    int                  period;                 // sectors, 0 until learned
+    int                  attempts;               // blocks without a period that could be learned
+
+    uint8_t              prefix[FIXED_LAYOUT_MAX_PERIOD][FIXED_LAYOUT_PREFIX_SIZE];
+    int                  prefix_size[FIXED_LAYOUT_MAX_PERIOD];
+
+    uint32_t             timecode_offset[FIXED_LAYOUT_FRAMES];
+    int                  piece_first[FIXED_LAYOUT_FRAMES + 1];
+    fixed_layout_piece_t piece[FIXED_LAYOUT_MAX_PIECES];
+}
+fixed_layout_t;
+
+static inline uint32_t fixed_layout_timecode(fixed_layout_t *layout, const uint8_t *sectors, int frame)
+{
+    audio_frame_info_t frame_info;
+
+    memcpy(&frame_info, sectors + layout->timecode_offset[frame], AUDIO_FRAME_INFO_SIZE - 1);
+    return TIME_FRAMECOUNT(&frame_info.timecode);
+}
+
+// parses period sectors that start with the first frame of a period (its timecode is a multiple of 3)
+// into layout, return 0 if they hold exactly 3 consecutive frames and nothing of the frames around
+static int fixed_layout_learn(fixed_layout_t *layout, const uint8_t *sectors, int period)
+{
+    int frame_count = 0, piece_count = 0;
+    int p, i;
+
+    for (p = 0; p < period; p++)
+    {
+        const uint8_t       *sector = sectors + p * SACD_LSN_SIZE;
+        audio_frame_header_t header;
+        uint32_t             offset;
+        int                  frame_info_idx = 0;
+
+        memcpy(&header, sector, AUDIO_SECTOR_HEADER_SIZE);
+        if (header.dst_encoded || header.packet_info_count == 0 || header.packet_info_count > 7)
+            return -1;
+
+        layout->prefix_size[p] = AUDIO_SECTOR_HEADER_SIZE + header.packet_info_count * AUDIO_PACKET_INFO_SIZE;
+        memcpy(layout->prefix[p], sector, layout->prefix_size[p]);
+        offset = layout->prefix_size[p] + header.frame_info_count * (AUDIO_FRAME_INFO_SIZE - 1);
+
+        for (i = 0; i < header.packet_info_count; i++)
+        {
+            const uint8_t *packet_info = sector + AUDIO_SECTOR_HEADER_SIZE + i * AUDIO_PACKET_INFO_SIZE;
+            int            frame_start = (packet_info[0] >> 7) & 1;
+            int            data_type = (packet_info[0] >> 3) & 7;
+            uint32_t       packet_length = (packet_info[0] & 7) << 8 | packet_info[1];
+
+            if (packet_length > MAX_PACKET_SIZE || offset + packet_length > SACD_LSN_SIZE)
+                return -1;
+
+            if (data_type == DATA_TYPE_AUDIO)
+            {
+                if (frame_start)
+                {
+                    if (frame_count == FIXED_LAYOUT_FRAMES || frame_info_idx == header.frame_info_count)
+                        return -1;
+                    layout->timecode_offset[frame_count] = p * SACD_LSN_SIZE + layout->prefix_size[p] + frame_info_idx * (AUDIO_FRAME_INFO_SIZE - 1);
+                    layout->piece_first[frame_count++] = piece_count;
+                    frame_info_idx++;
+                }
+                if (frame_count == 0 || piece_count == FIXED_LAYOUT_MAX_PIECES)
+                    return -1;
+                layout->piece[piece_count].offset = (uint16_t) (p * SACD_LSN_SIZE + offset);
+                layout->piece[piece_count].length = (uint16_t) packet_length;
+                piece_count++;
+            }
+            offset += packet_length;
+        }
+    }
+    if (frame_count != FIXED_LAYOUT_FRAMES)
+        return -1;
+    layout->piece_first[FIXED_LAYOUT_FRAMES] = piece_count;
+
+    for (i = 0; i < FIXED_LAYOUT_FRAMES; i++)
+    {
+        int size = 0, k;
+
+        for (k = layout->piece_first[i]; k < layout->piece_first[i + 1]; k++)
+            size += layout->piece[k].length;
+        if (size != 2 * FRAME_SIZE_64)
+            return -1;
+    }
+    if (fixed_layout_timecode(layout, sectors, 0) % FIXED_LAYOUT_FRAMES != 0 ||
+        fixed_layout_timecode(layout, sectors, 1) != fixed_layout_timecode(layout, sectors, 0) + 1 ||
+        fixed_layout_timecode(layout, sectors, 2) != fixed_layout_timecode(layout, sectors, 0) + 2)
+        return -1;
+
+    layout->period = period;
+    return 0;
+}
+
+static inline int fixed_layout_matches(fixed_layout_t *layout, const uint8_t *sectors)
+{
+    uint32_t timecode;
+    int      p;
+
+    for (p = 0; p < layout->period; p++)
+    {
+        if (memcmp(sectors + p * SACD_LSN_SIZE, layout->prefix[p], layout->prefix_size[p]) != 0)
+            return 0;
+    }
+    timecode = fixed_layout_timecode(layout, sectors, 0);
+    return fixed_layout_timecode(layout, sectors, 1) == timecode + 1 &&
+           fixed_layout_timecode(layout, sectors, 2) == timecode + 2;
+}
+
+// the frame handling of process_frames_sequential() for the 3 frames of a matching period,
+// the last one stays open in parser->frame
+static int process_fixed_period(scarletbook_frame_parser_t *parser, fixed_layout_t *layout, const uint8_t *sectors, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    int nr_frames_proccesed = 0;
+    int i, k;
+
+    for (i = 0; i < FIXED_LAYOUT_FRAMES; i++)
+    {
+        audio_frame_info_t frame_info;
+        uint32_t           frametimecode_prev = TIME_FRAMECOUNT(&parser->frame.timecode);
+        uint32_t           frametimecode_current;
+
+        if (parser->frame.started && frame_complete(&parser->frame))
+        {
+            exec_read_callback(parser, frame_read_callback, userdata);
+            nr_frames_proccesed++;
+        }
+
+        memcpy(&frame_info, sectors + layout->timecode_offset[i], AUDIO_FRAME_INFO_SIZE - 1);
+        frametimecode_current = TIME_FRAMECOUNT(&frame_info.timecode);
+        if (frametimecode_prev > 0 && frametimecode_current != frametimecode_prev + 1)
+        {
+            LOG(lm_main, LOG_ERROR, ("Error : scarletbook_process_frames(), frametimecode not succesive! frametimecode_current:%u, frametimecode_prev:%u", frametimecode_current, frametimecode_prev));
+        }
+
+        parser->frame.size = 0;
+        for (k = layout->piece_first[i]; k < layout->piece_first[i + 1]; k++)
+        {
+            memcpy(parser->frame.data + parser->frame.size, sectors + layout->piece[k].offset, layout->piece[k].length);
+            parser->frame.size += layout->piece[k].length;
+        }
+        parser->frame.dst_encoded = 0;
+        parser->frame.sector_count = 0;
+        parser->frame.channel_count = 2;
+        parser->frame.started = 1;
+        parser->frame.timecode.minutes = frame_info.timecode.minutes;
+        parser->frame.timecode.seconds = frame_info.timecode.seconds;
+        parser->frame.timecode.frames = frame_info.timecode.frames;
+    }
+
+    return nr_frames_proccesed;
+}
+
+static int process_frames_generic(scarletbook_frame_parser_t *parser, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+{
+#ifndef __lv2ppu__
+    if (parser->frame_parse_threads > 1 && blocks_read_in >= 2 * FRAME_PARSE_MIN_SECTORS)
+    {
+        int nr_frames_proccesed = process_frames_parallel(parser, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+        if (nr_frames_proccesed >= 0)
+            return nr_frames_proccesed;
+    }
+#endif
+    return process_frames_sequential(parser, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+}
+
+//       Takes every period of a 3 in 14/16 area that matches the learned layout,
+//       the sectors in between (the ends of the block, anything unusual) go to process_frames_generic()
+//       return nr of frames proccesed >=0 succes
+//              -1 error (has sector bad reads)
+//
+static int process_frames_fixed(scarletbook_frame_parser_t *parser, int period, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    fixed_layout_t *layout = (fixed_layout_t *) parser->frame_layout;
+    int             nr_frames_proccesed = 0;
+    int             sector_bad_reads = 0;
+    int             start = 0, j, ret;
+
+    if (!layout)
+    {
+        layout = (fixed_layout_t *) calloc(1, sizeof(fixed_layout_t));
+        if (!layout)
+            return process_frames_generic(parser, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+        parser->frame_layout = layout;
+    }
+
+    if (layout->period == 0)
+    {
+        for (j = 0; j + period <= blocks_read_in; j++)
+        {
+            const uint8_t *sector = read_buffer + j * SACD_LSN_SIZE;
+
+            // a period starts with the frame start of its first frame
+            if ((sector[0] & 1) == 0 && (sector[0] >> 2 & 7) > 0 && (sector[1] & 0xb8) == (0x80 | DATA_TYPE_AUDIO << 3) &&
+                fixed_layout_learn(layout, sector, period) == 0)
+            {
+                LOG(lm_main, LOG_NOTICE, ("scarletbook_process_frames(): fixed layout of %d sectors learned", period));
+                break;
+            }
+        }
+        if (layout->period == 0)
+        {
+            if (blocks_read_in >= 2 * period)
+                layout->attempts++;
+            return process_frames_generic(parser, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+        }
+    }
+
+    for (j = 0; j + period <= blocks_read_in; )
+    {
+        uint8_t *sectors = read_buffer + j * SACD_LSN_SIZE;
+
+        if (!fixed_layout_matches(layout, sectors))
+        {
+            j++;
+            continue;
+        }
+
+        if (j > start)
+        {
+            ret = process_frames_generic(parser, read_buffer + start * SACD_LSN_SIZE, j - start, 0, frame_read_callback, userdata);
+            if (ret < 0)
+                sector_bad_reads = 1;
+            else
+                nr_frames_proccesed += ret;
+        }
+        nr_frames_proccesed += process_fixed_period(parser, layout, sectors, frame_read_callback, userdata);
+        j += period;
+        start = j;
+    }
+
+    // also completes the last frame of the track
+    ret = process_frames_generic(parser, read_buffer + start * SACD_LSN_SIZE, blocks_read_in - start, last_block, frame_read_callback, userdata);
+    if (ret < 0)
+        sector_bad_reads = 1;
+    else
+        nr_frames_proccesed += ret;
+
+    if (sector_bad_reads > 0)
+        return -1;
+    else
+        return nr_frames_proccesed;
+}
+
+int scarletbook_process_frames(scarletbook_frame_parser_t *parser, uint8_t *read_buffer, int blocks_read_in, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    int period = 0;
+
+    // only the 2 channel area can have a fixed layout
+    if (parser->handle->twoch_area_idx != -1)
+    {
+        switch (parser->handle->area[parser->handle->twoch_area_idx].area_toc->frame_format)
+        {
+        case FRAME_FORMAT_DSD_3_IN_14:
+            period = 14;
+            break;
+        case FRAME_FORMAT_DSD_3_IN_16:
+            period = 16;
+            break;
+        }
+    }
+
+    if (period > 0 && (!parser->frame_layout || ((fixed_layout_t *) parser->frame_layout)->attempts < FIXED_LAYOUT_ATTEMPTS))
+        return process_frames_fixed(parser, period, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+
+    return process_frames_generic(parser, read_buffer, blocks_read_in, last_block, frame_read_callback, userdata);
+}
+
+typedef struct
+{
+    scarletbook_frame_parser_t *parser;
+    frame_read_callback_t       frame_read_callback;
+    void                       *userdata;
+}
+frame_forward_t;
+
+static void forward_frame(const sacd_input_frame_t *frame, void *userdata)
+{
+    frame_forward_t            *forward = (frame_forward_t *) userdata;
+    scarletbook_frame_parser_t *parser = forward->parser;
+
+    // the callbacks look at parser->frame, as after scarletbook_process_frames()
+    parser->frame.size = (int) frame->size;
+    parser->frame.dst_encoded = frame->dst_encoded;
+    parser->frame.channel_count = frame->channel_count;
+    parser->frame.timecode.minutes = frame->minutes;
+    parser->frame.timecode.seconds = frame->seconds;
+    parser->frame.timecode.frames = frame->frames;
+    parser->frame.started = 0;
+
+    forward->frame_read_callback(parser, frame->data, frame->size, forward->userdata);
+}
+
+int scarletbook_read_frames(scarletbook_frame_parser_t *parser, uint32_t lsn, uint32_t count, uint32_t end_lsn, int frame_flags, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    frame_forward_t forward;
+
+    forward.parser = parser;
+    forward.frame_read_callback = frame_read_callback;
+    forward.userdata = userdata;
+
+    return sacd_read_frames((sacd_reader_t *) parser->handle->sacd, lsn, count, end_lsn, frame_flags, forward_frame, &forward);
+}
+
+// sectors read at once when looking for the next sector that starts a frame,
+// a 6 channel DSD frame spans 14 sectors
+#define FRAME_PROBE_SECTORS    16
+
+// timecode of the last audio frame that starts in the sector, 0 if none starts there
+static int sector_last_frame(const uint8_t *sector, uint32_t *frame)
+{
+    audio_frame_header_t header;
+    audio_frame_info_t   frame_info;
+    size_t               frame_info_size;
+
+    memcpy(&header, sector, AUDIO_SECTOR_HEADER_SIZE);
+    if (header.frame_info_count == 0 || header.packet_info_count > 7)
+        return 0;
+
+    // DSD sectors leave out the channel byte of the frame info
+    frame_info_size = header.dst_encoded ? AUDIO_FRAME_INFO_SIZE : AUDIO_FRAME_INFO_SIZE - 1;
+    memcpy(&frame_info, sector + AUDIO_SECTOR_HEADER_SIZE + header.packet_info_count * AUDIO_PACKET_INFO_SIZE +
+           (header.frame_info_count - 1) * frame_info_size, AUDIO_FRAME_INFO_SIZE - 1);
+    *frame = TIME_FRAMECOUNT(&frame_info.timecode);
+
+    return 1;
+}
+
+static void frame_index_add(scarletbook_area_t *area, uint32_t lsn, uint32_t frame)
+{
+    int i;
+
+    if (area->frame_index_count == FRAME_INDEX_SIZE)
+        return;
+
+    for (i = area->frame_index_count; i > 0 && area->frame_index[i - 1].lsn >= lsn; i--)
+    {
+        if (area->frame_index[i - 1].lsn == lsn)
+            return;
+    }
+    memmove(&area->frame_index[i + 1], &area->frame_index[i], (area->frame_index_count - i) * sizeof(scarletbook_frame_index_t));
+    area->frame_index[i].lsn = lsn;
+    area->frame_index[i].frame = frame;
+    area->frame_index_count++;
+}
+
+uint32_t scarletbook_read_audio_sectors(scarletbook_handle_t *handle, int area_idx, uint32_t lsn, uint32_t count, uint8_t *buffer)
+{
+    uint32_t blocks_read;
+
+    blocks_read = sacd_read_block_raw((sacd_reader_t *) handle->sacd, lsn, count, buffer);
+    if (blocks_read == 0)
+        return 0;
+
+    // the track area is encrypted, except on the DSD 3 14/16 discs mentioned in scarletbook_output.c
+    switch (handle->area[area_idx].area_toc->frame_format)
+    {
+    case FRAME_FORMAT_DSD_3_IN_14:
+    case FRAME_FORMAT_DSD_3_IN_16:
+        if (*(uint64_t *)(buffer + 16) == 0)
+            break;
+        sacd_decrypt((sacd_reader_t *) handle->sacd, buffer, blocks_read);
+        break;
+    default:
+        sacd_decrypt((sacd_reader_t *) handle->sacd, buffer, blocks_read);
+        break;
+    }
+
+    return blocks_read;
+}
+
+// finds the first sector in [lsn, last] that starts an audio frame, 0 if there is none
+static uint32_t probe_frame_start(scarletbook_handle_t *handle, int area_idx, uint8_t *buffer, uint32_t lsn, uint32_t last, uint32_t *frame)
+{
+    scarletbook_area_t *area = &handle->area[area_idx];
+    uint32_t            blocks_read;
+    uint32_t            i;
+
+    while (lsn <= last)
+    {
+        blocks_read = scarletbook_read_audio_sectors(handle, area_idx, lsn, min(last - lsn + 1, FRAME_PROBE_SECTORS), buffer);
+        if (blocks_read == 0)
+            return 0;
+
+        for (i = 0; i < blocks_read; i++)
+        {
+            if (sector_last_frame(buffer + i * SACD_LSN_SIZE, frame))
+            {
+                frame_index_add(area, lsn + i, *frame);
+                return lsn + i;
+            }
+        }
+        lsn += blocks_read;
+    }
+    return 0;
+}
+
+uint32_t scarletbook_frame_to_lsn(scarletbook_handle_t *handle, int area_idx, uint32_t frame)
+{
+    scarletbook_area_t *area = &handle->area[area_idx];
+    uint8_t            *buffer;
+    uint32_t            lo, hi, mid, lsn, found = 0;
+    uint32_t            probe_frame;
+    int                 i;
+
+    if (!area->area_toc)
+        return 0;
+
+    // the probes would use up a forward-only stream, its tracks start at the TOC lsns
+    if (sacd_is_sequential((sacd_reader_t *) handle->sacd))
+        return 0;
+
+    // asked before, in this run or in one that saved the seek-point cache file
+    for (i = 0; i < area->frame_seek_count; i++)
+    {
+        if (area->frame_seek[i].frame == frame)
+            return area->frame_seek[i].lsn;
+    }
+
+    lo = area->area_toc->track_start;
+    hi = area->area_toc->track_end;
+
+    // the timecodes grow with the lsn, so every known sector narrows the search
+    for (i = 0; i < area->frame_index_count; i++)
+    {
+        if (area->frame_index[i].frame < frame)
+        {
+            lo = max(lo, area->frame_index[i].lsn + 1);
+        }
+        else
+        {
+            found = area->frame_index[i].lsn;
+            hi = found - 1;
+            break;
+        }
+    }
+
+    buffer = (uint8_t *) malloc(FRAME_PROBE_SECTORS * SACD_LSN_SIZE);
+    if (!buffer)
+        return 0;
+
+    while (lo <= hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        lsn = probe_frame_start(handle, area_idx, buffer, mid, hi, &probe_frame);
+        if (lsn == 0)
+        {
+            hi = mid - 1;
+        }
+        else if (probe_frame >= frame)
+        {
+            found = lsn;
+            hi = mid - 1;
+        }
+        else
+        {
+            lo = lsn + 1;
+        }
+    }
+
+    free(buffer);
+
+    if (found != 0 && area->frame_seek_count < FRAME_SEEK_SIZE)
+    {
+        area->frame_seek[area->frame_seek_count].frame = frame;
+        area->frame_seek[area->frame_seek_count].lsn = found;
+        area->frame_seek_count++;
+    }
+
+    LOG(lm_main, LOG_NOTICE, ("scarletbook_frame_to_lsn(): area: %d, frame: %u, lsn: %u", area_idx, frame, found));
+
+    return found;
+}
@@ -38,21 +38,62 @@ extern "C" {
 scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd_reader);
 
 /**
- * initialize scarletbook audio frames structs
+ * parser = scarletbook_frame_parser_create(handle);
+ *
+ * Creates the state for assembling the audio frames of a disc, one for every
+ * track that is extracted at the same time. The handle is only read.
  */
-void scarletbook_frame_init(scarletbook_handle_t *handle);
+scarletbook_frame_parser_t *scarletbook_frame_parser_create(scarletbook_handle_t *handle);
 
 /**
- * callback when a complete audio frame has been read
+ * frees a frame parser and its buffers
  */
-typedef void (*frame_read_callback_t)(scarletbook_handle_t *handle, uint8_t* frame_data, size_t frame_size, void *userdata);
+void scarletbook_frame_parser_destroy(scarletbook_frame_parser_t *parser);
+
+/**
+ * initialize scarletbook audio frames structs, before the first sectors of a track
+ */
+void scarletbook_frame_init(scarletbook_frame_parser_t *parser);
+
+/**
+ * callback when a complete audio frame has been read, parser->frame describes it
+ */
+typedef void (*frame_read_callback_t)(scarletbook_frame_parser_t *parser, uint8_t* frame_data, size_t frame_size, void *userdata);
 
 /**
  * processes scarletbook audio frames and does a callback in case it found a frame
  *   return -1 if errors encounters. (sector_bad_reads)
  *            1 succes
  */
-int scarletbook_process_frames(scarletbook_handle_t *, uint8_t *, int, int, frame_read_callback_t, void *);
+int scarletbook_process_frames(scarletbook_frame_parser_t *, uint8_t *, int, int, frame_read_callback_t, void *);
+
+/**
+ * lets the input assemble the audio frames of a sector range (a sacd server, see
+ * sacd_read_frames) and does a callback for every frame, parser->frame describes it.
+ * The sectors up to the end of the track range are requested ahead.
+ *   return number of sectors consumed, 0 on errors,
+ *          -1 if the input can't, use scarletbook_process_frames then
+ */
+int scarletbook_read_frames(scarletbook_frame_parser_t *, uint32_t, uint32_t, uint32_t, int, frame_read_callback_t, void *);
+
+/**
+ * reads count sectors of an area's track range into buffer and decrypts them,
+ *   return number of sectors read, 0 on errors
+ */
+uint32_t scarletbook_read_audio_sectors(scarletbook_handle_t *, int, uint32_t, uint32_t, uint8_t *);
+
+/**
+ * returns the first sector of the area's track range that holds the start of
+ * an audio frame with a timecode of at least frame (as frame count, see
+ * TIME_FRAMECOUNT), 0 if there is none, the disc can't be read or the input
+ * is a forward-only stream (sacd_is_sequential()).
+ *
+ * The sectors are found with a binary search over the frame info headers, the
+ * probed sectors are kept in the area's frame index for the next lookups and
+ * the answer in its frame_seek list (saved by scarletbook_frame_index_save()).
+ * As that changes the handle, call it before tracks are extracted in parallel.
+ */
+uint32_t scarletbook_frame_to_lsn(scarletbook_handle_t *, int, uint32_t);
 
 /**
  * scarletbook_close(ifofile);
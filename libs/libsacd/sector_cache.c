@@ -0,0 +1,509 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__lv2ppu__)
+#include <sys/mutex.h>
+#include <sys/cond.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <list.h>
+#include <utils.h>
+#include <logging.h>
+
+#include "scarletbook.h"
+#include "sector_cache.h"
+
+/* runs read with one backend call at most, a group never spans two shards */
+#define GROUP_RUNS (MAX_PROCESSING_BLOCK_SIZE / SECTOR_CACHE_RUN)
+#define GROUP_SECTORS (GROUP_RUNS * SECTOR_CACHE_RUN)
+
+#define MAX_SHARDS 8
+
+/* readers sharing the cache whose sequential access is recognized */
+#define MAX_STREAMS 8
+
+#if defined(__lv2ppu__)
+typedef sys_mutex_t cache_lock_t;
+typedef sys_cond_t cache_cond_t;
+
+static int lock_create(cache_lock_t *lock, cache_cond_t *cond)
+{
+    sys_mutex_attr_t mutex_attr;
+    sys_cond_attr_t  cond_attr;
+
+    memset(&mutex_attr, 0, sizeof(sys_mutex_attr_t));
+    mutex_attr.attr_protocol  = SYS_MUTEX_PROTOCOL_FIFO;
+    mutex_attr.attr_recursive = SYS_MUTEX_ATTR_NOT_RECURSIVE;
+    mutex_attr.attr_pshared   = SYS_MUTEX_ATTR_PSHARED;
+    mutex_attr.attr_adaptive  = SYS_MUTEX_ATTR_NOT_ADAPTIVE;
+    memset(&cond_attr, 0, sizeof(sys_cond_attr_t));
+    cond_attr.attr_pshared = SYS_COND_ATTR_PSHARED;
+
+    if (sysMutexCreate(lock, &mutex_attr) != 0)
+        return -1;
+    return sysCondCreate(cond, *lock, &cond_attr) != 0 ? -1 : 0;
+}
+#define lock_destroy(lock, cond)  do { sysCondDestroy(*(cond)); sysMutexDestroy(*(lock)); } while (0)
+#define lock_acquire(lock)        sysMutexLock(*(lock), 0)
+#define lock_release(lock)        sysMutexUnlock(*(lock))
+#define cond_wait(cond, lock)     sysCondWait(*(cond), 0)
+#define cond_broadcast(cond)      sysCondBroadcast(*(cond))
+#else
+typedef pthread_mutex_t cache_lock_t;
+typedef pthread_cond_t cache_cond_t;
+
+static int lock_create(cache_lock_t *lock, cache_cond_t *cond)
+{
+    if (pthread_mutex_init(lock, NULL) != 0)
+        return -1;
+    return pthread_cond_init(cond, NULL) != 0 ? -1 : 0;
+}
+#define lock_destroy(lock, cond)  do { pthread_cond_destroy(cond); pthread_mutex_destroy(lock); } while (0)
+#define lock_acquire(lock)        pthread_mutex_lock(lock)
+#define lock_release(lock)        pthread_mutex_unlock(lock)
+#define cond_wait(cond, lock)     pthread_cond_wait(cond, lock)
+#define cond_broadcast(cond)      pthread_cond_broadcast(cond)
+#endif
+
+enum
+{
+    ENTRY_EMPTY,
+    ENTRY_LOADING,                      /* a backend read is filling it, readers wait */
+    ENTRY_VALID
+};
+
+typedef struct
+{
+    uint32_t            lsn;            /* first sector, a multiple of SECTOR_CACHE_RUN */
+    uint32_t            count;          /* valid sectors */
+    int                 state;
+    int                 hash_next;      /* next entry in the same bucket, -1 ends the chain */
+    struct list_head    lru;
+    uint8_t            *data;
+}
+cache_entry_t;
+
+typedef struct
+{
+    cache_lock_t        lock;
+    cache_cond_t        changed;        /* a load of this shard finished */
+    cache_entry_t      *entries;
+    int                 entry_count;
+    int                *buckets;
+    uint32_t            bucket_mask;
+    struct list_head    lru;            /* most recently used first */
+    sector_cache_stats_t stats;
+}
+cache_shard_t;
+
+struct sector_cache_t
+{
+    cache_shard_t       shards[MAX_SHARDS];
+    int                 shard_count;
+    uint8_t            *data;
+
+    /* backend reads are served in ticket order */
+    cache_lock_t        backend_lock;
+    cache_cond_t        backend_turn;
+    uint32_t            next_ticket;
+    uint32_t            serving;
+    uint32_t            stream_end[MAX_STREAMS];    /* ends of recent requests, detect sequential access */
+    int                 next_stream;    /* the slot a new stream replaces */
+    uint8_t            *scratch;        /* a group of runs, used by the reader whose turn it is */
+
+    sector_cache_read_t read;
+    void               *context;
+};
+
+static cache_shard_t *shard_of(sector_cache_t *cache, uint32_t lsn)
+{
+    return &cache->shards[(lsn / GROUP_SECTORS) % cache->shard_count];
+}
+
+static uint32_t bucket_of(cache_shard_t *shard, uint32_t lsn)
+{
+    return ((lsn / SECTOR_CACHE_RUN) * 2654435761u) & shard->bucket_mask;
+}
+
+static cache_entry_t *cache_lookup(cache_shard_t *shard, uint32_t lsn)
+{
+    int i = shard->buckets[bucket_of(shard, lsn)];
+
+    while (i >= 0)
+    {
+        if (shard->entries[i].lsn == lsn)
+            return &shard->entries[i];
+        i = shard->entries[i].hash_next;
+    }
+    return 0;
+}
+
+static void cache_link(cache_shard_t *shard, cache_entry_t *entry, uint32_t lsn)
+{
+    uint32_t bucket = bucket_of(shard, lsn);
+
+    entry->lsn = lsn;
+    entry->hash_next = shard->buckets[bucket];
+    shard->buckets[bucket] = (int) (entry - shard->entries);
+}
+
+static void cache_unlink(cache_shard_t *shard, cache_entry_t *entry)
+{
+    int *link = &shard->buckets[bucket_of(shard, entry->lsn)];
+    int  index = (int) (entry - shard->entries);
+
+    while (*link >= 0)
+    {
+        if (*link == index)
+        {
+            *link = entry->hash_next;
+            break;
+        }
+        link = &shard->entries[*link].hash_next;
+    }
+    entry->hash_next = -1;
+    entry->state = ENTRY_EMPTY;
+    entry->count = 0;
+}
+
+/* least recently used entry that nobody is loading, 0 when all are busy */
+static cache_entry_t *cache_evict(cache_shard_t *shard)
+{
+    struct list_head *node;
+
+    for (node = shard->lru.prev; node != &shard->lru; node = node->prev)
+    {
+        cache_entry_t *entry = list_entry(node, cache_entry_t, lru);
+
+        if (entry->state == ENTRY_LOADING)
+            continue;
+        if (entry->state == ENTRY_VALID)
+            cache_unlink(shard, entry);
+        return entry;
+    }
+    return 0;
+}
+
+/* a short run is kept until its reader copied it, the next reader reads it again */
+static void cache_expire(cache_shard_t *shard, cache_entry_t *entry)
+{
+    cache_unlink(shard, entry);
+    list_move_tail(&entry->lru, &shard->lru);
+}
+
+/**
+ * reads the claimed runs with one backend call, the shard lock is released
+ * meanwhile. A reader has at most one read queued, so concurrent readers
+ * take turns on the backend. Short runs past request_end are not kept, no
+ * one is going to copy them.
+ */
+static uint32_t cache_load(sector_cache_t *cache, cache_shard_t *shard, cache_entry_t **claimed, int run_count, uint32_t request_end)
+{
+    uint32_t sectors_read;
+    uint32_t ticket;
+    int      i;
+
+    lock_release(&shard->lock);
+
+    lock_acquire(&cache->backend_lock);
+    ticket = cache->next_ticket++;
+    while (cache->serving != ticket)
+        cond_wait(&cache->backend_turn, &cache->backend_lock);
+    lock_release(&cache->backend_lock);
+
+    sectors_read = cache->read(cache->context, claimed[0]->lsn, run_count * SECTOR_CACHE_RUN, cache->scratch);
+    for (i = 0; i < run_count; i++)
+    {
+        uint32_t n = sectors_read > (uint32_t) i * SECTOR_CACHE_RUN ? min(sectors_read - i * SECTOR_CACHE_RUN, SECTOR_CACHE_RUN) : 0;
+
+        memcpy(claimed[i]->data, cache->scratch + (size_t) i * SECTOR_CACHE_RUN * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+        claimed[i]->count = n;
+    }
+
+    lock_acquire(&cache->backend_lock);
+    cache->serving++;
+    cond_broadcast(&cache->backend_turn);
+    lock_release(&cache->backend_lock);
+
+    lock_acquire(&shard->lock);
+    shard->stats.misses += run_count;
+    shard->stats.sectors_read += sectors_read;
+    for (i = 0; i < run_count; i++)
+    {
+        if (claimed[i]->count == SECTOR_CACHE_RUN || (claimed[i]->count > 0 && claimed[i]->lsn < request_end))
+        {
+            claimed[i]->state = ENTRY_VALID;
+        }
+        else
+        {
+            cache_expire(shard, claimed[i]);
+        }
+    }
+    cond_broadcast(&shard->changed);
+
+    return sectors_read;
+}
+
+static int shard_create(cache_shard_t *shard, cache_entry_t *entries, int entry_count, uint8_t *data)
+{
+    uint32_t bucket_count = 1;
+    int      i;
+
+    while (bucket_count < (uint32_t) entry_count * 2)
+        bucket_count <<= 1;
+    shard->bucket_mask = bucket_count - 1;
+    shard->buckets = (int *) malloc(bucket_count * sizeof(int));
+    if (!shard->buckets)
+        return -1;
+    memset(shard->buckets, 0xff, bucket_count * sizeof(int));
+
+    shard->entries = entries;
+    shard->entry_count = entry_count;
+    INIT_LIST_HEAD(&shard->lru);
+    for (i = 0; i < entry_count; i++)
+    {
+        entries[i].hash_next = -1;
+        entries[i].data = data + (size_t) i * SECTOR_CACHE_RUN * SACD_LSN_SIZE;
+        list_add_tail(&entries[i].lru, &shard->lru);
+    }
+
+    if (lock_create(&shard->lock, &shard->changed) != 0)
+    {
+        free(shard->buckets);
+        shard->buckets = 0;
+        return -1;
+    }
+    return 0;
+}
+
+sector_cache_t *sector_cache_create(uint32_t max_sectors, sector_cache_read_t read, void *context)
+{
+    sector_cache_t *cache;
+    cache_entry_t  *entries;
+    int             entry_count, shard_entries, i;
+
+    cache = (sector_cache_t *) calloc(1, sizeof(sector_cache_t));
+    if (!cache)
+        return 0;
+
+    // every shard holds at least one group of runs
+    entry_count = max(GROUP_RUNS, max_sectors / SECTOR_CACHE_RUN);
+    cache->shard_count = max(1, min(MAX_SHARDS, entry_count / GROUP_RUNS));
+    shard_entries = entry_count / cache->shard_count;
+    entry_count = shard_entries * cache->shard_count;
+
+    entries = (cache_entry_t *) calloc(entry_count, sizeof(cache_entry_t));
+    cache->data = (uint8_t *) malloc((size_t) entry_count * SECTOR_CACHE_RUN * SACD_LSN_SIZE);
+    cache->scratch = (uint8_t *) malloc((size_t) GROUP_SECTORS * SACD_LSN_SIZE);
+    cache->shards[0].entries = entries;
+    if (!entries || !cache->data || !cache->scratch || lock_create(&cache->backend_lock, &cache->backend_turn) != 0)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR in sector_cache_create(): Could not allocate memory"));
+        free(entries);
+        free(cache->data);
+        free(cache->scratch);
+        free(cache);
+        return 0;
+    }
+
+    for (i = 0; i < cache->shard_count; i++)
+    {
+        if (shard_create(&cache->shards[i], entries + i * shard_entries, shard_entries,
+                         cache->data + (size_t) i * shard_entries * SECTOR_CACHE_RUN * SACD_LSN_SIZE) != 0)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR in sector_cache_create(): Could not allocate memory"));
+            cache->shard_count = i + 1;
+            sector_cache_destroy(cache);
+            return 0;
+        }
+    }
+
+    for (i = 0; i < MAX_STREAMS; i++)
+        cache->stream_end[i] = (uint32_t) -1;
+    cache->read = read;
+    cache->context = context;
+
+    return cache;
+}
+
+void sector_cache_destroy(sector_cache_t *cache)
+{
+    int i;
+
+    if (!cache)
+        return;
+
+    for (i = 0; i < cache->shard_count; i++)
+    {
+        if (cache->shards[i].buckets)
+        {
+            lock_destroy(&cache->shards[i].lock, &cache->shards[i].changed);
+            free(cache->shards[i].buckets);
+        }
+    }
+    lock_destroy(&cache->backend_lock, &cache->backend_turn);
+
+    free(cache->shards[0].entries);
+    free(cache->data);
+    free(cache->scratch);
+    free(cache);
+}
+
+uint32_t sector_cache_read(sector_cache_t *cache, uint32_t lsn, uint32_t count, uint8_t *buffer)
+{
+    uint32_t done = 0;
+    uint32_t loaded_end = 0;            /* runs below this were loaded by this call */
+    uint32_t waited_lsn = (uint32_t) -1;
+    uint32_t load_end;
+    int      sequential = 0;
+    int      i;
+
+    // sequential if it continues one of the recent requests, the tracks
+    // extracted in parallel each read their own part of the disc
+    lock_acquire(&cache->backend_lock);
+    for (i = 0; i < MAX_STREAMS; i++)
+    {
+        if (cache->stream_end[i] == lsn)
+        {
+            sequential = 1;
+            break;
+        }
+    }
+    if (!sequential)
+    {
+        i = cache->next_stream;
+        cache->next_stream = (i + 1) % MAX_STREAMS;
+    }
+    cache->stream_end[i] = lsn + count;
+    lock_release(&cache->backend_lock);
+
+    while (done < count)
+    {
+        uint32_t       run_lsn = (lsn + done) - (lsn + done) % SECTOR_CACHE_RUN;
+        uint32_t       skip = lsn + done - run_lsn;
+        cache_shard_t *shard = shard_of(cache, run_lsn);
+        cache_entry_t *entry;
+        uint32_t       n;
+        int            short_run;
+
+        lock_acquire(&shard->lock);
+
+        entry = cache_lookup(shard, run_lsn);
+        if (entry && entry->state == ENTRY_LOADING)
+        {
+            // another reader is loading this run, wait for it instead of reading it twice
+            if (waited_lsn != run_lsn)
+            {
+                shard->stats.coalesced++;
+                waited_lsn = run_lsn;
+            }
+            cond_wait(&shard->changed, &shard->lock);
+            lock_release(&shard->lock);
+            continue;
+        }
+
+        if (!entry)
+        {
+            cache_entry_t *claimed[GROUP_RUNS];
+            int            run_count = 0;
+
+            // claim the missing runs up to the next cached one, sequential
+            // reads continue to the end of the group
+            load_end = run_lsn - run_lsn % GROUP_SECTORS + GROUP_SECTORS;
+            if (!sequential)
+                load_end = min(load_end, lsn + count);
+
+            while (run_lsn + run_count * SECTOR_CACHE_RUN < load_end &&
+                   !cache_lookup(shard, run_lsn + run_count * SECTOR_CACHE_RUN))
+            {
+                cache_entry_t *victim = cache_evict(shard);
+                if (!victim)
+                    break;
+                victim->state = ENTRY_LOADING;
+                cache_link(shard, victim, run_lsn + run_count * SECTOR_CACHE_RUN);
+                list_move(&victim->lru, &shard->lru);
+                claimed[run_count++] = victim;
+            }
+
+            if (run_count == 0)
+            {
+                // every entry of the shard is being loaded, wait for one
+                cond_wait(&shard->changed, &shard->lock);
+                lock_release(&shard->lock);
+                continue;
+            }
+
+            if (cache_load(cache, shard, claimed, run_count, lsn + count) == 0)
+            {
+                lock_release(&shard->lock);
+                break;
+            }
+            loaded_end = run_lsn + run_count * SECTOR_CACHE_RUN;
+            if (loaded_end > lsn + count)
+                shard->stats.read_ahead += loaded_end - max(lsn + count, run_lsn);
+            lock_release(&shard->lock);
+            continue;
+        }
+
+        if (run_lsn >= loaded_end)
+            shard->stats.hits++;
+        list_move(&entry->lru, &shard->lru);
+
+        // a short run is the end of the disc
+        n = skip < entry->count ? min(entry->count - skip, count - done) : 0;
+        memcpy(buffer + (size_t) done * SACD_LSN_SIZE, entry->data + (size_t) skip * SACD_LSN_SIZE, (size_t) n * SACD_LSN_SIZE);
+        done += n;
+        short_run = entry->count < SECTOR_CACHE_RUN;
+        if (short_run)
+            cache_expire(shard, entry);
+
+        lock_release(&shard->lock);
+
+        if (n == 0 || short_run)
+            break;
+    }
+
+    return done;
+}
+
+void sector_cache_get_stats(sector_cache_t *cache, sector_cache_stats_t *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(sector_cache_stats_t));
+    for (i = 0; i < cache->shard_count; i++)
+    {
+        cache_shard_t *shard = &cache->shards[i];
+
+        lock_acquire(&shard->lock);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->coalesced += shard->stats.coalesced;
+        stats->sectors_read += shard->stats.sectors_read;
+        stats->read_ahead += shard->stats.read_ahead;
+        lock_release(&shard->lock);
+    }
+}
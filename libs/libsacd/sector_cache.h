@@ -0,0 +1,72 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SECTOR_CACHE_H_INCLUDED
+#define SECTOR_CACHE_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* sectors per cache entry, entries start at a multiple of this */
+#define SECTOR_CACHE_RUN 32
+
+typedef uint32_t (*sector_cache_read_t)(void *context, uint32_t lsn, uint32_t count, uint8_t *buffer);
+
+typedef struct sector_cache_t sector_cache_t;
+
+typedef struct
+{
+    uint64_t hits;          /* runs served from the cache */
+    uint64_t misses;        /* runs read from the backend */
+    uint64_t coalesced;     /* runs another thread was reading already */
+    uint64_t sectors_read;  /* sectors read from the backend */
+    uint64_t read_ahead;    /* sectors read past the request on sequential access */
+}
+sector_cache_stats_t;
+
+/**
+ * LRU cache of raw sectors in front of a read function, for the readers and
+ * the servers that share one disc between threads. max_sectors is rounded
+ * down to whole runs.
+ *
+ * The runs are spread over shards with a lock each. Missing runs are read
+ * outside the lock with one backend call, one call at a time in request
+ * order, and a run that is being read is waited for instead of being read
+ * again. Sequential reads (ones that continue any of the last few requests,
+ * so parallel readers each count) are extended to the next 512 sector boundary.
+ * A run the backend returned short or not at all is not kept, the next
+ * request for it goes to the backend again.
+ */
+sector_cache_t *sector_cache_create(uint32_t max_sectors, sector_cache_read_t read, void *context);
+void sector_cache_destroy(sector_cache_t *);
+
+/* same contract as sacd_read_block_raw(), returns the number of sectors copied */
+uint32_t sector_cache_read(sector_cache_t *, uint32_t lsn, uint32_t count, uint8_t *buffer);
+
+void sector_cache_get_stats(sector_cache_t *, sector_cache_stats_t *);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SECTOR_CACHE_H_INCLUDED */
@@ -31,21 +31,33 @@
 #include <wchar.h>
 #include <locale.h>
 #include <time.h>
+#include <math.h>
 #ifndef __APPLE__
 #include <malloc.h>
 #endif
 #if defined(WIN32) || defined(_WIN32)
 #include <io.h>
+#else
+#include <dirent.h>
+#endif
+#if defined(__linux__)
+#include <sys/sysmacros.h>
 #endif
 
 #include <pthread.h>
 #include <charset.h>
 #include <logging.h>
+#include <pipeline_stats.h>
+#include <trace_events.h>
+#include <dst_stats.h>
+#include <mem_stats.h>
+#include <progress.h>
 
 #include "getopt.h"
 #include "sacd_reader.h"
 #include "scarletbook.h"
 #include "scarletbook_read.h"
+#include "scarletbook_frame_index.h"
 #include "scarletbook_output.h"
 #include "scarletbook_print.h"
 #include "scarletbook_helpers.h"
@@ -85,10 +97,43 @@ static struct opts_s
     int            id3_tag_mode; // 0=>no id3 inserted; 1=>id3 v2.3 with UTF-16 encoding; 2=>miminal id3v2.3 tag with UTF-16 encoding; 3=>id3v2.3 with ISO_8859_1 encoding; 4=>id3v2.4 with UTF-8 encoding; 5=>id3v2.4 minimal with UTF-8 encoding
     int            version;
     int            concurrent;
+    int            net_window; // read requests kept in flight when the input is a server
+    int            cache_size; // MB of sectors cached in front of the input, 0 = no cache
+    int            range;        // if 1 only the frames [range_start...range_end) are extracted, in one file per area
+    uint32_t       range_start;
+    uint32_t       range_end;
+    int            seek_cache;   // if 1 the seek points of the disc are kept in a file, so later runs don't probe for them
+    int            parse_threads; // threads that parse the audio frames of a block of sectors, 0 or 1 = no threads
+    int            jobs;          // tracks of an image file extracted at the same time
+    char          *batch_path;    // directory or list file with the inputs of a batch
+    char          *stats_json;    // file that gets the pipeline stats of each input (JSON)
+    char          *trace_file;    // file that gets the timeline of the threads (Chrome trace events)
+    char          *dst_stats;     // file that gets what the DST frames of each track cost to decode (JSON)
+    int            output_null;   // the tracks are extracted but not written (to measure the rest of the pipeline)
+    int            bench_runs;    // each input is extracted this many times cold and warm, see print_bench_summary()
+    int            progress_json; // the progress goes to stderr as JSON lines, in place of the console line
 } opts;
 
-scarletbook_handle_t *handle;
-scarletbook_output_t *output;
+// what an input changes of the options while it is extracted, each input of a batch
+// has its own, see extract_input()
+typedef struct
+{
+    char                   *input_device;
+    int                     two_channel;
+    int                     multi_channel;
+    int                     concurrent;
+    int                     print;
+    int                     output_iso;
+    int                     export_cue_sheet;
+    int                     jobs;               // tracks extracted at the same time, at most, then as many as were
+    scarletbook_output_t   *output;             // the one running, stopped by Ctrl+C
+    time_t                  started_processing;
+}
+input_state_t;
+
+// the inputs being extracted, one slot for each input of a batch that runs at the same time
+#define MAX_RUNNING_INPUTS 32
+static input_state_t *running_inputs[MAX_RUNNING_INPUTS];
 
 /* Parse all options. */
 static int parse_options(int argc, char *argv[]) 
@@ -119,10 +164,30 @@ static int parse_options(int argc, char *argv[])
         "  -A, --artist                    : artist name is added in folder name. Default is disabled\n"
         "  -a, --performer                 : performer name is added in track filename. Default is disabled\n"
         "  -b, --pauses                    : all pauses will be included. Default is disabled\n"
+        "  -r, --range mm:ss:ff-mm:ss:ff   : only extract this part of the area into one DSF/DSDIFF file\n"
+        "  -x, --seek-cache                : keep a seek-point cache (sectors where the tracks / ranges start) of the disc in a file\n"
+        "  -j, --jobs N                    : extract up to N tracks of an iso image at the same time\n"
+        "  -B, --batch PATH                : extract every iso image of a directory, or every input\n"
+        "                                    listed in a file (one per line), -j N of them at a time\n"
+        "                                    (no shared decode pool, see the readme)\n"
+        "  -J, --stats-json FILE           : write the time spent in each stage of the extraction\n"
+        "                                    (read, decrypt, parse, decode, reorder, write) as JSON\n"
+        "  -T, --trace FILE                : write a timeline of the reads, decoding and writes of all\n"
+        "                                    threads (Chrome trace events, open it in ui.perfetto.dev)\n"
+        "  -D, --dst-stats FILE            : write what the DST frames of each decoded track cost to\n"
+        "                                    decode (frame properties, times, costliest frames) as JSON\n"
+        "  -n, --output-null               : extract the tracks (DST decoded) without writing them,\n"
+        "                                    in place of -s or -p\n"
+        "  -N, --bench N                   : extract each input N times with its cached pages dropped\n"
+        "                                    (cold) and N times more (warm), then print the mean and\n"
+        "                                    standard deviation of the throughput of every stage\n"
+        "  -q, --progress-json             : no progress line, write the progress to stderr every\n"
+        "                                    second as a JSON line (for scripts)\n"
         "  -v, --version                   : Display version\n"
         "\n"
         "  -i, --input[=FILE]              : set source and determine if \"iso\" image, \n"
         "                                    device or server (ex. -i 192.168.1.10:2002)\n"
+        "                                    \"-\" or a named pipe streams an iso image (one area only)\n"
         "\n"
         "Help options:\n"
         "  -?, --help                      : Show this help message\n"
@@ -136,13 +201,16 @@ static int parse_options(int argc, char *argv[])
         "        [-e|--output-dsdiff-em] [-s|--output-dsf] [-I|--output-iso] [-w|--concurrent]\n"
 #endif
         "        [-c|--convert-dst] [-C|--export-cue] [-i|--input FILE] [-o|--output-dir DIR] [-y|--output-dir-conc DIR] [-P|--print]\n"
+        "        [-r|--range mm:ss:ff-mm:ss:ff] [-x|--seek-cache] [-j|--jobs N] [-B|--batch PATH]\n"
+        "        [-J|--stats-json FILE] [-T|--trace FILE] [-D|--dst-stats FILE] [-n|--output-null] [-N|--bench N]\n"
+        "        [-q|--progress-json]\n"
         "        [-?|--help] [--usage]\n";
 
 
 #ifdef SECTOR_LIMIT
-    static const char options_string[] = "2mepszt:kIcCo:y:PAabvi:?u";
+    static const char options_string[] = "2mepszt:kIcCo:y:PAabr:xj:B:J:T:D:nN:qvi:?u";
 #else
-    static const char options_string[] = "2mepszt:kIwcCo:y:PAabvi:?u";
+    static const char options_string[] = "2mepszt:kIwcCo:y:PAabr:xj:B:J:T:D:nN:qvi:?u";
 #endif
 
     static const struct option options_table[] = {
@@ -166,6 +234,16 @@ static int parse_options(int argc, char *argv[])
         {"artist", no_argument, NULL, 'A'},
         {"performer", no_argument, NULL, 'a'},
         {"pauses", no_argument, NULL, 'b'},
+        {"range", required_argument, NULL, 'r'},
+        {"seek-cache", no_argument, NULL, 'x'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"batch", required_argument, NULL, 'B'},
+        {"stats-json", required_argument, NULL, 'J'},
+        {"trace", required_argument, NULL, 'T'},
+        {"dst-stats", required_argument, NULL, 'D'},
+        {"output-null", no_argument, NULL, 'n'},
+        {"bench", required_argument, NULL, 'N'},
+        {"progress-json", no_argument, NULL, 'q'},
         {"version", no_argument, NULL, 'v'},
         {"input", required_argument, NULL, 'i'},                
         {"help", no_argument, NULL, '?'},
@@ -229,6 +307,53 @@ static int parse_options(int argc, char *argv[])
         case 'b':
             opts.audio_frame_trimming = 0;
             break;
+        case 'r':
+        {
+            unsigned int m1, s1, f1, m2, s2, f2;
+            if (sscanf(optarg, "%u:%u:%u-%u:%u:%u", &m1, &s1, &f1, &m2, &s2, &f2) == 6 &&
+                s1 < 60 && f1 < SACD_FRAME_RATE && s2 < 60 && f2 < SACD_FRAME_RATE)
+            {
+                opts.range_start = (m1 * 60 + s1) * SACD_FRAME_RATE + f1;
+                opts.range_end = (m2 * 60 + s2) * SACD_FRAME_RATE + f2;
+                opts.range = opts.range_end > opts.range_start;
+            }
+            if (!opts.range)
+                fwprintf(stderr, L"\n Warning: invalid range %s, expected mm:ss:ff-mm:ss:ff\n", optarg);
+            break;
+        }
+        case 'x':
+            opts.seek_cache = 1;
+            break;
+        case 'j':
+            opts.jobs = atoi(optarg);
+            if (opts.jobs < 1)
+                opts.jobs = 1;
+            break;
+        case 'B':
+            free(opts.batch_path);
+            opts.batch_path = strdup(optarg);
+            break;
+        case 'J':
+            free(opts.stats_json);
+            opts.stats_json = strdup(optarg);
+            break;
+        case 'T':
+            free(opts.trace_file);
+            opts.trace_file = strdup(optarg);
+            break;
+        case 'D':
+            free(opts.dst_stats);
+            opts.dst_stats = strdup(optarg);
+            break;
+        case 'n':
+            opts.output_null = 1;
+            break;
+        case 'N':
+            opts.bench_runs = max(0, atoi(optarg));
+            break;
+        case 'q':
+            opts.progress_json = 1;
+            break;
         case 'A':
             opts.artist_flag = 1;
             break;
@@ -344,6 +469,10 @@ static int parse_options(int argc, char *argv[])
 
 static lock *g_fwprintf_lock = 0;
 
+// what returns a static buffer (substr(), asctime(), the cue sheet and XML writers) is
+// called by one input at a time, the inputs of a batch can run at the same time
+static lock *g_static_buffers_lock = 0;
+
 static int safe_fwprintf(FILE *stream, const wchar_t *format, ...)
 {
     int retval;
@@ -362,10 +491,21 @@ static int safe_fwprintf(FILE *stream, const wchar_t *format, ...)
     return retval;
 }
 
+static volatile sig_atomic_t interrupted = 0;   // stops a batch after the inputs running
+
 static void handle_sigint(int sig_no)
 {
+    int i;
+
+    interrupted = 1;
     safe_fwprintf(stdout, L"\n\n Program interrupted...                                                      \n");
-    scarletbook_output_interrupt(output);
+    for (i = 0; i < MAX_RUNNING_INPUTS; i++)
+    {
+        input_state_t *in = running_inputs[i];
+
+        if (in && in->output)
+            scarletbook_output_interrupt(in->output);
+    }
 }
 
 
@@ -378,35 +518,61 @@ static void handle_status_update_track_callback(char *filename, int current_trac
     free(wide_filename);
 }
 
-static time_t started_processing;
+// the inputs of a batch run at the same time, the progress and memory peak are the batch's
+static int batch_progress = 0;
 
-static void handle_status_update_progress_callback(uint32_t stats_total_sectors, uint32_t stats_total_sectors_processed,
-                                 uint32_t stats_current_file_total_sectors, uint32_t stats_current_file_sectors_processed)
+// shows a sample of the progress counters (progress.h), runs on the reporter thread
+static void show_progress(const progress_sample_t *sample, void *userdata)
 {
-    // safe_fwprintf(stdout, L"\rCompleted: %d%% (%.1fMB), Total: %d%% (%.1fMB) at %.2fMB/sec", (stats_current_file_sectors_processed*100/stats_current_file_total_sectors), 
-    //                                          ((float)((double) stats_current_file_sectors_processed * SACD_LSN_SIZE / 1048576.00)),
-    //                                          (stats_total_sectors_processed * 100 / stats_total_sectors),
-    //                                          ((float)((double) stats_current_file_total_sectors * SACD_LSN_SIZE / 1048576.00)),
-    //                                          (float)((double) stats_total_sectors_processed * SACD_LSN_SIZE / 1048576.00) / (float)(time(0) - started_processing)
-    //                                          );
-    if (stats_current_file_total_sectors == stats_total_sectors) // no need to print both stats because is one file  (ISO or DFF)
+    const int64_t *counters = sample->counters;
+    double sector_mb = (double) SACD_LSN_SIZE / 1048576.0;
+    double mb_per_sec = 0, avg_mb_per_sec = 0, frames_per_sec = 0, avg_frames_per_sec = 0, eta = -1;
+    int64_t sectors_left = counters[PROGRESS_TOTAL_SECTORS] - counters[PROGRESS_SECTORS];
+    int percent = counters[PROGRESS_TOTAL_SECTORS] > 0 ? (int) (counters[PROGRESS_SECTORS] * 100 / counters[PROGRESS_TOTAL_SECTORS]) : 0;
+
+    (void) userdata;
+
+    if (sample->interval > 0)
     {
-        safe_fwprintf(stdout, L"\rCompleted: %d%% (file sectors processed: %d / total sectors:%d)",
-                    (stats_current_file_sectors_processed * 100 / stats_current_file_total_sectors),
-                    stats_current_file_sectors_processed,
-                    stats_current_file_total_sectors);
+        mb_per_sec = sample->deltas[PROGRESS_SECTORS] * sector_mb / sample->interval;
+        frames_per_sec = sample->deltas[PROGRESS_FRAMES] / sample->interval;
     }
-    else
+    if (sample->seconds > 0)
+    {
+        avg_mb_per_sec = counters[PROGRESS_SECTORS] * sector_mb / sample->seconds;
+        avg_frames_per_sec = counters[PROGRESS_FRAMES] / sample->seconds;
+    }
+    if (counters[PROGRESS_SECTORS] > 0)
+        eta = sectors_left * sample->seconds / counters[PROGRESS_SECTORS];
+
+    if (opts.progress_json)
     {
-        safe_fwprintf(stdout, L"\rCompleted: %d%% (file sectors processed: %d / total sectors:%d), Total: %d%% (total sectors processed: %d / total sectors: %d)",
-                    (stats_current_file_sectors_processed * 100 / stats_current_file_total_sectors),
-                    stats_current_file_sectors_processed,
-                    stats_current_file_total_sectors,
-                    (stats_total_sectors_processed * 100 / stats_total_sectors),
-                    stats_total_sectors_processed,
-                    stats_total_sectors);
+        safe_fwprintf(stderr, L"{\"seconds\": %.2f, \"sectors\": %lld, \"total_sectors\": %lld, \"tracks\": %lld, \"total_tracks\": %lld, "
+                      L"\"frames\": %lld, \"mb_per_sec\": %.2f, \"avg_mb_per_sec\": %.2f, \"frames_per_sec\": %.1f, \"avg_frames_per_sec\": %.1f, "
+                      L"\"realtime\": %.2f, \"decode_queue\": %lld, \"eta_seconds\": %.1f, \"final\": %d}\n",
+                      sample->seconds, (long long) counters[PROGRESS_SECTORS], (long long) counters[PROGRESS_TOTAL_SECTORS],
+                      (long long) counters[PROGRESS_TRACKS], (long long) counters[PROGRESS_TOTAL_TRACKS], (long long) counters[PROGRESS_FRAMES],
+                      mb_per_sec, avg_mb_per_sec, frames_per_sec, avg_frames_per_sec, frames_per_sec / SACD_FRAME_RATE,
+                      (long long) counters[PROGRESS_DECODE_QUEUE], eta, sample->final);
+        return;
     }
 
+    // the last sample comes right after the one before, its rates are the averages
+    if (sample->final)
+    {
+        mb_per_sec = avg_mb_per_sec;
+        frames_per_sec = avg_frames_per_sec;
+    }
+    if (eta < 0)
+        safe_fwprintf(stdout, L"\rCompleted: %d%% (%lld / %lld sectors), %.1f MB/s (avg %.1f), %.0f frames/s, %.1fx realtime, decode queue %lld, ETA --:--   ",
+                      percent, (long long) counters[PROGRESS_SECTORS], (long long) counters[PROGRESS_TOTAL_SECTORS],
+                      mb_per_sec, avg_mb_per_sec, frames_per_sec, frames_per_sec / SACD_FRAME_RATE,
+                      (long long) counters[PROGRESS_DECODE_QUEUE]);
+    else
+        safe_fwprintf(stdout, L"\rCompleted: %d%% (%lld / %lld sectors), %.1f MB/s (avg %.1f), %.0f frames/s, %.1fx realtime, decode queue %lld, ETA %02d:%02d   ",
+                      percent, (long long) counters[PROGRESS_SECTORS], (long long) counters[PROGRESS_TOTAL_SECTORS],
+                      mb_per_sec, avg_mb_per_sec, frames_per_sec, frames_per_sec / SACD_FRAME_RATE,
+                      (long long) counters[PROGRESS_DECODE_QUEUE], (int) (eta + 0.5) / 60, (int) (eta + 0.5) % 60);
 }
 
 /* Initialize global variables. */
@@ -435,6 +601,19 @@ static void init(void)
     opts.logging            = 0;
     opts.id3_tag_mode       = 3; // default id3v2.3 ; ISO_8859_1 encoding // id3v2.4 tag and UTF8 encoding
     opts.concurrent         = 0;
+    opts.net_window         = 4;
+    opts.cache_size         = 32;
+    opts.range              = 0;
+    opts.seek_cache         = 0;
+    opts.parse_threads      = 4;
+    opts.jobs               = 1;
+    opts.batch_path         = NULL;
+    opts.stats_json         = NULL;
+    opts.trace_file         = NULL;
+    opts.dst_stats          = NULL;
+    opts.output_null        = 0;
+    opts.bench_runs         = 0;
+    opts.progress_json      = 0;
 
 #if defined(WIN32) || defined(_WIN32)
     signal(SIGINT, handle_sigint);
@@ -447,32 +626,358 @@ static void init(void)
 #endif
 
         //init_logging(1);   //init_logging(0); 0 = not create a log file
+        // before the first lock, the memory stats free what they allocated
+        dst_decoder_count_memory();
         g_fwprintf_lock = new_lock(0);
+        g_static_buffers_lock = new_lock(0);
+}
+
+// the most memory held since print_start_time(), see mem_stats.h
+static void print_memory_peak(void)
+{
+    mem_subsystem_totals_t totals[MEM_SUBSYSTEMS];
+    uint64_t peak = mem_stats_totals(totals);
+    int i;
+
+    fwprintf(stdout, L" Memory peak: %.1f MB (", peak / (1024.0 * 1024.0));
+    for (i = 0; i < MEM_SUBSYSTEMS; i++)
+    {
+        wchar_t *wide_name;
+        CHAR2WCHAR(wide_name, mem_stats_subsystem_name(i));
+        fwprintf(stdout, L"%ls%ls %.1f MB", i ? L", " : L"", wide_name, totals[i].peak / (1024.0 * 1024.0));
+        free(wide_name);
+    }
+    fwprintf(stdout, L")\n");
+
+    mem_stats_log();
 }
 
-void print_start_time()
+void print_start_time(input_state_t *in)
 {
-	started_processing = time(0);
+	in->started_processing = time(0);
+	if (!batch_progress)
+	{
+		mem_stats_reset_peaks();
+		progress_start(opts.progress_json ? 1000 : 250, show_progress, NULL);
+	}
 	wchar_t *wide_asctime;
-	CHAR2WCHAR(wide_asctime, asctime(localtime(&started_processing)));
+	possess(g_static_buffers_lock);
+	CHAR2WCHAR(wide_asctime, asctime(localtime(&in->started_processing)));
+	release(g_static_buffers_lock);
 	fwprintf(stdout, L"\n Started at: %ls    \n", wide_asctime );
 	free(wide_asctime);
 }
-void print_end_time()
+void print_end_time(input_state_t *in)
 {
+	if (!batch_progress)
+		progress_stop();
 	time_t ended_processing=time(0);
-	time_t seconds = difftime(ended_processing,started_processing);
+	time_t seconds = difftime(ended_processing,in->started_processing);
 
 	char elapsed_time[100];
-	strftime(elapsed_time, 90, "%H hours:%M minutes:%S seconds", gmtime(&seconds));
     wchar_t *wide_result_time, *wide_asctime;
+	possess(g_static_buffers_lock);
+	strftime(elapsed_time, 90, "%H hours:%M minutes:%S seconds", gmtime(&seconds));
     CHAR2WCHAR(wide_result_time, elapsed_time);
 
 	CHAR2WCHAR(wide_asctime, asctime(localtime(&ended_processing)));
+	release(g_static_buffers_lock);
 
 	fwprintf(stdout, L"\n\n Ended at: %ls [elapsed: %ls]\n", wide_asctime, wide_result_time);
 	free(wide_result_time);
 	free(wide_asctime);	
+
+	if (!batch_progress)
+		print_memory_peak();
+}
+
+enum
+{
+    BATCH_INPUT_WAITING,
+    BATCH_INPUT_RUNNING,
+    BATCH_INPUT_DONE
+};
+
+// one input of a batch (-B), see read_batch_inputs()
+typedef struct
+{
+    char   *input;
+    int     state;      // BATCH_INPUT_WAITING, BATCH_INPUT_RUNNING or BATCH_INPUT_DONE
+    int     failed;
+    time_t  seconds;
+    int     rotational; // the inputs on the same spinning disk are extracted one after the other
+    dev_t   disk;
+}
+batch_input_t;
+
+static int compare_batch_inputs(const void *a, const void *b)
+{
+    return strcmp(((const batch_input_t *) a)->input, ((const batch_input_t *) b)->input);
+}
+
+static int add_batch_input(batch_input_t **inputs, int *count, const char *dir, const char *input)
+{
+    char dir_input[MAX_BUFF_FULL_PATH_LEN];
+    batch_input_t *grown = (batch_input_t *) realloc(*inputs, (*count + 1) * sizeof(batch_input_t));
+    if (!grown)
+        return -1;
+
+    *inputs = grown;
+    memset(&grown[*count], 0, sizeof(batch_input_t));
+    if (dir)
+    {
+        // the names are kept as they are, make_filename() would sanitize them
+#if defined(WIN32) || defined(_WIN32)
+        snprintf(dir_input, sizeof(dir_input), "%s\\%s", dir, input);
+#else
+        snprintf(dir_input, sizeof(dir_input), "%s/%s", dir, input);
+#endif
+        input = dir_input;
+    }
+    grown[*count].input = strdup(input);
+    (*count)++;
+    return 0;
+}
+
+// the inputs of a batch: the *.iso files of a directory (sorted by name), or the lines
+// of a list file (iso images, devices or servers; empty lines and # comments are skipped)
+static batch_input_t *read_batch_inputs(char *path, int *count)
+{
+    batch_input_t *inputs = NULL;
+    char line[MAX_BUFF_FULL_PATH_LEN];
+    size_t n;
+
+    *count = 0;
+
+    if (path_dir_exists(path))
+    {
+#if defined(WIN32) || defined(_WIN32)
+        struct _finddata_t entry;
+        intptr_t find;
+        snprintf(line, sizeof(line), "%s\\*.iso", path);
+        find = _findfirst(line, &entry);
+        if (find != -1)
+        {
+            do
+            {
+                add_batch_input(&inputs, count, path, entry.name);
+            } while (_findnext(find, &entry) == 0);
+            _findclose(find);
+        }
+#else
+        struct dirent *entry;
+        DIR *dir = opendir(path);
+
+        while (dir && (entry = readdir(dir)) != NULL)
+        {
+            n = strlen(entry->d_name);
+            if (n > 4 && strcasecmp(entry->d_name + n - 4, ".iso") == 0)
+                add_batch_input(&inputs, count, path, entry->d_name);
+        }
+        if (dir)
+            closedir(dir);
+#endif
+        if (*count > 1)
+            qsort(inputs, *count, sizeof(batch_input_t), compare_batch_inputs);
+    }
+    else
+    {
+        FILE *fp = fopen(path, "r");
+
+        while (fp && fgets(line, sizeof(line), fp) != NULL)
+        {
+            n = strlen(line);
+            while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r' || line[n - 1] == ' ' || line[n - 1] == '\t'))
+                line[--n] = '\0';
+            if (n == 0 || line[0] == '#')
+                continue;
+            add_batch_input(&inputs, count, NULL, line);
+        }
+        if (fp)
+            fclose(fp);
+    }
+
+    return inputs;
+}
+
+// a local image on a spinning disk is read by one job, seeking between tracks costs more than it gains.
+// disk (if not NULL) gets the device of the disk, the same for all its partitions
+static int is_on_rotational_disk(const char *path, dev_t *disk)
+{
+#if defined(__linux__)
+    struct stat st;
+    char sys_path[64];
+    FILE *fp;
+    int rotational = 0;
+
+    if (disk)
+        *disk = 0;
+    if (stat(path, &st) != 0)
+        return 0;
+
+    // the device itself, or the disk the file is on (a partition has the queue in its parent)
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    if (disk)
+        *disk = dev;
+    snprintf(sys_path, sizeof(sys_path), "/sys/dev/block/%u:%u/queue/rotational", major(dev), minor(dev));
+    fp = fopen(sys_path, "r");
+    if (!fp)
+    {
+        unsigned int disk_major, disk_minor;
+
+        snprintf(sys_path, sizeof(sys_path), "/sys/dev/block/%u:%u/../dev", major(dev), minor(dev));
+        fp = fopen(sys_path, "r");
+        if (fp)
+        {
+            if (disk && fscanf(fp, "%u:%u", &disk_major, &disk_minor) == 2)
+                *disk = makedev(disk_major, disk_minor);
+            fclose(fp);
+        }
+        snprintf(sys_path, sizeof(sys_path), "/sys/dev/block/%u:%u/../queue/rotational", major(dev), minor(dev));
+        fp = fopen(sys_path, "r");
+    }
+    if (fp)
+    {
+        if (fscanf(fp, "%d", &rotational) != 1)
+            rotational = 0;
+        fclose(fp);
+    }
+    return rotational == 1;
+#else
+    (void) path;
+    if (disk)
+        *disk = 0;
+    return 0;
+#endif
+}
+
+static void print_batch_summary(batch_input_t *inputs, int count)
+{
+    int i, failed = 0, processed = 0;
+
+    fwprintf(stdout, L"\n\nBatch summary:\n");
+    for (i = 0; i < count; i++)
+    {
+        wchar_t *wide_filename;
+        CHAR2WCHAR(wide_filename, inputs[i].input);
+        if (inputs[i].state != BATCH_INPUT_DONE)
+            fwprintf(stdout, L"  [skipped] %ls\n", wide_filename);
+        else
+            fwprintf(stdout, L"  [%ls] %ls (%02d:%02d:%02d)\n", inputs[i].failed ? L"failed" : L"ok", wide_filename,
+                     (int) (inputs[i].seconds / 3600), (int) (inputs[i].seconds / 60 % 60), (int) (inputs[i].seconds % 60));
+        free(wide_filename);
+
+        if (inputs[i].state == BATCH_INPUT_DONE)
+        {
+            processed++;
+            if (inputs[i].failed)
+                failed++;
+        }
+    }
+    fwprintf(stdout, L"\n %d of %d input(s) extracted, %d failed, %d skipped\n", processed - failed, count, failed, count - processed);
+    LOG(lm_main, LOG_NOTICE, ("Batch: %d of %d input(s) extracted, %d failed, %d skipped", processed - failed, count, failed, count - processed));
+}
+
+// one extraction of a bench (-N), see print_bench_summary()
+typedef struct
+{
+    int                     cold;
+    double                  wall_seconds;
+    pipeline_stage_totals_t stages[PIPELINE_STAGES];
+}
+bench_run_t;
+
+// drops the cached pages of an input file so the next run reads it from the disk,
+// returns -1 if it can't be done (a server, not on Linux)
+static int drop_input_cache(const char *path)
+{
+#if defined(__linux__)
+    int fd = open(path, O_RDONLY);
+    int result;
+
+    if (fd < 0)
+        return -1;
+    result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return result == 0 ? 0 : -1;
+#else
+    (void) path;
+    return -1;
+#endif
+}
+
+static void mean_stddev(const double *values, int count, double *mean, double *stddev)
+{
+    double sum = 0.0, squares = 0.0;
+    int i;
+
+    for (i = 0; i < count; i++)
+        sum += values[i];
+    *mean = count > 0 ? sum / count : 0.0;
+    for (i = 0; i < count; i++)
+        squares += (values[i] - *mean) * (values[i] - *mean);
+    *stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+}
+
+// mean and standard deviation of the wall time and of the throughput of every stage,
+// the cold and the warm runs apart
+static void print_bench_summary(const char *input, bench_run_t *runs, int count)
+{
+    double *values = (double *) malloc((count + 1) * sizeof(double));
+    double mean, stddev, busy, frames, capacity;
+    wchar_t *wide_filename;
+    int cold, i, n, stage;
+
+    if (!values)
+        return;
+
+    CHAR2WCHAR(wide_filename, input);
+    fwprintf(stdout, L"\n\nBench summary [%ls]:\n", wide_filename);
+    free(wide_filename);
+
+    for (cold = 1; cold >= 0; cold--)
+    {
+        for (i = n = 0; i < count; i++)
+        {
+            if (runs[i].cold == cold)
+                values[n++] = runs[i].wall_seconds;
+        }
+        if (n == 0)
+            continue;
+
+        mean_stddev(values, n, &mean, &stddev);
+        fwprintf(stdout, L"\n  %ls, %d run(s): %.3f s (+- %.3f)\n", cold ? L"cold" : L"warm", n, mean, stddev);
+        // the wall rate is what the rip got out of a stage, the busy rate what the stage
+        // could do (per thread) if it never had to wait for the others
+        fwprintf(stdout, L"    stage     wall MB/s  (+- stddev)   busy MB/s    frames/s   busy\n");
+
+        for (stage = 0; stage < PIPELINE_STAGES; stage++)
+        {
+            wchar_t *wide_stage;
+
+            busy = frames = capacity = 0.0;
+            for (i = n = 0; i < count; i++)
+            {
+                if (runs[i].cold != cold || runs[i].wall_seconds <= 0.0)
+                    continue;
+                values[n++] = runs[i].stages[stage].bytes / (1024.0 * 1024.0) / runs[i].wall_seconds;
+                frames += runs[i].stages[stage].frames / runs[i].wall_seconds;
+                busy += runs[i].stages[stage].busy_seconds / runs[i].wall_seconds;
+                if (runs[i].stages[stage].busy_seconds > 0.0)
+                    capacity += runs[i].stages[stage].bytes / (1024.0 * 1024.0) / runs[i].stages[stage].busy_seconds;
+            }
+            // a stage that didn't run (decrypt of an image, decode of plain DSD)
+            if (n == 0 || busy == 0.0)
+                continue;
+
+            mean_stddev(values, n, &mean, &stddev);
+            CHAR2WCHAR(wide_stage, pipeline_stats_stage_name(stage));
+            fwprintf(stdout, L"    %-9ls %10.2f  (+- %6.2f) %11.1f %11.1f %5.0f%%\n", wide_stage, mean, stddev, capacity / n, frames / n, 100.0 * busy / n);
+            free(wide_stage);
+        }
+    }
+
+    free(values);
 }
 #if defined(WIN32) || defined(_WIN32)
 /*  Convert wide argv to UTF8   */
@@ -564,6 +1069,18 @@ Use_default:
                 opts.id3_tag_mode = 4;
             if (strstr(content, "id3tag=5") != NULL) // 5=id3v2.4 minimal;UTF-8 encoding
                 opts.id3_tag_mode = 5;
+            if (strstr(content, "netwindow=") != NULL) // read requests in flight when reading from a server
+                opts.net_window = atoi(strstr(content, "netwindow=") + strlen("netwindow="));
+            if (strstr(content, "cachesize=") != NULL) // MB of sectors kept so they aren't read twice
+                opts.cache_size = atoi(strstr(content, "cachesize=") + strlen("cachesize="));
+            if (strstr(content, "parsethreads=") != NULL) // threads parsing the audio frames
+                opts.parse_threads = atoi(strstr(content, "parsethreads=") + strlen("parsethreads="));
+            if (strstr(content, "jobs=") != NULL) // tracks extracted at the same time
+                opts.jobs = max(1, atoi(strstr(content, "jobs=") + strlen("jobs=")));
+            if ((strstr(content, "seekcache=1") != NULL) || (strstr(content, "seekcache=yes") != NULL))
+                opts.seek_cache = 1;
+            if ((strstr(content, "seekcache=0") != NULL) || (strstr(content, "seekcache=no") != NULL))
+                opts.seek_cache = 0;
         }
         fclose(fp);
         fwprintf(stdout, L"\nFound configuration 'sacd_extract.cfg' file...\n" );
@@ -585,6 +1102,11 @@ void show_options()
     fwprintf(stdout, L"\tPadding-less [nopad=%d] %ls\n", opts.dsf_nopad, opts.dsf_nopad != 0 ? L"yes" : L"no");
     fwprintf(stdout, L"\tPauses included [pauses=%d] %ls\n", !opts.audio_frame_trimming, opts.audio_frame_trimming == 0 ? L"yes" : L"no");
     fwprintf(stdout, L"\tConcatenate [concatenate=%d] %ls\n", opts.concatenate, opts.concatenate > 0 ? L"yes" : L"no");
+    fwprintf(stdout, L"\tNetwork read requests in flight [netwindow=%d]\n", opts.net_window);
+    fwprintf(stdout, L"\tSector cache [cachesize=%d] MB\n", opts.cache_size);
+    fwprintf(stdout, L"\tSeek-point cache [seekcache=%d] %ls\n", opts.seek_cache, opts.seek_cache > 0 ? L"yes" : L"no");
+    fwprintf(stdout, L"\tFrame parsing threads [parsethreads=%d]\n", opts.parse_threads);
+    fwprintf(stdout, L"\tTracks extracted at the same time [jobs=%d]\n", opts.jobs);
     switch (opts.id3_tag_mode)
     {
     case 0:
@@ -646,6 +1168,8 @@ void show_options()
     if(opts.convert_dst != 0)fwprintf(stdout, L"\tAsked for DST decompression -c \n");
     if(opts.export_cue_sheet != 0)fwprintf(stdout, L"\tAsked for cuesheet+xml metadata -C \n");
     if(opts.concurrent != 0)fwprintf(stdout, L"\tAsked for concurrent -w \n");
+    if(opts.output_null != 0)fwprintf(stdout, L"\tAsked null output -n \n");
+    if(opts.bench_runs != 0)fwprintf(stdout, L"\tAsked bench -N %d \n", opts.bench_runs);
 
     if(opts.select_tracks > 0) 
     {
@@ -669,8 +1193,9 @@ void show_options()
 //            area_idx
 //            If there is no multichannel area then it did not add \Stereo..or Multich 
 //            base_output_dir = directory from where to start creating new directory tree
+//            create = 0 only returns the path (nothing is written)
 //
-char *create_path_output(scarletbook_handle_t *handle, int area_idx, char * base_output_dir)
+char *create_path_output(scarletbook_handle_t *handle, int area_idx, char * base_output_dir, int create)
 {
     char *path_output;
     char *album_path;
@@ -775,7 +1300,7 @@ char *create_path_output(scarletbook_handle_t *handle, int area_idx, char * base
         strcat(path_output, get_speaker_config_string(handle->area[area_idx].area_toc));
     }
 
-    if (path_dir_exists(path_output) == 0)
+    if (create && path_dir_exists(path_output) == 0)
     {
         // not exists, then create it
 
@@ -795,7 +1320,7 @@ char *create_path_output(scarletbook_handle_t *handle, int area_idx, char * base
         }
     }
 
-    LOG(lm_main, LOG_NOTICE, ("NOTICE in main:create_path_output()...directory created: %s", path_output));
+    LOG(lm_main, LOG_NOTICE, ("NOTICE in main:create_path_output()...directory %s: %s", create ? "created" : "not created", path_output));
     LOG(lm_main, LOG_NOTICE, ("NOTICE in main:create_path_output()...base_output_dir: %s", base_output_dir));
     return path_output;
 }
@@ -839,619 +1364,1092 @@ char * return_current_directory()
 }
 
 
-#if defined(WIN32) || defined(_WIN32)
-    int wmain(int argc, wchar_t *wargv[])      
-#else
-    int main(int argc, char *argv[])
-#endif
+// extracts an input with what it changes of the options in in, returns 0 on success
+static int extract_input(input_state_t *in)
 {
-    char *album_filename = NULL, *musicfilename = NULL, *file_path = NULL, *output_dir = NULL;;
+    char *album_filename = NULL, *musicfilename = NULL, *file_path = NULL, *output_dir = NULL;
     char *file_path_iso_unique = NULL;
+    char *seek_cache_file = NULL;
+    scarletbook_output_t *tracks_output = NULL;  // with several jobs it takes the tracks of all areas
+    scarletbook_handle_t *handle;
+    sacd_reader_t *sacd_reader;
+    int jobs = 1;
     int i, area_idx;
-    sacd_reader_t *sacd_reader = NULL;
-	int exit_main_flag=0; //0=succes; -1 failed
-
-#ifdef PTW32_STATIC_LIB
-    pthread_win32_process_attach_np();
-    pthread_win32_thread_attach_np();
-#endif
+    int ret = 0;
 
-    init();
-   
-#if defined(WIN32) || defined(_WIN32)
-    char **argvw_utf8 = convert_wargv_to_UTF8(argc,wargv);
-    if (parse_options(argc, argvw_utf8))
-#else
-    if (parse_options(argc, argv))
-#endif
+Open_sacd:
+    sacd_input_set_read_window((uint32_t) opts.net_window);
+    possess(g_static_buffers_lock);
+    sacd_reader = sacd_open(in->input_device);
+    release(g_static_buffers_lock);
+    if (sacd_reader != NULL) 
     {
-        setlocale(LC_ALL, "");
-        if (fwide(stdout, 1) < 0)
-        {
-            fprintf(stderr, "\nERROR: Output not set to wide.\n");
-			exit_main_flag=-1;
-            goto exit_main_1;
-        }
-        fwprintf(stdout, L"\nsacd_extract client " SACD_RIPPER_VERSION_STRING "\n");
-        fwprintf(stdout, L"\nEnhanced by euflo ....starting!\n");
-
-        read_config();
-        init_logging(opts.logging); //init_logging(0); 1= write logs in a file
-
-        show_options();
-
-        // Just print the current (working) directory:
-        char *buffer;
-        if ((buffer = return_current_directory() ) != NULL)   
-        {
-            wchar_t *wide_filename;
-            CHAR2WCHAR(wide_filename, buffer);
-            fwprintf(stdout, L"\nCurrent (working) directory (for the app and 'sacd_extract.cfg' file): [%ls]\n",wide_filename);
-            free(wide_filename);
-            free(buffer);
-        }
-
-
-        LOG(lm_main, LOG_NOTICE, ("sacd_extract Version: %s  ", SACD_RIPPER_VERSION_STRING));
-
-        if (opts.version==1)
+        if (sacd_is_sequential(sacd_reader))
         {
-            //fwprintf(stdout, L"\n" SACD_RIPPER_VERSION_INFO "\n");
-            fwprintf(stdout, L"git repository: " SACD_RIPPER_REPO "\n");
-            
-            goto exit_main;
+            // a stream can't seek back, so only one area can be extracted
+            if (in->two_channel && in->multi_channel)
+            {
+                fwprintf(stdout, L"\nStream input: only the two channel area will be extracted.\n");
+                in->multi_channel = 0;
+            }
+            sacd_set_stream_area(sacd_reader, in->multi_channel);
         }
 
-        // default to 2 channel
-        if (opts.two_channel == 0 && opts.multi_channel == 0)
-        {
-            opts.two_channel = 1;
-        }
+        if (opts.cache_size > 0)
+            sacd_set_cache(sacd_reader, (uint32_t) opts.cache_size * (1024 * 1024 / SACD_LSN_SIZE));
 
-#if defined(WIN32) || defined(_WIN32)
-        if ((opts.output_dir_base == NULL) && (opts.output_dir_conc_base == NULL))
+        jobs = sacd_can_read_in_parallel(sacd_reader) ? in->jobs : 1;
+        if (jobs > 1 && is_on_rotational_disk(in->input_device, NULL))
         {
-            // Get the current working directory:
-            char *buffer;          
-            if ((buffer = return_current_directory()) != NULL)
-            {
-                opts.output_dir_base = strdup(buffer);
-                free(buffer);
-            }                                
+            fwprintf(stdout, L"\nThe input is on a spinning disk, the tracks are extracted one after the other.\n");
+            jobs = 1;
         }
-#endif
 
-        if (opts.output_dir_base != NULL   ) // test if exists 
+        handle = scarletbook_open(sacd_reader);
+        if (handle)
         {
-            if (path_dir_exists(opts.output_dir_base) == 0)
+            handle->concatenate = opts.concatenate;
+            handle->audio_frame_trimming = opts.audio_frame_trimming;  
+            handle->dsf_nopad = opts.dsf_nopad;
+            handle->id3_tag_mode=opts.id3_tag_mode;
+            handle->artist_flag=opts.artist_flag;
+            handle->performer_flag=opts.performer_flag;
+            handle->frame_parse_threads = opts.parse_threads;
+
+            // a stream can't go back to the frames, it is parsed as it comes
+            if (opts.seek_cache && !sacd_is_sequential(sacd_reader))
             {
-                wchar_t *wide_filename;
-                CHAR2WCHAR(wide_filename, opts.output_dir_base);
-                fwprintf(stdout, L"%ls output dir doesn't exist or is not a directory.\n",wide_filename);
-                free(wide_filename);
-
-                LOG(lm_main, LOG_ERROR, ("ERROR in main: output dir [%s] doesn't exist or is not a directory!!\n", opts.output_dir_base));
+                char seek_cache_name[32];
 
-				exit_main_flag=-1;
-                goto exit_main;
+                snprintf(seek_cache_name, sizeof(seek_cache_name), "sacd_%016llx", (unsigned long long) scarletbook_frame_index_hash(handle));
+                seek_cache_file = make_filename(opts.output_dir_base, NULL, seek_cache_name, "sfi");
+                if (scarletbook_frame_index_load(handle, seek_cache_file) == 0)
+                    fwprintf(stdout, L"\nSeek-point cache loaded...\n");
             }
-            if (opts.output_dir_conc_base == NULL && opts.concatenate)
-                opts.output_dir_conc_base = strdup(opts.output_dir_base);
-        }
-		
-		if (opts.output_dir_conc_base != NULL   ) // test if exists 
-        {
-            if (path_dir_exists(opts.output_dir_conc_base) == 0)
-            {
-                wchar_t *wide_filename;
-                CHAR2WCHAR(wide_filename, opts.output_dir_conc_base);
-                fwprintf(stdout, L"%ls doesn't exist or is not a directory.\n",wide_filename);
-                free(wide_filename);
-
-                LOG(lm_main, LOG_ERROR, ("ERROR in main: output dir conc [%s] doesn't exist or is not a directory!!\n", opts.output_dir_conc_base));
 
-                exit_main_flag=-1;
-                goto exit_main;
+            if (in->print) 
+            { 
+                scarletbook_print(handle); 
+                in->print = 0;
             }
-            if (opts.output_dir_base == NULL)
-                opts.output_dir_base = strdup(opts.output_dir_conc_base);
-        }
-
-        if(opts.input_device == NULL)
-        {
-            opts.input_device = strdup("/dev/cdrom");
-        }
 
-        fwprintf(stdout, L"\nStart reading sacd...\n");
-        LOG(lm_main, LOG_NOTICE, ("Start reading sacd..."));
-Open_sacd:
-        sacd_reader = sacd_open(opts.input_device);
-        if (sacd_reader != NULL) 
-        {
-            handle = scarletbook_open(sacd_reader);
-            if (handle)
+            if( output_dir  == NULL)
             {
-                handle->concatenate = opts.concatenate;
-                handle->audio_frame_trimming = opts.audio_frame_trimming;  
-                handle->dsf_nopad = opts.dsf_nopad;
-                handle->id3_tag_mode=opts.id3_tag_mode;
-                handle->artist_flag=opts.artist_flag;
-                handle->performer_flag=opts.performer_flag;
-
-                if (opts.print) 
-                { 
-                    scarletbook_print(handle); 
-                    opts.print = 0;
-                }
+                // generate the main output folder stored in 'output_dir' 
+                char *album_path = get_path_disc_album(handle);
+                size_t album_path_size;
+                size_t output_dir_size;
 
-                if( output_dir  == NULL)
-                {
-                    // generate the main output folder stored in 'output_dir' 
-                    char *album_path = get_path_disc_album(handle);
-                    size_t album_path_size;
-                    size_t output_dir_size;
+                album_path_size = strlen(album_path);
 
-                    album_path_size = strlen(album_path);
+                //LOG(lm_main, LOG_NOTICE, ("NOTICE in main:after get_path_disc_album(); album_path=[%s]",album_path));
 
-                    //LOG(lm_main, LOG_NOTICE, ("NOTICE in main:after get_path_disc_album(); album_path=[%s]",album_path));
-
-                    if (opts.output_dir_base != NULL)
-                    {
-                        size_t size_output_dir_base = strlen(opts.output_dir_base);
-
-                        output_dir_size = size_output_dir_base + 1 + album_path_size + 1; 
-
-                        // do some safety checks
-                        if(size_output_dir_base > MAX_BUFF_FULL_PATH_LEN-1)
-                        {
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: output folder is huge(> %d). Try one shorter.", MAX_BUFF_FULL_PATH_LEN));
-                            fwprintf(stdout, L"\nERROR in main: output folder is huge(> %d). Try one shorter.\n", MAX_BUFF_FULL_PATH_LEN);
-                            goto Err_close;
-                        } 
+                if (opts.output_dir_base != NULL)
+                {
+                    size_t size_output_dir_base = strlen(opts.output_dir_base);
 
-                        if(output_dir_size > MAX_BUFF_FULL_PATH_LEN-1)
-                        {
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: The total size of output folder + the one will be generated is huge(> %d). Try one shorter.", MAX_BUFF_FULL_PATH_LEN));
-                            fwprintf(stdout, L"\nERROR in main: The total size of output folder + the one will be generated is huge(> %d). Try one shorter.\n", MAX_BUFF_FULL_PATH_LEN);
-                            goto Err_close;
-                        } 
+                    output_dir_size = size_output_dir_base + 1 + album_path_size + 1; 
 
-                        
-                        output_dir = calloc(output_dir_size, sizeof(char));
-                        LOG(lm_main, LOG_NOTICE, ("NOTICE in main:after calloc(output_dir_size=[%d], 1)",output_dir_size));
+                    // do some safety checks
+                    if(size_output_dir_base > MAX_BUFF_FULL_PATH_LEN-1)
+                    {
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: output folder is huge(> %d). Try one shorter.", MAX_BUFF_FULL_PATH_LEN));
+                        fwprintf(stdout, L"\nERROR in main: output folder is huge(> %d). Try one shorter.\n", MAX_BUFF_FULL_PATH_LEN);
+                        goto Err_close;
+                    } 
 
-                        if(output_dir !=NULL)
-                        {
-                            strncpy(output_dir, opts.output_dir_base,output_dir_size);
-                        
-                        #if defined(WIN32) || defined(_WIN32)
-                            if (opts.output_dir_base[size_output_dir_base - 1] != '\\')
-                                strcat(output_dir, "\\");
-                        #else
-                            if (opts.output_dir_base[size_output_dir_base - 1] != '/')
-                                strcat(output_dir, "/"); 
-                        #endif
-                                
+                    if(output_dir_size > MAX_BUFF_FULL_PATH_LEN-1)
+                    {
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: The total size of output folder + the one will be generated is huge(> %d). Try one shorter.", MAX_BUFF_FULL_PATH_LEN));
+                        fwprintf(stdout, L"\nERROR in main: The total size of output folder + the one will be generated is huge(> %d). Try one shorter.\n", MAX_BUFF_FULL_PATH_LEN);
+                        goto Err_close;
+                    } 
 
-                            if( album_path_size + size_output_dir_base + 1 < output_dir_size)
-                                strcat(output_dir, album_path);
-                        }
-                        else
-                        {
-Err_calloc1:                            
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: at calloc(); cannot create output_dir"));
-                            fwprintf(stdout, L"\nERROR in main: at calloc(); cannot create output_dir\n");
+                    
+                    output_dir = calloc(output_dir_size, sizeof(char));
+                    LOG(lm_main, LOG_NOTICE, ("NOTICE in main:after calloc(output_dir_size=[%d], 1)",output_dir_size));
 
-Err_close:                  scarletbook_close(handle);
-                            sacd_close(sacd_reader);
-                            exit_main_flag=-1;
+                    if(output_dir !=NULL)
+                    {
+                        strncpy(output_dir, opts.output_dir_base,output_dir_size);
+                    
+                    #if defined(WIN32) || defined(_WIN32)
+                        if (opts.output_dir_base[size_output_dir_base - 1] != '\\')
+                            strcat(output_dir, "\\");
+                    #else
+                        if (opts.output_dir_base[size_output_dir_base - 1] != '/')
+                            strcat(output_dir, "/"); 
+                    #endif
                             
-                            goto exit_main;                            
-                        }     
 
+                        if( album_path_size + size_output_dir_base + 1 < output_dir_size)
+                            strcat(output_dir, album_path);
                     }
                     else
                     {
-                            output_dir_size = album_path_size + 1;
-                            output_dir = calloc(output_dir_size, sizeof(char));
-                            if(output_dir != NULL)
-                                strcat(output_dir, album_path);
-                            else goto Err_calloc1;    
-                    }
+Err_calloc1:                            
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: at calloc(); cannot create output_dir"));
+                        fwprintf(stdout, L"\nERROR in main: at calloc(); cannot create output_dir\n");
 
+Err_close:                  scarletbook_close(handle);
+                        sacd_close(sacd_reader);
+                        ret = -1;
+                        
+                        goto Input_done;                            
+                    }     
 
-                    free(album_path);
-                    LOG(lm_main, LOG_NOTICE, ("NOTICE in main: after get_path_disc_album()...output_dir=[%s]", output_dir));
-                
-                } // if( output_dir  == NULL)
+                }
+                else
+                {
+                        output_dir_size = album_path_size + 1;
+                        output_dir = calloc(output_dir_size, sizeof(char));
+                        if(output_dir != NULL)
+                            strcat(output_dir, album_path);
+                        else goto Err_calloc1;    
+                }
+
+
+                free(album_path);
+                LOG(lm_main, LOG_NOTICE, ("NOTICE in main: after get_path_disc_album()...output_dir=[%s]", output_dir));
+            
+            } // if( output_dir  == NULL)
+
+            if(album_filename == NULL)
+            {
+                album_filename = get_album_dir(handle);
 
                 if(album_filename == NULL)
                 {
-                    album_filename = get_album_dir(handle);
+                    LOG(lm_main, LOG_ERROR, ("ERROR in main: cannot create album_filename"));
+                    fwprintf(stdout, L"\nERROR in main: cannot create album_filename\n"); 
+                    goto Err_close;                       
 
-                    if(album_filename == NULL)
-                    {
-                        LOG(lm_main, LOG_ERROR, ("ERROR in main: cannot create album_filename"));
-                        fwprintf(stdout, L"\nERROR in main: cannot create album_filename\n"); 
-                        goto Err_close;                       
-
-                    }
-                    //LOG(lm_main, LOG_NOTICE, ("NOTICE in main: after get_album_dir()...album_filename=[%s]", album_filename));
                 }
+                //LOG(lm_main, LOG_NOTICE, ("NOTICE in main: after get_album_dir()...album_filename=[%s]", album_filename));
+            }
 
-                if (opts.export_cue_sheet && file_path_iso_unique == NULL)  // export XML metadata at first; if already iso export is done, then do not export xml second time
+            if (in->export_cue_sheet && file_path_iso_unique == NULL)  // export XML metadata at first; if already iso export is done, then do not export xml second time
+            {
+
+                if (path_dir_exists(output_dir) == 0)
                 {
+                    // not exists, then create it
+                    int ret_mkdir = recursive_mkdir(output_dir, opts.output_dir_base, 0777);
 
-                    if (path_dir_exists(output_dir) == 0)
+                    if (ret_mkdir != 0)
                     {
-                        // not exists, then create it
-                        int ret_mkdir = recursive_mkdir(output_dir, opts.output_dir_base, 0777);
-
-                        if (ret_mkdir != 0)
-                        {
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: exporting XML, after recursive_mkdir...output_dir='%s'; ret=%d", output_dir, ret_mkdir));
-                            free(album_filename);
-                            free(output_dir);
-                            
-                            goto Err_close;
-                        }
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: exporting XML, after recursive_mkdir...output_dir='%s'; ret=%d", output_dir, ret_mkdir));
+                        
+                        goto Err_close;
                     }
+                }
 
-                    // create file XML metadata file
-                    char *metadata_file_path_unique = get_unique_filename(NULL, output_dir, album_filename, "xml");
-                    if (metadata_file_path_unique == NULL)
-                        fwprintf(stdout, L"\n ERROR: cannot create get_unique_filename XML for metadata (==NULL) !!\n");
-                    else
-                    {
-                        wchar_t *wide_filename;
-                        CHAR2WCHAR(wide_filename, metadata_file_path_unique);
-                        fwprintf(stdout, L"\n\nExporting metadata in XML file: [%ls] ... \n", wide_filename);
-                        free(wide_filename);
+                // create file XML metadata file
+                char *metadata_file_path_unique = get_unique_filename(NULL, output_dir, album_filename, "xml");
+                if (metadata_file_path_unique == NULL)
+                    fwprintf(stdout, L"\n ERROR: cannot create get_unique_filename XML for metadata (==NULL) !!\n");
+                else
+                {
+                    wchar_t *wide_filename;
+                    CHAR2WCHAR(wide_filename, metadata_file_path_unique);
+                    fwprintf(stdout, L"\n\nExporting metadata in XML file: [%ls] ... \n", wide_filename);
+                    free(wide_filename);
 
+                    possess(g_static_buffers_lock);
 #if defined(WIN32) || defined(_WIN32) || defined(WIN64) || defined(_WIN64)
-                        char filename_long[MAX_BUFF_FULL_PATH_LEN];
-                        memset(filename_long, '\0', sizeof(filename_long));
-                        strcpy(filename_long, "\\\\?\\");
-                        strncat(filename_long, metadata_file_path_unique, MAX_BUFF_FULL_PATH_LEN-8);
+                    char filename_long[MAX_BUFF_FULL_PATH_LEN];
+                    memset(filename_long, '\0', sizeof(filename_long));
+                    strcpy(filename_long, "\\\\?\\");
+                    strncat(filename_long, metadata_file_path_unique, MAX_BUFF_FULL_PATH_LEN-8);
 
-                        write_metadata_xml(handle, filename_long);
+                    write_metadata_xml(handle, filename_long);
 
 #else
-                        write_metadata_xml(handle, metadata_file_path_unique);
+                    write_metadata_xml(handle, metadata_file_path_unique);
 
 #endif
+                    release(g_static_buffers_lock);
 
-                        free(metadata_file_path_unique);
-                        fwprintf(stdout, L"\n\nWe are done exporting metadata in XML file. \n");
-                        LOG(lm_main, LOG_NOTICE, ("NOTICE in main: done exporting metadata in XML file."));
-                    }
-                } // end if XML export       
+                    free(metadata_file_path_unique);
+                    fwprintf(stdout, L"\n\nWe are done exporting metadata in XML file. \n");
+                    LOG(lm_main, LOG_NOTICE, ("NOTICE in main: done exporting metadata in XML file."));
+                }
+            } // end if XML export       
 
-                if (opts.output_iso)
-                {
-                    opts.output_iso = 0;   
+            if (in->output_iso)
+            {
+                in->output_iso = 0;   
 
-                    // create the output folder
-                    LOG(lm_main, LOG_NOTICE, ("NOTICE in main: extracting ISO, before recursive_mkdir(output_dir,..)...output_dir: %s", output_dir));
+                // create the output folder
+                LOG(lm_main, LOG_NOTICE, ("NOTICE in main: extracting ISO, before recursive_mkdir(output_dir,..)...output_dir: %s", output_dir));
 
-                    if (path_dir_exists(output_dir) == 0)
-                    {
-                        // not exists, then create it
+                if (path_dir_exists(output_dir) == 0)
+                {
+                    // not exists, then create it
 
-                        int ret_mkdir = recursive_mkdir(output_dir, opts.output_dir_base, 0777);
+                    int ret_mkdir = recursive_mkdir(output_dir, opts.output_dir_base, 0777);
 
-                        if (ret_mkdir != 0)
-                        {
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: ISO, after recursive_mkdir...output_dir: %s; ret=%d;", output_dir, ret_mkdir));
-                            free(album_filename);
-                            free(output_dir);
-                          
-                            goto Err_close;
-                        }
+                    if (ret_mkdir != 0)
+                    {
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: ISO, after recursive_mkdir...output_dir: %s; ret=%d;", output_dir, ret_mkdir));
+                      
+                        goto Err_close;
                     }
+                }
 
-                    output = scarletbook_output_create(handle, handle_status_update_track_callback, handle_status_update_progress_callback, safe_fwprintf);
+                in->output = scarletbook_output_create(handle, handle_status_update_track_callback, NULL, safe_fwprintf);
 
-                    
+                
 #ifdef SECTOR_LIMIT
 #define FAT32_SECTOR_LIMIT 2090000
-                    uint32_t sector_size = FAT32_SECTOR_LIMIT;
-                    uint32_t sector_offset = 0;
-                    uint32_t total_sectors;
+                uint32_t sector_size = FAT32_SECTOR_LIMIT;
+                uint32_t sector_offset = 0;
+                uint32_t total_sectors;
 
-                    total_sectors = handle->total_sectors_iso;
+                total_sectors = handle->total_sectors_iso;
 
-                    if (total_sectors > FAT32_SECTOR_LIMIT)
+                if (total_sectors > FAT32_SECTOR_LIMIT)
+                {
+                    musicfilename = (char *) malloc(512);
+                    file_path = make_filename(NULL, output_dir, album_filename, "iso");
+                    for (i = 1; total_sectors != 0; i++)
                     {
-                        musicfilename = (char *) malloc(512);
-                        file_path = make_filename(NULL, output_dir, album_filename, "iso");
-                        for (i = 1; total_sectors != 0; i++)
-                        {
-                            sector_size = min(total_sectors, FAT32_SECTOR_LIMIT);
-                            snprintf(musicfilename, 512, "%s.%03d", file_path, i);
-                            scarletbook_output_enqueue_raw_sectors(output, sector_offset, sector_size, musicfilename, "iso");
-                            sector_offset += sector_size;
-                            total_sectors -= sector_size;
-                        }
-                        free(file_path);
-                        free(musicfilename);
-                        
+                        sector_size = min(total_sectors, FAT32_SECTOR_LIMIT);
+                        snprintf(musicfilename, 512, "%s.%03d", file_path, i);
+                        scarletbook_output_enqueue_raw_sectors(in->output, sector_offset, sector_size, musicfilename, "iso");
+                        sector_offset += sector_size;
+                        total_sectors -= sector_size;
                     }
-                    else
+                    free(file_path);
+                    free(musicfilename);
+                    
+                }
+                else
 #endif
-                    {
-                        file_path_iso_unique = get_unique_filename(NULL, output_dir, album_filename, "iso");
+                {
+                    file_path_iso_unique = get_unique_filename(NULL, output_dir, album_filename, "iso");
 
-                        wchar_t *wide_filename;
-                        CHAR2WCHAR(wide_filename, file_path_iso_unique);
-                        fwprintf(stdout, L"\nExporting ISO output in file: [%ls] ... \n", wide_filename);
-                        free(wide_filename);
+                    wchar_t *wide_filename;
+                    CHAR2WCHAR(wide_filename, file_path_iso_unique);
+                    fwprintf(stdout, L"\nExporting ISO output in file: [%ls] ... \n", wide_filename);
+                    free(wide_filename);
 
-                        scarletbook_output_enqueue_raw_sectors(output, 0, handle->total_sectors_iso, file_path_iso_unique, "iso");
-                        
-                    }
+                    scarletbook_output_enqueue_raw_sectors(in->output, 0, handle->total_sectors_iso, file_path_iso_unique, "iso");
                     
-                    print_start_time();
-                    scarletbook_output_start(output);
-                    scarletbook_output_destroy(output);
-                    print_end_time();
+                }
+                
+                print_start_time(in);
+                scarletbook_output_start(in->output);
+                scarletbook_output_wait(in->output);
+                scarletbook_output_destroy(in->output);
+                in->output = NULL;
+                print_end_time(in);
 
-                    fwprintf(stdout, L"\nWe are done exporting ISO.\n");
+                fwprintf(stdout, L"\nWe are done exporting ISO.\n");
 
-                } // end if (opts.output_iso)
+            } // end if (in->output_iso)
 
 
-                if(opts.concurrent && file_path_iso_unique != NULL) // if concurent, use 'file_path_iso_unique' as an input device
-                {
-                    opts.concurrent = 0;
-                    scarletbook_close(handle);
-                    sacd_close(sacd_reader);
-                    free(opts.input_device);
-                    opts.input_device = strdup(file_path_iso_unique);  // use the freshly already created iso file as an input device/net
-                    fwprintf(stdout, L"\nConcurent mode. Start re-opening sacd iso file locally... \n");
-                    LOG(lm_main, LOG_NOTICE, ("NOTICE in main: Concurent mode. Start re-opening sacd iso file locally... "));
-                    goto Open_sacd;
-                }
+            if(in->concurrent && file_path_iso_unique != NULL) // if concurent, use 'file_path_iso_unique' as an input device
+            {
+                in->concurrent = 0;
+                free(seek_cache_file);
+                seek_cache_file = NULL;
+                scarletbook_close(handle);
+                sacd_close(sacd_reader);
+                free(in->input_device);
+                in->input_device = strdup(file_path_iso_unique);  // use the freshly already created iso file as an input device/net
+                fwprintf(stdout, L"\nConcurent mode. Start re-opening sacd iso file locally... \n");
+                LOG(lm_main, LOG_NOTICE, ("NOTICE in main: Concurent mode. Start re-opening sacd iso file locally... "));
+                goto Open_sacd;
+            }
 
 
-                if (opts.output_dsf || opts.output_dsdiff || opts.output_dsdiff_em || opts.export_cue_sheet)
+            if (opts.output_dsf || opts.output_dsdiff || opts.output_null || opts.output_dsdiff_em || in->export_cue_sheet)
+            {
+
+                while (in->two_channel + in->multi_channel > 0)
                 {
+                    if (in->multi_channel && (!has_multi_channel(handle))) // skip if we want multich but disc have no multich area
+                    {
+                        fwprintf(stdout, L"\n Asked for multi-channel format but disc has no multichannel area. So skip processing...\n");
+                        in->multi_channel = 0;
+                        continue;
+                    }
 
-                    while (opts.two_channel + opts.multi_channel > 0)
+                    if (in->two_channel && (!has_two_channel(handle) )) // skip;   if want 2ch but disc have no 2 ch area (YES !!! Exists these type of discs  - e.g Rubinstein - Grieg..only multich area)                                                    
                     {
-                        if (opts.multi_channel && (!has_multi_channel(handle))) // skip if we want multich but disc have no multich area
-                        {
-                            fwprintf(stdout, L"\n Asked for multi-channel format but disc has no multichannel area. So skip processing...\n");
-                            opts.multi_channel = 0;
+                            fwprintf(stdout, L"\n Asked for stereo format but disc has no stereo area. So skip processing...\n");
+                            in->two_channel = 0;
                             continue;
-                        }
+                    }
 
-                        if (opts.two_channel && (!has_two_channel(handle) )) // skip;   if want 2ch but disc have no 2 ch area (YES !!! Exists these type of discs  - e.g Rubinstein - Grieg..only multich area)                                                    
-                        {
-                                fwprintf(stdout, L"\n Asked for stereo format but disc has no stereo area. So skip processing...\n");
-                                opts.two_channel = 0;
-                                continue;
-                        }
+                    // select the channel area
+                    area_idx = has_multi_channel(handle) && in->multi_channel ? handle->mulch_area_idx : handle->twoch_area_idx;
+                    
 
-                        // select the channel area
-                        area_idx = has_multi_channel(handle) && opts.multi_channel ? handle->mulch_area_idx : handle->twoch_area_idx;
+                    // create the output folder with Stereo/MulCh
+                    char *output_dir_dsd = create_path_output(handle, area_idx, opts.output_dir_base,
+                                                              opts.output_dsdiff_em || in->export_cue_sheet || !opts.output_null);
+                    if (output_dir_dsd == NULL)
+                    {
+                        LOG(lm_main, LOG_ERROR, ("ERROR in main: after create_path_output() for dsf/dff/dff_em"));
                         
+                        goto Err_close;
+                    }
 
-                        // create the output folder with Stereo/MulCh
-                        char *output_dir_dsd = create_path_output(handle, area_idx, opts.output_dir_base);
-                        if (output_dir_dsd == NULL)
-                        {
-                            free(album_filename);
-                            free(output_dir);
-                            LOG(lm_main, LOG_ERROR, ("ERROR in main: after create_path_output() for dsf/dff/dff_em"));
-                            
-                            goto Err_close;
-                        }
+                    if (opts.output_dsdiff_em)
+                    {
 
-                        if (opts.output_dsdiff_em)
-                        {
+                        char *file_path_dsdiff_unique = get_unique_filename(NULL, output_dir_dsd, album_filename, "dff");   
 
-                            char *file_path_dsdiff_unique = get_unique_filename(NULL, output_dir_dsd, album_filename, "dff");   
+                        wchar_t *wide_filename;
+                        CHAR2WCHAR(wide_filename, file_path_dsdiff_unique);
+                        fwprintf(stdout, L"\nExporting DFF edit master output in file: [%ls] ... \n", wide_filename);
+                        free(wide_filename);
 
-                            wchar_t *wide_filename;
-                            CHAR2WCHAR(wide_filename, file_path_dsdiff_unique);
-                            fwprintf(stdout, L"\nExporting DFF edit master output in file: [%ls] ... \n", wide_filename);
-                            free(wide_filename);
+                        in->output = scarletbook_output_create(handle, handle_status_update_track_callback, NULL, safe_fwprintf);
 
-                            output = scarletbook_output_create(handle, handle_status_update_track_callback, handle_status_update_progress_callback, safe_fwprintf);
+                        scarletbook_output_enqueue_track(in->output, area_idx, 0, file_path_dsdiff_unique, "dsdiff_edit_master",
+                                                        (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST));
 
-                            scarletbook_output_enqueue_track(output, area_idx, 0, file_path_dsdiff_unique, "dsdiff_edit_master",
-                                                            (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST));
+                        free(file_path_dsdiff_unique);
 
-                            free(file_path_dsdiff_unique);
+                        print_start_time(in);
+                        
+                        scarletbook_output_start(in->output);
+                        scarletbook_output_wait(in->output);
+                        scarletbook_output_destroy(in->output);
+                        in->output = NULL;
+                        
+                        print_end_time(in);						
 
-                            print_start_time();
-                            
-                            scarletbook_output_start(output);
-                            scarletbook_output_destroy(output);
-                            
-                            print_end_time();						
+                        fwprintf(stdout, L"\n\nWe are done exporting DFF edit master.\n");
 
-                            fwprintf(stdout, L"\n\nWe are done exporting DFF edit master.\n");
+                        // Must generate cue sheet because it is mandatory just for dsdiff_em files
+                        in->export_cue_sheet=1;
 
-                            // Must generate cue sheet because it is mandatory just for dsdiff_em files
-                            opts.export_cue_sheet=1;
+                    } // end if  opts.output_dsdiff_em
 
-                        } // end if  opts.output_dsdiff_em
+                    if (in->export_cue_sheet)
+                    {
 
-                        if (opts.export_cue_sheet)
-                        {
+                        char *cue_file_path_unique = get_unique_filename(NULL, output_dir_dsd, album_filename, "cue");
+
+                        wchar_t *wide_filename;
+                        CHAR2WCHAR(wide_filename, cue_file_path_unique);
+                        fwprintf(stdout, L"\n\nExporting CUE sheet: [%ls] ... \n", wide_filename);
+                        free(wide_filename);
 
-                            char *cue_file_path_unique = get_unique_filename(NULL, output_dir_dsd, album_filename, "cue");
+                        file_path = make_filename(NULL, NULL, album_filename, "dff");
 
-                            wchar_t *wide_filename;
-                            CHAR2WCHAR(wide_filename, cue_file_path_unique);
-                            fwprintf(stdout, L"\n\nExporting CUE sheet: [%ls] ... \n", wide_filename);
-                            free(wide_filename);
+						possess(g_static_buffers_lock);
+						int rez_cuesheet= write_cue_sheet(handle, file_path, area_idx, cue_file_path_unique);
+						release(g_static_buffers_lock);
+						if(rez_cuesheet != -1)
+							fwprintf(stdout, L"\n\nWe are done exporting CUE sheet. \n");
+						else
+							fwprintf(stdout, L"\n\n ERROR: Cannot create CUE sheet file. \n");    
+                        
+                        free(cue_file_path_unique);
+                        free(file_path);                                
 
-                            file_path = make_filename(NULL, NULL, album_filename, "dff");
+                    }
 
-							int rez_cuesheet= write_cue_sheet(handle, file_path, area_idx, cue_file_path_unique);
-							if(rez_cuesheet != -1)
-								fwprintf(stdout, L"\n\nWe are done exporting CUE sheet. \n");
-							else
-								fwprintf(stdout, L"\n\n ERROR: Cannot create CUE sheet file. \n");    
-                            
-                            free(cue_file_path_unique);
-                            free(file_path);                                
+                    if (opts.output_dsf || opts.output_dsdiff || opts.output_null)
+                    {
 
+                        wchar_t *wide_folder;
+                        CHAR2WCHAR(wide_folder, output_dir_dsd);
+                        if (opts.output_null)
+                            fwprintf(stdout, L"\nExtracting without writing (null output) ... \n");
+                        else if (opts.output_dsf)
+                            fwprintf(stdout, L"\nExporting DSF output in folder: [%ls] ... \n", wide_folder);
+                        else
+                            fwprintf(stdout, L"\nExporting DSDIFF output in folder: [%ls]  ... \n", wide_folder);
+
+                        free(wide_folder);
+
+                        if (!tracks_output)
+                        {
+                            tracks_output = scarletbook_output_create(handle, handle_status_update_track_callback, NULL, safe_fwprintf);
+                            scarletbook_output_set_jobs(tracks_output, jobs);
                         }
+                        in->output = tracks_output;
 
-                        if (opts.output_dsf || opts.output_dsdiff)
+                        if (opts.range)
                         {
+                            char range_string[32];
+                            int first_track = 0;
 
-                            wchar_t *wide_folder;
-                            CHAR2WCHAR(wide_folder, output_dir_dsd);
-                            if (opts.output_dsf)
-                                fwprintf(stdout, L"\nExporting DSF output in folder: [%ls] ... \n", wide_folder);
-                            else
-                                fwprintf(stdout, L"\nExporting DSDIFF output in folder: [%ls]  ... \n", wide_folder);
+                            // the file is named after the track the range starts in
+                            while (first_track < handle->area[area_idx].area_toc->track_count - 1 &&
+                                   TIME_FRAMECOUNT(&handle->area[area_idx].area_tracklist_time->start[first_track + 1]) <= opts.range_start)
+                                first_track++;
+
+                            snprintf(range_string, sizeof(range_string), "[%02u.%02u.%02u-%02u.%02u.%02u]",
+                                     opts.range_start / (60 * SACD_FRAME_RATE), opts.range_start / SACD_FRAME_RATE % 60, opts.range_start % SACD_FRAME_RATE,
+                                     opts.range_end / (60 * SACD_FRAME_RATE), opts.range_end / SACD_FRAME_RATE % 60, opts.range_end % SACD_FRAME_RATE);
+
+                            musicfilename = get_music_filename(handle, area_idx, first_track, range_string);
+
+                            // a clip is zero padded, there is no next track to carry the samples over to
+                            handle->dsf_nopad = 0;
 
-                            free(wide_folder);
+                            fwprintf(stdout, L"\n Range: %02u:%02u:%02u to %02u:%02u:%02u\n",
+                                     opts.range_start / (60 * SACD_FRAME_RATE), opts.range_start / SACD_FRAME_RATE % 60, opts.range_start % SACD_FRAME_RATE,
+                                     opts.range_end / (60 * SACD_FRAME_RATE), opts.range_end / SACD_FRAME_RATE % 60, opts.range_end % SACD_FRAME_RATE);
+                            if (opts.output_null)
+                            {
+                                file_path = make_filename(NULL, output_dir_dsd, musicfilename, "null");
+                                scarletbook_output_enqueue_range(in->output, area_idx, opts.range_start, opts.range_end, file_path, "null",
+                                                                 1 /* always decode to DSD */);
+                            }
+                            else if (opts.output_dsf)
+                            {
+                                file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dsf");
+                                scarletbook_output_enqueue_range(in->output, area_idx, opts.range_start, opts.range_end, file_path, "dsf",
+                                                                 1 /* always decode to DSD */);
+                            }
+                            else
+                            {
+                                file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dff");
+                                scarletbook_output_enqueue_range(in->output, area_idx, opts.range_start, opts.range_end, file_path, "dsdiff",
+                                                                 (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST));
+                            }
+                            free(file_path);
+                            free(musicfilename);
+                        }
+                        else if(opts.concatenate == 0)
+                        {
+                            int no_of_enqued_tracks=0;
+                            int no_total_tracks = handle->area[area_idx].area_toc->track_count;
+                            // fill the queue with items to rip
+                            for (i = 0; i < no_total_tracks; i++)
+                            {
+                                if (opts.select_tracks && opts.selected_tracks[i] == 0x0)
+                                    continue;
 
-                            output = scarletbook_output_create(handle, handle_status_update_track_callback, handle_status_update_progress_callback, safe_fwprintf);
+                                musicfilename = get_music_filename(handle, area_idx, i, "");
 
-                            if(opts.concatenate == 0)
+                                if (opts.output_null)
+                                {
+                                    file_path = make_filename(NULL, output_dir_dsd, musicfilename, "null");
+                                    scarletbook_output_enqueue_track(in->output, area_idx, i, file_path, "null",
+                                                                     1 /* always decode to DSD */);
+                                    no_of_enqued_tracks++;
+                                }
+                                else if (opts.output_dsf)
+                                {
+                                    file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dsf");
+                                    scarletbook_output_enqueue_track(in->output, area_idx, i, file_path, "dsf",
+                                                                     1 /* always decode to DSD */);
+                                    no_of_enqued_tracks++;                                       
+                                }
+                                else if (opts.output_dsdiff)
+                                {
+                                    file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dff");
+                                    scarletbook_output_enqueue_track(in->output, area_idx, i, file_path, "dsdiff",
+                                                                     (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST));
+                                    no_of_enqued_tracks++;
+                                }
+                                free(file_path);
+                                free(musicfilename);
+                            }
+                            if ((no_of_enqued_tracks < no_total_tracks) && !opts.select_tracks)
                             {
-                                int no_of_enqued_tracks=0;
-                                int no_total_tracks = handle->area[area_idx].area_toc->track_count;
-                                // fill the queue with items to rip
-                                for (i = 0; i < no_total_tracks; i++)
+                                fwprintf(stdout, L"\n Error: Number of processed tracks %d will be smaller than total tracks %d !!\n", no_of_enqued_tracks, no_total_tracks);
+                            }
+                        }
+                        else  // made concatenation
+                        {
+                            // fill the queue with item to rip
+                            if (opts.select_tracks)
+                            {
+                                int first_track = handle->area[area_idx].area_toc->track_count-1;
+                                int last_track  = 0;
+                                // find first track and last track in list
+                                for (i = 0; i < handle->area[area_idx].area_toc->track_count; i++)
                                 {
-                                    if (opts.select_tracks && opts.selected_tracks[i] == 0x0)
-                                        continue;
+                                    if (opts.selected_tracks[i] == 0x01)
+                                    {
+                                        if (first_track > i)
+                                            first_track = i;
+                                        if (last_track <  i)
+                                            last_track = i;
+                                    }                                         
+                                }
 
-                                    musicfilename = get_music_filename(handle, area_idx, i, "");
 
-                                    if (opts.output_dsf)
+                                if ((first_track < handle->area[area_idx].area_toc->track_count)&&
+                                    (last_track < handle->area[area_idx].area_toc->track_count) )
+                                {
+                                    char conc_string[32];
+                                    snprintf(conc_string, sizeof(conc_string), "[%02d-%02d]",first_track + 1, last_track + 1);
+
+                                    musicfilename = get_music_filename(handle, area_idx, first_track, conc_string);
+
+                                    fwprintf(stdout, L"\n Concatenate tracks: %d to %d\n", first_track+1,last_track+1);
+                                    if (opts.output_null)
+                                    {
+                                        file_path = make_filename(NULL, output_dir_dsd, musicfilename, "null");
+                                        scarletbook_output_enqueue_concatenate_tracks(in->output, area_idx, first_track, file_path, "null",
+                                                                                      1 /* always decode to DSD */, last_track);
+                                    }
+                                    else if (opts.output_dsf)
                                     {
                                         file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dsf");
-                                        scarletbook_output_enqueue_track(output, area_idx, i, file_path, "dsf",
-                                                                         1 /* always decode to DSD */);
-                                        no_of_enqued_tracks++;                                       
+                                        scarletbook_output_enqueue_concatenate_tracks(in->output, area_idx, first_track, file_path, "dsf",
+                                                                                      1 /* always decode to DSD */, last_track);
                                     }
                                     else if (opts.output_dsdiff)
                                     {
                                         file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dff");
-                                        scarletbook_output_enqueue_track(output, area_idx, i, file_path, "dsdiff",
-                                                                         (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST));
-                                        no_of_enqued_tracks++;
+                                        scarletbook_output_enqueue_concatenate_tracks(in->output, area_idx, first_track, file_path, "dsdiff",
+                                                                                      (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST), last_track);
                                     }
                                     free(file_path);
                                     free(musicfilename);
-                                }
-                                if ((no_of_enqued_tracks < no_total_tracks) && !opts.select_tracks)
-                                {
-                                    fwprintf(stdout, L"\n Error: Number of processed tracks %d will be smaller than total tracks %d !!\n", no_of_enqued_tracks, no_total_tracks);
+                                
                                 }
                             }
-                            else  // made concatenation
+                            else  // no tracks specified
                             {
-                                // fill the queue with item to rip
-                                if (opts.select_tracks)
-                                {
-                                    int first_track = handle->area[area_idx].area_toc->track_count-1;
-                                    int last_track  = 0;
-                                    // find first track and last track in list
-                                    for (i = 0; i < handle->area[area_idx].area_toc->track_count; i++)
-                                    {
-                                        if (opts.selected_tracks[i] == 0x01)
-                                        {
-                                            if (first_track > i)
-                                                first_track = i;
-                                            if (last_track <  i)
-                                                last_track = i;
-                                        }                                         
-                                    }
-
-
-                                    if ((first_track < handle->area[area_idx].area_toc->track_count)&&
-                                        (last_track < handle->area[area_idx].area_toc->track_count) )
-                                    {
-                                        char conc_string[32];
-                                        snprintf(conc_string, sizeof(conc_string), "[%02d-%02d]",first_track + 1, last_track + 1);
-
-                                        musicfilename = get_music_filename(handle, area_idx, first_track, conc_string);
-
-                                        fwprintf(stdout, L"\n Concatenate tracks: %d to %d\n", first_track+1,last_track+1);
-                                        if (opts.output_dsf)
-                                        {
-                                            file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dsf");
-                                            scarletbook_output_enqueue_concatenate_tracks(output, area_idx, first_track, file_path, "dsf",
-                                                                                          1 /* always decode to DSD */, last_track);
-                                        }
-                                        else if (opts.output_dsdiff)
-                                        {
-                                            file_path = make_filename(NULL, output_dir_dsd, musicfilename, "dff");
-                                            scarletbook_output_enqueue_concatenate_tracks(output, area_idx, first_track, file_path, "dsdiff",
-                                                                                          (opts.convert_dst ? 1 : handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST), last_track);
-                                        }
-                                        free(file_path);
-                                        free(musicfilename);
-                                    
-                                    }
-                                }
-                                else  // no tracks specified
-                                {
-                                    fwprintf(stdout, L"\n\n Warning! Concatenation activated but no tracks selected!\n");
-                                }                                                                                                  
-                            }                          
+                                fwprintf(stdout, L"\n\n Warning! Concatenation activated but no tracks selected!\n");
+                            }                                                                                                  
+                        }                          
 
-                            print_start_time();
+                        // several jobs extract the multi channel tracks together with the two channel ones
+                        if (jobs > 1 && in->multi_channel == 1 && in->two_channel == 1 && has_two_channel(handle))
+                        {
+                            fwprintf(stdout, L"\n Queued, extracted together with the stereo tracks.\n");
+                        }
+                        else
+                        {
+                            print_start_time(in);
 
                             LOG(lm_main, LOG_NOTICE, ("Start processing dsf/dff files"));
-                            scarletbook_output_start(output);
+                            scarletbook_output_start(in->output);
+                            scarletbook_output_wait(in->output);
                             LOG(lm_main, LOG_NOTICE, ("Start destroy dsf/dff"));
-                            scarletbook_output_destroy(output);
+                            scarletbook_output_destroy(in->output);
+                            in->output = NULL;
                             LOG(lm_main, LOG_NOTICE, ("Finish destroy dsf/dff"));
-                            
-                            print_end_time();
+                            tracks_output = NULL;
+
+                            print_end_time(in);
 
-                            if (opts.output_dsf)
+                            if (opts.output_null)
+                                fwprintf(stdout, L"\n\nWe are done extracting (null output)...\n");
+                            else if (opts.output_dsf)
                                 fwprintf(stdout, L"\n\nWe are done exporting DSF...\n");                       
                             else
                                 fwprintf(stdout, L"\n\nWe are done exporting DSDIFF...\n");
+                        }
 
-                        } // end if (opts.output_dsf || opts.output_dsdiff)
+                    } // end if (opts.output_dsf || opts.output_dsdiff)
 
-                        
-                        if (opts.multi_channel == 1)
-                            opts.multi_channel = 0;
-                        else if(opts.two_channel == 1)
-                            opts.two_channel = 0;
+                    
+                    if (in->multi_channel == 1)
+                        in->multi_channel = 0;
+                    else if(in->two_channel == 1)
+                        in->two_channel = 0;
 
-                        free(output_dir_dsd);
+                    free(output_dir_dsd);
 
-                    } // end while opts.two_channel + opts.multi_channel
+                } // end while in->two_channel + in->multi_channel
 
-                }  // end if (opts.output_dsf || opts.output_dsdiff || opts.output_dsdiff_em || opts.export_cue_sheet)
+            }  // end if (opts.output_dsf || opts.output_dsdiff || opts.output_dsdiff_em || in->export_cue_sheet)
 
-                free(output_dir);
-                free(album_filename);
-                free(file_path_iso_unique);
+            free(output_dir);
+            free(album_filename);
+            free(file_path_iso_unique);
+            output_dir = album_filename = file_path_iso_unique = NULL;
 
-                scarletbook_close(handle);
+            // the lookups of the track starts and ranges made by this run
+            if (seek_cache_file && scarletbook_frame_index_save(handle, seek_cache_file) != 0)
+                fwprintf(stdout, L"\n Warning: cannot save the seek-point cache.\n");
+            free(seek_cache_file);
+            seek_cache_file = NULL;
+
+            scarletbook_close(handle);
 
-            }  // end if handle
-			else
+        }  // end if handle
+		else
+        {
+            fwprintf(stdout, L"\nErrors reading sacd data!!\n");
+            LOG(lm_main, LOG_ERROR, ("Error in main(), reading sacd data!!"));
+			ret = -1;
+        }
+
+        {
+            sector_cache_stats_t cache_stats;
+
+            if (sacd_get_cache_stats(sacd_reader, &cache_stats) == 0)
+                LOG(lm_main, LOG_NOTICE, ("NOTICE in main: sector cache hits %llu, misses %llu, sectors read %llu, read ahead %llu",
+                    (unsigned long long) cache_stats.hits, (unsigned long long) cache_stats.misses,
+                    (unsigned long long) cache_stats.sectors_read, (unsigned long long) cache_stats.read_ahead));
+        }
+        
+		sacd_close(sacd_reader);
+    }  // end if (sacd_reader != NULL
+	else
+    {
+        fwprintf(stdout, L"\nErrors opening sacd !!\n");
+        LOG(lm_main, LOG_ERROR, ("Error in main(), opening sacd !!"));
+		ret = -1;
+    }
+
+Input_done:
+    free(output_dir);
+    free(album_filename);
+    free(file_path_iso_unique);
+    free(seek_cache_file);
+
+    in->jobs = jobs;
+    return ret;
+}
+
+
+// the file of the pipeline stats (-J) and the runs of a bench (-N), the inputs of a batch are
+// extracted one at a time with either
+static FILE *stats_fd = NULL;
+static int stats_written = 0;
+static bench_run_t *bench_runs = NULL;
+
+// extracts an input with up to jobs tracks at the same time, a bench extracts it cold and
+// warm (see print_bench_summary()). slot is its place in running_inputs, returns 0 on success
+static int run_input(const char *input, int jobs, int slot)
+{
+    input_state_t in;
+    int bench_run = 0, bench_cold_runs = 0;
+    int ret;
+
+    do
+    {
+        // each run starts from the options
+        memset(&in, 0, sizeof(in));
+        in.input_device = strdup(input);
+        in.two_channel = opts.two_channel;
+        in.multi_channel = opts.multi_channel;
+        in.concurrent = opts.concurrent;
+        in.print = opts.print && bench_run == 0;
+        in.output_iso = opts.output_iso;
+        in.export_cue_sheet = opts.export_cue_sheet;
+        in.jobs = jobs;
+
+        if (bench_runs)
+        {
+            if (bench_run == 0)
             {
-                fwprintf(stdout, L"\nErrors reading sacd data!!\n");
-                LOG(lm_main, LOG_ERROR, ("Error in main(), reading sacd data!!"));
-				exit_main_flag=-1;
+                // cold runs only where the cached pages of the input can be dropped
+                bench_cold_runs = drop_input_cache(input) == 0 ? opts.bench_runs : 0;
+                if (bench_cold_runs == 0)
+                    fwprintf(stdout, L"\nThe cached pages of the input can't be dropped, all bench runs are warm.\n");
             }
-            
-			sacd_close(sacd_reader);
-        }  // end if (sacd_reader != NULL
-		else
+            else if (bench_run < bench_cold_runs)
+            {
+                drop_input_cache(input);
+            }
+            bench_runs[bench_run].cold = bench_run < bench_cold_runs;
+            fwprintf(stdout, L"\n\nBench run %d of %d (%ls)\n", bench_run + 1, bench_cold_runs + opts.bench_runs,
+                     bench_runs[bench_run].cold ? L"cold" : L"warm");
+        }
+
+        if (stats_fd || bench_runs)
+            pipeline_stats_reset();
+
+        fwprintf(stdout, L"\nStart reading sacd...\n");
+        LOG(lm_main, LOG_NOTICE, ("Start reading sacd..."));
+
+        running_inputs[slot] = &in;
+        ret = extract_input(&in);
+        running_inputs[slot] = NULL;
+
+        if (stats_fd)
+        {
+            if (stats_written++ > 0)
+                fprintf(stats_fd, ",\n");
+            pipeline_stats_write_json(stats_fd, in.input_device, in.jobs);
+        }
+        free(in.input_device);
+
+        if (bench_runs)
+            bench_runs[bench_run].wall_seconds = pipeline_stats_totals(bench_runs[bench_run].stages);
+    }
+    // a failed run ends the bench of an input
+    while (bench_runs && ret == 0 && ++bench_run < bench_cold_runs + opts.bench_runs && !interrupted);
+
+    if (bench_runs)
+        print_bench_summary(input, bench_runs, bench_run);
+
+    return ret;
+}
+
+// the inputs of a batch, taken by the runners, see batch_runner()
+typedef struct
+{
+    batch_input_t  *inputs;
+    int             count;
+    int             jobs;       // of each input
+    lock           *changed;    // possessed to take an input, twisted when one is done
+}
+batch_t;
+
+typedef struct
+{
+    batch_t        *batch;
+    int             slot;
+}
+batch_runner_t;
+
+// the first waiting input that isn't on a spinning disk read by an input running, -1 if
+// none can start yet, -2 if none is waiting. Call with batch->changed possessed
+static int next_batch_input(batch_t *batch)
+{
+    int i, j, waiting = 0;
+
+    for (i = 0; i < batch->count; i++)
+    {
+        batch_input_t *input = &batch->inputs[i];
+
+        if (input->state != BATCH_INPUT_WAITING)
+            continue;
+        waiting = 1;
+
+        for (j = 0; input->rotational && j < batch->count; j++)
+        {
+            if (batch->inputs[j].state == BATCH_INPUT_RUNNING && batch->inputs[j].rotational &&
+                batch->inputs[j].disk == input->disk)
+                break;
+        }
+        if (!input->rotational || j == batch->count)
+            return i;
+    }
+    return waiting ? -1 : -2;
+}
+
+// extracts the inputs of a batch until none is left to take, or Ctrl+C
+static void batch_runner(void *arg)
+{
+    batch_runner_t *runner = (batch_runner_t *) arg;
+    batch_t *batch = runner->batch;
+    batch_input_t *input;
+    time_t started;
+    int idx, ret;
+
+    possess(batch->changed);
+    for (;;)
+    {
+        idx = interrupted ? -2 : next_batch_input(batch);
+        if (idx == -2)
+            break;
+        if (idx == -1)
+        {
+            // the disk of the inputs left is being read, wait for an input to end
+            wait_for(batch->changed, NOT_TO_BE, peek_lock(batch->changed));
+            continue;
+        }
+        input = &batch->inputs[idx];
+        input->state = BATCH_INPUT_RUNNING;
+        release(batch->changed);
+
+        wchar_t *wide_filename;
+        CHAR2WCHAR(wide_filename, input->input);
+        fwprintf(stdout, L"\n\nBatch input %d of %d: [%ls]\n", idx + 1, batch->count, wide_filename);
+        free(wide_filename);
+        LOG(lm_main, LOG_NOTICE, ("Batch input %d of %d: [%s]", idx + 1, batch->count, input->input));
+
+        started = time(0);
+        ret = run_input(input->input, batch->jobs, runner->slot);
+
+        // a failed input doesn't stop the batch, only an interrupt does (and fails the inputs it stopped)
+        possess(batch->changed);
+        input->failed = ret != 0 || interrupted;
+        input->seconds = time(0) - started;
+        input->state = BATCH_INPUT_DONE;
+        twist(batch->changed, BY, 1);
+        possess(batch->changed);
+    }
+    release(batch->changed);
+}
+
+// extracts the inputs of a batch, as many at the same time as the jobs allow: each one gets
+// jobs / inputs (at least one) and the tracks extracted by all of them stay within the jobs.
+// The inputs on the same spinning disk are extracted one after the other, and all of them
+// with pipeline stats or a bench. Returns 0 if every input was extracted
+static int run_batch(batch_input_t *inputs, int count)
+{
+    batch_runner_t runners[MAX_RUNNING_INPUTS];
+    thread *threads[MAX_RUNNING_INPUTS];
+    batch_t batch;
+    int runner_count, i, ret = 0;
+
+    batch.inputs = inputs;
+    batch.count = count;
+    batch.jobs = max(1, opts.jobs / count);
+    runner_count = min(min(count, opts.jobs / batch.jobs), MAX_RUNNING_INPUTS);
+    if (stats_fd || bench_runs)
+    {
+        batch.jobs = opts.jobs;
+        runner_count = 1;
+    }
+    batch.changed = new_lock(0);
+
+    for (i = 0; i < count; i++)
+        inputs[i].rotational = is_on_rotational_disk(inputs[i].input, &inputs[i].disk);
+    for (i = 0; i < runner_count; i++)
+    {
+        runners[i].batch = &batch;
+        runners[i].slot = i;
+    }
+
+    if (runner_count > 1)
+    {
+        fwprintf(stdout, L"\nBatch: %d inputs at the same time, %d job(s) each.\n", runner_count, batch.jobs);
+
+        // one progress line and memory peak for all of them
+        batch_progress = 1;
+        mem_stats_reset_peaks();
+        progress_start(opts.progress_json ? 1000 : 250, show_progress, NULL);
+
+        for (i = 0; i < runner_count; i++)
+            threads[i] = launch(batch_runner, &runners[i]);
+        for (i = 0; i < runner_count; i++)
+            join(threads[i]);
+
+        progress_stop();
+        fwprintf(stdout, L"\n");
+        print_memory_peak();
+        batch_progress = 0;
+    }
+    else
+    {
+        batch_runner(&runners[0]);
+    }
+    free_lock(batch.changed);
+
+    print_batch_summary(inputs, count);
+
+    for (i = 0; i < count; i++)
+    {
+        if (inputs[i].state != BATCH_INPUT_DONE || inputs[i].failed)
+            ret = -1;
+    }
+    return ret;
+}
+
+#if defined(WIN32) || defined(_WIN32)
+    int wmain(int argc, wchar_t *wargv[])      
+#else
+    int main(int argc, char *argv[])
+#endif
+{
+    batch_input_t *batch_inputs = NULL;
+    int batch_count = 0;
+    int i;
+	int exit_main_flag=0; //0=succes; -1 failed
+
+#ifdef PTW32_STATIC_LIB
+    pthread_win32_process_attach_np();
+    pthread_win32_thread_attach_np();
+#endif
+
+    init();
+   
+#if defined(WIN32) || defined(_WIN32)
+    char **argvw_utf8 = convert_wargv_to_UTF8(argc,wargv);
+    if (parse_options(argc, argvw_utf8))
+#else
+    if (parse_options(argc, argv))
+#endif
+    {
+        setlocale(LC_ALL, "");
+        if (fwide(stdout, 1) < 0)
         {
-            fwprintf(stdout, L"\nErrors opening sacd !!\n");
-            LOG(lm_main, LOG_ERROR, ("Error in main(), opening sacd !!"));
+            fprintf(stderr, "\nERROR: Output not set to wide.\n");
 			exit_main_flag=-1;
+            goto exit_main_1;
+        }
+        fwprintf(stdout, L"\nsacd_extract client " SACD_RIPPER_VERSION_STRING "\n");
+        fwprintf(stdout, L"\nEnhanced by euflo ....starting!\n");
+
+        read_config();
+        init_logging(opts.logging); //init_logging(0); 1= write logs in a file
+
+        show_options();
+
+        // Just print the current (working) directory:
+        char *buffer;
+        if ((buffer = return_current_directory() ) != NULL)   
+        {
+            wchar_t *wide_filename;
+            CHAR2WCHAR(wide_filename, buffer);
+            fwprintf(stdout, L"\nCurrent (working) directory (for the app and 'sacd_extract.cfg' file): [%ls]\n",wide_filename);
+            free(wide_filename);
+            free(buffer);
+        }
+
+
+        LOG(lm_main, LOG_NOTICE, ("sacd_extract Version: %s  ", SACD_RIPPER_VERSION_STRING));
+
+        if (opts.version==1)
+        {
+            //fwprintf(stdout, L"\n" SACD_RIPPER_VERSION_INFO "\n");
+            fwprintf(stdout, L"git repository: " SACD_RIPPER_REPO "\n");
+            
+            goto exit_main;
+        }
+
+        // default to 2 channel
+        if (opts.two_channel == 0 && opts.multi_channel == 0)
+        {
+            opts.two_channel = 1;
+        }
+
+#if defined(WIN32) || defined(_WIN32)
+        if ((opts.output_dir_base == NULL) && (opts.output_dir_conc_base == NULL))
+        {
+            // Get the current working directory:
+            char *buffer;          
+            if ((buffer = return_current_directory()) != NULL)
+            {
+                opts.output_dir_base = strdup(buffer);
+                free(buffer);
+            }                                
+        }
+#endif
+
+        if (opts.output_dir_base != NULL   ) // test if exists 
+        {
+            if (path_dir_exists(opts.output_dir_base) == 0)
+            {
+                wchar_t *wide_filename;
+                CHAR2WCHAR(wide_filename, opts.output_dir_base);
+                fwprintf(stdout, L"%ls output dir doesn't exist or is not a directory.\n",wide_filename);
+                free(wide_filename);
+
+                LOG(lm_main, LOG_ERROR, ("ERROR in main: output dir [%s] doesn't exist or is not a directory!!\n", opts.output_dir_base));
+
+				exit_main_flag=-1;
+                goto exit_main;
+            }
+            if (opts.output_dir_conc_base == NULL && opts.concatenate)
+                opts.output_dir_conc_base = strdup(opts.output_dir_base);
+        }
+		
+		if (opts.output_dir_conc_base != NULL   ) // test if exists 
+        {
+            if (path_dir_exists(opts.output_dir_conc_base) == 0)
+            {
+                wchar_t *wide_filename;
+                CHAR2WCHAR(wide_filename, opts.output_dir_conc_base);
+                fwprintf(stdout, L"%ls doesn't exist or is not a directory.\n",wide_filename);
+                free(wide_filename);
+
+                LOG(lm_main, LOG_ERROR, ("ERROR in main: output dir conc [%s] doesn't exist or is not a directory!!\n", opts.output_dir_conc_base));
+
+                exit_main_flag=-1;
+                goto exit_main;
+            }
+            if (opts.output_dir_base == NULL)
+                opts.output_dir_base = strdup(opts.output_dir_conc_base);
+        }
+
+        if(opts.input_device == NULL)
+        {
+            opts.input_device = strdup("/dev/cdrom");
+        }
+
+        if (opts.batch_path != NULL)
+        {
+            batch_inputs = read_batch_inputs(opts.batch_path, &batch_count);
+            if (batch_count == 0)
+            {
+                wchar_t *wide_filename;
+                CHAR2WCHAR(wide_filename, opts.batch_path);
+                fwprintf(stdout, L"\nERROR: no inputs found in batch [%ls]\n", wide_filename);
+                free(wide_filename);
+
+                LOG(lm_main, LOG_ERROR, ("ERROR in main: no inputs found in batch [%s]", opts.batch_path));
+
+                exit_main_flag=-1;
+                goto exit_main;
+            }
+        }
+
+        if (opts.bench_runs > 0)
+        {
+            bench_runs = (bench_run_t *) calloc(2 * opts.bench_runs, sizeof(bench_run_t));
+            if (bench_runs)
+                pipeline_stats_enable(1);
+        }
+
+        if (opts.stats_json != NULL)
+        {
+            stats_fd = fopen(opts.stats_json, "w");
+            if (stats_fd == NULL)
+            {
+                wchar_t *wide_filename;
+                CHAR2WCHAR(wide_filename, opts.stats_json);
+                fwprintf(stdout, L"\nWarning: cannot create the stats file [%ls], no stats are written\n", wide_filename);
+                free(wide_filename);
+
+                LOG(lm_main, LOG_ERROR, ("Error in main: cannot create the stats file [%s]", opts.stats_json));
+            }
+            else
+            {
+                pipeline_stats_enable(1);
+                // a batch gets an array with one object per input, a bench one per run
+                if (batch_inputs || bench_runs)
+                    fprintf(stats_fd, "[\n");
+            }
+        }
+
+        if (opts.trace_file != NULL && trace_events_start(opts.trace_file) == 0)
+            trace_events_thread_name("main");
+
+        // the waits of the dst decoders on their locks go to the log with the stats
+        dst_decoder_set_lock_stats(pipeline_stats_enabled());
+
+        if (opts.dst_stats != NULL && dst_stats_start(opts.dst_stats) != 0)
+        {
+            wchar_t *wide_filename;
+            CHAR2WCHAR(wide_filename, opts.dst_stats);
+            fwprintf(stdout, L"\nWarning: cannot create the dst stats file [%ls], no dst stats are written\n", wide_filename);
+            free(wide_filename);
+
+            LOG(lm_main, LOG_ERROR, ("Error in main: cannot create the dst stats file [%s]", opts.dst_stats));
+        }
+
+        if (batch_inputs)
+            exit_main_flag = run_batch(batch_inputs, batch_count);
+        else
+            exit_main_flag = run_input(opts.input_device, opts.jobs, 0);
+
+        if (stats_fd)
+        {
+            fprintf(stats_fd, batch_inputs || bench_runs ? "\n]\n" : "\n");
+            if (fclose(stats_fd) != 0)
+            {
+                fwprintf(stdout, L"\nError in main: writing the stats file failed\n");
+                LOG(lm_main, LOG_ERROR, ("Error in main: writing the stats file [%s] failed", opts.stats_json));
+            }
+            stats_fd = NULL;
+            pipeline_stats_enable(0);
+        }
+
+        // the output threads have ended
+        if (trace_events_on && trace_events_stop() != 0)
+        {
+            fwprintf(stdout, L"\nError in main: writing the trace file failed\n");
+            LOG(lm_main, LOG_ERROR, ("Error in main: writing the trace file [%s] failed", opts.trace_file));
+        }
+
+        if (dst_stats_on && dst_stats_stop() != 0)
+        {
+            fwprintf(stdout, L"\nError in main: writing the dst stats file failed\n");
+            LOG(lm_main, LOG_ERROR, ("Error in main: writing the dst stats file [%s] failed", opts.dst_stats));
         }
 
         
@@ -1474,6 +2472,7 @@ exit_main:
     }
 exit_main_1:
     free_lock(g_fwprintf_lock);
+    free_lock(g_static_buffers_lock);
     destroy_logging();
 
     free(opts.output_dir_base);
@@ -1482,6 +2481,17 @@ exit_main_1:
 
     free(opts.input_device);
 
+    free(opts.batch_path);
+    free(opts.stats_json);
+    free(opts.trace_file);
+    free(opts.dst_stats);
+    free(bench_runs);
+    for (i = 0; i < batch_count; i++)
+    {
+        free(batch_inputs[i].input);
+    }
+    free(batch_inputs);
+
 #ifdef PTW32_STATIC_LIB
     pthread_win32_process_detach_np();
     pthread_win32_thread_detach_np();
@@ -0,0 +1,594 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * dst_bench loads the DST frames of an image (or a DSDIFF-DST file) into
+ * memory and decodes them without any disc reading or file output: once
+ * on the calling thread, timed per kernel of DST_FramDSTDecode, then
+ * through dst_decoder_t with 1..N threads. The checksum of the decoded
+ * DSD tells whether an optimization is still bit-exact. With -s the frames
+ * of the first single thread run go into a dst_stats report, with -l the
+ * threaded decoders log the waits on their locks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <locale.h>
+
+#include <utils.h>
+#include <logging.h>
+#include <pipeline_stats.h>
+#include <mem_stats.h>
+
+#include "scarletbook.h"
+#include "scarletbook_read.h"
+#include "sacd_reader.h"
+#include "dst_decoder.h"
+#include "dst_init.h"
+#include "dst_fram.h"
+#include "dst_stats.h"
+
+#define FRAMES_PER_SECOND   75
+
+static struct opts_s
+{
+    char          *input;
+    int            multichannel;    /* bench the multichannel area of an image */
+    uint32_t       frame_limit;
+    int            runs;
+    int            max_threads;
+    double         min_fps;         /* fail below this single thread frames/s */
+    char          *checksum;        /* fail if the decoded DSD differs */
+    char          *stats_file;      /* dst_stats report of the frames */
+    int            lock_stats;      /* log the lock waits of the threaded decoders */
+} opts;
+
+typedef struct
+{
+    uint8_t       *data;
+    size_t         size;
+    size_t         capacity;
+    size_t        *offset;          /* frame i is data[offset[i]..offset[i + 1]] */
+    uint32_t       count;
+    uint32_t       capacity_frames;
+    int            channel_count;
+}
+frame_set_t;
+
+typedef struct
+{
+    uint64_t       checksum;        /* of the first run */
+    uint32_t       frames;
+    uint32_t       checked_frames;  /* frames in one run */
+    int            errors;
+}
+decode_result_t;
+
+static int add_frame(frame_set_t *set, const uint8_t *data, size_t size)
+{
+    if (set->count + 1 >= set->capacity_frames)
+    {
+        uint32_t capacity = set->capacity_frames ? set->capacity_frames * 2 : 1024;
+        size_t *offset = (size_t *) realloc(set->offset, capacity * sizeof(size_t));
+
+        if (!offset)
+            return -1;
+        set->offset = offset;
+        set->capacity_frames = capacity;
+    }
+    if (set->size + size > set->capacity)
+    {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024 * 1024;
+        uint8_t *buffer;
+
+        while (capacity < set->size + size)
+            capacity *= 2;
+        buffer = (uint8_t *) realloc(set->data, capacity);
+        if (!buffer)
+            return -1;
+        set->data = buffer;
+        set->capacity = capacity;
+    }
+
+    memcpy(set->data + set->size, data, size);
+    set->offset[set->count++] = set->size;
+    set->size += size;
+    set->offset[set->count] = set->size;
+    return 0;
+}
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#define FNV1A_INIT  0xcbf29ce484222325ULL
+
+static uint64_t read_be(FILE *fd, int bytes, int *error)
+{
+    uint8_t  buffer[8];
+    uint64_t value = 0;
+    int      i;
+
+    if (fread(buffer, 1, bytes, fd) != (size_t) bytes)
+    {
+        *error = 1;
+        return 0;
+    }
+    for (i = 0; i < bytes; i++)
+        value = (value << 8) | buffer[i];
+    return value;
+}
+
+#define CHUNK_ID(a, b, c, d)    (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | ((uint32_t) (c) << 8) | (uint32_t) (d))
+
+/* the DSTF chunks of a DSDIFF file with DST compression */
+static int load_dsdiff(FILE *fd, frame_set_t *set)
+{
+    uint8_t *buffer = NULL;
+    uint64_t form_end, chunk_id, chunk_size;
+    int      error = 0, result = -1;
+
+    if (read_be(fd, 4, &error) != CHUNK_ID('F', 'R', 'M', '8'))
+        return -1;
+    form_end = read_be(fd, 8, &error) + 12;
+    if (read_be(fd, 4, &error) != CHUNK_ID('D', 'S', 'D', ' ') || error)
+        return -1;
+
+    while (!error && (uint64_t) ftello(fd) + 12 <= form_end && (!opts.frame_limit || set->count < opts.frame_limit))
+    {
+        off_t chunk_end;
+
+        chunk_id = read_be(fd, 4, &error);
+        chunk_size = read_be(fd, 8, &error);
+        if (error)
+            break;
+        chunk_end = ftello(fd) + (off_t) ((chunk_size + 1) & ~1ULL);
+
+        if (chunk_id == CHUNK_ID('P', 'R', 'O', 'P'))
+        {
+            // descend into the sound properties for the channel count
+            read_be(fd, 4, &error);
+            continue;
+        }
+        if (chunk_id == CHUNK_ID('D', 'S', 'T', ' '))
+        {
+            // the frames follow as sub chunks
+            continue;
+        }
+        if (chunk_id == CHUNK_ID('C', 'H', 'N', 'L'))
+        {
+            set->channel_count = (int) read_be(fd, 2, &error);
+        }
+        else if (chunk_id == CHUNK_ID('C', 'M', 'P', 'R'))
+        {
+            if (read_be(fd, 4, &error) != CHUNK_ID('D', 'S', 'T', ' '))
+            {
+                fwprintf(stderr, L"%s is not DST compressed\n", opts.input);
+                return -1;
+            }
+        }
+        else if (chunk_id == CHUNK_ID('D', 'S', 'T', 'F'))
+        {
+            if (chunk_size > MAX_DST_SIZE)
+            {
+                fwprintf(stderr, L"DST frame of %llu bytes\n", (unsigned long long) chunk_size);
+                break;
+            }
+            if (!buffer)
+                buffer = (uint8_t *) malloc(MAX_DST_SIZE);
+            if (!buffer || fread(buffer, 1, (size_t) chunk_size, fd) != chunk_size ||
+                add_frame(set, buffer, (size_t) chunk_size) != 0)
+                break;
+        }
+        if (fseeko(fd, chunk_end, SEEK_SET) != 0)
+            break;
+    }
+
+    free(buffer);
+    if (set->count > 0 && set->channel_count > 0)
+        result = 0;
+    return result;
+}
+
+static void store_frame(scarletbook_frame_parser_t *parser, uint8_t *frame_data, size_t frame_size, void *userdata)
+{
+    frame_set_t *set = (frame_set_t *) userdata;
+
+    if (!parser->frame.dst_encoded || (opts.frame_limit && set->count >= opts.frame_limit))
+        return;
+    if (add_frame(set, frame_data, frame_size) != 0)
+        set->channel_count = 0;
+}
+
+/* the frames of the stereo (or -m multichannel) DST area of an image or a server */
+static int load_image(frame_set_t *set)
+{
+    sacd_reader_t              *sacd_reader;
+    scarletbook_handle_t       *handle;
+    scarletbook_frame_parser_t *parser;
+    uint8_t                    *buffer;
+    uint32_t                    lsn, end_lsn;
+    int                         area_idx, result = -1;
+
+    sacd_reader = sacd_open(opts.input);
+    if (!sacd_reader)
+    {
+        fwprintf(stderr, L"can't open %s\n", opts.input);
+        return -1;
+    }
+    handle = scarletbook_open(sacd_reader);
+    if (!handle)
+    {
+        sacd_close(sacd_reader);
+        return -1;
+    }
+
+    area_idx = opts.multichannel ? handle->mulch_area_idx : handle->twoch_area_idx;
+    if (area_idx == -1)
+    {
+        fwprintf(stderr, L"%s has no %ls area\n", opts.input, opts.multichannel ? L"multichannel" : L"stereo");
+    }
+    else if (handle->area[area_idx].area_toc->frame_format != FRAME_FORMAT_DST)
+    {
+        fwprintf(stderr, L"the %ls area of %s is not DST coded\n", opts.multichannel ? L"multichannel" : L"stereo", opts.input);
+    }
+    else
+    {
+        parser = scarletbook_frame_parser_create(handle);
+        buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+        if (parser && buffer)
+        {
+            set->channel_count = handle->area[area_idx].area_toc->channel_count;
+            lsn = handle->area[area_idx].area_toc->track_start;
+            end_lsn = handle->area[area_idx].area_toc->track_end + 1;
+
+            scarletbook_frame_init(parser);
+            while (lsn < end_lsn && set->channel_count && (!opts.frame_limit || set->count < opts.frame_limit))
+            {
+                uint32_t count = min(MAX_PROCESSING_BLOCK_SIZE, end_lsn - lsn);
+                uint32_t blocks = sacd_read_block_raw(sacd_reader, lsn, count, buffer);
+
+                if (blocks == 0)
+                {
+                    fwprintf(stderr, L"read error at %u\n", lsn);
+                    break;
+                }
+                lsn += blocks;
+                scarletbook_process_frames(parser, buffer, (int) blocks, lsn >= end_lsn, store_frame, set);
+            }
+            if (set->count > 0 && set->channel_count)
+                result = 0;
+        }
+        free(buffer);
+        if (parser)
+            scarletbook_frame_parser_destroy(parser);
+    }
+
+    scarletbook_close(handle);
+    sacd_close(sacd_reader);
+    return result;
+}
+
+static int load_frames(frame_set_t *set)
+{
+    FILE *fd = fopen(opts.input, "rb");
+    int   result;
+
+    if (fd)
+    {
+        char id[4];
+
+        if (fread(id, 1, sizeof(id), fd) == sizeof(id) && memcmp(id, "FRM8", 4) == 0)
+        {
+            rewind(fd);
+            result = load_dsdiff(fd, set);
+            fclose(fd);
+            if (result != 0)
+                fwprintf(stderr, L"can't read the DST frames of %s\n", opts.input);
+            return result;
+        }
+        fclose(fd);
+    }
+
+    // an image, a drive or a server
+    return load_image(set);
+}
+
+/* all frames on the calling thread, with the time per kernel */
+static double decode_single(frame_set_t *set, uint64_t kernel_time[DST_KERNELS], dst_stats_t *stats, decode_result_t *result)
+{
+    FrameStats frame;
+    ebunch   *D;
+    uint8_t  *dsd;
+    size_t    dsd_size = (size_t) set->channel_count * FRAME_SIZE_64;
+    uint64_t  start;
+    uint32_t  i;
+    int       run;
+
+    memset(result, 0, sizeof(*result));
+    D = (ebunch *) malloc(sizeof(ebunch));
+    dsd = (uint8_t *) malloc(dsd_size);
+    if (!D || !dsd || DST_InitDecoder(D, set->channel_count, 64) != 0)
+    {
+        free(D);
+        free(dsd);
+        result->errors = -1;
+        return 0.0;
+    }
+    D->KernelTime = kernel_time;
+
+    result->checksum = FNV1A_INIT;
+    start = pipeline_stats_now();
+    for (run = 0; run < opts.runs; run++)
+    {
+        D->Stats = run == 0 && stats ? &frame : NULL;
+        for (i = 0; i < set->count; i++)
+        {
+            if (DST_FramDSTDecode(set->data + set->offset[i], dsd, (int) (set->offset[i + 1] - set->offset[i]), (int) i, D) != 0)
+                result->errors++;
+            if (D->Stats)
+                dst_stats_add(stats, &frame);
+            if (run == 0)
+                result->checksum = fnv1a(result->checksum, dsd, dsd_size);
+            result->frames++;
+        }
+    }
+    start = pipeline_stats_now() - start;
+
+    DST_CloseDecoder(D);
+    free(D);
+    free(dsd);
+    return start / 1e9;
+}
+
+static void frame_decoded(uint8_t *frame_data, size_t frame_size, void *userdata)
+{
+    decode_result_t *result = (decode_result_t *) userdata;
+
+    if (result->frames++ < result->checked_frames)
+        result->checksum = fnv1a(result->checksum, frame_data, frame_size);
+}
+
+static void frame_error(int frame_count, int frame_error_code, const char *frame_error_message, void *userdata)
+{
+    decode_result_t *result = (decode_result_t *) userdata;
+
+    result->errors++;
+}
+
+/* all frames through a dst_decoder_t with threads decoding threads */
+static double decode_threaded(frame_set_t *set, int threads, decode_result_t *result)
+{
+    dst_decoder_t *dst_decoder;
+    uint64_t       start;
+    uint32_t       i;
+    int            run;
+
+    memset(result, 0, sizeof(*result));
+    result->checksum = FNV1A_INIT;
+    result->checked_frames = set->count;
+
+    dst_decoder_set_threads(threads);
+    start = pipeline_stats_now();
+    dst_decoder = dst_decoder_create(set->channel_count, frame_decoded, frame_error, result);
+    for (run = 0; run < opts.runs; run++)
+    {
+        for (i = 0; i < set->count; i++)
+        {
+            dst_decoder_decode(dst_decoder, set->data + set->offset[i], set->offset[i + 1] - set->offset[i]);
+        }
+    }
+    // waits for the last frame
+    dst_decoder_destroy(dst_decoder);
+    start = pipeline_stats_now() - start;
+    dst_decoder_set_threads(0);
+
+    return start / 1e9;
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] -i image.iso|file.dff\n"
+        "Options:\n"
+        "  -i INPUT   : image, server (ip:port) or DSDIFF-DST file to take the frames from\n"
+        "  -m         : the multichannel area of an image (default: stereo)\n"
+        "  -n FRAMES  : load at most this many frames (default: all)\n"
+        "  -r RUNS    : decode the frames this many times (default 1)\n"
+        "  -j N       : dst_decoder_t with 1..N threads (default: processors)\n"
+        "  -f FPS     : fail if the single thread decodes fewer frames/s\n"
+        "  -x SUM     : fail if the checksum of the decoded DSD is not SUM\n"
+        "  -s FILE    : write what the frames cost to decode as JSON (dst_stats)\n"
+        "  -l         : log the lock waits of the threaded decoders (LOG_MODULES=all:5)\n",
+        program_name);
+}
+
+int main(int argc, char *argv[])
+{
+    frame_set_t     set;
+    dst_stats_t    *stats = NULL;
+    decode_result_t single, threaded;
+    uint64_t        kernel_time[DST_KERNELS];
+    uint64_t        kernel_total = 0;
+    double          elapsed, fps;
+    int             i, opt, failed = 0;
+
+    opts.runs = 1;
+    opts.max_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "i:mn:r:j:f:x:s:lh")) >= 0)
+    {
+        switch (opt)
+        {
+        case 'i':
+            opts.input = optarg;
+            break;
+        case 'm':
+            opts.multichannel = 1;
+            break;
+        case 'n':
+            opts.frame_limit = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            opts.runs = max(1, atoi(optarg));
+            break;
+        case 'j':
+            opts.max_threads = atoi(optarg);
+            break;
+        case 'f':
+            opts.min_fps = atof(optarg);
+            break;
+        case 'x':
+            opts.checksum = optarg;
+            break;
+        case 's':
+            opts.stats_file = optarg;
+            break;
+        case 'l':
+            opts.lock_stats = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!opts.input)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    opts.max_threads = max(1, opts.max_threads);
+
+    setlocale(LC_ALL, "");
+    if (fwide(stdout, 1) < 0)
+    {
+        fprintf(stderr, "ERROR: Output not set to wide.\n");
+    }
+
+    init_logging(0);
+    dst_decoder_count_memory();
+
+    memset(&set, 0, sizeof(set));
+    if (load_frames(&set) != 0)
+        return 1;
+    if (set.channel_count < 1 || set.channel_count > MAX_CHANNELS)
+    {
+        fwprintf(stderr, L"%d channels are not supported\n", set.channel_count);
+        return 1;
+    }
+
+    fwprintf(stdout, L"%u frames of %d channels, %.2f MB DST (%.1f%% of DSD), %.1f s of audio, %d run(s)\n",
+             set.count, set.channel_count, set.size / (1024.0 * 1024.0),
+             100.0 * set.size / ((double) set.count * set.channel_count * FRAME_SIZE_64),
+             (double) set.count / FRAMES_PER_SECOND, opts.runs);
+
+    if (opts.stats_file)
+    {
+        stats = (dst_stats_t *) malloc(sizeof(dst_stats_t));
+        if (!stats || dst_stats_start(opts.stats_file) != 0)
+        {
+            fwprintf(stderr, L"can't create %s\n", opts.stats_file);
+            return 1;
+        }
+        dst_stats_init(stats, set.channel_count);
+    }
+
+    memset(kernel_time, 0, sizeof(kernel_time));
+    elapsed = decode_single(&set, kernel_time, stats, &single);
+    if (single.errors < 0)
+    {
+        fwprintf(stderr, L"can't initialize the DST decoder\n");
+        return 1;
+    }
+    fps = elapsed > 0 ? single.frames / elapsed : 0.0;
+    for (i = 0; i < DST_KERNELS; i++)
+        kernel_total += kernel_time[i];
+    if (kernel_total == 0)
+        kernel_total = 1;
+
+    fwprintf(stdout, L"single thread : %8.1f frames/s %7.2fx realtime, checksum %016llx, %d error(s)\n",
+             fps, fps / FRAMES_PER_SECOND, (unsigned long long) single.checksum, single.errors);
+    fwprintf(stdout, L"                unpack %.1f%%, tables %.1f%%, ac loop %.1f%%\n",
+             100.0 * kernel_time[DST_KERNEL_UNPACK] / kernel_total,
+             100.0 * kernel_time[DST_KERNEL_TABLES] / kernel_total,
+             100.0 * kernel_time[DST_KERNEL_AC] / kernel_total);
+    if (stats)
+    {
+        fwprintf(stdout, L"                %u plain DSD frame(s), slowest frame %d: %.1f us (%d filters, %d Ptables)\n",
+                 stats->plain_frames, stats->costliest[0].FrameNr, stats->costliest[0].DecodeTime / 1000.0,
+                 stats->costliest[0].NrOfFilters, stats->costliest[0].NrOfPtables);
+        dst_stats_report(stats, opts.input);
+        if (dst_stats_stop() != 0)
+        {
+            fwprintf(stderr, L"writing %s failed\n", opts.stats_file);
+            failed = 1;
+        }
+        free(stats);
+    }
+
+    dst_decoder_set_lock_stats(opts.lock_stats);
+    for (i = 1; i <= opts.max_threads; i++)
+    {
+        mem_subsystem_totals_t memory[MEM_SUBSYSTEMS];
+        double threaded_fps;
+
+        mem_stats_reset_peaks();
+        elapsed = decode_threaded(&set, i, &threaded);
+        threaded_fps = elapsed > 0 ? threaded.frames / elapsed : 0.0;
+        mem_stats_totals(memory);
+        fwprintf(stdout, L"%2d thread(s)  : %8.1f frames/s %7.2fx realtime, checksum %016llx, peak pools %.1f MB, tables %.1f MB%ls\n",
+                 i, threaded_fps, threaded_fps / FRAMES_PER_SECOND, (unsigned long long) threaded.checksum,
+                 memory[MEM_BUFFER_POOL].peak / (1024.0 * 1024.0), memory[MEM_DST_DECODER].peak / (1024.0 * 1024.0),
+                 threaded.checksum == single.checksum && threaded.frames == single.frames ? L"" : L" MISMATCH");
+        if (threaded.checksum != single.checksum || threaded.frames != single.frames)
+            failed = 1;
+    }
+
+    if (opts.min_fps > 0 && fps < opts.min_fps)
+    {
+        fwprintf(stdout, L"FAILED: %.1f frames/s is below %.1f\n", fps, opts.min_fps);
+        failed = 1;
+    }
+    if (opts.checksum && strtoull(opts.checksum, NULL, 16) != single.checksum)
+    {
+        fwprintf(stdout, L"FAILED: checksum %016llx, expected %s\n", (unsigned long long) single.checksum, opts.checksum);
+        failed = 1;
+    }
+    if (single.errors)
+        failed = 1;
+
+    free(set.data);
+    free(set.offset);
+
+    return failed;
+}
@@ -0,0 +1,264 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * sacd_server serves ISO images with the same protocol as the PS3 server
+ * (src/server.c), so network ripping can be developed and benchmarked
+ * without a PS3. Every image gets its own port, all connections on an
+ * image share one opened disc and its sector cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <wchar.h>
+#include <locale.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <socket.h>
+#include <logging.h>
+
+#include "scarletbook.h"
+#include "sacd_reader.h"
+#include "sacd_server.h"
+
+#define DEFAULT_PORT 2002
+
+static struct opts_s
+{
+    int            port;
+    uint32_t       cache_size;      /* MB per image, 0 disables the cache */
+    int            latency;         /* ms from a request to its response */
+    uint32_t       bandwidth;       /* KB/s per connection, 0 is unlimited */
+} opts;
+
+typedef struct
+{
+    const char          *path;
+    int                  port;
+    int                  listener;
+    sacd_reader_t       *sacd_reader;
+    sacd_server_config_t config;
+}
+disc_t;
+
+typedef struct
+{
+    disc_t              *disc;
+    t_socket             client;
+}
+connection_t;
+
+static void *client_thread(void *userdata)
+{
+    connection_t        *connection = (connection_t *) userdata;
+    sector_cache_stats_t stats;
+    int                  ret;
+
+    ret = sacd_server_session(&connection->client, &connection->disc->config);
+
+    if (sacd_get_cache_stats(connection->disc->sacd_reader, &stats) == 0)
+    {
+        fwprintf(stdout, L"%s: session ended (%d), cache hits: %llu, misses: %llu, coalesced: %llu\n", connection->disc->path, ret,
+                 (unsigned long long) stats.hits, (unsigned long long) stats.misses, (unsigned long long) stats.coalesced);
+    }
+    else
+    {
+        fwprintf(stdout, L"%s: session ended (%d)\n", connection->disc->path, ret);
+    }
+
+    fflush(stdout);
+
+    socket_destroy(&connection->client);
+    free(connection);
+
+    return NULL;
+}
+
+static void *listener_thread(void *userdata)
+{
+    disc_t *disc = (disc_t *) userdata;
+
+    for (;;)
+    {
+        connection_t  *connection;
+        pthread_t      id;
+        pthread_attr_t attr;
+        int            client;
+
+        client = accept(disc->listener, NULL, NULL);
+        if (client < 0)
+            continue;
+
+        connection = (connection_t *) malloc(sizeof(connection_t));
+        if (!connection)
+        {
+            close(client);
+            continue;
+        }
+        connection->disc = disc;
+        connection->client = client;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&id, &attr, client_thread, connection) != 0)
+        {
+            close(client);
+            free(connection);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+    return NULL;
+}
+
+static int open_disc(disc_t *disc)
+{
+    struct sockaddr_in sa;
+    int                one = 1;
+
+    disc->sacd_reader = sacd_open(disc->path);
+    if (!disc->sacd_reader)
+    {
+        fwprintf(stderr, L"can't open %s\n", disc->path);
+        return -1;
+    }
+
+    memset(&disc->config, 0, sizeof(disc->config));
+    disc->config.path = disc->path;
+    disc->config.sacd_reader = disc->sacd_reader;
+    // emulates the PS3 link, the requests in flight overlap like on the real one
+    disc->config.latency = (uint32_t) opts.latency;
+    disc->config.bandwidth = opts.bandwidth;
+
+    if (sacd_set_cache(disc->sacd_reader, opts.cache_size * (1024 * 1024 / SACD_LSN_SIZE)) != 0)
+        return -1;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((unsigned short) disc->port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    disc->listener = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (disc->listener < 0)
+        return -1;
+    setsockopt(disc->listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(disc->listener, (struct sockaddr *) &sa, sizeof(sa)) == -1 || listen(disc->listener, 8) == -1)
+    {
+        fwprintf(stderr, L"can't listen on port %d\n", disc->port);
+        return -1;
+    }
+
+    fwprintf(stdout, L"serving %s on port %d\n", disc->path, disc->port);
+
+    return 0;
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] image.iso [image.iso ...]\n"
+        "Options:\n"
+        "  -p PORT    : port of the first image, the next images use the following ports (default %d)\n"
+        "  -c MB      : sector cache per image in MB, 0 disables it (default 64)\n"
+        "  -l MS      : time from a request to its response, the requests in flight overlap (emulates the link latency)\n"
+        "  -b KB      : bandwidth per connection in KB/s\n",
+        program_name, DEFAULT_PORT);
+}
+
+int main(int argc, char *argv[])
+{
+    disc_t    *discs;
+    pthread_t *threads;
+    int        disc_count, i, opt;
+
+    opts.port = DEFAULT_PORT;
+    opts.cache_size = 64;
+
+    while ((opt = getopt(argc, argv, "p:c:l:b:h")) >= 0)
+    {
+        switch (opt)
+        {
+        case 'p':
+            opts.port = atoi(optarg);
+            break;
+        case 'c':
+            opts.cache_size = (uint32_t) atoi(optarg);
+            break;
+        case 'l':
+            opts.latency = atoi(optarg);
+            break;
+        case 'b':
+            opts.bandwidth = (uint32_t) atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    disc_count = argc - optind;
+    if (disc_count <= 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    setlocale(LC_ALL, "");
+    if (fwide(stdout, 1) < 0)
+    {
+        fprintf(stderr, "ERROR: Output not set to wide.\n");
+    }
+
+    init_logging(0);
+
+    // a client that goes away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    discs = (disc_t *) calloc(disc_count, sizeof(disc_t));
+    threads = (pthread_t *) calloc(disc_count, sizeof(pthread_t));
+    if (!discs || !threads)
+        return 1;
+
+    for (i = 0; i < disc_count; i++)
+    {
+        discs[i].path = argv[optind + i];
+        discs[i].port = opts.port + i;
+        if (open_disc(&discs[i]) != 0)
+            return 1;
+    }
+
+    for (i = 0; i < disc_count; i++)
+    {
+        pthread_create(&threads[i], NULL, listener_thread, &discs[i]);
+    }
+    for (i = 0; i < disc_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * sacd_bench reads a sector range from a server (or an image) with one or
+ * more concurrent clients and reports the throughput and the latency of
+ * the read calls, e.g. against sacd_server with a latency / bandwidth set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <locale.h>
+#include <pthread.h>
+
+#include <utils.h>
+#include <logging.h>
+#include <timeout.h>
+
+#include "scarletbook.h"
+#include "scarletbook_read.h"
+#include "sacd_reader.h"
+#include "sacd_input.h"
+
+static struct opts_s
+{
+    char          *input;
+    int            clients;
+    uint32_t       start_lsn;
+    uint32_t       sector_count;
+    uint32_t       block_size;
+    uint32_t       window;
+    int            frames;          /* read with DISC_READ_FRAMES */
+} opts;
+
+typedef struct
+{
+    sacd_reader_t *sacd_reader;
+    uint8_t       *buffer;
+    double        *latency;         /* seconds per read call */
+    uint32_t       call_count;
+    uint32_t       call_capacity;
+    uint64_t       sectors;
+    uint64_t       frames;
+    uint64_t       frame_bytes;
+    int            error;
+}
+client_t;
+
+static void count_frame(const sacd_input_frame_t *frame, void *userdata)
+{
+    client_t *client = (client_t *) userdata;
+
+    client->frames++;
+    client->frame_bytes += frame->size;
+}
+
+static void *client_thread(void *userdata)
+{
+    client_t *client = (client_t *) userdata;
+    uint32_t  lsn = opts.start_lsn;
+    uint32_t  end_lsn = opts.start_lsn + opts.sector_count;
+
+    while (lsn < end_lsn)
+    {
+        uint32_t count = min(opts.block_size, end_lsn - lsn);
+        double   start = timeout_gettime();
+        int      ret;
+
+        if (opts.frames)
+        {
+            int frame_flags = (lsn == opts.start_lsn ? SACD_FRAMES_RESTART : 0) |
+                              (lsn + count >= end_lsn ? SACD_FRAMES_LAST : 0);
+
+            ret = sacd_read_frames(client->sacd_reader, lsn, count, end_lsn, frame_flags, count_frame, client);
+        }
+        else
+        {
+            ret = (int) sacd_read_block_raw(client->sacd_reader, lsn, count, client->buffer);
+        }
+
+        if (ret <= 0)
+        {
+            client->error = 1;
+            break;
+        }
+
+        if (client->call_count == client->call_capacity)
+        {
+            double *latency = (double *) realloc(client->latency, client->call_capacity * 2 * sizeof(double));
+            if (!latency)
+            {
+                client->error = 1;
+                break;
+            }
+            client->latency = latency;
+            client->call_capacity *= 2;
+        }
+        client->latency[client->call_count++] = timeout_gettime() - start;
+        client->sectors += (uint32_t) ret;
+        lsn += (uint32_t) ret;
+    }
+
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, uint32_t count, int p)
+{
+    uint32_t i = (uint32_t) (((uint64_t) count * p + 99) / 100);
+
+    return count == 0 ? 0.0 : sorted[i > 0 ? i - 1 : 0];
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] -i 127.0.0.1:2002\n"
+        "Options:\n"
+        "  -i INPUT   : server (ip:port) or image to read from\n"
+        "  -c N       : concurrent clients, each reads the whole range (default 1)\n"
+        "  -s LSN     : first sector (default: start of the audio area)\n"
+        "  -n COUNT   : number of sectors (default: up to the end of the audio area)\n"
+        "  -b COUNT   : sectors per read call (default %d)\n"
+        "  -w N       : read requests kept in flight (default 4)\n"
+        "  -f         : let the server assemble the audio frames\n",
+        program_name, MAX_PROCESSING_BLOCK_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    client_t *clients;
+    pthread_t *threads;
+    double   *latency;
+    double    start, elapsed;
+    uint64_t  sectors = 0, frames = 0, frame_bytes = 0;
+    uint32_t  call_count = 0;
+    int       i, opt, errors = 0;
+
+    opts.clients = 1;
+    opts.block_size = MAX_PROCESSING_BLOCK_SIZE;
+
+    while ((opt = getopt(argc, argv, "i:c:s:n:b:w:fh")) >= 0)
+    {
+        switch (opt)
+        {
+        case 'i':
+            opts.input = optarg;
+            break;
+        case 'c':
+            opts.clients = max(1, atoi(optarg));
+            break;
+        case 's':
+            opts.start_lsn = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            opts.sector_count = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            opts.block_size = max(1, min((uint32_t) atoi(optarg), MAX_PROCESSING_BLOCK_SIZE));
+            break;
+        case 'w':
+            opts.window = (uint32_t) atoi(optarg);
+            break;
+        case 'f':
+            opts.frames = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!opts.input)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    setlocale(LC_ALL, "");
+    if (fwide(stdout, 1) < 0)
+    {
+        fprintf(stderr, "ERROR: Output not set to wide.\n");
+    }
+
+    init_logging(0);
+
+    if (opts.window > 0)
+        sacd_input_set_read_window(opts.window);
+
+    clients = (client_t *) calloc(opts.clients, sizeof(client_t));
+    threads = (pthread_t *) calloc(opts.clients, sizeof(pthread_t));
+    if (!clients || !threads)
+        return 1;
+
+    // every client has its own connection, opened up front
+    for (i = 0; i < opts.clients; i++)
+    {
+        clients[i].sacd_reader = sacd_open(opts.input);
+        if (!clients[i].sacd_reader)
+        {
+            fwprintf(stderr, L"can't open %s\n", opts.input);
+            return 1;
+        }
+    }
+
+    if (opts.sector_count == 0)
+    {
+        scarletbook_handle_t *handle = scarletbook_open(clients[0].sacd_reader);
+        scarletbook_area_t   *area;
+
+        if (!handle || (!handle->area[0].area_toc && !handle->area[1].area_toc))
+        {
+            fwprintf(stderr, L"%s has no audio area, use -s and -n\n", opts.input);
+            return 1;
+        }
+        area = handle->area[0].area_toc ? &handle->area[0] : &handle->area[1];
+        if (opts.start_lsn == 0)
+            opts.start_lsn = area->area_toc->track_start;
+        if (area->area_toc->track_end >= opts.start_lsn)
+            opts.sector_count = area->area_toc->track_end + 1 - opts.start_lsn;
+        scarletbook_close(handle);
+    }
+
+    if (opts.sector_count == 0)
+    {
+        fwprintf(stderr, L"nothing to read\n");
+        return 1;
+    }
+
+    for (i = 0; i < opts.clients; i++)
+    {
+        clients[i].buffer = (uint8_t *) malloc((size_t) opts.block_size * SACD_LSN_SIZE);
+        clients[i].call_capacity = (opts.sector_count + opts.block_size - 1) / opts.block_size + 1;
+        clients[i].latency = (double *) malloc(clients[i].call_capacity * sizeof(double));
+        if (!clients[i].buffer || !clients[i].latency)
+            return 1;
+    }
+
+    fwprintf(stdout, L"reading %u sectors from %u, %d client(s), %u sectors per %ls\n", opts.sector_count, opts.start_lsn,
+             opts.clients, opts.block_size, opts.frames ? L"frame request" : L"read");
+
+    start = timeout_gettime();
+    for (i = 0; i < opts.clients; i++)
+    {
+        pthread_create(&threads[i], NULL, client_thread, &clients[i]);
+    }
+    for (i = 0; i < opts.clients; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = timeout_gettime() - start;
+
+    for (i = 0; i < opts.clients; i++)
+    {
+        sectors += clients[i].sectors;
+        frames += clients[i].frames;
+        frame_bytes += clients[i].frame_bytes;
+        call_count += clients[i].call_count;
+        errors += clients[i].error;
+    }
+
+    latency = (double *) malloc((call_count + 1) * sizeof(double));
+    if (!latency)
+        return 1;
+    call_count = 0;
+    for (i = 0; i < opts.clients; i++)
+    {
+        memcpy(latency + call_count, clients[i].latency, clients[i].call_count * sizeof(double));
+        call_count += clients[i].call_count;
+    }
+    qsort(latency, call_count, sizeof(double), compare_double);
+
+    fwprintf(stdout, L"%llu sectors in %.3f s: %.2f MB/s\n", (unsigned long long) sectors, elapsed,
+             elapsed > 0 ? sectors * SACD_LSN_SIZE / (1024.0 * 1024.0) / elapsed : 0.0);
+    fwprintf(stdout, L"%u calls, latency p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", call_count,
+             percentile(latency, call_count, 50) * 1000, percentile(latency, call_count, 90) * 1000,
+             percentile(latency, call_count, 99) * 1000, call_count ? latency[call_count - 1] * 1000 : 0.0);
+    if (opts.frames)
+    {
+        fwprintf(stdout, L"%llu frames, %.2f MB of frame data\n", (unsigned long long) frames,
+                 frame_bytes / (1024.0 * 1024.0));
+    }
+    if (errors)
+    {
+        fwprintf(stdout, L"%d client(s) stopped on a read error\n", errors);
+    }
+
+    for (i = 0; i < opts.clients; i++)
+    {
+        sacd_close(clients[i].sacd_reader);
+        free(clients[i].buffer);
+        free(clients[i].latency);
+    }
+    free(latency);
+    free(threads);
+    free(clients);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,1169 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * sacd_gen writes a synthetic Scarletbook image: the master TOC, a stereo
+ * and / or a multichannel area TOC with text, and the track areas in plain
+ * DSD (3 in 14 / 3 in 16) or DST. The audio is a tone per channel or seeded
+ * noise, so the same options always give the same image and benchmarks or
+ * regression runs don't need real discs.
+ *
+ * The DST frames come from a simple encoder: one prediction filter per
+ * channel fitted on the frame, one probability table per channel and the
+ * arithmetic coder of libdstdec in reverse. A frame that does not get
+ * smaller is stored uncompressed, as the format allows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <locale.h>
+
+#include <utils.h>
+
+#include "scarletbook.h"
+#include "dst_init.h"
+#include "dst_fram.h"
+
+#define AREA_TOC_1_START        544
+#define AREA_TEXT_OFFSET        208     // first byte after the Area_Text pointers in Area_TOC_0
+#define MAX_TRACK_TEXT_SIZE     (32 * SACD_LSN_SIZE)
+#define ACCESS_LIST_SIZE        32
+
+#define DSD_SILENCE             0x69
+#define TONE_LEVEL              0.5
+#define DITHER_LEVEL            0.005
+
+// DST encoder, see libdstdec for the decoding side
+#define DST_ORDER               32
+#define DST_PTABLE_LEN          64
+#define DST_BITS_PER_CH         (FRAME_SIZE_64 * 8)
+#define AC_ABITS                12
+#define AC_ONE                  (1 << AC_ABITS)
+#define AC_HALF                 (1 << (AC_ABITS - 1))
+
+enum
+{
+    CONTENT_TONE,       // a tone per channel, sigma-delta modulated
+    CONTENT_NOISE,      // white noise, sigma-delta modulated
+    CONTENT_RANDOM      // random bits, DST can't compress them
+};
+
+static struct opts_s
+{
+    char          *output;
+    int            track_count;
+    int            track_frames;
+    int            stereo_format;   /* frame_format_t, -1 = no stereo area */
+    int            mulch_channels;  /* 0 = no multichannel area */
+    int            content;
+    uint32_t       seed;
+    int            pause_frames;
+    int            verify;          /* decode every DST frame again */
+} opts;
+
+typedef struct
+{
+    double         re, im;          // tone oscillator
+    double         step_re, step_im;
+    double         s1, s2;          // modulator integrators
+    uint32_t       random;
+}
+channel_gen_t;
+
+typedef struct
+{
+    int            channels;
+    int16_t        coef[MAX_CHANNEL_COUNT][DST_ORDER];
+    int16_t        table[MAX_CHANNEL_COUNT][DST_ORDER / 8][256];
+    int            ptable[MAX_CHANNEL_COUNT][DST_PTABLE_LEN];
+    int            ptable_len[MAX_CHANNEL_COUNT];
+    uint8_t       *residual;        // per bit, in the order of the decoder (bit major)
+    uint8_t       *index;           // Ptable entry of every bit
+    uint8_t       *ac_bits;         // arithmetic code, one bit per byte
+    int            ac_size;
+    ebunch        *verify;
+}
+dst_encoder_t;
+
+typedef struct
+{
+    FILE          *fd;
+    int            dst;
+    uint32_t       lsn;             // sector being filled
+    int            packet_count;
+    int            frame_count;
+    int            data_size;
+    uint8_t        packet_info[7][2];
+    uint8_t        frame_info[7][4];
+    uint8_t        data[SACD_LSN_SIZE];
+}
+sector_writer_t;
+
+typedef struct
+{
+    int            channels;
+    int            frame_format;
+    uint32_t       toc_1_start;
+    uint32_t       toc_2_start;
+    int            toc_size;
+    uint32_t       track_start;
+    uint32_t       track_end;
+    uint32_t       total_frames;
+    uint32_t       track_start_lsn[255];
+    uint32_t       track_end_lsn[255];
+    uint32_t       track_start_frame[255];   // without the pause
+    uint32_t       track_frames[255];
+    uint64_t       audio_bytes;
+    uint32_t       coded_frames;
+}
+area_t;
+
+static void put_be16(void *p, uint16_t v)
+{
+    uint8_t *b = (uint8_t *) p;
+
+    b[0] = (uint8_t) (v >> 8);
+    b[1] = (uint8_t) v;
+}
+
+static void put_be32(void *p, uint32_t v)
+{
+    uint8_t *b = (uint8_t *) p;
+
+    b[0] = (uint8_t) (v >> 24);
+    b[1] = (uint8_t) (v >> 16);
+    b[2] = (uint8_t) (v >> 8);
+    b[3] = (uint8_t) v;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int write_sectors(FILE *fd, uint32_t lsn, const void *data, int count)
+{
+    if (fseeko(fd, (off_t) lsn * SACD_LSN_SIZE, SEEK_SET) != 0)
+        return -1;
+    return fwrite(data, SACD_LSN_SIZE, count, fd) == (size_t) count ? 0 : -1;
+}
+
+/* audio content */
+
+static void init_channels(channel_gen_t *gen, int channels)
+{
+    int ch;
+
+    memset(gen, 0, sizeof(channel_gen_t) * channels);
+    for (ch = 0; ch < channels; ch++)
+    {
+        gen[ch].re = 1.0;
+        gen[ch].random = opts.seed * 2654435761U + (uint32_t) ch * 40503U + 1;
+        if (gen[ch].random == 0)
+            gen[ch].random = 1;
+    }
+}
+
+static void set_tone(channel_gen_t *gen, int channels, int track)
+{
+    int ch;
+
+    for (ch = 0; ch < channels; ch++)
+    {
+        double frequency = 220.0 * (ch + 2) * (1.0 + 0.125 * (track % 8));
+
+        gen[ch].step_re = cos(2 * M_PI * frequency / SACD_SAMPLING_FREQUENCY);
+        gen[ch].step_im = sin(2 * M_PI * frequency / SACD_SAMPLING_FREQUENCY);
+    }
+}
+
+// one frame in the muxed layout of the sectors: byte n of channel c at n * channels + c
+static void generate_frame(channel_gen_t *gen, int channels, int silent, uint8_t *frame)
+{
+    int ch, n, i;
+
+    if (silent)
+    {
+        memset(frame, DSD_SILENCE, FRAME_SIZE_64 * channels);
+        return;
+    }
+
+    for (ch = 0; ch < channels; ch++)
+    {
+        channel_gen_t *g = &gen[ch];
+        double scale;
+
+        for (n = 0; n < FRAME_SIZE_64; n++)
+        {
+            uint8_t byte = 0;
+
+            if (opts.content == CONTENT_RANDOM)
+            {
+                frame[n * channels + ch] = (uint8_t) (next_random(&g->random) >> 24);
+                continue;
+            }
+
+            for (i = 0; i < 8; i++)
+            {
+                double in, q, re;
+
+                if (opts.content == CONTENT_TONE)
+                {
+                    re = g->re * g->step_re - g->im * g->step_im;
+                    g->im = g->re * g->step_im + g->im * g->step_re;
+                    g->re = re;
+                    in = TONE_LEVEL * g->im + DITHER_LEVEL * ((double) next_random(&g->random) / 4294967296.0 - 0.5);
+                }
+                else
+                {
+                    in = (double) next_random(&g->random) / 4294967296.0 - 0.5;
+                }
+
+                // second order sigma-delta modulator
+                q = g->s2 >= 0 ? 1.0 : -1.0;
+                g->s1 += in - q;
+                g->s2 += g->s1 - q;
+                byte = (uint8_t) ((byte << 1) | (q > 0));
+            }
+            frame[n * channels + ch] = byte;
+        }
+
+        // keep the oscillator on the unit circle
+        scale = 1.0 / sqrt(g->re * g->re + g->im * g->im);
+        g->re *= scale;
+        g->im *= scale;
+    }
+}
+
+/* DST encoder */
+
+static int popcount64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+// least squares prediction filter of a channel (Levinson-Durbin on the autocorrelation)
+static void fit_filter(dst_encoder_t *enc, const uint8_t *frame, int ch)
+{
+    uint64_t words[DST_BITS_PER_CH / 64];
+    double   r[DST_ORDER + 1], a[DST_ORDER + 1], prev[DST_ORDER + 1];
+    double   error, largest = 0.0;
+    int      channels = enc->channels;
+    int      i, j, k, t;
+
+    // the samples of the channel packed, the first sample in the MSB
+    for (i = 0; i < DST_BITS_PER_CH / 64; i++)
+    {
+        uint64_t w = 0;
+
+        for (j = 0; j < 8; j++)
+            w = (w << 8) | frame[(i * 8 + j) * channels + ch];
+        words[i] = w;
+    }
+
+    // x[n] * x[n - k] is 1 for equal bits and -1 otherwise
+    for (k = 0; k <= DST_ORDER; k++)
+    {
+        int differ = 0;
+
+        for (i = 1; i < DST_BITS_PER_CH / 64; i++)
+        {
+            uint64_t delayed = k == 0 ? words[i] : (words[i] >> k) | (words[i - 1] << (64 - k));
+
+            differ += popcount64(words[i] ^ delayed);
+        }
+        r[k] = (double) (DST_BITS_PER_CH - 64) - 2.0 * differ;
+    }
+
+    memset(a, 0, sizeof(a));
+    error = r[0];
+    for (i = 1; i <= DST_ORDER && error > r[0] * 1e-9; i++)
+    {
+        double reflection = r[i];
+
+        for (j = 1; j < i; j++)
+            reflection -= a[j] * r[i - j];
+        reflection /= error;
+
+        memcpy(prev, a, sizeof(a));
+        a[i] = reflection;
+        for (j = 1; j < i; j++)
+            a[j] = prev[j] - reflection * prev[i - j];
+        error *= 1.0 - reflection * reflection;
+    }
+
+    // 9 bit coefficients, the largest one at full scale
+    for (i = 1; i <= DST_ORDER; i++)
+        largest = max(largest, fabs(a[i]));
+    for (i = 0; i < DST_ORDER; i++)
+    {
+        long c = largest > 0.0 ? lrint(a[i + 1] * 255.0 / largest) : 0;
+
+        enc->coef[ch][i] = (int16_t) min(max(c, -256), 255);
+    }
+
+    // the per byte lookup tables of the decoder, bit j of byte t is the sample t * 8 + j + 1 back
+    for (t = 0; t < DST_ORDER / 8; t++)
+    {
+        for (i = 0; i < 256; i++)
+        {
+            int value = 0;
+
+            for (j = 0; j < 8; j++)
+                value += (((i >> j) & 1) * 2 - 1) * enc->coef[ch][t * 8 + j];
+            enc->table[ch][t][i] = (int16_t) value;
+        }
+    }
+}
+
+static void ac_encode(dst_encoder_t *enc, uint32_t *a, uint32_t *low, int bit, int p)
+{
+    uint32_t ap = ((*a >> 8) | ((*a >> 7) & 1)) * (uint32_t) p;
+    uint32_t h = *a - ap;
+
+    if (bit == 0)
+    {
+        *low += h;
+        *a = ap;
+    }
+    else
+    {
+        *a = h;
+    }
+
+    if (*low >= AC_ONE)
+    {
+        int i = enc->ac_size - 1;
+
+        // carry into the bits already written, never beyond the leading 0
+        *low -= AC_ONE;
+        while (enc->ac_bits[i] == 1)
+            enc->ac_bits[i--] = 0;
+        enc->ac_bits[i] = 1;
+    }
+
+    while (*a < AC_HALF)
+    {
+        *a <<= 1;
+        enc->ac_bits[enc->ac_size++] = (uint8_t) ((*low >> (AC_ABITS - 1)) & 1);
+        *low = (*low << 1) & (AC_ONE - 1);
+    }
+}
+
+static void put_bits(uint8_t *out, int *pos, uint32_t value, int count)
+{
+    while (count-- > 0)
+    {
+        if ((*pos & 7) == 0)
+            out[*pos >> 3] = 0;
+        if ((value >> count) & 1)
+            out[*pos >> 3] |= (uint8_t) (0x80 >> (*pos & 7));
+        (*pos)++;
+    }
+}
+
+static int log2_round_up(int x)
+{
+    int y = 0;
+
+    while (x >= (1 << y))
+        y++;
+    return y;
+}
+
+static int dst_encoder_init(dst_encoder_t *enc, int channels)
+{
+    memset(enc, 0, sizeof(dst_encoder_t));
+    enc->channels = channels;
+    enc->residual = (uint8_t *) malloc(DST_BITS_PER_CH * channels);
+    enc->index = (uint8_t *) malloc(DST_BITS_PER_CH * channels);
+    // at most 9 renormalizations per coded bit (p = 1)
+    enc->ac_bits = (uint8_t *) malloc((size_t) DST_BITS_PER_CH * channels * 9 + 64);
+    if (!enc->residual || !enc->index || !enc->ac_bits)
+        return -1;
+
+    if (opts.verify)
+    {
+        enc->verify = (ebunch *) malloc(sizeof(ebunch));
+        if (!enc->verify || DST_InitDecoder(enc->verify, channels, 64) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void dst_encoder_close(dst_encoder_t *enc)
+{
+    if (enc->verify)
+    {
+        DST_CloseDecoder(enc->verify);
+        free(enc->verify);
+    }
+    free(enc->residual);
+    free(enc->index);
+    free(enc->ac_bits);
+}
+
+// returns the size of the DST frame in out, 1 + FRAME_SIZE_64 * channels if stored uncompressed
+static int dst_encode_frame(dst_encoder_t *enc, const uint8_t *frame, uint8_t *out)
+{
+    uint32_t counts[MAX_CHANNEL_COUNT][DST_PTABLE_LEN][2];
+    uint64_t history[MAX_CHANNEL_COUNT];
+    int      channels = enc->channels;
+    int      raw_size = 1 + FRAME_SIZE_64 * channels;
+    int      ch, bit_nr, i, pos = 0;
+    uint32_t a, low;
+    uint8_t *residual = enc->residual, *index = enc->index;
+
+    memset(counts, 0, sizeof(counts));
+    for (ch = 0; ch < channels; ch++)
+    {
+        fit_filter(enc, frame, ch);
+        history[ch] = 0xaaaaaaaaaaaaaaaaULL;     // the initial filter status of the decoder
+    }
+
+    // the residuals and their Ptable entries
+    for (bit_nr = 0; bit_nr < DST_BITS_PER_CH; bit_nr++)
+    {
+        for (ch = 0; ch < channels; ch++)
+        {
+            int16_t predict = 0;
+            int     bit, entry;
+
+            for (i = 0; i < DST_ORDER / 8; i++)
+                predict = (int16_t) (predict + enc->table[ch][i][(history[ch] >> (i * 8)) & 0xff]);
+
+            bit = (frame[(bit_nr / 8) * channels + ch] >> (7 - bit_nr % 8)) & 1;
+            entry = min(abs(predict) >> 3, DST_PTABLE_LEN - 1);
+
+            *residual = (uint8_t) (bit ^ (predict < 0));
+            *index = (uint8_t) entry;
+            counts[ch][entry][*residual]++;
+            residual++;
+            index++;
+
+            history[ch] = (history[ch] << 1) | (uint64_t) bit;
+        }
+    }
+
+    // P(residual == 0) in 1/256, at most one half
+    for (ch = 0; ch < channels; ch++)
+    {
+        enc->ptable_len[ch] = 2;
+        for (i = 0; i < DST_PTABLE_LEN; i++)
+        {
+            uint32_t total = counts[ch][i][0] + counts[ch][i][1];
+
+            if (total > 0)
+                enc->ptable_len[ch] = max(enc->ptable_len[ch], i + 1);
+            enc->ptable[ch][i] = (int) min(max(((uint64_t) counts[ch][i][0] * 512 + total + 1) / (2 * (uint64_t) total + 2), 1), 128);
+        }
+    }
+
+    // frame header: one segment, a filter and a Ptable per channel
+    put_bits(out, &pos, 1, 1);                  // DSTCoded
+    put_bits(out, &pos, 1, 1);                  // PSameSegAsF
+    put_bits(out, &pos, 1, 1);                  // FSameSegAllCh
+    put_bits(out, &pos, 1, 1);                  // EndOfChannel
+    put_bits(out, &pos, 1, 1);                  // PSameMapAsF
+    put_bits(out, &pos, channels == 1, 1);      // FSameMapAllCh
+    for (ch = 1; ch < channels; ch++)
+        put_bits(out, &pos, ch, log2_round_up(ch));
+    for (ch = 0; ch < channels; ch++)
+        put_bits(out, &pos, 0, 1);              // HalfProb
+    for (ch = 0; ch < channels; ch++)
+    {
+        put_bits(out, &pos, DST_ORDER - 1, 7);
+        put_bits(out, &pos, 0, 1);              // not Rice coded
+        for (i = 0; i < DST_ORDER; i++)
+            put_bits(out, &pos, (uint32_t) enc->coef[ch][i] & 0x1ff, 9);
+    }
+    for (ch = 0; ch < channels; ch++)
+    {
+        put_bits(out, &pos, enc->ptable_len[ch] - 1, 6);
+        put_bits(out, &pos, 0, 1);              // not Rice coded
+        for (i = 0; i < enc->ptable_len[ch]; i++)
+            put_bits(out, &pos, enc->ptable[ch][i] - 1, 7);
+    }
+
+    // arithmetic code, the first bit is always 0
+    enc->ac_bits[0] = 0;
+    enc->ac_size = 1;
+    a = AC_ONE - 1;
+    low = 0;
+    {
+        int c = (enc->coef[0][0] + (1 << 9)) & 127, reversed = 0;
+
+        for (i = 0; i < 7; i++)
+            reversed |= ((c >> i) & 1) << (6 - i);
+        ac_encode(enc, &a, &low, 0, reversed + 1);
+    }
+    residual = enc->residual;
+    index = enc->index;
+    for (bit_nr = 0; bit_nr < DST_BITS_PER_CH; bit_nr++)
+    {
+        for (ch = 0; ch < channels; ch++)
+        {
+            ac_encode(enc, &a, &low, *residual, enc->ptable[ch][min(*index, enc->ptable_len[ch] - 1)]);
+            residual++;
+            index++;
+        }
+    }
+    for (i = AC_ABITS - 1; i >= 0; i--)
+        enc->ac_bits[enc->ac_size++] = (uint8_t) ((low >> i) & 1);
+
+    if ((pos + enc->ac_size + 7) / 8 >= raw_size)
+    {
+        out[0] = 0;                             // DSTCoded = 0, stuffing 0
+        memcpy(out + 1, frame, FRAME_SIZE_64 * channels);
+        return raw_size;
+    }
+
+    for (i = 0; i < enc->ac_size; i++)
+        put_bits(out, &pos, enc->ac_bits[i], 1);
+    return (pos + 7) / 8;
+}
+
+static int dst_verify_frame(dst_encoder_t *enc, uint8_t *dst, int size, const uint8_t *frame, uint32_t frame_nr)
+{
+    uint8_t decoded[FRAME_SIZE_64 * MAX_CHANNEL_COUNT];
+    int     error;
+
+    error = DST_FramDSTDecode(dst, decoded, size, (int) frame_nr, enc->verify);
+    if (error != 0 || memcmp(decoded, frame, FRAME_SIZE_64 * enc->channels) != 0)
+    {
+        fwprintf(stderr, L"DST frame %u does not decode to its input: %s\n", frame_nr, DST_GetErrorMessage(error));
+        return -1;
+    }
+    return 0;
+}
+
+/* audio sectors */
+
+static int sector_free(sector_writer_t *w)
+{
+    return SACD_LSN_SIZE - (int) AUDIO_SECTOR_HEADER_SIZE - w->packet_count * (int) AUDIO_PACKET_INFO_SIZE -
+           w->frame_count * (w->dst ? 4 : 3) - w->data_size;
+}
+
+static void add_packet(sector_writer_t *w, int data_type, int frame_start, const uint8_t *data, int length)
+{
+    uint8_t *info = w->packet_info[w->packet_count++];
+
+    info[0] = (uint8_t) ((frame_start << 7) | (data_type << 3) | (length >> 8));
+    info[1] = (uint8_t) (length & 0xff);
+    if (data)
+        memcpy(w->data + w->data_size, data, length);
+    else
+        memset(w->data + w->data_size, 0, length);
+    w->data_size += length;
+}
+
+static int flush_sector(sector_writer_t *w)
+{
+    uint8_t  sector[SACD_LSN_SIZE];
+    uint8_t *p = sector;
+    int      i, free_size = sector_free(w);
+
+    if (w->packet_count < 7 && free_size > (int) AUDIO_PACKET_INFO_SIZE)
+        add_packet(w, DATA_TYPE_PADDING, 0, NULL, min(free_size - (int) AUDIO_PACKET_INFO_SIZE, MAX_PACKET_SIZE));
+
+    memset(sector, 0, sizeof(sector));
+    *p++ = (uint8_t) ((w->packet_count << 5) | (w->frame_count << 2) | w->dst);
+    for (i = 0; i < w->packet_count; i++, p += AUDIO_PACKET_INFO_SIZE)
+        memcpy(p, w->packet_info[i], AUDIO_PACKET_INFO_SIZE);
+    for (i = 0; i < w->frame_count; i++, p += w->dst ? 4 : 3)
+        memcpy(p, w->frame_info[i], w->dst ? 4 : 3);
+    memcpy(p, w->data, w->data_size);
+
+    if (fwrite(sector, SACD_LSN_SIZE, 1, w->fd) != 1)
+        return -1;
+
+    w->lsn++;
+    w->packet_count = 0;
+    w->frame_count = 0;
+    w->data_size = 0;
+    return 0;
+}
+
+// the packets a frame is split into when it's added now, one per sector
+static int count_packets(sector_writer_t *w, int size)
+{
+    int packets = 0, packet_count = w->packet_count, frame_count = w->frame_count;
+    int free_size = sector_free(w);
+
+    while (size > 0)
+    {
+        int need = (int) AUDIO_PACKET_INFO_SIZE + (packets == 0 ? (w->dst ? 4 : 3) : 0);
+        int length;
+
+        if (packet_count == 7 || (packets == 0 && frame_count == 7) || free_size < need + 1)
+        {
+            packet_count = 0;
+            frame_count = 0;
+            free_size = SACD_LSN_SIZE - (int) AUDIO_SECTOR_HEADER_SIZE;
+        }
+        length = min(min(size, free_size - need), MAX_PACKET_SIZE);
+        size -= length;
+        free_size -= need + length;
+        packet_count++;
+        frame_count += packets == 0;
+        packets++;
+    }
+    return packets;
+}
+
+// adds a frame, start_lsn / end_lsn get the sectors of its first and last packet
+static int add_frame(sector_writer_t *w, const uint8_t *data, int size, uint32_t timecode, int channels,
+                     uint32_t *start_lsn, uint32_t *end_lsn)
+{
+    int sector_count = w->dst ? count_packets(w, size) : 0;
+    int offset = 0;
+
+    while (offset < size)
+    {
+        int first = offset == 0;
+        int need = (int) AUDIO_PACKET_INFO_SIZE + (first ? (w->dst ? 4 : 3) : 0);
+        int length;
+
+        if (w->packet_count == 7 || (first && w->frame_count == 7) || sector_free(w) < need + 1)
+        {
+            if (flush_sector(w) != 0)
+                return -1;
+        }
+
+        if (first)
+        {
+            uint8_t *info = w->frame_info[w->frame_count++];
+
+            info[0] = (uint8_t) (timecode / (60 * SACD_FRAME_RATE));
+            info[1] = (uint8_t) (timecode / SACD_FRAME_RATE % 60);
+            info[2] = (uint8_t) (timecode % SACD_FRAME_RATE);
+            info[3] = (uint8_t) ((sector_count << 2) | (channels == 6 ? 2 : channels == 5 ? 1 : 0));
+            *start_lsn = w->lsn;
+        }
+
+        length = min(min(size - offset, sector_free(w) - (int) AUDIO_PACKET_INFO_SIZE), MAX_PACKET_SIZE);
+        add_packet(w, DATA_TYPE_AUDIO, first, data + offset, length);
+        offset += length;
+    }
+    *end_lsn = w->lsn;
+    return 0;
+}
+
+static int write_audio(FILE *fd, area_t *area)
+{
+    channel_gen_t   gen[MAX_CHANNEL_COUNT];
+    dst_encoder_t   enc;
+    sector_writer_t w;
+    uint8_t        *frame, *dst = NULL;
+    uint32_t        timecode = 0, group_lsn;
+    int             dst_coded = area->frame_format == FRAME_FORMAT_DST;
+    int             period = area->frame_format == FRAME_FORMAT_DSD_3_IN_16 ? 16 : 14;
+    int             track, result = -1;
+
+    frame = (uint8_t *) malloc(FRAME_SIZE_64 * area->channels);
+    if (!frame)
+        return -1;
+    if (dst_coded)
+    {
+        dst = (uint8_t *) malloc(MAX_DST_SIZE);
+        if (!dst || dst_encoder_init(&enc, area->channels) != 0)
+        {
+            fwprintf(stderr, L"out of memory\n");
+            free(dst);
+            free(frame);
+            return -1;
+        }
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.fd = fd;
+    w.dst = dst_coded;
+    w.lsn = area->track_start;
+    group_lsn = w.lsn;
+    if (fseeko(fd, (off_t) w.lsn * SACD_LSN_SIZE, SEEK_SET) != 0)
+        goto error;
+
+    init_channels(gen, area->channels);
+    for (track = 0; track < opts.track_count; track++)
+    {
+        int pause = track > 0 ? opts.pause_frames : 0;
+        uint32_t i, frames = (uint32_t) (pause + opts.track_frames), start_lsn = 0, end_lsn = 0;
+
+        set_tone(gen, area->channels, track);
+        area->track_start_frame[track] = timecode + (uint32_t) pause;
+        area->track_frames[track] = (uint32_t) opts.track_frames;
+
+        for (i = 0; i < frames; i++, timecode++)
+        {
+            const uint8_t *data = frame;
+            int size = FRAME_SIZE_64 * area->channels;
+
+            generate_frame(gen, area->channels, i < (uint32_t) pause, frame);
+            if (dst_coded)
+            {
+                size = dst_encode_frame(&enc, frame, dst);
+                if (opts.verify && dst_verify_frame(&enc, dst, size, frame, timecode) != 0)
+                    goto error;
+                area->coded_frames += size < 1 + FRAME_SIZE_64 * area->channels;
+                data = dst;
+            }
+
+            if (add_frame(&w, data, size, timecode, area->channels, &start_lsn, &end_lsn) != 0)
+                goto error;
+            area->audio_bytes += (uint64_t) size;
+            if (i == 0)
+                area->track_start_lsn[track] = start_lsn;
+            area->track_end_lsn[track] = end_lsn;
+
+            // plain DSD: every 3 frames fill a fixed number of sectors
+            if (!dst_coded && timecode % 3 == 2)
+            {
+                if (flush_sector(&w) != 0)
+                    goto error;
+                while (w.lsn < group_lsn + (uint32_t) period)
+                {
+                    if (flush_sector(&w) != 0)
+                        goto error;
+                }
+                if (w.lsn != group_lsn + (uint32_t) period)
+                {
+                    fwprintf(stderr, L"3 frames don't fit in %d sectors\n", period);
+                    goto error;
+                }
+                group_lsn = w.lsn;
+            }
+        }
+    }
+
+    if (w.packet_count > 0 && flush_sector(&w) != 0)
+        goto error;
+    while (!dst_coded && w.lsn != group_lsn && w.lsn < group_lsn + (uint32_t) period)
+    {
+        if (flush_sector(&w) != 0)
+            goto error;
+    }
+
+    area->total_frames = timecode;
+    area->track_end = w.lsn - 1;
+    result = 0;
+
+error:
+    if (result != 0)
+        fwprintf(stderr, L"can't write the audio of the %d channel area\n", area->channels);
+    if (dst_coded)
+        dst_encoder_close(&enc);
+    free(dst);
+    free(frame);
+    return result;
+}
+
+/* TOCs */
+
+static int put_text(uint8_t *base, int *pos, int limit, const char *text)
+{
+    int start = *pos, length = (int) strlen(text) + 1;
+
+    if (start + length > limit)
+        return 0;
+    memcpy(base + start, text, length);
+    *pos = (start + length + 3) & ~3;
+    return start;
+}
+
+static int track_text(uint8_t *text, int track_count)
+{
+    int pos, track;
+
+    memset(text, 0, MAX_TRACK_TEXT_SIZE);
+    memcpy(text, "SACDTTxt", 8);
+    pos = (8 + 2 * track_count + 3) & ~3;
+
+    for (track = 0; track < track_count; track++)
+    {
+        char title[32];
+        int  items = pos;
+
+        if (pos + 4 > MAX_TRACK_TEXT_SIZE)
+            return -1;
+        put_be16(text + 8 + 2 * track, (uint16_t) pos);
+        text[items] = 2;                        // N_Items
+        pos += 4;
+
+        snprintf(title, sizeof(title), "Track %d", track + 1);
+        if (pos + 2 > MAX_TRACK_TEXT_SIZE)
+            return -1;
+        text[pos++] = TRACK_TYPE_TITLE;
+        text[pos++] = 0x20;
+        if (put_text(text, &pos, MAX_TRACK_TEXT_SIZE, title) == 0)
+            return -1;
+
+        if (pos + 2 > MAX_TRACK_TEXT_SIZE)
+            return -1;
+        text[pos++] = TRACK_TYPE_PERFORMER;
+        text[pos++] = 0x20;
+        if (put_text(text, &pos, MAX_TRACK_TEXT_SIZE, "sacd_gen") == 0)
+            return -1;
+    }
+    return (pos + SACD_LSN_SIZE - 1) / SACD_LSN_SIZE;
+}
+
+static void set_time(area_tracklist_time_t *time, uint32_t frames)
+{
+    time->minutes = (uint8_t) (frames / (60 * SACD_FRAME_RATE));
+    time->seconds = (uint8_t) (frames / SACD_FRAME_RATE % 60);
+    time->frames = (uint8_t) (frames % SACD_FRAME_RATE);
+}
+
+static int area_toc_size(area_t *area)
+{
+    uint8_t *text = (uint8_t *) malloc(MAX_TRACK_TEXT_SIZE);
+    int      text_sectors;
+
+    if (!text)
+        return -1;
+    text_sectors = track_text(text, opts.track_count);
+    free(text);
+    if (text_sectors < 0)
+        return -1;
+
+    // Area_TOC_0, Track_List_1, Track_List_2, ISRC_and_Genre_List, Access_List (DST only), Track_Text
+    return 1 + 1 + 1 + 2 + (area->frame_format == FRAME_FORMAT_DST ? ACCESS_LIST_SIZE : 0) + text_sectors;
+}
+
+static int write_area_toc(FILE *fd, area_t *area)
+{
+    uint8_t                 *data, *text, *p;
+    area_toc_t              *toc;
+    area_tracklist_offset_t *list_1;
+    area_tracklist_t        *list_2;
+    int                      i, pos, text_offset, result;
+
+    data = (uint8_t *) calloc(area->toc_size, SACD_LSN_SIZE);
+    if (!data)
+        return -1;
+
+    toc = (area_toc_t *) data;
+    memcpy(toc->id, area->channels == 2 ? "TWOCHTOC" : "MULCHTOC", 8);
+    toc->version.major = SUPPORTED_VERSION_MAJOR;
+    toc->version.minor = SUPPORTED_VERSION_MINOR;
+    put_be16(&toc->size, (uint16_t) area->toc_size);
+    put_be32(&toc->max_byte_rate, (uint32_t) (FRAME_SIZE_64 * area->channels * SACD_FRAME_RATE));
+    toc->sample_frequency = 4;
+    toc->frame_format = (uint8_t) area->frame_format;
+    toc->channel_count = (uint8_t) area->channels;
+    // the readers here take the configuration from the extra settings bits
+    toc->extra_settings = (uint8_t) (area->channels == 6 ? 4 : area->channels == 5 ? 3 : 0);
+    toc->max_available_channels = (uint8_t) area->channels;
+    toc->total_playtime.minutes = (uint8_t) (area->total_frames / (60 * SACD_FRAME_RATE));
+    toc->total_playtime.seconds = (uint8_t) (area->total_frames / SACD_FRAME_RATE % 60);
+    toc->total_playtime.frames = (uint8_t) (area->total_frames % SACD_FRAME_RATE);
+    toc->track_count = (uint8_t) opts.track_count;
+    put_be32(&toc->track_start, area->track_start);
+    put_be32(&toc->track_end, area->track_end);
+    toc->text_area_count = 1;
+    memcpy(toc->languages[0].language_code, "en", 2);
+    toc->languages[0].character_set = CHAR_SET_ISO8859_1;
+
+    text_offset = area->frame_format == FRAME_FORMAT_DST ? 5 + ACCESS_LIST_SIZE : 5;
+    put_be16(&toc->track_text_offset, (uint16_t) text_offset);
+    if (area->frame_format == FRAME_FORMAT_DST)
+        put_be16(&toc->access_list_offset, 5);
+
+    pos = AREA_TEXT_OFFSET;
+    put_be16(&toc->area_description_offset, (uint16_t) put_text(data, &pos, SACD_LSN_SIZE,
+             area->channels == 2 ? "Synthetic stereo area" : "Synthetic multichannel area"));
+    put_be16(&toc->copyright_offset, (uint16_t) put_text(data, &pos, SACD_LSN_SIZE, "No copyright"));
+
+    p = data + SACD_LSN_SIZE;
+    list_1 = (area_tracklist_offset_t *) p;
+    list_2 = (area_tracklist_t *) (p + SACD_LSN_SIZE);
+    memcpy(list_1->id, "SACDTRL1", 8);
+    memcpy(list_2->id, "SACDTRL2", 8);
+    for (i = 0; i < opts.track_count; i++)
+    {
+        put_be32(&list_1->track_start_lsn[i], area->track_start_lsn[i]);
+        put_be32(&list_1->track_length_lsn[i], area->track_end_lsn[i] - area->track_start_lsn[i] + 1);
+        set_time(&list_2->start[i], area->track_start_frame[i]);
+        set_time(&list_2->duration[i], area->track_frames[i]);
+    }
+    memcpy(p + 2 * SACD_LSN_SIZE, "SACD_IGL", 8);
+    if (area->frame_format == FRAME_FORMAT_DST)
+        memcpy(p + 4 * SACD_LSN_SIZE, "SACD_ACC", 8);       // no entries, nothing reads it
+
+    text = (uint8_t *) malloc(MAX_TRACK_TEXT_SIZE);
+    if (!text || track_text(text, opts.track_count) < 0)
+    {
+        free(text);
+        free(data);
+        return -1;
+    }
+    memcpy(data + text_offset * SACD_LSN_SIZE, text, (area->toc_size - text_offset) * SACD_LSN_SIZE);
+    free(text);
+
+    result = write_sectors(fd, area->toc_1_start, data, area->toc_size);
+    if (result == 0)
+        result = write_sectors(fd, area->toc_2_start, data, area->toc_size);
+    free(data);
+    return result;
+}
+
+static int write_master_toc(FILE *fd, area_t *stereo, area_t *mulch)
+{
+    uint8_t             data[MASTER_TOC_LEN * SACD_LSN_SIZE];
+    master_toc_t       *toc = (master_toc_t *) data;
+    master_sacd_text_t *text;
+    int                 i, pos;
+
+    memset(data, 0, sizeof(data));
+    memcpy(toc->id, "SACDMTOC", 8);
+    toc->version.major = SUPPORTED_VERSION_MAJOR;
+    toc->version.minor = SUPPORTED_VERSION_MINOR;
+    put_be16(&toc->album_set_size, 1);
+    put_be16(&toc->album_sequence_number, 1);
+    memcpy(toc->album_catalog_number, "SACDGEN         ", 16);
+    memcpy(toc->disc_catalog_number, "SACDGEN         ", 16);
+    if (stereo)
+    {
+        put_be32(&toc->area_1_toc_1_start, stereo->toc_1_start);
+        put_be32(&toc->area_1_toc_2_start, stereo->toc_2_start);
+        put_be16(&toc->area_1_toc_size, (uint16_t) stereo->toc_size);
+    }
+    if (mulch)
+    {
+        put_be32(&toc->area_2_toc_1_start, mulch->toc_1_start);
+        put_be32(&toc->area_2_toc_2_start, mulch->toc_2_start);
+        put_be16(&toc->area_2_toc_size, (uint16_t) mulch->toc_size);
+    }
+    toc->text_area_count = 1;
+    memcpy(toc->locales[0].language_code, "en", 2);
+    toc->locales[0].character_set = CHAR_SET_ISO8859_1;
+
+    // the text of all 8 text channels is there, only the first one is used
+    for (i = 0; i < MAX_LANGUAGE_COUNT; i++)
+        memcpy(data + (1 + i) * SACD_LSN_SIZE, "SACDText", 8);
+    text = (master_sacd_text_t *) (data + SACD_LSN_SIZE);
+    pos = 64;
+    put_be16(&text->album_title_position, (uint16_t) put_text((uint8_t *) text, &pos, SACD_LSN_SIZE, "Synthetic SACD"));
+    put_be16(&text->album_artist_position, (uint16_t) put_text((uint8_t *) text, &pos, SACD_LSN_SIZE, "sacd_gen"));
+    put_be16(&text->disc_title_position, (uint16_t) put_text((uint8_t *) text, &pos, SACD_LSN_SIZE, "Synthetic SACD"));
+    put_be16(&text->disc_artist_position, (uint16_t) put_text((uint8_t *) text, &pos, SACD_LSN_SIZE, "sacd_gen"));
+    memcpy(data + 9 * SACD_LSN_SIZE, "SACD_Man", 8);
+
+    // Master_TOC and its two copies
+    for (i = 0; i < 3; i++)
+    {
+        if (write_sectors(fd, START_OF_MASTER_TOC + i * MASTER_TOC_LEN, data, MASTER_TOC_LEN) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int write_area(FILE *fd, area_t *area, uint32_t *lsn)
+{
+    area->toc_size = area_toc_size(area);
+    if (area->toc_size < 0 || area->toc_size > MAX_AREA_TOC_SIZE_LSN)
+    {
+        fwprintf(stderr, L"the track text doesn't fit in the area TOC\n");
+        return -1;
+    }
+
+    // Area_TOC_1, the track area, Area_TOC_2
+    area->toc_1_start = *lsn;
+    area->track_start = area->toc_1_start + (uint32_t) area->toc_size;
+    if (write_audio(fd, area) != 0)
+        return -1;
+    area->toc_2_start = area->track_end + 1;
+    if (write_area_toc(fd, area) != 0)
+        return -1;
+    *lsn = area->toc_2_start + (uint32_t) area->toc_size;
+
+    fwprintf(stdout, L"%ls area: %d channels, %ls, %u frames, sectors %u - %u",
+             area->channels == 2 ? L"stereo" : L"multichannel", area->channels,
+             area->frame_format == FRAME_FORMAT_DST ? L"DST" :
+             area->frame_format == FRAME_FORMAT_DSD_3_IN_16 ? L"DSD 3 in 16" : L"DSD 3 in 14",
+             area->total_frames, area->toc_1_start, *lsn - 1);
+    if (area->frame_format == FRAME_FORMAT_DST)
+    {
+        fwprintf(stdout, L", %u of %u frames coded, %.1f%% of the DSD size", area->coded_frames, area->total_frames,
+                 100.0 * area->audio_bytes / ((double) area->total_frames * FRAME_SIZE_64 * area->channels));
+    }
+    fwprintf(stdout, L"\n");
+    return 0;
+}
+
+static void print_usage(const char *program_name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] image.iso\n"
+        "Options:\n"
+        "  -t N       : tracks per area, 1..255 (default 3)\n"
+        "  -d SECONDS : length of every track (default 10)\n"
+        "  -2 FORMAT  : stereo area as dsd14, dsd16, dst or none (default dsd14)\n"
+        "  -m N       : add a multichannel area of 5 or 6 DST channels\n"
+        "  -c CONTENT : tone, noise or random (incompressible) (default tone)\n"
+        "  -s SEED    : seed of the noise and the dither (default 1)\n"
+        "  -p FRAMES  : pause in front of every track but the first (default 0)\n"
+        "  -V         : decode every DST frame again and compare\n",
+        program_name);
+}
+
+int main(int argc, char *argv[])
+{
+    area_t *stereo = NULL, *mulch = NULL;
+    FILE   *fd;
+    uint32_t lsn = AREA_TOC_1_START;
+    int     opt, result = 0;
+
+    opts.track_count = 3;
+    opts.track_frames = 10 * SACD_FRAME_RATE;
+    opts.stereo_format = FRAME_FORMAT_DSD_3_IN_14;
+    opts.seed = 1;
+
+    while ((opt = getopt(argc, argv, "t:d:2:m:c:s:p:Vh")) >= 0)
+    {
+        switch (opt)
+        {
+        case 't':
+            opts.track_count = atoi(optarg);
+            break;
+        case 'd':
+            opts.track_frames = (int) (atof(optarg) * SACD_FRAME_RATE + 0.5);
+            break;
+        case '2':
+            if (strcmp(optarg, "dsd14") == 0)
+                opts.stereo_format = FRAME_FORMAT_DSD_3_IN_14;
+            else if (strcmp(optarg, "dsd16") == 0)
+                opts.stereo_format = FRAME_FORMAT_DSD_3_IN_16;
+            else if (strcmp(optarg, "dst") == 0)
+                opts.stereo_format = FRAME_FORMAT_DST;
+            else if (strcmp(optarg, "none") == 0)
+                opts.stereo_format = -1;
+            else
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'm':
+            opts.mulch_channels = atoi(optarg);
+            break;
+        case 'c':
+            if (strcmp(optarg, "tone") == 0)
+                opts.content = CONTENT_TONE;
+            else if (strcmp(optarg, "noise") == 0)
+                opts.content = CONTENT_NOISE;
+            else if (strcmp(optarg, "random") == 0)
+                opts.content = CONTENT_RANDOM;
+            else
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+            opts.seed = (uint32_t) strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            opts.pause_frames = max(0, atoi(optarg));
+            break;
+        case 'V':
+            opts.verify = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || opts.track_count < 1 || opts.track_count > 255 || opts.track_frames < 1 ||
+        (opts.mulch_channels != 0 && opts.mulch_channels != 5 && opts.mulch_channels != 6) ||
+        (opts.stereo_format < 0 && opts.mulch_channels == 0))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    opts.output = argv[optind];
+
+    setlocale(LC_ALL, "");
+    if (fwide(stdout, 1) < 0)
+    {
+        fprintf(stderr, "ERROR: Output not set to wide.\n");
+    }
+
+    fd = fopen(opts.output, "wb");
+    if (!fd)
+    {
+        fwprintf(stderr, L"can't create %s\n", opts.output);
+        return 1;
+    }
+
+    if (opts.stereo_format >= 0)
+    {
+        stereo = (area_t *) calloc(1, sizeof(area_t));
+        if (!stereo)
+            result = -1;
+        else
+        {
+            stereo->channels = 2;
+            stereo->frame_format = opts.stereo_format;
+            result = write_area(fd, stereo, &lsn);
+        }
+    }
+    if (result == 0 && opts.mulch_channels)
+    {
+        mulch = (area_t *) calloc(1, sizeof(area_t));
+        if (!mulch)
+            result = -1;
+        else
+        {
+            mulch->channels = opts.mulch_channels;
+            mulch->frame_format = FRAME_FORMAT_DST;
+            result = write_area(fd, mulch, &lsn);
+        }
+    }
+    if (result == 0)
+        result = write_master_toc(fd, stereo, mulch);
+
+    if (fclose(fd) != 0)
+        result = -1;
+    if (result != 0)
+        fwprintf(stderr, L"writing %s failed\n", opts.output);
+    else
+        fwprintf(stdout, L"%s: %u sectors\n", opts.output, lsn);
+
+    free(stereo);
+    free(mulch);
+    return result != 0 ? 1 : 0;
+}
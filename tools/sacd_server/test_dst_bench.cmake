@@ -0,0 +1,21 @@
+# Runs from ctest: writes a DST image with sacd_gen and decodes it with
+# dst_bench, which fails below MIN_FPS frames/s or on another checksum.
+#
+#   cmake -DSACD_GEN=... -DDST_BENCH=... -DIMAGE=... -DMIN_FPS=... -DCHECKSUM=... -P test_dst_bench.cmake
+
+execute_process(
+    COMMAND ${SACD_GEN} -t 2 -d 5 -2 dst -m none -c noise -s 1 ${IMAGE}
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "sacd_gen failed (${result})")
+endif()
+
+execute_process(
+    COMMAND ${DST_BENCH} -i ${IMAGE} -j 2 -r 1 -f ${MIN_FPS} -x ${CHECKSUM}
+    RESULT_VARIABLE result
+)
+file(REMOVE ${IMAGE})
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "dst_bench failed (${result})")
+endif()
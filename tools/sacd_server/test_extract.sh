@@ -0,0 +1,68 @@
+#!/bin/sh
+# Runs from ctest: extracts a generated DST image with sacd_extract in the
+# ways that have to give the same files: one track at a time and 4 tracks
+# at a time, from the image file and from a stream on stdin, and locally
+# and from sacd_server.
+#
+#   test_extract.sh sacd_gen sacd_server sacd_extract workdir port
+
+SACD_GEN=$1
+SACD_SERVER=$2
+SACD_EXTRACT=$3
+WORKDIR=$4
+PORT=$5
+IMAGE="$WORKDIR/extract_test.iso"
+JOBS_IMAGE="$IMAGE"
+
+rm -rf "$WORKDIR"
+mkdir -p "$WORKDIR" || exit 1
+# sacd_extract reads sacd_extract.cfg from the working directory, there is none here
+cd "$WORKDIR" || exit 1
+
+# one area, a stream can only give one
+"$SACD_GEN" -t 4 -d 6 -2 dst -m none -c noise -s 3 "$IMAGE" > /dev/null || exit 1
+
+"$SACD_SERVER" -p "$PORT" "$IMAGE" > /dev/null &
+SERVER=$!
+trap 'kill $SERVER 2> /dev/null; wait $SERVER; rm -rf "$WORKDIR"; [ "$JOBS_IMAGE" = "$IMAGE" ] || rm -f "$JOBS_IMAGE"' EXIT
+
+# on a spinning disk -j 4 runs one track at a time, a copy in memory doesn't
+if [ -d /dev/shm ] && [ -w /dev/shm ]; then
+    JOBS_IMAGE="/dev/shm/sacd_extract_test_$$.iso"
+    cp "$IMAGE" "$JOBS_IMAGE" || exit 1
+fi
+
+# extract NAME ARGS... extracts the stereo tracks as DSF into $WORKDIR/NAME
+extract()
+{
+    name=$1
+    shift
+    mkdir "$WORKDIR/$name" || return 1
+    "$SACD_EXTRACT" -2 -s -o "$WORKDIR/$name" "$@" > "$WORKDIR/$name.log" 2>&1 || { echo "FAILED: sacd_extract $*"; return 1; }
+}
+
+# same NAME OTHER, the two extractions wrote the same files
+same()
+{
+    diff -r "$WORKDIR/$1" "$WORKDIR/$2" > /dev/null || { echo "FAILED: $1 and $2 differ"; return 1; }
+    echo "$1 and $2: same files"
+}
+
+status=0
+extract file -i "$IMAGE" -j 1 || exit 1
+[ "$(find "$WORKDIR/file" -name '*.dsf' | wc -l)" -eq 4 ] || { echo "FAILED: expected 4 DSF files"; exit 1; }
+
+extract jobs -i "$JOBS_IMAGE" -j 4 && same file jobs || status=1
+grep -q "spinning disk" "$WORKDIR/jobs.log" && echo "note: -j 4 ran one track at a time, the image is on a spinning disk"
+extract stream -i - < "$IMAGE" && same file stream || status=1
+
+tries=0
+until "$SACD_EXTRACT" -P -i "127.0.0.1:$PORT" > /dev/null 2>&1; do
+    tries=$((tries + 1))
+    # gone when it could not listen on the port
+    kill -0 $SERVER 2> /dev/null && [ $tries -lt 50 ] || { echo "sacd_server did not start"; exit 1; }
+    sleep 0.1
+done
+extract network -i "127.0.0.1:$PORT" && same file network || status=1
+
+exit $status
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Runs from ctest: reads a generated image from sacd_server with 20 ms
+# latency per response, once with one request in flight and once with a
+# window of 8. The window has to hide most of the latency, for sector reads
+# and for frame requests alike.
+#
+#   test_latency.sh sacd_gen sacd_server sacd_bench image.iso port
+
+SACD_GEN=$1
+SACD_SERVER=$2
+SACD_BENCH=$3
+IMAGE=$4
+PORT=$5
+
+"$SACD_GEN" -t 2 -d 15 -2 dst -m none -c random -s 1 "$IMAGE" > /dev/null || exit 1
+
+"$SACD_SERVER" -p "$PORT" -l 20 "$IMAGE" > /dev/null &
+SERVER=$!
+trap 'kill $SERVER 2> /dev/null; wait $SERVER; rm -f "$IMAGE"' EXIT
+
+# the time of the reads, sacd_bench prints "N sectors in T s: R MB/s"
+bench()
+{
+    "$SACD_BENCH" -i "127.0.0.1:$PORT" "$@" | awk '/ sectors in / { print $4 }'
+}
+
+tries=0
+until "$SACD_BENCH" -i "127.0.0.1:$PORT" -n 1 > /dev/null 2>&1; do
+    tries=$((tries + 1))
+    # gone when it could not listen on the port
+    kill -0 $SERVER 2> /dev/null && [ $tries -lt 50 ] || { echo "sacd_server did not start"; exit 1; }
+    sleep 0.1
+done
+
+status=0
+for mode in "" "-f"; do
+    t1=$(bench -w 1 $mode)
+    t8=$(bench -w 8 $mode)
+    echo "sacd_bench $mode: ${t1} s at window 1, ${t8} s at window 8"
+    # 21 reads of 512 sectors take 0.45 s one by one, with 8 in flight about 0.07 s
+    awk -v t1="$t1" -v t8="$t8" 'BEGIN { exit !(t1 > 0 && t8 > 0 && t8 * 3 < t1) }' || { echo "FAILED: the window does not hide the latency"; status=1; }
+done
+
+exit $status